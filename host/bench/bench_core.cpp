@@ -0,0 +1,168 @@
+/**
+  ******************************************************************************
+  * @authors        : Tomas Gonzalez & Brian Morris
+  * @file           : bench_core.cpp
+  * @brief          : Microbenchmarks of LSU management, slot allocation and
+  *                   the radio frame paths, at fleet sizes from 10 to 10k
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 Tomas Gonzalez & Brian Morris
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  */
+
+/**
+ * Built with Google Benchmark when the host build finds it, see the README.
+ * The fleet benchmarks take the fleet size as their argument. The clock is
+ * the manual host clock, so timeouts and request holds are moved past
+ * without waiting.
+ */
+
+#include <benchmark/benchmark.h>
+#include <cstring>
+#include <vector>
+#include "hal_host.h"
+#include "LSUManager.h"
+#include "request_queue.h"
+#include "shard_router.h"
+#include "rylr998.h"
+#include "cu_comms.h"
+#include "esp_log.h"
+
+/* Defines ------------------------------------------------------------- */
+#define FLEET_MIN 10
+#define FLEET_MAX 10000
+#define TIMEOUT_STEP_US (LSU_TIMEOUT_US(TIME_PERIOD_MS) + LSU_TIMEOUT_PADDING_US + 1)
+#define REQUEST_HOLD_STEP_US 1000000  // Longer than the hold of get_request()
+
+/* Private functions --------------------------------------------------------- */
+static void fill_fleet(LSUManager& manager, int64_t count) {
+  for (int64_t i = 0; i < count; i++) {
+    manager.createLSU();
+  }
+}
+
+/* LSU management ------------------------------------------------------ */
+// Joins one more LSU into a fleet of the given size, slot planning included
+static void BM_CreateLSU(benchmark::State& state) {
+  LSUManager manager;
+  fill_fleet(manager, state.range(0));
+  for (auto _ : state) {
+    auto [lsu, created] = manager.createLSU();
+    benchmark::DoNotOptimize(created);
+    state.PauseTiming();
+    manager.removeLSU(lsu->getId());
+    state.ResumeTiming();
+  }
+}
+BENCHMARK(BM_CreateLSU)->RangeMultiplier(10)->Range(FLEET_MIN, FLEET_MAX);
+
+static void BM_KeepaliveLSU(benchmark::State& state) {
+  LSUManager manager;
+  fill_fleet(manager, state.range(0));
+  std::vector<LSUData> fleet = manager.getLsuSerializedData();
+  size_t next = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(manager.keepaliveLSU(fleet[next].id, -80, 7));
+    next = (next + 1) % fleet.size();
+  }
+}
+BENCHMARK(BM_KeepaliveLSU)->RangeMultiplier(10)->Range(FLEET_MIN, FLEET_MAX);
+
+// Every timeout of the fleet is due and every LSU is still alive, so each one is re-armed
+static void BM_ProcessTimeouts(benchmark::State& state) {
+  LSUManager manager;
+  fill_fleet(manager, state.range(0));
+  std::vector<LSUData> fleet = manager.getLsuSerializedData();
+  for (auto _ : state) {
+    state.PauseTiming();
+    hal_host_clock_advance(TIMEOUT_STEP_US);
+    for (const LSUData& lsu : fleet) {
+      manager.keepaliveLSU(lsu.id, -80, 7);
+    }
+    state.ResumeTiming();
+    manager.processTimeouts();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ProcessTimeouts)->RangeMultiplier(10)->Range(FLEET_MIN, FLEET_MAX);
+
+// What generateTimeSlot() does: collect the slots of the fleet and plan the next one
+static void BM_GenerateTimeSlot(benchmark::State& state) {
+  LSUManager manager;
+  fill_fleet(manager, state.range(0));
+  std::vector<LSUData> fleet = manager.getLsuSerializedData();
+  for (auto _ : state) {
+    std::vector<uint32_t> slots;
+    slots.reserve(fleet.size());
+    for (const LSUData& lsu : fleet) {
+      slots.push_back(lsu.timeSlotInPeriod);
+    }
+    benchmark::DoNotOptimize(lsu_plan_time_slot(slots, manager.getPeriodMs()));
+  }
+}
+BENCHMARK(BM_GenerateTimeSlot)->RangeMultiplier(10)->Range(FLEET_MIN, FLEET_MAX);
+
+static void BM_GetLsuSerializedData(benchmark::State& state) {
+  LSUManager manager;
+  fill_fleet(manager, state.range(0));
+  for (auto _ : state) {
+    std::vector<LSUData> fleet = manager.getLsuSerializedData();
+    benchmark::DoNotOptimize(fleet.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_GetLsuSerializedData)->RangeMultiplier(10)->Range(FLEET_MIN, FLEET_MAX);
+
+/* Radio frames -------------------------------------------------------- */
+static void BM_ParseLine(benchmark::State& state) {
+  static const char line[] = "+RCV=1234,10,DATA-T38.6,-45,9\r\n";
+  RYLR_response_t response;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(rylr998_parseLine(line, sizeof(line) - 1, &response));
+  }
+}
+BENCHMARK(BM_ParseLine);
+
+static void BM_CreateConfigPayload(benchmark::State& state) {
+  LSU_config_package_t config = {4321, TIME_PERIOD_MS, 37512, 45000, 9, 22, 915000000};
+  char payload[64];
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(create_config_payload(payload, sizeof(payload), &config));
+  }
+}
+BENCHMARK(BM_CreateConfigPayload);
+
+/* Request queue ------------------------------------------------------- */
+// A DATA request through its shard queue, the hold is skipped on the manual clock
+static void BM_PostGetRequest(benchmark::State& state) {
+  uint32_t hold_ms;
+  for (auto _ : state) {
+    post_request("DATA-T38.6", 1234, UART_PORT_MAIN, -80, 7, hal_time_us());
+    state.PauseTiming();
+    hal_host_clock_advance(REQUEST_HOLD_STEP_US);
+    state.ResumeTiming();
+    Request request;
+    benchmark::DoNotOptimize(get_request(shard_of(1234), &hold_ms, &request));
+  }
+}
+BENCHMARK(BM_PostGetRequest);
+
+/* Main ---------------------------------------------------------------- */
+int main(int argc, char **argv) {
+  esp_log_level_set("*", ESP_LOG_ERROR);
+  hal_host_clock_manual(1000000);
+  request_queue_init();
+
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
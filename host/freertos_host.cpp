@@ -0,0 +1,268 @@
+/**
+  ******************************************************************************
+  * @authors        : Tomas Gonzalez & Brian Morris
+  * @file           : freertos_host.cpp
+  * @brief          : FreeRTOS subset on std::thread, enough to run the CU
+  *                   tasks, queues, notifications and mutexes on Linux
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 Tomas Gonzalez & Brian Morris
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  */
+
+/* Includes ------------------------------------------------------------ */
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "hal_host.h"
+
+/* Private types ------------------------------------------------------- */
+struct HostTask {
+  std::string name;
+  std::mutex lock;
+  std::condition_variable notified;
+  uint32_t value = 0;
+  bool pending = false;
+};
+
+struct HostQueue {
+  std::mutex lock;
+  std::condition_variable changed;
+  std::vector<uint8_t> items;
+  size_t itemSize;
+  size_t length;
+  size_t head = 0;
+  size_t count = 0;
+};
+
+struct HostSemaphore {
+  std::timed_mutex lock;
+};
+
+/* Private variables --------------------------------------------------------- */
+static std::recursive_mutex critical_lock;
+static thread_local HostTask *currentTask = nullptr;
+
+/* Private functions --------------------------------------------------------- */
+// Waits on cv until ready() holds or the ticks run out, portMAX_DELAY waits forever
+template <typename Ready>
+static bool wait_for(std::condition_variable& cv, std::unique_lock<std::mutex>& lock, TickType_t ticks,
+                     Ready ready) {
+  if (ticks == portMAX_DELAY) {
+    cv.wait(lock, ready);
+    return true;
+  }
+  if (ticks == 0) {
+    return ready();  // A zero timeout still sleeps for the timer slack, polls are hot
+  }
+  return cv.wait_for(lock, std::chrono::milliseconds(pdTICKS_TO_MS(ticks)), ready);
+}
+
+/* Critical sections --------------------------------------------------- */
+void host_enter_critical(void) {
+  critical_lock.lock();
+}
+
+void host_exit_critical(void) {
+  critical_lock.unlock();
+}
+
+/* Tasks --------------------------------------------------------------- */
+BaseType_t xTaskCreate(TaskFunction_t function, const char *name, uint32_t stackBytes, void *arg,
+                       UBaseType_t priority, TaskHandle_t *handle) {
+  (void) stackBytes;
+  (void) priority;
+  HostTask *task = new HostTask();  // Tasks never end, the handle lives forever
+  task->name = name;
+  if (handle != NULL) {
+    *handle = task;
+  }
+  std::thread([function, arg, task] {
+    currentTask = task;
+    function(arg);
+  }).detach();
+  return pdPASS;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char *name, uint32_t stackBytes, void *arg,
+                                   UBaseType_t priority, TaskHandle_t *handle, BaseType_t core) {
+  (void) core;
+  return xTaskCreate(function, name, stackBytes, arg, priority, handle);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) {
+  if (currentTask == nullptr) {
+    currentTask = new HostTask();
+    currentTask->name = "host";
+  }
+  return currentTask;
+}
+
+TaskHandle_t hal_host_task_handle(const char *name) {
+  HostTask *task = new HostTask();
+  task->name = name;
+  return task;
+}
+
+TickType_t xTaskGetTickCount(void) {
+  return (TickType_t) (hal_time_us() / 1000 / portTICK_PERIOD_MS);
+}
+
+void vTaskDelay(TickType_t ticks) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(pdTICKS_TO_MS(ticks)));
+}
+
+/* Notifications ------------------------------------------------------- */
+BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action) {
+  {
+    std::lock_guard<std::mutex> guard(task->lock);
+    switch (action) {
+      case eSetBits:
+        task->value |= value;
+        break;
+      case eIncrement:
+        task->value++;
+        break;
+      case eNoAction:
+        break;
+    }
+    task->pending = true;
+  }
+  task->notified.notify_all();
+  return pdPASS;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+  return xTaskNotify(task, 0, eIncrement);
+}
+
+BaseType_t xTaskNotifyWait(uint32_t clearOnEntry, uint32_t clearOnExit, uint32_t *value, TickType_t wait) {
+  HostTask *task = xTaskGetCurrentTaskHandle();
+  std::unique_lock<std::mutex> lock(task->lock);
+  if (!task->pending) {
+    task->value &= ~clearOnEntry;
+  }
+  if (!wait_for(task->notified, lock, wait, [task] { return task->pending; })) {
+    if (value != NULL) {
+      *value = task->value;
+    }
+    return pdFALSE;
+  }
+  if (value != NULL) {
+    *value = task->value;
+  }
+  task->value &= ~clearOnExit;
+  task->pending = false;
+  return pdTRUE;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t wait) {
+  HostTask *task = xTaskGetCurrentTaskHandle();
+  std::unique_lock<std::mutex> lock(task->lock);
+  wait_for(task->notified, lock, wait, [task] { return task->value != 0; });
+  uint32_t value = task->value;
+  if (value != 0) {
+    task->value = clearOnExit ? 0 : value - 1;
+  }
+  task->pending = false;
+  return value;
+}
+
+uint32_t ulTaskNotifyValueClear(TaskHandle_t task, uint32_t bitsToClear) {
+  std::lock_guard<std::mutex> guard(task->lock);
+  uint32_t value = task->value;
+  task->value &= ~bitsToClear;
+  return value;
+}
+
+/* Queues -------------------------------------------------------------- */
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+  HostQueue *queue = new HostQueue();
+  queue->items.resize((size_t) length * itemSize);
+  queue->itemSize = itemSize;
+  queue->length = length;
+  return queue;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t wait) {
+  std::unique_lock<std::mutex> lock(queue->lock);
+  if (!wait_for(queue->changed, lock, wait, [queue] { return queue->count < queue->length; })) {
+    return pdFALSE;
+  }
+  size_t tail = (queue->head + queue->count) % queue->length;
+  memcpy(&queue->items[tail * queue->itemSize], item, queue->itemSize);
+  queue->count++;
+  lock.unlock();
+  queue->changed.notify_all();
+  return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t wait) {
+  std::unique_lock<std::mutex> lock(queue->lock);
+  if (!wait_for(queue->changed, lock, wait, [queue] { return queue->count > 0; })) {
+    return pdFALSE;
+  }
+  memcpy(item, &queue->items[queue->head * queue->itemSize], queue->itemSize);
+  queue->head = (queue->head + 1) % queue->length;
+  queue->count--;
+  lock.unlock();
+  queue->changed.notify_all();
+  return pdTRUE;
+}
+
+BaseType_t xQueuePeek(QueueHandle_t queue, void *item, TickType_t wait) {
+  std::unique_lock<std::mutex> lock(queue->lock);
+  if (!wait_for(queue->changed, lock, wait, [queue] { return queue->count > 0; })) {
+    return pdFALSE;
+  }
+  memcpy(item, &queue->items[queue->head * queue->itemSize], queue->itemSize);
+  return pdTRUE;
+}
+
+BaseType_t xQueueReset(QueueHandle_t queue) {
+  {
+    std::lock_guard<std::mutex> guard(queue->lock);
+    queue->head = 0;
+    queue->count = 0;
+  }
+  queue->changed.notify_all();
+  return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+  std::lock_guard<std::mutex> guard(queue->lock);
+  return (UBaseType_t) queue->count;
+}
+
+/* Mutexes ------------------------------------------------------------- */
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *buffer) {
+  (void) buffer;
+  return new HostSemaphore();  // Lives as long as the static buffer would
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t wait) {
+  if (wait == portMAX_DELAY) {
+    semaphore->lock.lock();
+    return pdTRUE;
+  }
+  return semaphore->lock.try_lock_for(std::chrono::milliseconds(pdTICKS_TO_MS(wait))) ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+  semaphore->lock.unlock();
+  return pdTRUE;
+}
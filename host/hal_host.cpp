@@ -0,0 +1,268 @@
+/**
+  ******************************************************************************
+  * @authors        : Tomas Gonzalez & Brian Morris
+  * @file           : hal_host.cpp
+  * @brief          : Linux implementation of the HAL, in-memory NVS, publishes
+  *                   handed to a hook and logs printed to stderr
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 Tomas Gonzalez & Brian Morris
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  */
+
+/* Includes ------------------------------------------------------------ */
+#include "hal_host.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <malloc.h>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "esp_log.h"
+#include "wi-fi/mqtt_api.h"
+
+/* Private types ------------------------------------------------------- */
+struct NvsValue {
+  hal_nvs_type_t type;
+  std::vector<uint8_t> bytes;
+};
+
+/* Private variables --------------------------------------------------------- */
+static const auto bootTime = std::chrono::steady_clock::now();
+static std::atomic<bool> manualClock{false};
+static std::atomic<int64_t> manualTime_us{0};
+
+static std::atomic<esp_log_level_t> logLevel{ESP_LOG_INFO};
+static std::mutex log_lock;
+
+static std::mutex publish_lock;
+static hal_host_publish_hook_t publishHook = NULL;
+static void *publishCtx = NULL;
+static std::atomic<bool> connected{true};
+
+static std::mutex nvs_lock;
+static std::map<std::string, std::map<std::string, NvsValue>> nvs;
+static std::atomic<uint32_t> nvsCommits{0};
+
+static std::mutex trace_lock;
+static std::vector<uint8_t> traceStorage(HAL_HOST_TRACE_SIZE, 0xFF);
+
+static std::mutex display_lock;
+static status_model_t display;
+
+/* Private functions --------------------------------------------------------- */
+static size_t value_size(hal_nvs_type_t type, size_t blobSize) {
+  switch (type) {
+    case HAL_NVS_U32: return sizeof(uint32_t);
+    case HAL_NVS_I64: return sizeof(int64_t);
+    default: return blobSize;
+  }
+}
+
+/* Time ---------------------------------------------------------------- */
+int64_t hal_time_us(void) {
+  if (manualClock) {
+    return manualTime_us;
+  }
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - bootTime).count();
+}
+
+void hal_host_clock_manual(int64_t start_us) {
+  manualTime_us = start_us;
+  manualClock = true;
+}
+
+void hal_host_clock_advance(int64_t us) {
+  manualTime_us += us;
+}
+
+size_t hal_free_heap(void) {
+  return mallinfo2().fordblks;
+}
+
+/* Logging ------------------------------------------------------------- */
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...) {
+  (void) tag;
+  if (level > logLevel) {
+    return;
+  }
+  std::lock_guard<std::mutex> guard(log_lock);
+  va_list args;
+  va_start(args, format);
+  vfprintf(stderr, format, args);
+  va_end(args);
+}
+
+uint32_t esp_log_timestamp(void) {
+  return (uint32_t) (hal_time_us() / 1000);
+}
+
+void esp_log_level_set(const char *tag, esp_log_level_t level) {
+  (void) tag;
+  logLevel = level;
+}
+
+/* NVS ----------------------------------------------------------------- */
+hal_nvs_err_t hal_nvs_write(const char *ns, const hal_nvs_item_t *items, size_t count) {
+  std::lock_guard<std::mutex> guard(nvs_lock);
+  auto& keys = nvs[ns];
+  for (size_t i = 0; i < count; i++) {
+    const hal_nvs_item_t& item = items[i];
+    if (item.type == HAL_NVS_BLOB && item.size == 0) {
+      continue;
+    }
+    const uint8_t *bytes = (const uint8_t*) item.value;
+    keys[item.key] = NvsValue{item.type, std::vector<uint8_t>(bytes, bytes + value_size(item.type, item.size))};
+  }
+  nvsCommits++;
+  return HAL_NVS_OK;
+}
+
+hal_nvs_err_t hal_nvs_read(const char *ns, const char *key, hal_nvs_type_t type, void *value, size_t *size) {
+  std::lock_guard<std::mutex> guard(nvs_lock);
+  auto keys = nvs.find(ns);
+  if (keys == nvs.end()) {
+    return HAL_NVS_NOT_FOUND;
+  }
+  auto stored = keys->second.find(key);
+  if (stored == keys->second.end()) {
+    return HAL_NVS_NOT_FOUND;
+  }
+  if (stored->second.type != type) {
+    return HAL_NVS_FAIL;
+  }
+
+  size_t length = stored->second.bytes.size();
+  if (type == HAL_NVS_BLOB) {
+    if (size == NULL || *size < length) {
+      return HAL_NVS_FAIL;
+    }
+    *size = length;
+  }
+  memcpy(value, stored->second.bytes.data(), length);
+  return HAL_NVS_OK;
+}
+
+hal_nvs_err_t hal_nvs_erase(const char *ns) {
+  std::lock_guard<std::mutex> guard(nvs_lock);
+  nvs.erase(ns);
+  nvsCommits++;
+  return HAL_NVS_OK;
+}
+
+void hal_host_nvs_clear(void) {
+  std::lock_guard<std::mutex> guard(nvs_lock);
+  nvs.clear();
+}
+
+uint32_t hal_host_nvs_commits(void) {
+  return nvsCommits;
+}
+
+/* Trace storage ------------------------------------------------------- */
+size_t hal_trace_size(void) {
+  return traceStorage.size();
+}
+
+bool hal_trace_erase(size_t offset, size_t size) {
+  std::lock_guard<std::mutex> guard(trace_lock);
+  if (offset % HAL_TRACE_SECTOR_SIZE != 0 || size % HAL_TRACE_SECTOR_SIZE != 0 || offset + size > traceStorage.size()) {
+    return false;
+  }
+  memset(traceStorage.data() + offset, 0xFF, size);
+  return true;
+}
+
+bool hal_trace_write(size_t offset, const void *data, size_t size) {
+  std::lock_guard<std::mutex> guard(trace_lock);
+  if (offset + size > traceStorage.size()) {
+    return false;
+  }
+  // NOR flash only clears bits, writing over unerased bytes corrupts them as on the target
+  const uint8_t *bytes = (const uint8_t*) data;
+  for (size_t i = 0; i < size; i++) {
+    traceStorage[offset + i] &= bytes[i];
+  }
+  return true;
+}
+
+bool hal_trace_read(size_t offset, void *data, size_t size) {
+  std::lock_guard<std::mutex> guard(trace_lock);
+  if (offset + size > traceStorage.size()) {
+    return false;
+  }
+  memcpy(data, traceStorage.data() + offset, size);
+  return true;
+}
+
+/* Publish ------------------------------------------------------------- */
+void hal_publish(const char *topic, const char *payload, bool retained) {
+  if (!connected) {
+    return;
+  }
+  std::lock_guard<std::mutex> guard(publish_lock);
+  if (publishHook != NULL) {
+    publishHook(topic, payload, retained, publishCtx);
+  }
+}
+
+void hal_publish_queued(const char *topic, const char *payload, bool retained) {
+  hal_publish(topic, payload, retained);  // The hook never blocks
+}
+
+void hal_publish_reply(uint32_t correlation_id, const char *result) {
+  char reply[MQTT_REPLY_MAX_LEN];
+  snprintf(reply, sizeof(reply), "%u %s", (unsigned) correlation_id, result);
+  hal_publish(MQTT_CU_REPLY_TOPIC, reply, false);
+}
+
+bool hal_publish_connected(void) {
+  return connected;
+}
+
+void hal_host_set_publish_hook(hal_host_publish_hook_t hook, void *ctx) {
+  std::lock_guard<std::mutex> guard(publish_lock);
+  publishHook = hook;
+  publishCtx = ctx;
+}
+
+void hal_host_set_connected(bool isConnected) {
+  connected = isConnected;
+}
+
+/* Display ------------------------------------------------------------- */
+void hal_display_lsu_count(uint32_t count) {
+  std::lock_guard<std::mutex> guard(display_lock);
+  display.lsu_count = count;
+}
+
+void hal_display_queue_depths(uint16_t rx_main, uint16_t rx_aux, uint16_t commands) {
+  std::lock_guard<std::mutex> guard(display_lock);
+  display.rx_queue_main = rx_main;
+  display.rx_queue_aux = rx_aux;
+  display.command_queue = commands;
+}
+
+void hal_display_lsu_rows(const status_lsu_row_t *rows, uint8_t count) {
+  std::lock_guard<std::mutex> guard(display_lock);
+  if (count > STATUS_MAX_LSU_ROWS) {
+    count = STATUS_MAX_LSU_ROWS;
+  }
+  memcpy(display.lsu, rows, count * sizeof(status_lsu_row_t));
+  display.lsu_rows = count;
+}
+
+void hal_host_display_get(status_model_t *model) {
+  std::lock_guard<std::mutex> guard(display_lock);
+  *model = display;
+}
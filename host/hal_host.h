@@ -0,0 +1,101 @@
+/**
+  ******************************************************************************
+  * @authors        : Tomas Gonzalez & Brian Morris
+  * @file           : hal_host.h
+  * @brief          : Controls of the Linux HAL, used by tests and tools to
+  *                   drive the clock, the radios and to observe publishes
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 Tomas Gonzalez & Brian Morris
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef HAL_HOST_H
+#define HAL_HOST_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "hal/hal.h"
+#include "uart.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Defines -------------------------------------------------------------------*/
+#define HAL_HOST_TRACE_SIZE 0x40000  // Same as the uarttrace partition
+
+/* Types ---------------------------------------------------------------------*/
+typedef void (*hal_host_publish_hook_t)(const char *topic, const char *payload, bool retained, void *ctx);
+
+typedef void (*hal_host_uart_tx_hook_t)(UartPort_t port, const char *data, uint16_t length, void *ctx);
+
+/* Clock ---------------------------------------------------------------------*/
+/**
+ * @brief Stop the clock at start_us, from now on it only moves with hal_host_clock_advance()
+ * @details Only hal_time_us() and the tick count follow it, blocking waits keep using real time
+ */
+void hal_host_clock_manual(int64_t start_us);
+
+void hal_host_clock_advance(int64_t us);
+
+/* Publish -------------------------------------------------------------------*/
+/**
+ * @brief Receive every publish made while connected, called on the publishing task
+ */
+void hal_host_set_publish_hook(hal_host_publish_hook_t hook, void *ctx);
+
+/**
+ * @brief Broker state seen by the core, connected by default
+ */
+void hal_host_set_connected(bool connected);
+
+/* NVS -----------------------------------------------------------------------*/
+/**
+ * @brief Forget every namespace, as a freshly erased flash
+ */
+void hal_host_nvs_clear(void);
+
+/**
+ * @brief Commits made since start, by hal_nvs_write() and hal_nvs_erase()
+ */
+uint32_t hal_host_nvs_commits(void);
+
+/* Display -------------------------------------------------------------------*/
+/**
+ * @brief Copy of the fields the core pushed to the display
+ */
+void hal_host_display_get(status_model_t *model);
+
+/* Tasks ---------------------------------------------------------------------*/
+/**
+ * @brief A task handle no thread runs, its owner polls it with ulTaskNotifyValueClear()
+ * @details Lets a single-threaded driver receive the notifications meant for a task
+ */
+TaskHandle_t hal_host_task_handle(const char *name);
+
+/* UART ----------------------------------------------------------------------*/
+/**
+ * @brief Receive every write to the radios, called on the writing task
+ * @details The hook plays the radio, it usually answers with hal_host_uart_inject()
+ */
+void hal_host_uart_set_tx_hook(hal_host_uart_tx_hook_t hook, void *ctx);
+
+/**
+ * @brief Bytes sent by a radio, read by the next uart_receive() of the port
+ */
+void hal_host_uart_inject(UartPort_t port, const char *data, size_t length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HAL_HOST_H */
@@ -0,0 +1,76 @@
+/**
+  ******************************************************************************
+  * @authors        : Tomas Gonzalez & Brian Morris
+  * @file           : host_boot.cpp
+  * @brief          : Boots the CU core on the host the way app_main does,
+  *                   shared by the tests and tools
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 Tomas Gonzalez & Brian Morris
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  */
+
+/* Includes ------------------------------------------------------------ */
+#include "host_boot.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include "hal_host.h"
+#include "request_queue.h"
+#include "command_queue.h"
+#include "shard_router.h"
+#include "coroutine.h"
+#include "timer_service.h"
+#include "tx_scheduler.h"
+#include "rx_channel.h"
+#include "process_requests.h"
+#include "freertos/task.h"
+
+/* Private variables --------------------------------------------------------- */
+static UartPort_t mainPort = UART_PORT_MAIN;
+static UartPort_t auxPort = UART_PORT_AUX;
+static const int shards[LSU_SHARD_COUNT] = {0, 1};
+
+/* Functions ------------------------------------------------------------ */
+void host_core_init() {
+  command_queue_init();
+  request_queue_init();
+  shard_router_init();
+  coro_executor_init();
+  timer_service_init();
+  tx_scheduler_init();
+}
+
+void host_boot_core() {
+  host_core_init();
+
+  xTaskCreate(timer_service_task, "timer_service", 0, NULL, 15, NULL);
+  xTaskCreate(coro_executor_task, "coro_executor", 0, NULL, 10, NULL);
+  xTaskCreate(rx_channel_task, "uart_main_rx_task", 0, &mainPort, 12, NULL);
+  xTaskCreate(rx_channel_task, "uart_aux_rx_task", 0, &auxPort, 12, NULL);
+}
+
+void host_start_shards() {
+  for (int shard = 0; shard < LSU_SHARD_COUNT; shard++) {
+    xTaskCreate(process_requests_task, "process_shard", 0, (void*) &shards[shard], 11, NULL);
+  }
+}
+
+void host_radio_accept(UartPort_t port, const char *data, uint16_t length, void *ctx) {
+  (void) data;
+  (void) length;
+  (void) ctx;
+  hal_host_uart_inject(port, "+OK\r\n", 5);
+}
+
+void host_fail(const char *what) {
+  fflush(stdout);
+  fprintf(stderr, "FAIL: %s\n", what);
+  fflush(stderr);
+  std::_Exit(EXIT_FAILURE);
+}
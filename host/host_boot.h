@@ -0,0 +1,55 @@
+/**
+  ******************************************************************************
+  * @authors        : Tomas Gonzalez & Brian Morris
+  * @file           : host_boot.h
+  * @brief          : Boots the CU core on the host the way app_main does,
+  *                   shared by the tests and tools
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 Tomas Gonzalez & Brian Morris
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef HOST_BOOT_H
+#define HOST_BOOT_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include "uart.h"
+
+/* Functions -----------------------------------------------------------------*/
+/**
+ * @brief Set up the queues, the shard router, the executor, the timers and the TX scheduler, no task is started
+ */
+void host_core_init();
+
+/**
+ * @brief host_core_init(), then the timer, executor and both RX tasks as in app_main
+ * @details The shards are left to the caller, some drive them from their own thread
+ */
+void host_boot_core();
+
+/**
+ * @brief Start a process_requests_task for every shard
+ */
+void host_start_shards();
+
+/**
+ * @brief UART TX hook playing both radios, every command is answered +OK
+ * @details Hooks that look at the commands first call it to answer
+ */
+void host_radio_accept(UartPort_t port, const char *data, uint16_t length, void *ctx);
+
+/**
+ * @brief Print the failed check and exit without running the static destructors
+ * @details The core's tasks never return, their objects must stay alive
+ */
+[[noreturn]] void host_fail(const char *what);
+
+#endif /* HOST_BOOT_H */
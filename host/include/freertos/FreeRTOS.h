@@ -0,0 +1,73 @@
+/**
+  ******************************************************************************
+  * @authors        : Tomas Gonzalez & Brian Morris
+  * @file           : FreeRTOS.h
+  * @brief          : Host build of the FreeRTOS subset used by the CU core,
+  *                   tasks are threads, implemented by host/freertos_host.cpp
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 Tomas Gonzalez & Brian Morris
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef HOST_FREERTOS_H
+#define HOST_FREERTOS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Types ---------------------------------------------------------------------*/
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+typedef void (*TaskFunction_t)(void *arg);
+
+typedef struct HostQueue *QueueHandle_t;
+typedef struct HostTask *TaskHandle_t;
+
+// Critical sections share one recursive lock, the name only documents intent
+typedef int portMUX_TYPE;
+
+typedef enum {
+  eNoAction,
+  eSetBits,
+  eIncrement,
+} eNotifyAction;
+
+/* Defines -------------------------------------------------------------------*/
+#define pdFALSE 0
+#define pdTRUE  1
+#define pdFAIL  pdFALSE
+#define pdPASS  pdTRUE
+
+// Same tick rate as the firmware, CONFIG_FREERTOS_HZ=100
+#define portTICK_PERIOD_MS  10
+#define portMAX_DELAY       ((TickType_t) 0xffffffffUL)
+#define pdMS_TO_TICKS(ms)   ((TickType_t) ((uint64_t) (ms) / portTICK_PERIOD_MS))
+#define pdTICKS_TO_MS(t)    ((TickType_t) ((uint64_t) (t) * portTICK_PERIOD_MS))
+
+#define portMUX_INITIALIZER_UNLOCKED 0
+#define portMUX_INITIALIZE(mux)      (*(mux) = portMUX_INITIALIZER_UNLOCKED)
+
+#define taskENTER_CRITICAL(mux) ((void) (mux), host_enter_critical())
+#define taskEXIT_CRITICAL(mux)  ((void) (mux), host_exit_critical())
+
+/* Function prototypes -------------------------------------------------------*/
+void host_enter_critical(void);
+void host_exit_critical(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HOST_FREERTOS_H */
@@ -0,0 +1,46 @@
+/**
+  ******************************************************************************
+  * @authors        : Tomas Gonzalez & Brian Morris
+  * @file           : queue.h
+  * @brief          : Host build of the FreeRTOS queue API, copies items by
+  *                   value like the real one
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 Tomas Gonzalez & Brian Morris
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef HOST_FREERTOS_QUEUE_H
+#define HOST_FREERTOS_QUEUE_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "freertos/FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Function prototypes -------------------------------------------------------*/
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize);
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t wait);
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t wait);
+
+BaseType_t xQueuePeek(QueueHandle_t queue, void *item, TickType_t wait);
+
+BaseType_t xQueueReset(QueueHandle_t queue);
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HOST_FREERTOS_QUEUE_H */
@@ -0,0 +1,47 @@
+/**
+  ******************************************************************************
+  * @authors        : Tomas Gonzalez & Brian Morris
+  * @file           : semphr.h
+  * @brief          : Host build of the FreeRTOS mutex API
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 Tomas Gonzalez & Brian Morris
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef HOST_FREERTOS_SEMPHR_H
+#define HOST_FREERTOS_SEMPHR_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "freertos/FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Types ---------------------------------------------------------------------*/
+typedef struct HostSemaphore *SemaphoreHandle_t;
+
+// The host keeps the mutex on the heap, the buffer only keeps the firmware signature
+typedef struct {
+  uint8_t unused;
+} StaticSemaphore_t;
+
+/* Function prototypes -------------------------------------------------------*/
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *buffer);
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t wait);
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HOST_FREERTOS_SEMPHR_H */
@@ -0,0 +1,437 @@
+/**
+  ******************************************************************************
+  * @authors        : Tomas Gonzalez & Brian Morris
+  * @file           : rylr998_emu.cpp
+  * @brief          : RYLR998 module emulator, answers the AT commands of both
+  *                   radios through the host UART shim
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 Tomas Gonzalez & Brian Morris
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "rylr998_emu.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+#include "hal_host.h"
+#include "rylr998.h"
+
+/* Defines -------------------------------------------------------------------*/
+#define DEFAULT_RESPONSE_LATENCY_US 2000
+#define RESET_TIME_US               100000  // +RESET to +READY
+#define EMU_PORT_COUNT              2
+
+/* Private types -------------------------------------------------------------*/
+typedef std::chrono::steady_clock Clock;
+
+struct Module {
+  rylr998_emu_stats_t stats;
+  uint32_t baud;
+  char password[9];
+  rylr998_emu_fault_t fault;
+  Clock::time_point txBusyUntil;
+};
+
+enum DeliveryKind {
+  DELIVER_UART,  // Bytes from the module to the CU
+  DELIVER_AIR,   // Frame leaving the module
+};
+
+struct Delivery {
+  Clock::time_point due;
+  uint64_t seq;
+  DeliveryKind kind;
+  UartPort_t port;
+  uint16_t destination;
+  std::string bytes;
+  bool operator>(const Delivery& other) const {
+    return due != other.due ? due > other.due : seq > other.seq;
+  }
+};
+
+/* Private variables ---------------------------------------------------------*/
+static std::mutex lock;
+static std::condition_variable changed;
+static std::priority_queue<Delivery, std::vector<Delivery>, std::greater<Delivery>> deliveries;
+static uint64_t nextSeq = 0;
+static Module modules[EMU_PORT_COUNT];
+static rylr998_emu_config_t emuConfig = {DEFAULT_RESPONSE_LATENCY_US, 1.0};
+static rylr998_emu_air_hook_t airHook = NULL;
+static void *airCtx = NULL;
+static bool started = false;
+
+/* Private functions ---------------------------------------------------------*/
+static Clock::duration scaled(uint64_t us) {
+  return std::chrono::microseconds((int64_t) llround(us * emuConfig.time_scale));
+}
+
+static void factory_settings(Module& module) {
+  rylr998_emu_stats_t counters = module.stats;
+  module.stats = rylr998_emu_stats_t{};
+  module.stats.commands = counters.commands;
+  module.stats.errors = counters.errors;
+  module.stats.sends = counters.sends;
+  module.stats.received = counters.received;
+  module.stats.missed = counters.missed;
+  module.stats.flash_writes = counters.flash_writes;
+  module.stats.airtime_us = counters.airtime_us;
+  module.stats.network_id = 18;
+  module.stats.sf = 9;
+  module.stats.bw = 7;
+  module.stats.cr = 1;
+  module.stats.preamble = 12;
+  module.stats.band_hz = 915000000;
+  module.stats.crfop = 22;
+  module.baud = 115200;
+  strcpy(module.password, "00000000");
+}
+
+// Must hold lock
+static void schedule(Clock::time_point due, DeliveryKind kind, UartPort_t port, std::string bytes,
+                     uint16_t destination = 0) {
+  deliveries.push(Delivery{due, nextSeq++, kind, port, destination, std::move(bytes)});
+  changed.notify_all();
+}
+
+// Must hold lock
+static void answer(UartPort_t port, const std::string& line, uint64_t extra_us = 0) {
+  schedule(Clock::now() + scaled(emuConfig.response_latency_us + extra_us), DELIVER_UART, port, line + "\r\n");
+}
+
+// Must hold lock
+static void answer_error(UartPort_t port, int code) {
+  modules[port].stats.errors++;
+  answer(port, "+ERR=" + std::to_string(code));
+}
+
+// Parses "a,b,c" into up to count unsigned values, false if malformed
+static bool parse_values(const std::string& args, unsigned long *values, int count) {
+  const char *cursor = args.c_str();
+  for (int i = 0; i < count; i++) {
+    char *end;
+    if (*cursor < '0' || *cursor > '9') {
+      return false;
+    }
+    values[i] = strtoul(cursor, &end, 10);
+    cursor = end;
+    if (i < count - 1) {
+      if (*cursor != ',') {
+        return false;
+      }
+      cursor++;
+    }
+  }
+  return *cursor == '\0';
+}
+
+// Must hold lock
+static void handle_send(UartPort_t port, const std::string& args) {
+  Module& module = modules[port];
+  size_t first = args.find(',');
+  size_t second = first == std::string::npos ? std::string::npos : args.find(',', first + 1);
+  unsigned long header[2];
+  if (second == std::string::npos || !parse_values(args.substr(0, second), header, 2) || header[0] > 65535) {
+    answer_error(port, RYLR998_ERR_UNKNOWN);
+    return;
+  }
+  std::string payload = args.substr(second + 1);
+  if (header[1] > RYLR998_EMU_MAX_PAYLOAD) {
+    answer_error(port, RYLR998_ERR_TX_TOO_LONG);
+    return;
+  }
+  if (payload.size() != header[1]) {
+    answer_error(port, RYLR998_ERR_LENGTH);
+    return;
+  }
+  Clock::time_point now = Clock::now();
+  if (now < module.txBusyUntil) {
+    answer_error(port, RYLR998_ERR_TX_BUSY);
+    return;
+  }
+
+  // The module answers once the frame is out
+  uint32_t airtime_us = rylr998_emu_airtime_us(module.stats.sf, module.stats.bw, module.stats.cr,
+                                               module.stats.preamble, payload.size());
+  Clock::time_point done = now + scaled(emuConfig.response_latency_us + airtime_us);
+  module.txBusyUntil = done;
+  module.stats.sends++;
+  module.stats.airtime_us += airtime_us;
+  schedule(done, DELIVER_AIR, port, payload, (uint16_t) header[0]);
+  schedule(done, DELIVER_UART, port, "+OK\r\n");
+}
+
+// Must hold lock. Handles "NAME=args" and "NAME?" of the settings.
+static void handle_setting(UartPort_t port, const std::string& name, bool query, const std::string& args) {
+  Module& module = modules[port];
+  rylr998_emu_stats_t& settings = module.stats;
+  unsigned long values[4];
+  char reply[64];
+
+  if (name == "ADDRESS") {
+    if (query) {
+      snprintf(reply, sizeof(reply), "+ADDRESS=%u", settings.address);
+    } else if (parse_values(args, values, 1) && values[0] <= 65535) {
+      settings.address = values[0];
+    } else {
+      answer_error(port, RYLR998_ERR_UNKNOWN);
+      return;
+    }
+  } else if (name == "NETWORKID") {
+    if (query) {
+      snprintf(reply, sizeof(reply), "+NETWORKID=%u", settings.network_id);
+    } else if (parse_values(args, values, 1) && ((values[0] >= 3 && values[0] <= 15) || values[0] == 18)) {
+      settings.network_id = values[0];
+    } else {
+      answer_error(port, RYLR998_ERR_UNKNOWN);
+      return;
+    }
+  } else if (name == "PARAMETER") {
+    if (query) {
+      snprintf(reply, sizeof(reply), "+PARAMETER=%u,%u,%u,%u", settings.sf, settings.bw, settings.cr,
+               settings.preamble);
+    } else if (!parse_values(args, values, 4) || values[0] < 5 || values[0] > 11 || values[1] < 7 ||
+               values[1] > 9 || values[2] < 1 || values[2] > 4) {
+      answer_error(port, RYLR998_ERR_UNKNOWN);
+      return;
+    } else if (settings.network_id == 18 ? values[3] < 4 || values[3] > 24 : values[3] != 12) {
+      answer_error(port, RYLR998_ERR_PREAMBLE);
+      return;
+    } else {
+      settings.sf = values[0];
+      settings.bw = values[1];
+      settings.cr = values[2];
+      settings.preamble = values[3];
+    }
+  } else if (name == "MODE") {
+    if (query) {
+      snprintf(reply, sizeof(reply), "+MODE=%u", settings.mode);
+    } else if ((parse_values(args, values, 1) && values[0] <= 1) ||
+               (parse_values(args, values, 3) && values[0] == 2 && values[1] >= 30 && values[1] <= 60000 &&
+                values[2] >= 30 && values[2] <= 60000)) {
+      settings.mode = values[0];
+    } else {
+      answer_error(port, RYLR998_ERR_UNKNOWN);
+      return;
+    }
+  } else if (name == "BAND") {
+    bool persist = args.ends_with(",M");
+    if (query) {
+      snprintf(reply, sizeof(reply), "+BAND=%lu", (unsigned long) settings.band_hz);
+    } else if (parse_values(persist ? args.substr(0, args.size() - 2) : args, values, 1) &&
+               values[0] >= 862000000 && values[0] <= 1020000000) {
+      settings.band_hz = values[0];
+      settings.flash_writes += persist;
+    } else {
+      answer_error(port, RYLR998_ERR_UNKNOWN);
+      return;
+    }
+  } else if (name == "CRFOP") {
+    if (query) {
+      snprintf(reply, sizeof(reply), "+CRFOP=%u", settings.crfop);
+    } else if (parse_values(args, values, 1) && values[0] <= 22) {
+      settings.crfop = values[0];
+    } else {
+      answer_error(port, RYLR998_ERR_UNKNOWN);
+      return;
+    }
+  } else if (name == "IPR") {
+    if (query) {
+      snprintf(reply, sizeof(reply), "+IPR=%lu", (unsigned long) module.baud);
+    } else if (parse_values(args, values, 1) && values[0] >= 300 && values[0] <= 115200) {
+      module.baud = values[0];
+    } else {
+      answer_error(port, RYLR998_ERR_UNKNOWN);
+      return;
+    }
+  } else if (name == "CPIN") {
+    if (query) {
+      snprintf(reply, sizeof(reply), "+CPIN=%s", module.password);
+    } else if (args.size() == 8 && args.find_first_not_of("0123456789ABCDEFabcdef") == std::string::npos) {
+      snprintf(module.password, sizeof(module.password), "%s", args.c_str());
+    } else {
+      answer_error(port, RYLR998_ERR_UNKNOWN);
+      return;
+    }
+  } else {
+    answer_error(port, RYLR998_ERR_UNKNOWN);
+    return;
+  }
+  answer(port, query ? reply : "+OK");
+}
+
+// Must hold lock
+static void handle_command(UartPort_t port, std::string line) {
+  Module& module = modules[port];
+  module.stats.commands++;
+  if (module.fault == RYLR998_EMU_SILENT) {
+    return;
+  }
+  if (module.fault == RYLR998_EMU_FAILING) {
+    answer_error(port, RYLR998_ERR_UNKNOWN_FAIL);
+    return;
+  }
+
+  if (!line.ends_with("\r\n")) {
+    answer_error(port, RYLR998_ERR_NO_ENTER);
+    return;
+  }
+  line.resize(line.size() - 2);
+  if (!line.starts_with("AT")) {
+    answer_error(port, RYLR998_ERR_NO_AT);
+    return;
+  }
+  if (line == "AT") {
+    answer(port, "+OK");
+    return;
+  }
+  if (!line.starts_with("AT+")) {
+    answer_error(port, RYLR998_ERR_UNKNOWN);
+    return;
+  }
+
+  std::string command = line.substr(3);
+  size_t equals = command.find('=');
+  std::string name = command.substr(0, equals);
+  std::string args = equals == std::string::npos ? "" : command.substr(equals + 1);
+  bool query = equals == std::string::npos && name.ends_with("?");
+  if (query) {
+    name.pop_back();
+  }
+
+  if (name == "SEND" && equals != std::string::npos) {
+    handle_send(port, args);
+  } else if (name == "RESET" && equals == std::string::npos && !query) {
+    answer(port, "+RESET");
+    answer(port, "+READY", RESET_TIME_US);
+  } else if (name == "FACTORY" && equals == std::string::npos && !query) {
+    factory_settings(module);
+    answer(port, "+FACTORY");
+  } else if (name == "VER" && query) {
+    answer(port, "+VER=RYLR998_REYAX_V1.2.2");
+  } else if (name == "UID" && query) {
+    answer(port, port == UART_PORT_MAIN ? "+UID=000000000000000000000001" : "+UID=000000000000000000000002");
+  } else if (query || equals != std::string::npos) {
+    handle_setting(port, name, query, args);
+  } else {
+    answer_error(port, RYLR998_ERR_UNKNOWN);
+  }
+}
+
+static void on_uart_tx(UartPort_t port, const char *data, uint16_t length, void *ctx) {
+  (void) ctx;
+  std::lock_guard<std::mutex> guard(lock);
+  handle_command(port, std::string(data, length));
+}
+
+static void delivery_thread() {
+  std::unique_lock<std::mutex> guard(lock);
+  while (true) {
+    if (deliveries.empty()) {
+      changed.wait(guard);
+      continue;
+    }
+    Clock::time_point due = deliveries.top().due;
+    if (Clock::now() < due) {
+      changed.wait_until(guard, due);
+      continue;
+    }
+    Delivery delivery = deliveries.top();
+    deliveries.pop();
+    rylr998_emu_air_hook_t hook = airHook;
+    void *ctx = airCtx;
+
+    // The firmware and the hook may call back into the emulator
+    guard.unlock();
+    if (delivery.kind == DELIVER_UART) {
+      hal_host_uart_inject(delivery.port, delivery.bytes.data(), delivery.bytes.size());
+    } else if (hook != NULL) {
+      hook(delivery.port, delivery.destination, delivery.bytes.data(), delivery.bytes.size(), ctx);
+    }
+    guard.lock();
+  }
+}
+
+/* Public functions ----------------------------------------------------------*/
+void rylr998_emu_start(const rylr998_emu_config_t *config) {
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    if (config != NULL) {
+      emuConfig = *config;
+    }
+    if (!started) {
+      for (Module& module : modules) {
+        module = Module{};
+        factory_settings(module);
+      }
+      std::thread(delivery_thread).detach();  // Runs until the process exits, like the tasks
+      started = true;
+    }
+  }
+  hal_host_uart_set_tx_hook(on_uart_tx, NULL);
+}
+
+void rylr998_emu_set_air_hook(rylr998_emu_air_hook_t hook, void *ctx) {
+  std::lock_guard<std::mutex> guard(lock);
+  airHook = hook;
+  airCtx = ctx;
+}
+
+bool rylr998_emu_air_send(UartPort_t port, uint16_t from, const char *payload, int16_t rssi, int8_t snr) {
+  std::lock_guard<std::mutex> guard(lock);
+  Module& module = modules[port];
+  size_t length = strlen(payload);
+  if (length > RYLR998_EMU_MAX_PAYLOAD) {
+    return false;
+  }
+  // Half duplex, a module on the air hears nothing
+  Clock::time_point now = Clock::now();
+  if (now < module.txBusyUntil || module.fault == RYLR998_EMU_SILENT) {
+    module.stats.missed++;
+    return false;
+  }
+
+  char line[RYLR998_EMU_MAX_PAYLOAD + 48];
+  snprintf(line, sizeof(line), "+RCV=%u,%zu,%s,%d,%d\r\n", from, length, payload, rssi, snr);
+  uint32_t airtime_us = rylr998_emu_airtime_us(module.stats.sf, module.stats.bw, module.stats.cr,
+                                               module.stats.preamble, length);
+  module.stats.received++;
+  schedule(now + scaled(airtime_us), DELIVER_UART, port, line);
+  return true;
+}
+
+void rylr998_emu_set_fault(UartPort_t port, rylr998_emu_fault_t fault) {
+  std::lock_guard<std::mutex> guard(lock);
+  modules[port].fault = fault;
+}
+
+void rylr998_emu_get_stats(UartPort_t port, rylr998_emu_stats_t *stats) {
+  std::lock_guard<std::mutex> guard(lock);
+  *stats = modules[port].stats;
+}
+
+uint32_t rylr998_emu_airtime_us(uint8_t sf, uint8_t bw, uint8_t cr, uint8_t preamble, size_t length) {
+  // Same calculator as the firmware, the module and the CU agree on every frame
+  RYLR_config_t config = {};
+  config.SF = sf;
+  config.BW = bw;
+  config.CR = cr;
+  config.ProgramedPreamble = preamble;
+  return rylr998_airtime_us(&config, length);
+}
@@ -0,0 +1,147 @@
+/**
+  ******************************************************************************
+  * @authors        : Tomas Gonzalez & Brian Morris
+  * @file           : rylr998_emu.h
+  * @brief          : RYLR998 module emulator, answers the AT commands of both
+  *                   radios through the host UART shim
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 Tomas Gonzalez & Brian Morris
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef RYLR998_EMU_H
+#define RYLR998_EMU_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "uart.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * One emulated module sits behind each UART port. It takes the commands the
+ * firmware writes with uart_send() and answers through hal_host_uart_inject(),
+ * so the RX tasks, the parser and the conversations run unchanged.
+ *
+ * - Settings: AT, ADDRESS, NETWORKID, PARAMETER, MODE, BAND, CRFOP, IPR, CPIN,
+ *   each set with "=" and read back with "?", plus RESET, FACTORY, VER? and UID?
+ * - AT+SEND answers +OK once the frame has been on the air for its time on
+ *   air, computed from the PARAMETER setting. The air hook sees the frame.
+ * - rylr998_emu_air_send() plays an LSU: the module reports +RCV with RSSI and
+ *   SNR once the frame has been on the air, unless it was transmitting itself.
+ * - Malformed or out of range commands get the +ERR=<code> of the datasheet.
+ *
+ * Delays run on the real clock, scaled by time_scale. Tests that use the
+ * manual host clock keep it for the firmware, the emulator does not read it.
+ */
+
+/* Defines -------------------------------------------------------------------*/
+#define RYLR998_EMU_MAX_PAYLOAD 240
+
+// +ERR codes of the RYLR998 datasheet
+#define RYLR998_ERR_NO_ENTER       1   // Command not ended by "\r\n"
+#define RYLR998_ERR_NO_AT          2   // Command does not start with "AT"
+#define RYLR998_ERR_UNKNOWN        4   // Unknown command or invalid value
+#define RYLR998_ERR_LENGTH         5   // Data length does not match
+#define RYLR998_ERR_TX_TOO_LONG    13  // More than 240 bytes of data
+#define RYLR998_ERR_UNKNOWN_FAIL   15
+#define RYLR998_ERR_TX_BUSY        17  // Last TX not completed
+#define RYLR998_ERR_PREAMBLE       18  // Preamble not allowed for the network ID
+
+/* Types ---------------------------------------------------------------------*/
+typedef struct {
+  uint32_t response_latency_us;  // From the end of a command to its answer
+  double time_scale;             // 1 runs in real time, 0.1 ten times faster, 0 without delays
+} rylr998_emu_config_t;
+
+typedef enum {
+  RYLR998_EMU_HEALTHY = 0,
+  RYLR998_EMU_SILENT,    // Never answers, the module is dead or unplugged
+  RYLR998_EMU_FAILING,   // Answers every command with +ERR=15
+} rylr998_emu_fault_t;
+
+typedef struct {
+  // Settings the module holds
+  uint16_t address;
+  uint8_t network_id;
+  uint8_t sf;
+  uint8_t bw;          // 7: 125 kHz, 8: 250 kHz, 9: 500 kHz
+  uint8_t cr;          // 1: 4/5 ... 4: 4/8
+  uint8_t preamble;
+  uint8_t mode;
+  uint32_t band_hz;
+  uint8_t crfop;
+  // Traffic
+  uint32_t commands;
+  uint32_t errors;        // +ERR answers
+  uint32_t sends;
+  uint32_t received;      // +RCV reported
+  uint32_t missed;        // Frames that arrived while the module was transmitting
+  uint32_t flash_writes;  // Settings persisted with ",M"
+  uint64_t airtime_us;    // Total time on air of the frames sent
+} rylr998_emu_stats_t;
+
+// Frame sent by the module, called once its time on air has passed
+typedef void (*rylr998_emu_air_hook_t)(UartPort_t port, uint16_t destination, const char *payload, size_t length,
+                                       void *ctx);
+
+/* Functions -----------------------------------------------------------------*/
+/**
+ * @brief Install the emulator as the UART TX hook and start answering
+ * @param config Latency and time scale, NULL for 2 ms in real time
+ */
+void rylr998_emu_start(const rylr998_emu_config_t *config);
+
+/**
+ * @brief Set the hook that sees every frame the modules send
+ */
+void rylr998_emu_set_air_hook(rylr998_emu_air_hook_t hook, void *ctx);
+
+/**
+ * @brief An LSU sends a frame to the module behind port
+ * @param port Module receiving it
+ * @param from Address of the LSU
+ * @param payload ASCII payload, at most RYLR998_EMU_MAX_PAYLOAD bytes
+ * @param rssi RSSI the module reports, in dBm
+ * @param snr SNR the module reports, in dB
+ * @return true if the module will report it, false if it is transmitting or the payload is too long
+ */
+bool rylr998_emu_air_send(UartPort_t port, uint16_t from, const char *payload, int16_t rssi, int8_t snr);
+
+/**
+ * @brief Make a module misbehave, RYLR998_EMU_HEALTHY to heal it
+ */
+void rylr998_emu_set_fault(UartPort_t port, rylr998_emu_fault_t fault);
+
+/**
+ * @brief Settings and traffic counters of a module
+ */
+void rylr998_emu_get_stats(UartPort_t port, rylr998_emu_stats_t *stats);
+
+/**
+ * @brief Time on air of a LoRa frame with an explicit header and CRC, from rylr998_airtime_us()
+ * @param sf Spreading factor, 5 to 12
+ * @param bw Bandwidth code of AT+PARAMETER, 7 to 9
+ * @param cr Coding rate code of AT+PARAMETER, 1 to 4
+ * @param preamble Preamble length in symbols
+ * @param length Payload length in bytes
+ * @return Time on air in microseconds
+ */
+uint32_t rylr998_emu_airtime_us(uint8_t sf, uint8_t bw, uint8_t cr, uint8_t preamble, size_t length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RYLR998_EMU_H */
@@ -0,0 +1,138 @@
+/**
+  ******************************************************************************
+  * @authors        : Tomas Gonzalez & Brian Morris
+  * @file           : cu_stepper.cpp
+  * @brief          : Runs the CU core single-threaded on the manual host
+  *                   clock, the shard tasks and their timers become steps
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 Tomas Gonzalez & Brian Morris
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  */
+
+/* Includes ------------------------------------------------------------ */
+#include "cu_stepper.h"
+
+#include <cstdint>
+#include "hal_host.h"
+#include "host_boot.h"
+#include "shard_router.h"
+#include "coroutine.h"
+#include "general_config.h"
+#include "freertos/task.h"
+
+/* Private variables --------------------------------------------------------- */
+static int64_t now_us = 0;
+static ShardWorker workers[LSU_SHARD_COUNT];
+static TaskHandle_t shardHandles[LSU_SHARD_COUNT];
+
+// Deadlines of the timers process_requests_task() arms, INT64_MAX when idle
+static int64_t holdAt[LSU_SHARD_COUNT];
+static int64_t timeoutsAt[LSU_SHARD_COUNT];
+static int64_t housekeepingAt = INT64_MAX;
+
+/* Private functions --------------------------------------------------------- */
+// Earliest due timer or coroutine deadline, fires it and re-arms the periodic ones
+static bool fire_next(int64_t until_us) {
+  int64_t *next = &housekeepingAt;
+  int shard = LSU_COORDINATOR_SHARD;
+  uint32_t bits = SHARD_WAKE_HOUSEKEEPING;
+  for (int s = 0; s < LSU_SHARD_COUNT; s++) {
+    if (timeoutsAt[s] < *next) {
+      next = &timeoutsAt[s];
+      shard = s;
+      bits = SHARD_WAKE_TIMEOUTS;
+    }
+    if (holdAt[s] < *next) {
+      next = &holdAt[s];
+      shard = s;
+      bits = SHARD_WAKE_REQUEST;
+    }
+  }
+  // A coroutine sleeping or waiting for an answer only needs the clock, settle expires it
+  int64_t wait_us = coro_next_deadline();
+  if (wait_us < *next && wait_us <= until_us) {
+    if (wait_us > now_us) {
+      hal_host_clock_advance(wait_us - now_us);
+      now_us = wait_us;
+    }
+    return true;
+  }
+  if (*next > until_us) {
+    return false;
+  }
+
+  hal_host_clock_advance(*next - now_us);
+  now_us = *next;
+  switch (bits) {
+    case SHARD_WAKE_TIMEOUTS: *next += TIMEOUT_CHECK_INTERVAL_MS * 1000LL; break;
+    case SHARD_WAKE_HOUSEKEEPING: *next += HOUSEKEEPING_INTERVAL_MS * 1000LL; break;
+    default: *next = INT64_MAX; break;
+  }
+  xTaskNotify(shardHandles[shard], bits, eSetBits);
+  return true;
+}
+
+/* Functions ------------------------------------------------------------ */
+void cu_stepper_init(int64_t start_us) {
+  now_us = start_us;
+  hal_host_clock_manual(start_us);
+
+  host_core_init();
+
+  // The workers run on the caller's thread, their wake-ups land on handles polled by settle
+  for (int shard = 0; shard < LSU_SHARD_COUNT; shard++) {
+    shardHandles[shard] = hal_host_task_handle(shard == 0 ? "step_shard_0" : "step_shard_1");
+    shard_attach(shard, shardHandles[shard]);
+    shard_worker_init(workers[shard], shard);
+    holdAt[shard] = INT64_MAX;
+    timeoutsAt[shard] = now_us + TIMEOUT_CHECK_INTERVAL_MS * 1000LL;
+  }
+  housekeepingAt = now_us + HOUSEKEEPING_INTERVAL_MS * 1000LL;
+  shard_worker_restore(workers[LSU_COORDINATOR_SHARD]);
+  cu_stepper_settle();
+}
+
+void cu_stepper_settle() {
+  bool busy = true;
+  while (busy) {
+    busy = false;
+    coro_executor_poll();
+    for (int shard = 0; shard < LSU_SHARD_COUNT; shard++) {
+      uint32_t wake = ulTaskNotifyValueClear(shardHandles[shard], UINT32_MAX);
+      if (wake == 0) {
+        continue;
+      }
+      busy = true;
+      uint32_t hold_ms = shard_worker_step(workers[shard], wake);
+      // Same as re-arming the one-shot hold timer, only the earliest deadline counts
+      int64_t due_us = now_us + (int64_t) hold_ms * 1000;
+      if (hold_ms > 0 && due_us < holdAt[shard]) {
+        holdAt[shard] = due_us;
+      }
+    }
+  }
+}
+
+void cu_stepper_run_until(int64_t time_us) {
+  while (fire_next(time_us)) {
+    cu_stepper_settle();
+  }
+  if (time_us > now_us) {
+    hal_host_clock_advance(time_us - now_us);
+    now_us = time_us;
+  }
+}
+
+int64_t cu_stepper_now_us() {
+  return now_us;
+}
+
+ShardWorker& cu_stepper_worker(int shard) {
+  return workers[shard];
+}
@@ -0,0 +1,53 @@
+/**
+  ******************************************************************************
+  * @authors        : Tomas Gonzalez & Brian Morris
+  * @file           : cu_stepper.h
+  * @brief          : Runs the CU core single-threaded on the manual host
+  *                   clock, the shard tasks and their timers become steps
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 Tomas Gonzalez & Brian Morris
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef CU_STEPPER_H
+#define CU_STEPPER_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <cstdint>
+#include "process_requests.h"
+
+/**
+ * Shared by the fleet simulator and the UART replay. Both shard workers, the
+ * coroutine executor and the timers they arm run on the calling thread, so a
+ * run depends only on its inputs and the virtual clock.
+ */
+
+/* Functions -----------------------------------------------------------------*/
+/**
+ * @brief Stop the host clock at start_us, set up the queues and both shard workers, restore the fleet
+ */
+void cu_stepper_init(int64_t start_us);
+
+/**
+ * @brief Run coroutines and every woken shard until nobody has anything left to do
+ */
+void cu_stepper_settle();
+
+/**
+ * @brief Fire the firmware timers due up to time_us in order, settling after each
+ * @details The clock ends at time_us, it never moves backwards
+ */
+void cu_stepper_run_until(int64_t time_us);
+
+int64_t cu_stepper_now_us();
+
+ShardWorker& cu_stepper_worker(int shard);
+
+#endif /* CU_STEPPER_H */
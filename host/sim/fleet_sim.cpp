@@ -0,0 +1,686 @@
+/**
+  ******************************************************************************
+  * @authors        : Tomas Gonzalez & Brian Morris
+  * @file           : fleet_sim.cpp
+  * @brief          : Discrete-event fleet simulator, drives the real shard
+  *                   workers with thousands of simulated LSUs on a virtual clock
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 Tomas Gonzalez & Brian Morris
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  */
+
+/**
+ * Everything between the radio and the broker is the firmware code: the
+ * request queues, both shard workers, the fleet coordinator, the coroutine
+ * conversations and the NVS persistence. The simulator replaces the tasks
+ * and timers with events on a virtual clock, so a day takes seconds.
+ *
+ * Simulated LSUs:
+ * - boot with a temporary address and send SYNC on the join channel until a
+ *   CONFIG arrives
+ * - then send DATA once per period in their slot on the channel the CONFIG
+ *   named, their crystal drifting
+ * - rejoin after missing too many ACKs in a row
+ * Uplinks that overlap on the same channel are all lost, every packet may also
+ * be lost. A radio hears the uplinks and reaches the LSUs of the channel it is
+ * tuned to, and one of them can be made to fail part way through the run and
+ * come back later.
+ *
+ * Usage: fleet_sim [--lsus N] [--hours H] [--loss P] [--drift-ppm PPM] ...
+ * Run with --help for every option.
+ */
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <queue>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "hal_host.h"
+#include "request_queue.h"
+#include "coroutine.h"
+#include "cu_comms.h"
+#include "adr.h"
+#include "radio_roles.h"
+#include "radio_health.h"
+#include "rylr998.h"
+#include "process_requests.h"
+#include "tx_scheduler.h"
+#include "cu_stepper.h"
+#include "general_config.h"
+#include "esp_log.h"
+
+/* Defines ------------------------------------------------------------- */
+#define SIM_START_US       1000000  // Boot time of the CU on the virtual clock
+#define TEMP_ADDRESS_TOP   65535    // Unjoined LSUs count down from here
+#define REPORT_INTERVAL_US (3600LL * 1000000)
+
+/* Types --------------------------------------------------------------- */
+enum FailMode {
+  FAIL_MUTE,   // Answers nothing, hears nothing
+  FAIL_ERROR,  // Answers +ERR to everything, hears nothing
+  FAIL_DEAF,   // Answers +OK but neither sends nor hears
+};
+
+struct SimConfig {
+  uint32_t lsus = 1000;
+  double hours = 24;
+  double loss = 0.01;            // Per packet, uplink and downlink
+  double driftPpm = 20;          // Crystal error, each LSU draws from [-ppm, ppm]
+  uint32_t airtimeMs = 50;       // Time on air of one uplink, downlinks take the module time on air
+  uint32_t bootWindowS = 60;     // LSUs power on spread over this window
+  double stormAtHours = -1;      // Join storm, off when negative
+  double stormFraction = 1.0;    // Share of the fleet that reboots
+  uint32_t stormWindowS = 10;
+  RadioRoles roles = RADIO_ROLES_DEFAULT;
+  int failRadio = -1;            // Radio that dies, off when negative
+  double failAtHours = 1;
+  double recoverAtHours = -1;    // The failed radio works again, off when negative
+  FailMode failMode = FAIL_MUTE;
+  uint32_t rejoinAfter = 2;      // Missed ACKs in a row before joining again, the CU times out after two periods
+  uint32_t syncRetryMs = 5000;   // First wait for CONFIG before sending SYNC again
+  uint32_t syncBackoffMaxS = 600;  // Retries double up to this, jittered up to twice
+  uint64_t seed = 1;
+  double minJoined = 0;          // Exit with 1 below this joined share at the end
+  bool verbose = false;
+};
+
+enum LsuState { LSU_OFF, LSU_JOINING, LSU_JOINED };
+
+struct SimLsu {
+  LsuState state = LSU_OFF;
+  uint32_t address = 0;          // Temporary address until joined, then the assigned ID
+  uint32_t tempAddress = 0;
+  uint32_t epoch = 0;            // Bumped on state changes, stale events are ignored
+  double drift = 0;
+  int16_t rssi = 0;              // At full power
+  int8_t snr = 0;
+  uint32_t txPower = ADR_MAX_POWER_DBM;  // As the last CONFIG set it
+  uint32_t band = 0;             // Channel it sends and listens on
+  uint32_t missedAcks = 0;
+  uint32_t syncAttempts = 0;
+  int64_t joinStart_us = 0;
+  uint32_t configId = 0, configPeriod = 0, configNow = 0, configSlot = 0;  // Last CONFIG on the air
+  uint32_t pendingBand = 0;
+};
+
+struct SimRadio {
+  uint32_t band;
+  bool dead;
+};
+
+enum EventType {
+  EV_LSU_TX,       // a: LSU, b: epoch
+  EV_UPLINK_END,   // a: flight
+  EV_CONFIG_RX,    // a: LSU
+  EV_ACK_RX,       // a: LSU, b: address it was sent to
+  EV_STORM,
+  EV_RADIO_FAIL,
+  EV_RADIO_RECOVER,
+  EV_REPORT,
+};
+
+struct Event {
+  int64_t time_us;
+  uint64_t seq;
+  EventType type;
+  uint32_t a;
+  uint32_t b;
+  bool operator>(const Event& other) const {
+    return time_us != other.time_us ? time_us > other.time_us : seq > other.seq;
+  }
+};
+
+struct Flight {
+  uint32_t lsu;
+  uint32_t from;
+  uint32_t band;
+  bool sync;
+  bool collided;
+  int64_t end_us;
+};
+
+struct SimStats {
+  uint64_t events = 0;
+  uint64_t uplinks = 0, collided = 0, lost = 0, delivered = 0;
+  uint64_t syncs = 0, configsSent = 0, configsLost = 0, joins = 0, rejoins = 0;
+  uint64_t acksSent = 0, acksLost = 0;
+  uint64_t linkPushes = 0;
+  uint64_t moves = 0, unheard = 0, offChannel = 0;
+  int64_t failedAt_us = 0;
+  uint64_t channelUplinks[RADIO_COUNT] = {};
+  uint64_t dataPublishes = 0, alerts = 0, snapshots = 0;
+  int64_t joinSum_us = 0, joinMax_us = 0;
+  size_t maxQueueDepth = 0;
+  uint32_t highestId = 0;
+};
+
+/* Private variables --------------------------------------------------------- */
+static SimConfig config;
+static SimStats stats;
+static std::mt19937_64 rng;
+static std::vector<SimLsu> lsus;
+static SimRadio radios[RADIO_COUNT];
+static std::unordered_map<uint32_t, uint32_t> byAddress;
+static std::vector<Flight> flights;
+static std::vector<uint32_t> freeFlights;
+static std::vector<uint32_t> onAir;
+static std::priority_queue<Event, std::vector<Event>, std::greater<Event>> events;
+static uint64_t nextSeq = 0;
+static int64_t now_us = SIM_START_US;
+
+/* Private functions --------------------------------------------------------- */
+static double uniform(double low, double high) {
+  return std::uniform_real_distribution<double>(low, high)(rng);
+}
+
+static bool lost() {
+  return config.loss > 0 && uniform(0, 1) < config.loss;
+}
+
+static void schedule(int64_t time_us, EventType type, uint32_t a = 0, uint32_t b = 0) {
+  events.push(Event{time_us, nextSeq++, type, a, b});
+}
+
+// Index of a channel in the stats, the radio the roles put on it
+static int band_index(uint32_t band) {
+  return band == RYLR_MAIN_BAND_HZ ? UART_PORT_MAIN : UART_PORT_AUX;
+}
+
+// Local time of an LSU runs fast or slow by its drift
+static int64_t lsu_delay_us(const SimLsu& lsu, int64_t local_us) {
+  return (int64_t) ((double) local_us / (1.0 + lsu.drift));
+}
+
+static void start_join(uint32_t index, int64_t at_us) {
+  SimLsu& lsu = lsus[index];
+  lsu.state = LSU_JOINING;
+  lsu.address = lsu.tempAddress;
+  lsu.missedAcks = 0;
+  lsu.syncAttempts = 0;
+  lsu.joinStart_us = at_us;
+  lsu.band = radio_band_hz(RADIO_JOIN_PORT);
+  lsu.epoch++;
+  schedule(at_us, EV_LSU_TX, index, lsu.epoch);
+}
+
+/* Radio --------------------------------------------------------------- */
+// Plays the CU radios: every command is accepted, sends reach the LSUs
+static void on_radio_tx(UartPort_t port, const char *data, uint16_t length, void *ctx) {
+  (void) ctx;
+  SimRadio& radio = radios[port];
+  if (radio.dead && config.failMode == FAIL_MUTE) {
+    return;
+  }
+  const char *answer = radio.dead && config.failMode == FAIL_ERROR ? "+ERR=4\r\n" : "+OK\r\n";
+  RYLR_response_t response;
+  rylr998_parseLine(answer, strlen(answer), &response);
+  CU_onResponse(port, &response);
+  if (radio.dead) {
+    return;
+  }
+
+  std::string command(data, length);
+  unsigned long band;
+  if (sscanf(command.c_str(), "AT+BAND=%lu", &band) == 1) {
+    radio.band = band;
+    return;
+  }
+  unsigned long destination;
+  int offset = 0;
+  if (sscanf(command.c_str(), "AT+SEND=%lu,%*d,%n", &destination, &offset) != 1 || offset == 0) {
+    return;
+  }
+  auto target = byAddress.find(destination);
+  if (target == byAddress.end()) {
+    return;
+  }
+  uint32_t index = target->second;
+  SimLsu& lsu = lsus[index];
+  if (lsu.band != radio.band) {
+    stats.offChannel++;
+    return;
+  }
+  const char *payload = command.c_str() + offset;
+  // Downlinks take the time on air the module settings give them, from the firmware clock: a
+  // conversation that waited for a gap sends after the event that queued it
+  int64_t arrival_us = cu_stepper_now_us() + rylr998_airtime_us(rylr998_getConfig(port), strlen(payload) - 2);
+
+  if (strncmp(payload, "CONFIG-", 7) == 0) {
+    stats.configsSent++;
+    if (lost()) {
+      stats.configsLost++;
+      return;
+    }
+    unsigned long id, period, now, slot, sf, power, band;
+    int fields = sscanf(payload, "CONFIG-%lu-%lu-%lu-%lu-%lu-%lu-%lu", &id, &period, &now, &slot, &sf, &power, &band);
+    if (fields != 7) {
+      return;
+    }
+    lsu.txPower = power;
+    lsu.pendingBand = band;
+    lsu.configId = id;
+    lsu.configPeriod = period;
+    lsu.configNow = now;
+    lsu.configSlot = slot;
+    schedule(arrival_us, EV_CONFIG_RX, index);
+  } else if (strncmp(payload, "ACK", 3) == 0) {
+    stats.acksSent++;
+    if (lost()) {
+      stats.acksLost++;
+      return;
+    }
+    schedule(arrival_us, EV_ACK_RX, index, destination);
+  }
+}
+
+static void on_publish(const char *topic, const char *payload, bool retained, void *ctx) {
+  (void) retained;
+  (void) ctx;
+  size_t length = strlen(topic);
+  auto ends_with = [topic, length](const char *suffix) {
+    size_t suffixLength = strlen(suffix);
+    return length >= suffixLength && strcmp(topic + length - suffixLength, suffix) == 0;
+  };
+  if (ends_with("/data")) {
+    stats.dataPublishes++;
+  } else if (ends_with("/alert")) {
+    stats.alerts++;
+  } else if (ends_with("/fleet")) {
+    stats.snapshots++;
+  } else if (strcmp(topic, RADIO_HEALTH_TOPIC) == 0) {
+    printf("# %s at %.2f h\n", payload, (now_us - SIM_START_US) / 3.6e9);
+  }
+}
+
+/* Events -------------------------------------------------------------- */
+static void lsu_transmit(uint32_t index, uint32_t epoch) {
+  SimLsu& lsu = lsus[index];
+  if (epoch != lsu.epoch || lsu.state == LSU_OFF) {
+    return;
+  }
+
+  if (lsu.state == LSU_JOINED) {
+    if (lsu.missedAcks >= config.rejoinAfter) {
+      stats.rejoins++;
+      start_join(index, now_us);
+      return;
+    }
+    lsu.missedAcks++;
+    schedule(now_us + lsu_delay_us(lsu, (int64_t) lsu.configPeriod * 1000), EV_LSU_TX, index, lsu.epoch);
+  } else {
+    stats.syncs++;
+    // Exponential backoff, a fleet retrying at a fixed rate saturates the channel
+    int64_t backoff_us = std::min((int64_t) config.syncRetryMs * 1000 << std::min(lsu.syncAttempts, 20u),
+                                  (int64_t) config.syncBackoffMaxS * 1000000);
+    lsu.syncAttempts++;
+    int64_t retry_us = (int64_t) (backoff_us * uniform(1.0, 2.0));
+    schedule(now_us + retry_us, EV_LSU_TX, index, lsu.epoch);
+  }
+
+  // Anything still on the air collides with this packet, and the other way round
+  uint32_t flight;
+  if (!freeFlights.empty()) {
+    flight = freeFlights.back();
+    freeFlights.pop_back();
+  } else {
+    flight = flights.size();
+    flights.emplace_back();
+  }
+  flights[flight] = Flight{index, lsu.address, lsu.band, lsu.state == LSU_JOINING, false,
+                           now_us + (int64_t) config.airtimeMs * 1000};
+  for (uint32_t other : onAir) {
+    if (flights[other].band == lsu.band) {
+      flights[other].collided = true;
+      flights[flight].collided = true;
+    }
+  }
+  onAir.push_back(flight);
+  stats.uplinks++;
+  stats.channelUplinks[band_index(lsu.band)]++;
+  schedule(flights[flight].end_us, EV_UPLINK_END, flight);
+}
+
+static void uplink_end(uint32_t flight) {
+  onAir.erase(std::find(onAir.begin(), onAir.end(), flight));
+  freeFlights.push_back(flight);
+  const Flight& packet = flights[flight];
+  if (packet.collided) {
+    stats.collided++;
+    return;
+  }
+  if (lost()) {
+    stats.lost++;
+    return;
+  }
+
+  // Heard by the radio tuned to its channel, if that one is alive
+  int port = 0;
+  while (port < RADIO_COUNT && (radios[port].dead || radios[port].band != packet.band)) {
+    port++;
+  }
+  if (port == RADIO_COUNT) {
+    stats.unheard++;
+    return;
+  }
+
+  // What the RX task does with a +RCV
+  stats.delivered++;
+  const SimLsu& lsu = lsus[packet.lsu];
+  int16_t backoff = (int16_t) (ADR_MAX_POWER_DBM - lsu.txPower);
+  const char *data = packet.sync ? "SYNC" : "DATA-T38.6";
+  post_request(data, (uint16_t) packet.from, (UartPort_t) port, lsu.rssi - backoff, (int8_t) (lsu.snr - backoff),
+               now_us);
+  tx_scheduler_record_rx((UartPort_t) port, strlen(data));
+  radio_health_record((UartPort_t) port, RADIO_EVENT_RX);
+  stats.maxQueueDepth = std::max(stats.maxQueueDepth,
+                                 request_queue_depth(UART_PORT_MAIN) + request_queue_depth(UART_PORT_AUX));
+}
+
+static void config_received(uint32_t index) {
+  SimLsu& lsu = lsus[index];
+  if (lsu.state == LSU_JOINED) {
+    if (lsu.configId != lsu.address) {
+      return;  // Duplicate join CONFIG, the first one won
+    }
+    // New settings for a joined LSU, it takes the clock and slot again and sends at the new power
+    stats.linkPushes++;
+    stats.moves += lsu.pendingBand != lsu.band ? 1 : 0;
+  } else {
+    lsu.state = LSU_JOINED;
+    lsu.address = lsu.configId;
+    byAddress[lsu.address] = index;
+    stats.joins++;
+    stats.highestId = std::max(stats.highestId, lsu.configId);
+    int64_t join_us = now_us - lsu.joinStart_us;
+    stats.joinSum_us += join_us;
+    stats.joinMax_us = std::max(stats.joinMax_us, join_us);
+  }
+  lsu.band = lsu.pendingBand;
+  lsu.missedAcks = 0;
+  lsu.epoch++;
+
+  // First DATA in the assigned slot, as told by the CU clock in the CONFIG
+  uint32_t period = lsu.configPeriod > 0 ? lsu.configPeriod : TIME_PERIOD_MS;
+  uint32_t wait_ms = (lsu.configSlot + period - lsu.configNow % period) % period;
+  if (wait_ms == 0) {
+    wait_ms = period;
+  }
+  lsu.configPeriod = period;
+  schedule(now_us + lsu_delay_us(lsu, (int64_t) wait_ms * 1000), EV_LSU_TX, index, lsu.epoch);
+}
+
+static void ack_received(uint32_t index, uint32_t address) {
+  SimLsu& lsu = lsus[index];
+  if (lsu.state == LSU_JOINED && lsu.address == address) {
+    lsu.missedAcks = 0;
+  }
+}
+
+static void radio_fail() {
+  radios[config.failRadio].dead = true;
+  stats.failedAt_us = now_us;
+  printf("# radio %s dies at %.2f h\n", config.failRadio == UART_PORT_MAIN ? "main" : "aux",
+         (now_us - SIM_START_US) / 3.6e9);
+}
+
+static void radio_recover() {
+  radios[config.failRadio].dead = false;
+  printf("# radio %s works again at %.2f h\n", config.failRadio == UART_PORT_MAIN ? "main" : "aux",
+         (now_us - SIM_START_US) / 3.6e9);
+}
+
+static void storm() {
+  uint32_t rebooted = 0;
+  for (uint32_t index = 0; index < lsus.size(); index++) {
+    if (uniform(0, 1) < config.stormFraction) {
+      start_join(index, now_us + (int64_t) (uniform(0, config.stormWindowS) * 1000000));
+      rebooted++;
+    }
+  }
+  printf("# join storm: %u LSUs rebooted at %.2f h\n", rebooted, (now_us - SIM_START_US) / 3.6e9);
+}
+
+static uint32_t joined_count() {
+  return std::count_if(lsus.begin(), lsus.end(), [](const SimLsu& lsu) { return lsu.state == LSU_JOINED; });
+}
+
+static uint32_t registered_count() {
+  status_model_t display;
+  hal_host_display_get(&display);
+  return display.lsu_count;
+}
+
+static void report() {
+  printf("%8.2f %9u %10u %10" PRIu64 " %9" PRIu64 " %9" PRIu64 " %8" PRIu64 " %8" PRIu64 " %8" PRIu64 " %8u\n",
+         (now_us - SIM_START_US) / 3.6e9, joined_count(), registered_count(), stats.delivered, stats.collided,
+         stats.lost, stats.alerts, stats.rejoins, stats.joins, hal_host_nvs_commits());
+}
+
+/* Setup --------------------------------------------------------------- */
+static void usage() {
+  printf("Usage: fleet_sim [options]\n"
+         "  --lsus N              Fleet size (1000)\n"
+         "  --hours H             Simulated time (24)\n"
+         "  --loss P              Packet loss probability, both directions (0.01)\n"
+         "  --drift-ppm PPM       Crystal error bound of the LSUs (20)\n"
+         "  --airtime-ms MS       Time on air of one uplink (50)\n"
+         "  --boot-window-s S     Power-on spread of the fleet (60)\n"
+         "  --storm-at-hours H    Reboot part of the fleet at once (off)\n"
+         "  --storm-fraction F    Share of the fleet in the storm (1.0)\n"
+         "  --storm-window-s S    Spread of the storm (10)\n"
+         "  --rejoin-after N      Missed ACKs in a row before joining again (2)\n"
+         "  --sync-retry-ms MS    First SYNC retry interval (5000)\n"
+         "  --sync-backoff-max-s S  Longest SYNC retry interval, jittered up to twice (600)\n"
+         "  --roles R             Radio roles, join-data or split (join-data)\n"
+         "  --fail-radio R        Radio that dies, main or aux (off)\n"
+         "  --fail-at-hours H     When it dies (1)\n"
+         "  --recover-at-hours H  When it works again, the CU must use it by the end (off)\n"
+         "  --fail-mode M         mute, error (+ERR) or deaf (mute)\n"
+         "  --seed N              Random seed (1)\n"
+         "  --min-joined F        Exit with 1 if a smaller share is joined at the end (0)\n"
+         "  --verbose             Firmware logs down to INFO\n"
+         "Fleets above %d LSUs need the cu_core_fleet build, see host/CMakeLists.txt\n", MAX_LSU_COUNT);
+}
+
+static bool parse_args(int argc, char **argv) {
+  for (int i = 1; i < argc; i++) {
+    std::string option = argv[i];
+    if (option == "--verbose") {
+      config.verbose = true;
+      continue;
+    }
+    if (option == "--help" || i + 1 >= argc) {
+      return false;
+    }
+    if (option == "--roles") {
+      std::string roles = argv[++i];
+      if (roles != "join-data" && roles != "split") {
+        return false;
+      }
+      config.roles = roles == "split" ? RADIO_ROLES_SPLIT : RADIO_ROLES_JOIN_DATA;
+      continue;
+    }
+    if (option == "--fail-radio") {
+      std::string radio = argv[++i];
+      if (radio != "main" && radio != "aux") {
+        return false;
+      }
+      config.failRadio = radio == "main" ? UART_PORT_MAIN : UART_PORT_AUX;
+      continue;
+    }
+    if (option == "--fail-mode") {
+      std::string mode = argv[++i];
+      if (mode == "mute") config.failMode = FAIL_MUTE;
+      else if (mode == "error") config.failMode = FAIL_ERROR;
+      else if (mode == "deaf") config.failMode = FAIL_DEAF;
+      else {
+        return false;
+      }
+      continue;
+    }
+    double value = atof(argv[++i]);
+    if (option == "--lsus") config.lsus = (uint32_t) value;
+    else if (option == "--hours") config.hours = value;
+    else if (option == "--loss") config.loss = value;
+    else if (option == "--drift-ppm") config.driftPpm = value;
+    else if (option == "--airtime-ms") config.airtimeMs = (uint32_t) value;
+    else if (option == "--boot-window-s") config.bootWindowS = (uint32_t) value;
+    else if (option == "--storm-at-hours") config.stormAtHours = value;
+    else if (option == "--storm-fraction") config.stormFraction = value;
+    else if (option == "--storm-window-s") config.stormWindowS = (uint32_t) value;
+    else if (option == "--fail-at-hours") config.failAtHours = value;
+    else if (option == "--recover-at-hours") config.recoverAtHours = value;
+    else if (option == "--rejoin-after") config.rejoinAfter = (uint32_t) value;
+    else if (option == "--sync-retry-ms") config.syncRetryMs = (uint32_t) value;
+    else if (option == "--sync-backoff-max-s") config.syncBackoffMaxS = (uint32_t) value;
+    else if (option == "--seed") config.seed = strtoull(argv[i], NULL, 10);
+    else if (option == "--min-joined") config.minJoined = value;
+    else {
+      return false;
+    }
+  }
+  return config.lsus > 0 && config.lsus < TEMP_ADDRESS_TOP / 2;
+}
+
+static void setup_fleet() {
+  lsus.resize(config.lsus);
+  for (uint32_t index = 0; index < config.lsus; index++) {
+    SimLsu& lsu = lsus[index];
+    lsu.tempAddress = TEMP_ADDRESS_TOP - index;
+    lsu.drift = uniform(-config.driftPpm, config.driftPpm) * 1e-6;
+    lsu.rssi = (int16_t) uniform(-120, -60);
+    lsu.snr = (int8_t) uniform(-10, 10);
+    byAddress[lsu.tempAddress] = index;
+    start_join(index, SIM_START_US + (int64_t) (uniform(0, config.bootWindowS) * 1000000));
+  }
+}
+
+static void setup_firmware() {
+  esp_log_level_set("*", config.verbose ? ESP_LOG_INFO : ESP_LOG_ERROR);
+  hal_host_set_publish_hook(on_publish, NULL);
+  hal_host_uart_set_tx_hook(on_radio_tx, NULL);
+
+  radio_roles_set(config.roles);
+  for (int port = 0; port < RADIO_COUNT; port++) {
+    radios[port] = SimRadio{radio_band_hz((UartPort_t) port), false};
+  }
+  cu_stepper_init(SIM_START_US);
+}
+
+/* Main ---------------------------------------------------------------- */
+int main(int argc, char **argv) {
+  if (!parse_args(argc, argv)) {
+    usage();
+    return 2;
+  }
+  rng.seed(config.seed);
+  setup_firmware();
+  setup_fleet();
+
+  int64_t end_us = SIM_START_US + (int64_t) (config.hours * 3.6e9);
+  if (config.stormAtHours >= 0) {
+    schedule(SIM_START_US + (int64_t) (config.stormAtHours * 3.6e9), EV_STORM);
+  }
+  if (config.failRadio >= 0) {
+    schedule(SIM_START_US + (int64_t) (config.failAtHours * 3.6e9), EV_RADIO_FAIL);
+    if (config.recoverAtHours >= 0) {
+      schedule(SIM_START_US + (int64_t) (config.recoverAtHours * 3.6e9), EV_RADIO_RECOVER);
+    }
+  }
+  schedule(SIM_START_US + REPORT_INTERVAL_US, EV_REPORT);
+
+  printf("# %u LSUs, %.1f h, loss %.3f, drift %.0f ppm, airtime %u ms, seed %" PRIu64 "\n", config.lsus,
+         config.hours, config.loss, config.driftPpm, config.airtimeMs, config.seed);
+  printf("%8s %9s %10s %10s %9s %9s %8s %8s %8s %8s\n", "hours", "joined", "registered", "delivered",
+         "collided", "lost", "timeouts", "rejoins", "joins", "nvs");
+
+  auto wallStart = std::chrono::steady_clock::now();
+  while (!events.empty() && events.top().time_us <= end_us) {
+    Event event = events.top();
+    events.pop();
+    // The firmware timers due before the event fire first
+    cu_stepper_run_until(event.time_us);
+    now_us = event.time_us;
+    stats.events++;
+
+    switch (event.type) {
+      case EV_LSU_TX: lsu_transmit(event.a, event.b); break;
+      case EV_UPLINK_END: uplink_end(event.a); break;
+      case EV_CONFIG_RX: config_received(event.a); break;
+      case EV_ACK_RX: ack_received(event.a, event.b); break;
+      case EV_STORM: storm(); break;
+      case EV_RADIO_FAIL: radio_fail(); break;
+      case EV_RADIO_RECOVER: radio_recover(); break;
+      case EV_REPORT:
+        report();
+        schedule(now_us + REPORT_INTERVAL_US, EV_REPORT);
+        break;
+    }
+    cu_stepper_settle();
+  }
+  double wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+
+  uint32_t joined = joined_count();
+  double simulated_s = (now_us - SIM_START_US) / 1e6;
+  printf("\n# Summary\n");
+  printf("simulated_h        %.2f\n", simulated_s / 3600);
+  printf("wall_s             %.2f (%.0fx real time, %" PRIu64 " events)\n", wall_s,
+         wall_s > 0 ? simulated_s / wall_s : 0, stats.events);
+  printf("joined             %u of %u (%u registered on the CU)\n", joined, config.lsus, registered_count());
+  printf("uplinks            %" PRIu64 " (collided %.2f%%, lost %.2f%%, delivered %.2f%%)\n", stats.uplinks,
+         100.0 * stats.collided / std::max<uint64_t>(stats.uplinks, 1),
+         100.0 * stats.lost / std::max<uint64_t>(stats.uplinks, 1),
+         100.0 * stats.delivered / std::max<uint64_t>(stats.uplinks, 1));
+  printf("joins              %" PRIu64 " from %" PRIu64 " SYNC, %" PRIu64 " CONFIG sent, %" PRIu64 " lost\n",
+         stats.joins, stats.syncs, stats.configsSent, stats.configsLost);
+  printf("join_time_s        mean %.2f, max %.2f\n",
+         stats.joins > 0 ? stats.joinSum_us / 1e6 / stats.joins : 0.0, stats.joinMax_us / 1e6);
+  printf("rejoins            %" PRIu64 " after %u missed ACKs\n", stats.rejoins, config.rejoinAfter);
+  printf("timeouts           %" PRIu64 " LSUs removed by the CU\n", stats.alerts);
+  printf("acks               %" PRIu64 " sent, %" PRIu64 " lost\n", stats.acksSent, stats.acksLost);
+  uint64_t powerSum = 0;
+  for (const SimLsu& lsu : lsus) {
+    powerSum += lsu.state == LSU_JOINED ? lsu.txPower : 0;
+  }
+  printf("channels           main %s %" PRIu64 " uplinks, aux %s %" PRIu64 " uplinks\n",
+         radio_role_name(UART_PORT_MAIN), stats.channelUplinks[UART_PORT_MAIN], radio_role_name(UART_PORT_AUX),
+         stats.channelUplinks[UART_PORT_AUX]);
+  printf("adr                %" PRIu64 " link setting pushes, mean TX power %.1f dBm\n", stats.linkPushes,
+         joined > 0 ? (double) powerSum / joined : 0.0);
+  if (config.failRadio >= 0) {
+    printf("failover           %" PRIu64 " LSUs moved channel, %" PRIu64 " uplinks unheard, %" PRIu64
+           " downlinks off channel\n", stats.moves, stats.unheard, stats.offChannel);
+  }
+  printf("publishes          %" PRIu64 " data, %" PRIu64 " fleet snapshots\n", stats.dataPublishes,
+         stats.snapshots);
+  printf("nvs_commits        %u (%.1f per hour)\n", hal_host_nvs_commits(),
+         simulated_s > 0 ? hal_host_nvs_commits() / (simulated_s / 3600) : 0.0);
+  printf("request_queue      max depth %zu, %u dropped\n", stats.maxQueueDepth, request_queue_dropped());
+  printf("highest_id         %u\n", stats.highestId);
+  printf("coroutine_frames   %zu alive, %u dropped\n", coro_frames_alive(), coro_dropped());
+  fflush(stdout);
+
+  bool passed = joined >= config.minJoined * config.lsus;
+  if (!passed) {
+    fprintf(stderr, "FAIL: %u of %u LSUs joined, expected at least %.0f%%\n", joined, config.lsus,
+            config.minJoined * 100);
+  }
+  if (config.failRadio >= 0 && config.recoverAtHours >= 0 && !radio_health_alive((UartPort_t) config.failRadio)) {
+    fprintf(stderr, "FAIL: radio %d works again but is not used\n", config.failRadio);
+    passed = false;
+  }
+  // The firmware statics are never torn down on the target either
+  std::_Exit(passed ? EXIT_SUCCESS : EXIT_FAILURE);
+}
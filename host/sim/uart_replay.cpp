@@ -0,0 +1,311 @@
+/**
+  ******************************************************************************
+  * @authors        : Tomas Gonzalez & Brian Morris
+  * @file           : uart_replay.cpp
+  * @brief          : Replays a UART trace captured on the CU through the host
+  *                   build, on the virtual clock and in the captured order
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 Tomas Gonzalez & Brian Morris
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  */
+
+/**
+ * The trace is either the raw partition or the TRACE_EXPORT messages saved
+ * one per line, as "mosquitto_sub -t livestock/cu/trace -v" prints them.
+ * Every read is injected into its port and handed to rx_channel_receive() at
+ * its captured time, the shard workers and timers run on cu_stepper. Nothing
+ * is answered on the air, the module answers are in the trace.
+ *
+ * The same trace always gives the same run. --print lists the reads, radio
+ * commands and publishes with their times, diff two builds with it.
+ *
+ * Usage: uart_replay [--speed X] [--print] [--verbose] <trace>
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "hal_host.h"
+#include "uart_trace.h"
+#include "rx_channel.h"
+#include "request_queue.h"
+#include "coroutine.h"
+#include "cu_stepper.h"
+#include "esp_log.h"
+
+/* Types --------------------------------------------------------------- */
+struct ReplayConfig {
+  double speed = 0;  // 1 paces the run like the capture, N runs N times faster, 0 never waits
+  bool print = false;
+  bool verbose = false;
+  const char *path = NULL;
+};
+
+struct ReplayStats {
+  uint64_t records = 0, reads = 0, bytes = 0;
+  uint64_t frames = 0, answers = 0;  // +RCV lines and module answers
+  uint64_t txCommands = 0, sends = 0;
+  std::map<std::string, uint64_t> publishes;
+};
+
+/* Private variables --------------------------------------------------------- */
+static ReplayConfig config;
+static ReplayStats stats;
+static int64_t traceStart_us = 0;
+
+/* Private functions --------------------------------------------------------- */
+static void usage() {
+  fprintf(stderr,
+          "Usage: uart_replay [options] <trace>\n"
+          "  <trace>       raw trace partition or the TRACE_EXPORT messages, one per line\n"
+          "  --speed X     1 replays at the captured pace, X times faster above, 0 as fast as possible (0)\n"
+          "  --print       list reads, radio commands and publishes with their times\n"
+          "  --verbose     firmware logs on stderr\n");
+}
+
+static bool parse_args(int argc, char **argv) {
+  for (int i = 1; i < argc; i++) {
+    std::string option = argv[i];
+    if (option == "--print") {
+      config.print = true;
+    } else if (option == "--verbose") {
+      config.verbose = true;
+    } else if (option == "--speed" && i + 1 < argc) {
+      config.speed = atof(argv[++i]);
+    } else if (option.starts_with("--") || config.path != NULL) {
+      return false;
+    } else {
+      config.path = argv[i];
+    }
+  }
+  return config.path != NULL && config.speed >= 0;
+}
+
+static int base64_value(char c) {
+  if (c >= 'A' && c <= 'Z') return c - 'A';
+  if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+  if (c >= '0' && c <= '9') return c - '0' + 52;
+  if (c == '+') return 62;
+  if (c == '/') return 63;
+  return -1;
+}
+
+static bool base64_decode(const std::string& text, std::vector<uint8_t>& out) {
+  uint32_t block = 0;
+  int bits = 0;
+  for (char c : text) {
+    if (c == '=') {
+      break;
+    }
+    int value = base64_value(c);
+    if (value < 0) {
+      return false;
+    }
+    block = block << 6 | value;
+    bits += 6;
+    if (bits >= 8) {
+      bits -= 8;
+      out.push_back((uint8_t) (block >> bits));
+    }
+  }
+  return true;
+}
+
+// "<offset> <base64>" per message, the topic may come first, "<offset> END" closes it
+static bool parse_export(const std::string& text, std::vector<uint8_t>& trace) {
+  std::istringstream lines(text);
+  std::string line;
+  bool ended = false;
+  while (std::getline(lines, line)) {
+    std::istringstream fields(line);
+    std::vector<std::string> words;
+    std::string word;
+    while (fields >> word) {
+      words.push_back(word);
+    }
+    if (words.size() < 2) {
+      continue;
+    }
+    size_t offset = strtoul(words[words.size() - 2].c_str(), NULL, 10);
+    const std::string& body = words.back();
+    if (body == "END") {
+      trace.resize(offset);
+      ended = true;
+      continue;
+    }
+    std::vector<uint8_t> chunk;
+    if (!base64_decode(body, chunk)) {
+      fprintf(stderr, "Bad base64 at offset %zu\n", offset);
+      return false;
+    }
+    if (trace.size() < offset + chunk.size()) {
+      trace.resize(offset + chunk.size(), 0xFF);
+    }
+    std::copy(chunk.begin(), chunk.end(), trace.begin() + offset);
+  }
+  if (!ended) {
+    fprintf(stderr, "Export has no END message, replaying what arrived\n");
+  }
+  return true;
+}
+
+static bool load_trace(const char *path, std::vector<uint8_t>& trace) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    fprintf(stderr, "Cannot open %s\n", path);
+    return false;
+  }
+  std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  if (content.starts_with(UART_TRACE_MAGIC)) {
+    trace.assign(content.begin(), content.end());
+    return true;
+  }
+  return parse_export(content, trace);
+}
+
+static double trace_seconds(int64_t time_us) {
+  return (time_us - traceStart_us) / 1e6;
+}
+
+// Readable on one line, the radio strings end with "\r\n"
+static std::string printable(const char *data, size_t length) {
+  std::string out;
+  for (size_t i = 0; i < length; i++) {
+    char c = data[i];
+    if (c == '\r') out += "\\r";
+    else if (c == '\n') out += "\\n";
+    else if (c >= 32 && c < 127) out += c;
+    else {
+      char hex[8];
+      snprintf(hex, sizeof(hex), "\\x%02x", (uint8_t) c);
+      out += hex;
+    }
+  }
+  return out;
+}
+
+static void on_radio_tx(UartPort_t port, const char *data, uint16_t length, void *ctx) {
+  (void) ctx;
+  stats.txCommands++;
+  if (length > 8 && strncmp(data, "AT+SEND=", 8) == 0) {
+    stats.sends++;
+  }
+  if (config.print) {
+    printf("%12.6f tx  %d %s\n", trace_seconds(hal_time_us()), port, printable(data, length).c_str());
+  }
+}
+
+static void on_publish(const char *topic, const char *payload, bool retained, void *ctx) {
+  (void) retained;
+  (void) ctx;
+  stats.publishes[topic]++;
+  if (config.print) {
+    printf("%12.6f pub %s %s\n", trace_seconds(hal_time_us()), topic, payload);
+  }
+}
+
+/* Main ---------------------------------------------------------------- */
+int main(int argc, char **argv) {
+  if (!parse_args(argc, argv)) {
+    usage();
+    return 2;
+  }
+  std::vector<uint8_t> trace;
+  if (!load_trace(config.path, trace)) {
+    return 1;
+  }
+
+  size_t pos = 0;
+  uart_trace_record_t record = {};
+  std::vector<uart_trace_record_t> records;
+  while (uart_trace_decode(trace.data(), trace.size(), &pos, &record)) {
+    records.push_back(record);
+  }
+  if (pos == 0) {
+    fprintf(stderr, "%s is not a UART trace\n", config.path);
+    return 1;
+  }
+  // The firmware clock starts where the capture started, the header holds it
+  for (int i = 0; i < 8; i++) {
+    traceStart_us |= (int64_t) ((uint64_t) trace[8 + i] << (8 * i));
+  }
+
+  esp_log_level_set("*", config.verbose ? ESP_LOG_INFO : ESP_LOG_ERROR);
+  hal_host_set_publish_hook(on_publish, NULL);
+  hal_host_uart_set_tx_hook(on_radio_tx, NULL);
+  cu_stepper_init(traceStart_us);
+
+  auto wallStart = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < records.size();) {
+    const uart_trace_record_t& first = records[i];
+    cu_stepper_run_until(first.time_us);
+    if (config.speed > 0) {
+      auto due = wallStart + std::chrono::microseconds((int64_t) ((first.time_us - traceStart_us) / config.speed));
+      std::this_thread::sleep_until(due);
+    }
+
+    // Reads longer than a record were split, the pieces follow at the same time
+    std::string read((const char*) first.data, first.length);
+    stats.records++;
+    size_t next = i + 1;
+    while (next < records.size() && records[next - 1].length == UART_TRACE_MAX_RECORD &&
+           records[next].port == first.port && records[next].time_us == first.time_us) {
+      read.append((const char*) records[next].data, records[next].length);
+      stats.records++;
+      next++;
+    }
+    i = next;
+
+    stats.reads++;
+    stats.bytes += read.size();
+    if (read.starts_with("+RCV=")) {
+      stats.frames++;
+    } else {
+      stats.answers++;
+    }
+    if (config.print) {
+      printf("%12.6f rx  %d %s\n", trace_seconds(first.time_us), first.port, printable(read.data(), read.size()).c_str());
+    }
+    UartPort_t port = first.port == 0 ? UART_PORT_MAIN : UART_PORT_AUX;
+    hal_host_uart_inject(port, read.data(), read.size());
+    rx_channel_receive(port);
+    cu_stepper_settle();
+  }
+  // Let the last holds, timeouts and publishes play out
+  int64_t end_us = records.empty() ? traceStart_us : records.back().time_us;
+  cu_stepper_run_until(end_us + HOUSEKEEPING_INTERVAL_MS * 1000LL);
+  double wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+
+  double traced_s = trace_seconds(end_us);
+  printf("# Replay of %s\n", config.path);
+  printf("trace_s            %.3f\n", traced_s);
+  printf("wall_s             %.3f (%.0fx the captured pace)\n", wall_s, wall_s > 0 ? traced_s / wall_s : 0);
+  printf("records            %" PRIu64 " in %" PRIu64 " reads, %" PRIu64 " bytes\n", stats.records, stats.reads,
+         stats.bytes);
+  printf("rcv_frames         %" PRIu64 "\n", stats.frames);
+  printf("module_answers     %" PRIu64 "\n", stats.answers);
+  printf("throughput         %.0f reads/s\n", wall_s > 0 ? stats.reads / wall_s : 0);
+  printf("radio_commands     %" PRIu64 " (%" PRIu64 " AT+SEND)\n", stats.txCommands, stats.sends);
+  for (const auto& [topic, count] : stats.publishes) {
+    printf("publishes          %" PRIu64 " on %s\n", count, topic.c_str());
+  }
+  printf("request_queue      %u dropped\n", request_queue_dropped());
+  printf("coroutine_frames   %zu alive, %u dropped\n", coro_frames_alive(), coro_dropped());
+  fflush(stdout);
+  std::_Exit(EXIT_SUCCESS);
+}
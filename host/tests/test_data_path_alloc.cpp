@@ -0,0 +1,156 @@
+/**
+  ******************************************************************************
+  * @authors        : Tomas Gonzalez & Brian Morris
+  * @file           : test_data_path_alloc.cpp
+  * @brief          : Heap use of the DATA path on the host, every operator new
+  *                   and malloc made by process_data_request() is counted
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 Tomas Gonzalez & Brian Morris
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  */
+
+/**
+ * Built and run by ctest from the host build, see the README.
+ * Linked with --wrap=malloc so the core's own malloc calls are seen next to
+ * operator new. Only the calling thread is counted: the ACK conversations
+ * run on the executor task and their frames come back to it when they end.
+ * Once every flow of the path has run once, DATA must not touch the heap.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <thread>
+#include "hal_host.h"
+#include "host_boot.h"
+#include "shard_router.h"
+#include "coroutine.h"
+#include "process_requests.h"
+
+#define WARM_UP_REQUESTS 32   // Past the ADR window, its CONFIG flow runs too
+#define COUNTED_REQUESTS 64
+#define DRAIN_TIMEOUT std::chrono::seconds(10)
+
+static thread_local bool counting = false;
+static size_t allocations = 0;
+static std::atomic<uint32_t> publishes{0};
+static std::atomic<uint32_t> acks{0};
+
+/* Counting allocators ------------------------------------------------------ */
+extern "C" void *__real_malloc(size_t size);
+
+extern "C" void *__wrap_malloc(size_t size) {
+  if (counting) {
+    allocations++;
+  }
+  return __real_malloc(size);
+}
+
+void *operator new(size_t size) {
+  if (counting) {
+    allocations++;
+  }
+  void *memory = __real_malloc(size);
+  if (memory == NULL) {
+    throw std::bad_alloc();
+  }
+  return memory;
+}
+
+void operator delete(void *memory) noexcept {
+  free(memory);
+}
+
+void operator delete(void *memory, size_t size) noexcept {
+  (void) size;
+  free(memory);
+}
+
+/* Helpers ------------------------------------------------------------------ */
+// Nothing is kept, a copy would be an allocation of the test itself
+static void on_publish(const char *topic, const char *payload, bool retained, void *ctx) {
+  (void) topic;
+  (void) payload;
+  (void) retained;
+  (void) ctx;
+  publishes++;
+}
+
+static void on_radio_tx(UartPort_t port, const char *data, uint16_t length, void *ctx) {
+  if (length >= 7 && strncmp(data, "AT+SEND", 7) == 0 && memmem(data, length, ",ACK", 4) != NULL) {
+    acks++;
+  }
+  host_radio_accept(port, data, length, ctx);
+}
+
+// The executor is done with every coroutine the request spawned
+static void drain(size_t frames) {
+  auto deadline = std::chrono::steady_clock::now() + DRAIN_TIMEOUT;
+  while (coro_frames_alive() > frames) {
+    if (std::chrono::steady_clock::now() > deadline) {
+      host_fail("coroutines of the DATA path never finished");
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+}
+
+int main() {
+  hal_host_set_publish_hook(on_publish, NULL);
+  hal_host_uart_set_tx_hook(on_radio_tx, NULL);
+
+  host_boot_core();
+
+  // The shard is driven from here, its task is not started
+  static ShardWorker worker;
+  shard_worker_init(worker, LSU_COORDINATOR_SHARD);
+  auto [lsu, created] = worker.manager.createLSU();
+  if (!created) {
+    host_fail("test LSU not created");
+  }
+  Request request = {};
+  request.from_id = (uint16_t) lsu->getId();
+  request.type = REQUEST_TYPE_DATA;
+  strcpy(request.data, "ALLOC-TEST");
+  request.sourcePort = UART_PORT_MAIN;
+  request.rssi = -45;
+  request.snr = 9;
+
+  size_t frames = coro_frames_alive();
+  for (int i = 0; i < WARM_UP_REQUESTS; i++) {
+    request.received_us = hal_time_us();
+    process_data_request(&request, worker);
+    drain(frames);
+  }
+
+  for (int i = 0; i < COUNTED_REQUESTS; i++) {
+    request.received_us = hal_time_us();
+    counting = true;
+    process_data_request(&request, worker);
+    counting = false;
+    drain(frames);
+  }
+
+  printf("%d DATA requests: %zu allocations, %u publishes, %u ACKs\n", COUNTED_REQUESTS, allocations,
+         (unsigned) publishes.load(), (unsigned) acks.load());
+  if (publishes != WARM_UP_REQUESTS + COUNTED_REQUESTS) {
+    host_fail("DATA not published");
+  }
+  if (acks != WARM_UP_REQUESTS + COUNTED_REQUESTS) {
+    host_fail("DATA not acknowledged");
+  }
+  if (allocations != 0) {
+    host_fail("DATA path allocated");
+  }
+  printf("DATA path allocation test passed\n");
+  fflush(stdout);
+  std::_Exit(EXIT_SUCCESS);
+}
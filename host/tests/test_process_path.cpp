@@ -0,0 +1,179 @@
+/**
+  ******************************************************************************
+  * @authors        : Tomas Gonzalez & Brian Morris
+  * @file           : test_process_path.cpp
+  * @brief          : Processing path on the host, from the radio UART to the
+  *                   broker, with the real tasks running as threads
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 Tomas Gonzalez & Brian Morris
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  */
+
+/**
+ * Built and run by ctest from the host build, see the README.
+ * A SYNC must end in a link publish once the radio accepts the config, and
+ * DATA from the joined LSU in a data publish and an ACK, and a PERIOD command
+ * in a CONFIG carrying the new period to that LSU. A downlink command
+ * argument past UINT32_MAX is rejected, not wrapped. A link restored from NVS
+ * is sent back to full power before it has any samples.
+ */
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "hal_host.h"
+#include "LSU.h"
+#include "host_boot.h"
+#include "command_queue.h"
+#include "adr.h"
+#include "esp_log.h"
+
+#define WAIT_TIMEOUT std::chrono::seconds(10)
+
+struct Published {
+  std::string topic;
+  std::string payload;
+};
+
+static std::mutex lock;
+static std::condition_variable changed;
+static std::vector<Published> published;
+static std::vector<std::string> sent;  // Commands written to the radios
+
+static void on_publish(const char *topic, const char *payload, bool retained, void *ctx) {
+  (void) retained;
+  (void) ctx;
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    published.push_back({topic, payload});
+  }
+  changed.notify_all();
+}
+
+static void on_radio_tx(UartPort_t port, const char *data, uint16_t length, void *ctx) {
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    sent.emplace_back(data, length);
+  }
+  changed.notify_all();
+  host_radio_accept(port, data, length, ctx);
+}
+
+static bool wait_until(const std::function<bool()>& done) {
+  std::unique_lock<std::mutex> guard(lock);
+  return changed.wait_for(guard, WAIT_TIMEOUT, done);
+}
+
+static void radio_receive(UartPort_t port, uint32_t from, const char *data) {
+  char line[96];
+  int length = snprintf(line, sizeof(line), "+RCV=%u,%zu,%s,-45,9\r\n", (unsigned) from, strlen(data), data);
+  hal_host_uart_inject(port, line, length);
+}
+
+int main() {
+  Command command;
+  const char *largest = "7 PERIOD 4294967295";
+  const char *overflow = "7 PERIOD 99999999999";
+  if (!parse_command(largest, strlen(largest), &command) || command.arg != UINT32_MAX ||
+      parse_command(overflow, strlen(overflow), &command)) {
+    host_fail("command argument range");
+  }
+  // The reply to a bad ID must not carry the digits read before the overflow
+  const char *bad_id = "99999999999 PERIOD 5";
+  if (parse_command(bad_id, strlen(bad_id), &command) || command.correlation_id != 0) {
+    host_fail("overflowing correlation ID kept");
+  }
+
+  AdrLink restored;
+  AdrSetting next;
+  adr_link_restore(restored);
+  if (!adr_link_due(restored, 9, &next) || next.sf != 9 || next.txPower_dbm != ADR_MAX_POWER_DBM) {
+    host_fail("restored link not resynced");
+  }
+  adr_link_apply(restored, next);
+  if (adr_link_due(restored, 9, &next)) {
+    host_fail("restored link resynced twice");
+  }
+
+  hal_host_set_publish_hook(on_publish, NULL);
+  hal_host_uart_set_tx_hook(on_radio_tx, NULL);
+
+  host_boot_core();
+  host_start_shards();
+
+  // Join: the config goes out on the AUX radio, the link is published once it is accepted
+  radio_receive(UART_PORT_MAIN, 7, "SYNC");
+  std::string linkTopic;
+  bool linked = wait_until([&linkTopic] {
+    for (const Published& message : published) {
+      size_t suffix = message.topic.rfind("/link");
+      if (suffix != std::string::npos && suffix + 5 == message.topic.size()) {
+        linkTopic = message.topic;
+        return true;
+      }
+    }
+    return false;
+  });
+  if (!linked) {
+    host_fail("no link publish after SYNC");
+  }
+  uint32_t lsuId = strtoul(linkTopic.c_str() + strlen(LSU_TOPIC_PREFIX), NULL, 10);
+  printf("LSU %u linked\n", (unsigned) lsuId);
+
+  // Data from the new ID reaches its topic and is acknowledged
+  char dataTopic[LSU_TOPIC_MAX_LEN];
+  lsu_format_topic(dataTopic, sizeof(dataTopic), lsuId, LSU_TOPIC_DATA);
+  char ack[32];
+  snprintf(ack, sizeof(ack), "AT+SEND=%u,3,ACK", (unsigned) lsuId);
+
+  radio_receive(UART_PORT_MAIN, lsuId, "HELLO");
+  bool delivered = wait_until([&dataTopic, &ack] {
+    bool gotData = false;
+    bool gotAck = false;
+    for (const Published& message : published) {
+      gotData |= message.topic == dataTopic && message.payload == "HELLO";
+    }
+    for (const std::string& command : sent) {
+      gotAck |= command.starts_with(ack);
+    }
+    return gotData && gotAck;
+  });
+  if (!delivered) {
+    host_fail("DATA was not published and acknowledged");
+  }
+
+  // A new period reaches the connected LSU with its rescaled slot
+  Command period = {9, COMMAND_TYPE_PERIOD, 30000};
+  char periodConfig[48];
+  snprintf(periodConfig, sizeof(periodConfig), "CONFIG-%u-30000-", (unsigned) lsuId);
+  if (!post_command(&period)) {
+    host_fail("PERIOD command not queued");
+  }
+  bool announced = wait_until([&periodConfig] {
+    for (const std::string& command : sent) {
+      if (command.find(periodConfig) != std::string::npos) {
+        return true;
+      }
+    }
+    return false;
+  });
+  if (!announced) {
+    host_fail("new period not sent to the LSU");
+  }
+
+  printf("Processing path test passed\n");
+  fflush(stdout);
+  std::_Exit(EXIT_SUCCESS);
+}
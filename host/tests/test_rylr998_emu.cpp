@@ -0,0 +1,185 @@
+/**
+  ******************************************************************************
+  * @authors        : Tomas Gonzalez & Brian Morris
+  * @file           : test_rylr998_emu.cpp
+  * @brief          : Radio setup, join and data round trip against the
+  *                   emulated RYLR998 modules, with the latencies reported
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 Tomas Gonzalez & Brian Morris
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  */
+
+/**
+ * Built and run by ctest from the host build, see the README.
+ * radio_setup_run() must leave both modules with the channel settings and,
+ * run again as on the next boot, only query them without writing anything. A
+ * SYNC must be answered by a CONFIG on the air and DATA from the joined LSU
+ * by an ACK. RSSI and SNR parse with their signs, data ends where its length
+ * says and not at the first comma. The module delays are scaled down to a
+ * tenth.
+ */
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include "hal_host.h"
+#include "rylr998_emu.h"
+#include "rylr998.h"
+#include "host_boot.h"
+#include "radio_setup.h"
+#include "general_config.h"
+
+#define WAIT_TIMEOUT std::chrono::seconds(10)
+#define TEMP_ADDRESS 4321
+#define TIME_SCALE   0.1
+
+typedef std::chrono::steady_clock Clock;
+
+static std::mutex lock;
+static std::condition_variable changed;
+static uint32_t joinedId = 0;
+static bool acked = false;
+static Clock::time_point configAt, ackAt;
+
+// Plays the LSU on the other end of the air
+static void on_air(UartPort_t port, uint16_t destination, const char *payload, size_t length, void *ctx) {
+  (void) port;
+  (void) ctx;
+  std::string frame(payload, length);
+  std::lock_guard<std::mutex> guard(lock);
+  unsigned long id;
+  if (destination == TEMP_ADDRESS && sscanf(frame.c_str(), "CONFIG-%lu-", &id) == 1) {
+    joinedId = id;
+    configAt = Clock::now();
+  } else if (joinedId != 0 && destination == joinedId && frame == "ACK") {
+    acked = true;
+    ackAt = Clock::now();
+  }
+  changed.notify_all();
+}
+
+static void check_channel(UartPort_t port, uint32_t band_hz) {
+  rylr998_emu_stats_t stats;
+  rylr998_emu_get_stats(port, &stats);
+  if (stats.address != CU_ADDRESS || stats.network_id != 18 || stats.sf != 9 || stats.bw != 7 || stats.cr != 1 ||
+      stats.preamble != 12 || stats.band_hz != band_hz || stats.crfop != 22 || stats.errors != 0) {
+    host_fail("channel settings not applied");
+  }
+}
+
+static double elapsed_ms(Clock::time_point from, Clock::time_point to) {
+  return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+int main() {
+  // Semtech calculator: SF9, 125 kHz, 4/5, 12 symbols of preamble, 16 bytes
+  if (rylr998_emu_airtime_us(9, 7, 1, 12, 16) != 181248) {
+    host_fail("time on air");
+  }
+
+  // A link below the noise floor reports a negative SNR
+  RYLR_response_t response;
+  const char *weak = "+RCV=1200,10,DATA-T38.6,-117,-9\r\n";
+  rylr998_parseLine(weak, strlen(weak), &response);
+  if (response.packet.rssi != -117 || response.packet.snr != -9) {
+    host_fail("negative RSSI or SNR");
+  }
+
+  // The length, not the first comma, tells where the data ends
+  const char *commas = "+RCV=7,5,A,B,C,-40,8\r\n";
+  if (rylr998_parseLine(commas, strlen(commas), &response) != RYLR_RCV || strcmp(response.packet.data, "A,B,C") != 0 ||
+      response.packet.rssi != -40 || response.packet.snr != 8) {
+    host_fail("data with commas");
+  }
+
+  // A module error goes back to the caller, the radio health counts it
+  const char *error = "+ERR=4\r\n";
+  if (rylr998_parseLine(error, strlen(error), &response) != RYLR_ERR) {
+    host_fail("+ERR answer");
+  }
+
+  rylr998_emu_config_t emuConfig = {2000, TIME_SCALE};
+  rylr998_emu_start(&emuConfig);
+  rylr998_emu_set_air_hook(on_air, NULL);
+
+  host_boot_core();
+
+  // Radio setup, as in app_main
+  Clock::time_point setupStart = Clock::now();
+  if (!radio_setup_run(CU_ADDRESS)) {
+    host_fail("radio setup");
+  }
+  double setup_ms = elapsed_ms(setupStart, Clock::now());
+  check_channel(UART_PORT_MAIN, 915000000);
+  check_channel(UART_PORT_AUX, 925000000);
+  RadioSetupReport firstSetup;
+  radio_setup_report(&firstSetup);
+
+  // Next boot, the modules kept their settings
+  rylr998_emu_stats_t before[2], after[2];
+  rylr998_emu_get_stats(UART_PORT_MAIN, &before[UART_PORT_MAIN]);
+  rylr998_emu_get_stats(UART_PORT_AUX, &before[UART_PORT_AUX]);
+  setupStart = Clock::now();
+  if (!radio_setup_run(CU_ADDRESS)) {
+    host_fail("radio setup on the next boot");
+  }
+  double again_ms = elapsed_ms(setupStart, Clock::now());
+  RadioSetupReport secondSetup;
+  radio_setup_report(&secondSetup);
+  for (int port = 0; port < 2; port++) {
+    rylr998_emu_get_stats((UartPort_t) port, &after[port]);
+    if (secondSetup.written[port] != 0 || after[port].flash_writes != before[port].flash_writes ||
+        after[port].commands - before[port].commands != 1 + RYLR_SET_COUNT) {
+      host_fail("settings written again on the next boot");
+    }
+  }
+
+  host_start_shards();
+
+  // Join, the CONFIG reaches the temporary address
+  Clock::time_point syncAt = Clock::now();
+  if (!rylr998_emu_air_send(UART_PORT_MAIN, TEMP_ADDRESS, "SYNC", -71, 8)) {
+    host_fail("SYNC not received");
+  }
+  std::unique_lock<std::mutex> guard(lock);
+  if (!changed.wait_for(guard, WAIT_TIMEOUT, [] { return joinedId != 0; })) {
+    host_fail("no CONFIG after SYNC");
+  }
+
+  // Data from the new ID is acknowledged on the air
+  Clock::time_point dataAt = Clock::now();
+  guard.unlock();
+  if (!rylr998_emu_air_send(UART_PORT_MAIN, joinedId, "DATA-T38.6", -71, 8)) {
+    host_fail("DATA not received");
+  }
+  guard.lock();
+  if (!changed.wait_for(guard, WAIT_TIMEOUT, [] { return acked; })) {
+    host_fail("no ACK after DATA");
+  }
+
+  rylr998_emu_stats_t mainStats, auxStats;
+  rylr998_emu_get_stats(UART_PORT_MAIN, &mainStats);
+  rylr998_emu_get_stats(UART_PORT_AUX, &auxStats);
+  printf("Module delays at %.1fx real time\n", TIME_SCALE);
+  printf("Radio setup %.0f ms, %u settings written, %u flash writes. Next boot %.0f ms, %u written\n", setup_ms,
+         (unsigned) (firstSetup.written[UART_PORT_MAIN] + firstSetup.written[UART_PORT_AUX]),
+         (unsigned) (mainStats.flash_writes + auxStats.flash_writes), again_ms,
+         (unsigned) (secondSetup.written[UART_PORT_MAIN] + secondSetup.written[UART_PORT_AUX]));
+  printf("SYNC to CONFIG on air %.0f ms, DATA to ACK on air %.0f ms\n",
+         elapsed_ms(syncAt, configAt), elapsed_ms(dataAt, ackAt));
+  printf("Main: %u commands, %u sends, %.1f ms on air. Aux: %u commands, %u sends, %.1f ms on air\n",
+         (unsigned) mainStats.commands, (unsigned) mainStats.sends, mainStats.airtime_us / 1000.0,
+         (unsigned) auxStats.commands, (unsigned) auxStats.sends, auxStats.airtime_us / 1000.0);
+  printf("RYLR998 emulator test passed\n");
+  fflush(stdout);
+  std::_Exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,164 @@
+/**
+  ******************************************************************************
+  * @authors        : Tomas Gonzalez & Brian Morris
+  * @file           : test_uart_trace.cpp
+  * @brief          : UART capture round trip through the trace partition and
+  *                   the MQTT export, the export feeds the replay smoke test
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 Tomas Gonzalez & Brian Morris
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  */
+
+/**
+ * Built and run by ctest from the host build, see the README.
+ * Reads recorded while capturing must decode back with their ports, bytes and
+ * times, reads longer than a record included. The export must cover the trace
+ * and end with END, it is saved as uart_trace_export.txt for uart_replay.
+ * A capture that fills the partition must stop and stay decodable.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "hal_host.h"
+#include "host_boot.h"
+#include "uart_trace.h"
+
+#define START_US    5000000
+#define EXPORT_FILE "uart_trace_export.txt"
+
+struct Read {
+  uint8_t port;
+  int64_t time_us;
+  std::string bytes;
+};
+
+static std::vector<std::string> exported;
+
+static void on_publish(const char *topic, const char *payload, bool retained, void *ctx) {
+  (void) retained;
+  (void) ctx;
+  if (strcmp(topic, UART_TRACE_TOPIC) == 0) {
+    exported.push_back(payload);
+  }
+}
+
+static std::vector<uint8_t> read_trace() {
+  uart_trace_stats_t stats;
+  uart_trace_get_stats(&stats);
+  std::vector<uint8_t> trace(stats.bytes);
+  if (!hal_trace_read(0, trace.data(), trace.size())) {
+    host_fail("trace read");
+  }
+  return trace;
+}
+
+int main() {
+  hal_host_clock_manual(START_US);
+  hal_host_set_publish_hook(on_publish, NULL);
+
+  // A join and a data frame as the radios deliver them, the last read holds three lines
+  std::string burst;
+  for (int i = 0; i < 3; i++) {
+    burst += "+RCV=" + std::to_string(1200 + i) + ",10,DATA-T38." + std::to_string(i) + ",-82,7\r\n" + std::string(30, ' ');
+  }
+  const std::vector<Read> reads = {
+    {0, START_US + 120000, "+RCV=4321,4,SYNC,-71,8\r\n"},
+    {0, START_US + 410000, "+OK\r\n"},
+    {1, START_US + 410000, "+RCV=1100,10,DATA-T37.9,-95,3\r\n"},
+    {1, START_US + 660000, "+OK\r\n"},
+    {0, START_US + 1500000, burst},
+  };
+
+  if (!uart_trace_start()) {
+    host_fail("no trace partition");
+  }
+  uart_trace_flush();
+  for (const Read& read : reads) {
+    uart_trace_record(read.port, (const uint8_t*) read.bytes.data(), read.bytes.size(), read.time_us);
+  }
+  uart_trace_flush();
+  uart_trace_stop();
+  uart_trace_flush();
+
+  // Decode, pieces of a split read follow at the same time
+  std::vector<uint8_t> trace = read_trace();
+  size_t pos = 0;
+  uart_trace_record_t record = {};
+  size_t next = 0;
+  std::string joined;
+  while (uart_trace_decode(trace.data(), trace.size(), &pos, &record)) {
+    if (next >= reads.size() || record.port != reads[next].port || record.time_us != reads[next].time_us) {
+      host_fail("record out of order");
+    }
+    joined.append((const char*) record.data, record.length);
+    if (joined.size() == reads[next].bytes.size()) {
+      if (joined != reads[next].bytes) {
+        host_fail("record bytes differ");
+      }
+      joined.clear();
+      next++;
+    }
+  }
+  if (next != reads.size() || pos != trace.size()) {
+    host_fail("trace incomplete");
+  }
+
+  // Export, then keep it for uart_replay
+  if (!uart_trace_export_begin()) {
+    host_fail("export refused");
+  }
+  while (uart_trace_export_step(2)) {
+  }
+  if (exported.empty() || exported.back() != std::to_string(trace.size()) + " END") {
+    host_fail("export not closed with END");
+  }
+  size_t exportedBytes = trace.size();
+  FILE *file = fopen(EXPORT_FILE, "w");
+  if (file == NULL) {
+    host_fail("cannot write " EXPORT_FILE);
+  }
+  for (const std::string& message : exported) {
+    fprintf(file, "%s %s\n", UART_TRACE_TOPIC, message.c_str());
+  }
+  fclose(file);
+
+  // Fill the partition, the capture stops by itself and the trace stays readable
+  if (!uart_trace_start()) {
+    host_fail("restart");
+  }
+  uart_trace_flush();
+  std::string line(UART_TRACE_MAX_RECORD, 'x');
+  uart_trace_stats_t stats = {};
+  for (int i = 0; i < 100000 && !stats.full; i++) {
+    uart_trace_record(0, (const uint8_t*) line.data(), line.size(), START_US + i);
+    uart_trace_flush();
+    uart_trace_get_stats(&stats);
+  }
+  if (!stats.full || stats.active || stats.bytes != HAL_HOST_TRACE_SIZE) {
+    host_fail("full partition not detected");
+  }
+  trace = read_trace();
+  pos = 0;
+  size_t decoded = 0;
+  while (uart_trace_decode(trace.data(), trace.size(), &pos, &record)) {
+    decoded++;
+  }
+  // Records still staged when the partition filled up are counted but lost
+  if (decoded == 0 || decoded > stats.records) {
+    host_fail("full trace does not decode");
+  }
+
+  printf("%zu reads in %zu bytes, %zu export messages, full trace of %zu records\n", reads.size(), exportedBytes,
+         exported.size(), decoded);
+  printf("UART trace test passed\n");
+  return 0;
+}
@@ -0,0 +1,93 @@
+/**
+  ******************************************************************************
+  * @authors        : Tomas Gonzalez & Brian Morris
+  * @file           : uart_host.cpp
+  * @brief          : Linux implementation of uart.h, the radios are played by
+  *                   a TX hook that answers through hal_host_uart_inject()
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 Tomas Gonzalez & Brian Morris
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "uart.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include "hal_host.h"
+
+/* Private types -------------------------------------------------------------*/
+struct HostPort {
+  std::mutex lock;
+  std::condition_variable received;
+  std::deque<uint8_t> pending;  // Bytes sent by the radio, not read yet
+};
+
+/* Private variables ---------------------------------------------------------*/
+static uint8_t rx_buff[2][UART_RX_BUFF_SIZE + 1];
+static HostPort hostPorts[2];
+
+static std::mutex tx_lock;
+static hal_host_uart_tx_hook_t txHook = NULL;
+static void *txCtx = NULL;
+
+/* Public functions ----------------------------------------------------------*/
+void uart_init(void) {
+}
+
+void uart_send(const char *data, uint16_t length, UartPort_t portIndex) {
+  std::lock_guard<std::mutex> guard(tx_lock);
+  if (txHook != NULL) {
+    txHook(portIndex, data, length, txCtx);
+  }
+}
+
+uint16_t uart_receive(UartPort_t portIndex) {
+  HostPort& port = hostPorts[portIndex];
+  std::lock_guard<std::mutex> guard(port.lock);
+  uint16_t length = 0;
+  while (length < UART_RX_BUFF_SIZE && !port.pending.empty()) {
+    rx_buff[portIndex][length++] = port.pending.front();
+    port.pending.pop_front();
+  }
+  return length;
+}
+
+bool uart_wait_rx(UartPort_t portIndex, TickType_t wait) {
+  HostPort& port = hostPorts[portIndex];
+  std::unique_lock<std::mutex> lock(port.lock);
+  auto ready = [&port] { return !port.pending.empty(); };
+  if (wait == portMAX_DELAY) {
+    port.received.wait(lock, ready);
+    return true;
+  }
+  return port.received.wait_for(lock, std::chrono::milliseconds(pdTICKS_TO_MS(wait)), ready);
+}
+
+uint8_t* uart_get_rx_buff(UartPort_t portIndex) {
+  return rx_buff[portIndex];
+}
+
+/* Host controls -------------------------------------------------------------*/
+void hal_host_uart_set_tx_hook(hal_host_uart_tx_hook_t hook, void *ctx) {
+  std::lock_guard<std::mutex> guard(tx_lock);
+  txHook = hook;
+  txCtx = ctx;
+}
+
+void hal_host_uart_inject(UartPort_t portIndex, const char *data, size_t length) {
+  HostPort& port = hostPorts[portIndex];
+  {
+    std::lock_guard<std::mutex> guard(port.lock);
+    port.pending.insert(port.pending.end(), data, data + length);
+  }
+  port.received.notify_all();
+}
@@ -0,0 +1,133 @@
+/**
+  ******************************************************************************
+  * @authors        : Tomas Gonzalez & Brian Morris
+  * @file           : command_queue.cpp
+  * @brief          : Downlink command queue, filled by the MQTT task and
+  *                   drained by the task that owns the LSUManager
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 Tomas Gonzalez & Brian Morris
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  */
+
+/* Includes ------------------------------------------------------------ */
+#include "command_queue.h"
+
+#include <string.h>
+#include "shard_router.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+
+/* Private variables --------------------------------------------------------- */
+static const char *COMMAND_QUEUE_TAG = "CMD_QUEUE";
+static QueueHandle_t CommandQueue = NULL;
+
+static const CommandEntry commandTable[] = {
+  {"REMOVE", COMMAND_TYPE_REMOVE, true},
+  {"PERIOD", COMMAND_TYPE_PERIOD, true},
+  {"DIAG", COMMAND_TYPE_DIAG, false},
+  {"TRACE_START", COMMAND_TYPE_TRACE_START, false},
+  {"TRACE_STOP", COMMAND_TYPE_TRACE_STOP, false},
+  {"TRACE_EXPORT", COMMAND_TYPE_TRACE_EXPORT, false},
+  {NULL, COMMAND_TYPE_INVALID, false} // Sentinel value
+};
+
+/* Private functions --------------------------------------------------------- */
+static size_t skip_spaces(const char *data, size_t len, size_t pos) {
+  while (pos < len && data[pos] == ' ') pos++;
+  return pos;
+}
+
+// False if no digits or the value does not fit a uint32_t
+static bool parse_uint(const char *data, size_t len, size_t *pos, uint32_t *value) {
+  size_t start = *pos;
+  uint32_t result = 0;
+  while (*pos < len && data[*pos] >= '0' && data[*pos] <= '9') {
+    uint32_t digit = data[*pos] - '0';
+    if (result > (UINT32_MAX - digit) / 10) {
+      *value = 0;
+      return false;
+    }
+    result = result * 10 + digit;
+    (*pos)++;
+  }
+  *value = result;
+  return *pos > start;
+}
+
+/* Functions ------------------------------------------------------------ */
+void command_queue_init() {
+  if (CommandQueue == NULL) {
+    CommandQueue = xQueueCreate(COMMAND_QUEUE_LENGTH, sizeof(Command));
+    if (CommandQueue == NULL) {
+      ESP_LOGE(COMMAND_QUEUE_TAG, "Failed to create command queue");
+    }
+  }
+}
+
+bool parse_command(const char *data, size_t len, Command *command) {
+  size_t pos = 0;
+  command->type = COMMAND_TYPE_INVALID;
+  command->arg = 0;
+
+  if (!parse_uint(data, len, &pos, &command->correlation_id)) {
+    return false;
+  }
+  pos = skip_spaces(data, len, pos);
+
+  size_t verb_start = pos;
+  while (pos < len && data[pos] != ' ') pos++;
+  size_t verb_len = pos - verb_start;
+
+  for (int i = 0; commandTable[i].verb != NULL; i++) {
+    const CommandEntry *entry = &commandTable[i];
+    if (strlen(entry->verb) != verb_len || memcmp(&data[verb_start], entry->verb, verb_len) != 0) {
+      continue;
+    }
+    if (entry->has_arg) {
+      pos = skip_spaces(data, len, pos);
+      if (!parse_uint(data, len, &pos, &command->arg)) {
+        return false;
+      }
+    }
+    // Tolerate trailing whitespace and line endings only
+    while (pos < len && (data[pos] == ' ' || data[pos] == '\r' || data[pos] == '\n')) pos++;
+    if (pos != len) {
+      return false;
+    }
+    command->type = entry->type;
+    return true;
+  }
+  return false;
+}
+
+bool post_command(const Command *command) {
+  if (CommandQueue == NULL) {
+    return false;
+  }
+  if (xQueueSend(CommandQueue, command, 0) != pdTRUE) {
+    return false;
+  }
+  shard_wake(LSU_COORDINATOR_SHARD, SHARD_WAKE_COMMAND);
+  return true;
+}
+
+bool get_command(Command *command) {
+  if (CommandQueue == NULL) {
+    return false;
+  }
+  return xQueueReceive(CommandQueue, command, 0) == pdTRUE;
+}
+
+size_t command_queue_depth() {
+  if (CommandQueue == NULL) {
+    return 0;
+  }
+  return uxQueueMessagesWaiting(CommandQueue);
+}
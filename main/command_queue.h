@@ -0,0 +1,90 @@
+/**
+  ******************************************************************************
+  * @authors        : Tomas Gonzalez & Brian Morris
+  * @file           : command_queue.h
+  * @brief          : Header for the downlink command queue, filled by the MQTT
+  *                   task and drained by the task that owns the LSUManager
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 Tomas Gonzalez & Brian Morris
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  */
+
+#ifndef COMMAND_QUEUE_H
+#define COMMAND_QUEUE_H
+
+/* Includes ------------------------------------------------------------ */
+#include <cstddef>
+#include <cstdint>
+
+/* Defines ------------------------------------------------------------- */
+#define COMMAND_QUEUE_LENGTH 64
+
+/* Structs ------------------------------------------------------------- */
+enum CommandType {
+  COMMAND_TYPE_REMOVE,  /**< REMOVE <lsu_id> */
+  COMMAND_TYPE_PERIOD,  /**< PERIOD <period_ms> */
+  COMMAND_TYPE_DIAG,    /**< DIAG */
+  COMMAND_TYPE_TRACE_START,   /**< TRACE_START */
+  COMMAND_TYPE_TRACE_STOP,    /**< TRACE_STOP */
+  COMMAND_TYPE_TRACE_EXPORT,  /**< TRACE_EXPORT */
+  COMMAND_TYPE_INVALID,
+};
+
+/**
+ * @brief Parsed downlink command, copied by value through the queue
+ */
+struct Command {
+  uint32_t correlation_id; /**< Echoed back in the reply */
+  CommandType type;
+  uint32_t arg;
+};
+
+struct CommandEntry {
+  const char *verb;
+  CommandType type;
+  bool has_arg;
+};
+
+/* Public API ---------------------------------------------------------- */
+/**
+ * @brief Initialize the command queue, must be called before any other function
+ */
+void command_queue_init();
+
+/**
+ * @brief Parse a command in place, without copying the payload
+ * @details Expected format: "<correlation_id> <VERB> [arg]"
+ * @param data Payload, not null terminated
+ * @param len Payload length
+ * @param command Output command, correlation_id is set whenever it could be parsed
+ * @return true if the command is valid
+ */
+bool parse_command(const char *data, size_t len, Command *command);
+
+/**
+ * @brief Post a command to the queue without blocking
+ * @param command Command to post
+ * @return true if posted, false if the queue is full
+ */
+bool post_command(const Command *command);
+
+/**
+ * @brief Get a command from the queue without blocking
+ * @param command Output command
+ * @return true if a command was retrieved
+ */
+bool get_command(Command *command);
+
+/**
+ * @brief Number of commands waiting to be processed
+ * @return Queue depth
+ */
+size_t command_queue_depth();
+
+#endif /* COMMAND_QUEUE_H */
@@ -0,0 +1,401 @@
+/**
+  ******************************************************************************
+  * @authors        : Tomas Gonzalez & Brian Morris
+  * @file           : coroutine.cpp
+  * @brief          : Coroutine executor, protocol flows run as C++20
+  *                   coroutines on a single FreeRTOS task
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 Tomas Gonzalez & Brian Morris
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  */
+
+/* Includes ------------------------------------------------------------ */
+#include "coroutine.h"
+
+#include <atomic>
+#include <cstddef>
+#include "esp_log.h"
+#include "hal/hal.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+
+/* Defines ------------------------------------------------------------- */
+#define WAIT_INDEX_BITS 8     // Low bits of a wait ID, the rest is the slot generation
+#define FRAME_CLASS_BYTES 32  // Frame sizes are rounded up to a multiple of this
+#define FRAME_CLASSES 16      // Frames up to 512 bytes are recycled, larger ones go back to the heap
+
+/* Private types ------------------------------------------------------- */
+struct CoMessage {
+  void *handle;      // Coroutine to resume, NULL for a wait wake-up
+  uint32_t wait_id;  // CORO_NO_WAIT for a plain resume
+};
+
+struct CoWait {
+  std::coroutine_handle<> handle;
+  int64_t deadline_us;  // INT64_MAX when waiting forever or already claimed by a wake-up
+  bool *result;
+  CoEvent *owner;
+  uint32_t generation;
+  bool used;
+};
+
+// In front of every frame, keeps the promise aligned
+struct alignas(alignof(std::max_align_t)) FrameHeader {
+  FrameHeader *next;    // Free list link while recycled
+  uint32_t frameClass;  // FRAME_CLASSES for a frame the heap takes back
+};
+
+/* Private variables --------------------------------------------------------- */
+static const char *COROUTINE_TAG = "COROUTINE";
+
+static QueueHandle_t ReadyQueue = NULL;
+static TaskHandle_t executorTask = NULL;
+static std::atomic<size_t> framesAlive{0};
+static std::atomic<uint32_t> messagesDropped{0};
+
+// Frames are freed on the executor and allocated by any task that spawns
+static portMUX_TYPE frame_lock = portMUX_INITIALIZER_UNLOCKED;
+static FrameHeader *freeFrames[FRAME_CLASSES];
+
+// Executor only: timed waits and wake-ups posted by the executor itself,
+// which must never block on its own queue
+static CoWait waits[CORO_MAX_WAITS];
+static CoMessage localReady[CORO_READY_QUEUE_LENGTH];
+static uint32_t localHead = 0;
+static uint32_t localTail = 0;
+
+// Executor only: mutex waiters the lock was handed to, linked through the
+// awaiters themselves so the hand-off never needs a queue slot
+static CoMutex::Awaiter *handedOffHead = nullptr;
+static CoMutex::Awaiter *handedOffTail = nullptr;
+
+/* Private functions --------------------------------------------------------- */
+// Never blocks: the RX tasks and shard workers must not stall behind a busy executor
+static bool post_message(const CoMessage& message) {
+  if (executorTask != NULL && xTaskGetCurrentTaskHandle() == executorTask) {
+    if (localHead - localTail < CORO_READY_QUEUE_LENGTH) {
+      localReady[localHead++ % CORO_READY_QUEUE_LENGTH] = message;
+      return true;
+    }
+  } else if (message.wait_id == CORO_NO_WAIT && uxQueueMessagesWaiting(ReadyQueue) >= CORO_SPAWN_SLOTS) {
+    // Each wait gets one wake-up at most, the slots left are theirs
+    messagesDropped.fetch_add(1, std::memory_order_relaxed);
+    ESP_LOGW(COROUTINE_TAG, "Executor behind, coroutine dropped");
+    return false;
+  }
+  if (xQueueSend(ReadyQueue, &message, 0) != pdTRUE) {
+    messagesDropped.fetch_add(1, std::memory_order_relaxed);
+    ESP_LOGE(COROUTINE_TAG, "Ready queues full, %s lost", message.wait_id == CORO_NO_WAIT ? "coroutine" : "wake-up");
+    return false;
+  }
+  return true;
+}
+
+static void release_wait(uint32_t index) {
+  waits[index].used = false;
+  waits[index].handle = nullptr;
+}
+
+static void dispatch(const CoMessage& message) {
+  if (message.wait_id == CORO_NO_WAIT) {
+    std::coroutine_handle<>::from_address(message.handle).resume();
+    return;
+  }
+
+  // A wake-up may race with a timeout, only the first one counts
+  uint32_t index = message.wait_id & ((1u << WAIT_INDEX_BITS) - 1);
+  CoWait& wait = waits[index];
+  if (!wait.used || wait.generation != message.wait_id >> WAIT_INDEX_BITS) {
+    return;
+  }
+  std::coroutine_handle<> handle = wait.handle;
+  *wait.result = true;
+  release_wait(index);
+  handle.resume();
+}
+
+static void expire_waits(int64_t now_us) {
+  for (uint32_t index = 0; index < CORO_MAX_WAITS; index++) {
+    CoWait& wait = waits[index];
+    if (!wait.used || wait.deadline_us > now_us) {
+      continue;
+    }
+    uint32_t wait_id = (wait.generation << WAIT_INDEX_BITS) | index;
+    if (wait.owner != nullptr && !wait.owner->timeout(wait_id)) {
+      wait.deadline_us = INT64_MAX; // set() won, its wake-up is queued
+      continue;
+    }
+    std::coroutine_handle<> handle = wait.handle;
+    *wait.result = false;
+    release_wait(index);
+    handle.resume();
+  }
+}
+
+// Executor only
+static bool local_pending() {
+  return localTail != localHead || handedOffHead != nullptr;
+}
+
+static void dispatch_local() {
+  while (local_pending()) {
+    while (localTail != localHead) {
+      CoMessage message = localReady[localTail++ % CORO_READY_QUEUE_LENGTH];
+      dispatch(message);
+    }
+    coro_detail::resume_mutex_waiters();
+  }
+}
+
+static int64_t next_deadline() {
+  int64_t deadline_us = INT64_MAX;
+  for (uint32_t index = 0; index < CORO_MAX_WAITS; index++) {
+    if (waits[index].used && waits[index].deadline_us < deadline_us) {
+      deadline_us = waits[index].deadline_us;
+    }
+  }
+  return deadline_us;
+}
+
+/* Frames ------------------------------------------------------------------ */
+// A freed frame waits for the next coroutine of its size class, so once the
+// flows have each run once spawning them no longer touches the heap
+void *coro_detail::allocate_frame(size_t size) {
+  uint32_t frameClass = size == 0 ? 0 : (size - 1) / FRAME_CLASS_BYTES;
+  FrameHeader *header = NULL;
+  if (frameClass < FRAME_CLASSES) {
+    taskENTER_CRITICAL(&frame_lock);
+    header = freeFrames[frameClass];
+    if (header != NULL) {
+      freeFrames[frameClass] = header->next;
+    }
+    taskEXIT_CRITICAL(&frame_lock);
+  } else {
+    frameClass = FRAME_CLASSES;
+  }
+
+  if (header == NULL) {
+    size_t bytes = frameClass < FRAME_CLASSES ? (frameClass + 1) * FRAME_CLASS_BYTES : size;
+    header = (FrameHeader*) malloc(sizeof(FrameHeader) + bytes);
+    if (header == NULL) {
+      ESP_LOGE(COROUTINE_TAG, "Out of memory for a %u byte coroutine frame", (unsigned) size);
+      abort();
+    }
+    header->frameClass = frameClass;
+  }
+  framesAlive.fetch_add(1, std::memory_order_relaxed);
+  return header + 1;
+}
+
+void coro_detail::free_frame(void *frame) {
+  FrameHeader *header = (FrameHeader*) frame - 1;
+  framesAlive.fetch_sub(1, std::memory_order_relaxed);
+  if (header->frameClass == FRAME_CLASSES) {
+    free(header);
+    return;
+  }
+  taskENTER_CRITICAL(&frame_lock);
+  header->next = freeFrames[header->frameClass];
+  freeFrames[header->frameClass] = header;
+  taskEXIT_CRITICAL(&frame_lock);
+}
+
+/* Functions ------------------------------------------------------------ */
+void coro_executor_init() {
+  if (ReadyQueue == NULL) {
+    ReadyQueue = xQueueCreate(CORO_READY_QUEUE_LENGTH, sizeof(CoMessage));
+    if (ReadyQueue == NULL) {
+      ESP_LOGE(COROUTINE_TAG, "Failed to create ready queue");
+    }
+  }
+}
+
+bool coro_post(std::coroutine_handle<> handle) {
+  return post_message(CoMessage{handle.address(), CORO_NO_WAIT});
+}
+
+uint32_t coro_dropped() {
+  return messagesDropped.load(std::memory_order_relaxed);
+}
+
+size_t coro_frames_alive() {
+  return framesAlive.load(std::memory_order_relaxed);
+}
+
+uint32_t coro_register_wait(std::coroutine_handle<> handle, uint32_t timeout_ms, bool *result, CoEvent *owner) {
+  for (uint32_t index = 0; index < CORO_MAX_WAITS; index++) {
+    CoWait& wait = waits[index];
+    if (wait.used) {
+      continue;
+    }
+    wait.used = true;
+    wait.handle = handle;
+    wait.deadline_us = timeout_ms == 0 ? INT64_MAX : hal_time_us() + (int64_t) timeout_ms * 1000;
+    wait.result = result;
+    wait.owner = owner;
+    wait.generation = (wait.generation + 1) & (UINT32_MAX >> WAIT_INDEX_BITS);
+    return (wait.generation << WAIT_INDEX_BITS) | index;
+  }
+  ESP_LOGE(COROUTINE_TAG, "No free wait slot (%d in use)", CORO_MAX_WAITS);
+  return CORO_NO_WAIT;
+}
+
+void coro_cancel_wait(uint32_t wait_id) {
+  uint32_t index = wait_id & ((1u << WAIT_INDEX_BITS) - 1);
+  if (waits[index].used && waits[index].generation == wait_id >> WAIT_INDEX_BITS) {
+    release_wait(index);
+  }
+}
+
+void coro_wake_wait(uint32_t wait_id) {
+  post_message(CoMessage{NULL, wait_id});
+}
+
+void coro_executor_task(void *arg) {
+  ESP_LOGI(COROUTINE_TAG, "Coroutine executor started");
+  executorTask = xTaskGetCurrentTaskHandle();
+
+  while (1) {
+    dispatch_local();
+
+    // Sleep until a wake-up arrives or the next wait expires
+    TickType_t ticks = portMAX_DELAY;
+    int64_t deadline_us = next_deadline();
+    if (local_pending()) {
+      ticks = 0;
+    } else if (deadline_us != INT64_MAX) {
+      int64_t remaining_us = deadline_us - hal_time_us();
+      ticks = remaining_us <= 0 ? 0 : pdMS_TO_TICKS((remaining_us + 999) / 1000);
+      if (ticks == 0 && remaining_us > 0) {
+        ticks = 1;
+      }
+    }
+
+    CoMessage message;
+    if (xQueueReceive(ReadyQueue, &message, ticks) == pdTRUE) {
+      dispatch(message);
+    }
+    expire_waits(hal_time_us());
+  }
+}
+
+int64_t coro_next_deadline() {
+  return next_deadline();
+}
+
+void coro_executor_poll() {
+  executorTask = xTaskGetCurrentTaskHandle();
+  CoMessage message;
+  do {
+    dispatch_local();
+    while (xQueueReceive(ReadyQueue, &message, 0) == pdTRUE) {
+      dispatch(message);
+    }
+    expire_waits(hal_time_us());
+  } while (local_pending());
+}
+
+/* Awaitables ---------------------------------------------------------- */
+void CoEvent::set() {
+  taskENTER_CRITICAL(&lock);
+  uint32_t wait_id = waiter;
+  waiter = CORO_NO_WAIT;
+  if (wait_id == CORO_NO_WAIT) {
+    signaled = true;
+  }
+  taskEXIT_CRITICAL(&lock);
+
+  if (wait_id != CORO_NO_WAIT) {
+    coro_wake_wait(wait_id);
+  }
+}
+
+void CoEvent::reset() {
+  taskENTER_CRITICAL(&lock);
+  signaled = false;
+  taskEXIT_CRITICAL(&lock);
+}
+
+bool CoEvent::timeout(uint32_t wait_id) {
+  taskENTER_CRITICAL(&lock);
+  bool claimed = waiter == wait_id;
+  if (claimed) {
+    waiter = CORO_NO_WAIT;
+  }
+  taskEXIT_CRITICAL(&lock);
+  return claimed;
+}
+
+bool CoEvent::Awaiter::await_suspend(std::coroutine_handle<> handle) {
+  uint32_t wait_id = coro_register_wait(handle, timeout_ms, &result, &event);
+  if (wait_id == CORO_NO_WAIT) {
+    result = false;
+    return false;
+  }
+
+  taskENTER_CRITICAL(&event.lock);
+  bool already_set = event.signaled;
+  if (already_set) {
+    event.signaled = false;
+  } else {
+    event.waiter = wait_id;
+  }
+  taskEXIT_CRITICAL(&event.lock);
+
+  if (already_set) {
+    coro_cancel_wait(wait_id);
+    result = true;
+    return false;
+  }
+  return true;
+}
+
+void CoMutex::Awaiter::await_suspend(std::coroutine_handle<> caller) {
+  handle = caller;
+  if (mutex.tail != nullptr) {
+    mutex.tail->next = this;
+  } else {
+    mutex.head = this;
+  }
+  mutex.tail = this;
+}
+
+void CoMutex::unlock() {
+  Awaiter *first = head;
+  if (first == nullptr) {
+    locked = false;
+    return;
+  }
+  // The lock passes straight to the first waiter
+  head = first->next;
+  if (head == nullptr) {
+    tail = nullptr;
+  }
+  first->next = nullptr;
+  if (handedOffTail != nullptr) {
+    handedOffTail->next = first;
+  } else {
+    handedOffHead = first;
+  }
+  handedOffTail = first;
+}
+
+void coro_detail::resume_mutex_waiters() {
+  while (handedOffHead != nullptr) {
+    CoMutex::Awaiter *waiter = handedOffHead;
+    handedOffHead = waiter->next;
+    if (handedOffHead == nullptr) {
+      handedOffTail = nullptr;
+    }
+    // The awaiter lives in the frame being resumed, read it first
+    std::coroutine_handle<> handle = waiter->handle;
+    handle.resume();
+  }
+}
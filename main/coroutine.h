@@ -0,0 +1,358 @@
+/**
+  ******************************************************************************
+  * @authors        : Tomas Gonzalez & Brian Morris
+  * @file           : coroutine.h
+  * @brief          : Header for the coroutine executor, protocol flows run as
+  *                   C++20 coroutines on a single FreeRTOS task
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 Tomas Gonzalez & Brian Morris
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  */
+
+#ifndef COROUTINE_H
+#define COROUTINE_H
+
+/* Includes ------------------------------------------------------------ */
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <type_traits>
+#include <utility>
+#include "freertos/FreeRTOS.h"
+
+/* Defines ------------------------------------------------------------- */
+#define CORO_MAX_WAITS          64  // Timed waits suspended at once
+#define CORO_SPAWN_SLOTS        48  // Spawns from other tasks queued at once, the rest is kept for wake-ups
+#define CORO_READY_QUEUE_LENGTH (CORO_MAX_WAITS + CORO_SPAWN_SLOTS + 16)  // +16: producers checking at once
+#define CORO_NO_WAIT            UINT32_MAX
+
+/* Executor API -------------------------------------------------------- */
+class CoEvent;
+
+/**
+ * @brief Initialize the executor, must be called before spawning
+ */
+void coro_executor_init();
+
+/**
+ * @brief Runs every coroutine, sleeping until the next wake-up or deadline
+ */
+void coro_executor_task(void *arg);
+
+/**
+ * @brief Run the ready coroutines and the expired waits, then return
+ * @details For host tools without an executor task, the caller becomes the executor
+ */
+void coro_executor_poll();
+
+/**
+ * @brief Deadline of the earliest timed wait, for host tools that move the clock themselves
+ * @return hal_time_us() time of the deadline, INT64_MAX if no coroutine waits with a timeout
+ */
+int64_t coro_next_deadline();
+
+/**
+ * @brief Schedule a suspended coroutine, safe from any task and never blocks
+ * @details Other tasks get CORO_SPAWN_SLOTS, the rest of the queue is kept
+ *          for wake-ups so an event set by an RX task always gets through
+ * @param handle Coroutine to resume on the executor
+ * @return false if the ready queue is full, the coroutine was not scheduled
+ */
+bool coro_post(std::coroutine_handle<> handle);
+
+/**
+ * @brief Coroutines and wake-ups dropped because the ready queue was full, since boot
+ * @return Drop count
+ */
+uint32_t coro_dropped();
+
+/**
+ * @brief Number of coroutine frames alive, spawned or awaited
+ * @details Freed frames are kept for the next coroutine of the same size and
+ *          are not counted, the heap never gets them back
+ * @return Frame count
+ */
+size_t coro_frames_alive();
+
+/**
+ * @brief Register a timed wait, executor only
+ * @param handle Coroutine to resume
+ * @param timeout_ms Time before resuming with result false, 0 for none
+ * @param result Set to true when woken by coro_wake_wait(), false on timeout
+ * @param owner Event asked through CoEvent::timeout() before expiring, may be NULL
+ * @return Wait ID, CORO_NO_WAIT if every slot is taken
+ */
+uint32_t coro_register_wait(std::coroutine_handle<> handle, uint32_t timeout_ms, bool *result, CoEvent *owner);
+
+/**
+ * @brief Drop a registered wait without resuming it, executor only
+ * @param wait_id ID from coro_register_wait()
+ */
+void coro_cancel_wait(uint32_t wait_id);
+
+/**
+ * @brief Wake a registered wait with result true, safe from any task
+ * @param wait_id ID from coro_register_wait()
+ */
+void coro_wake_wait(uint32_t wait_id);
+
+/* Task ---------------------------------------------------------------- */
+template <typename T>
+class CoTask;
+
+namespace coro_detail {
+
+void *allocate_frame(size_t size);
+void free_frame(void *frame);
+void resume_mutex_waiters();
+
+struct PromiseBase {
+  std::coroutine_handle<> continuation;
+  bool detached = false;
+
+  struct FinalAwaiter {
+    bool await_ready() noexcept { return false; }
+
+    template <typename Promise>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+      PromiseBase& promise = handle.promise();
+      if (promise.continuation) {
+        return promise.continuation;
+      }
+      // Nobody awaits a spawned coroutine, it frees itself
+      if (promise.detached) {
+        handle.destroy();
+      }
+      return std::noop_coroutine();
+    }
+
+    void await_resume() noexcept {}
+  };
+
+  std::suspend_always initial_suspend() noexcept { return {}; }
+  FinalAwaiter final_suspend() noexcept { return {}; }
+  void unhandled_exception() { abort(); }
+
+  static void *operator new(size_t size) { return allocate_frame(size); }
+  static void operator delete(void *frame) { free_frame(frame); }
+};
+
+template <typename T>
+struct Promise : PromiseBase {
+  T value{};
+  CoTask<T> get_return_object();
+  void return_value(T result) { value = std::move(result); }
+};
+
+template <>
+struct Promise<void> : PromiseBase {
+  CoTask<void> get_return_object();
+  void return_void() {}
+};
+
+} // namespace coro_detail
+
+/**
+ * @brief Lazy coroutine, starts when awaited or spawned with coro_spawn()
+ * @details Frames come from the heap and are kept for reuse when the coroutine
+ *          ends, a suspended conversation costs its frame only, never a stack.
+ *          Store a co_await result before testing it, GCC 12 (host builds)
+ *          miscompiles a co_await inside an if condition.
+ */
+template <typename T = void>
+class CoTask {
+  public:
+    using promise_type = coro_detail::Promise<T>;
+    using Handle = std::coroutine_handle<promise_type>;
+
+    explicit CoTask(Handle handle) : handle(handle) {}
+    CoTask(CoTask&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+    CoTask(const CoTask&) = delete;
+    CoTask& operator=(const CoTask&) = delete;
+    ~CoTask() {
+      if (handle) {
+        handle.destroy();
+      }
+    }
+
+    bool await_ready() const noexcept { return false; }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller) noexcept {
+      handle.promise().continuation = caller;
+      return handle;
+    }
+
+    T await_resume() {
+      if constexpr (!std::is_void_v<T>) {
+        return std::move(handle.promise().value);
+      }
+    }
+
+    /**
+     * @brief Give up ownership, the frame frees itself when it ends
+     * @return The coroutine
+     */
+    Handle detach() {
+      handle.promise().detached = true;
+      return std::exchange(handle, nullptr);
+    }
+
+  private:
+    Handle handle;
+};
+
+namespace coro_detail {
+
+template <typename T>
+CoTask<T> Promise<T>::get_return_object() {
+  return CoTask<T>(std::coroutine_handle<Promise<T>>::from_promise(*this));
+}
+
+inline CoTask<void> Promise<void>::get_return_object() {
+  return CoTask<void>(std::coroutine_handle<Promise<void>>::from_promise(*this));
+}
+
+} // namespace coro_detail
+
+/**
+ * @brief Start a coroutine on the executor without waiting for it, safe from any task
+ * @param task Coroutine to run
+ */
+inline void coro_spawn(CoTask<void>&& task) {
+  std::coroutine_handle<> handle = task.detach();
+  if (!coro_post(handle)) {
+    handle.destroy(); // Never started, only its frame to free
+  }
+}
+
+/* Awaitables ---------------------------------------------------------- */
+/**
+ * @brief Suspend the calling coroutine for a while, executor only
+ */
+class CoSleep {
+  public:
+    explicit CoSleep(uint32_t ms) : ms(ms), expired(false) {}
+
+    bool await_ready() const noexcept { return ms == 0; }
+    bool await_suspend(std::coroutine_handle<> handle) {
+      // Resume right away when out of wait slots, the caller only loses the delay
+      return coro_register_wait(handle, ms, &expired, nullptr) != CORO_NO_WAIT;
+    }
+    void await_resume() const noexcept {}
+
+  private:
+    uint32_t ms;
+    bool expired;
+};
+
+inline CoSleep co_sleep_ms(uint32_t ms) {
+  return CoSleep(ms);
+}
+
+/**
+ * @brief Auto-reset event, set from any task and awaited by one coroutine
+ */
+class CoEvent {
+  public:
+    CoEvent() : signaled(false), waiter(CORO_NO_WAIT) { portMUX_INITIALIZE(&lock); }
+
+    /**
+     * @brief Wake the waiting coroutine, or the next one to wait, safe from any task
+     */
+    void set();
+
+    /**
+     * @brief Forget a set() nobody waited for, e.g. before sending a command
+     */
+    void reset();
+
+    /**
+     * @brief Called by the executor on timeout, claims the wait unless set() already did
+     * @param wait_id ID of the expiring wait
+     * @return true if the wait timed out, false if a wake-up is on its way
+     */
+    bool timeout(uint32_t wait_id);
+
+    class Awaiter {
+      public:
+        Awaiter(CoEvent& event, uint32_t timeout_ms) : event(event), timeout_ms(timeout_ms), result(false) {}
+
+        bool await_ready() const noexcept { return false; }
+        bool await_suspend(std::coroutine_handle<> handle);
+        bool await_resume() const noexcept { return result; }
+
+      private:
+        CoEvent& event;
+        uint32_t timeout_ms;
+        bool result;
+    };
+
+    /**
+     * @brief Wait for set(), executor only
+     * @param timeout_ms Give up after this long, 0 waits forever
+     * @return Awaitable, true if set, false on timeout
+     */
+    Awaiter wait(uint32_t timeout_ms) { return Awaiter(*this, timeout_ms); }
+
+  private:
+    portMUX_TYPE lock;
+    bool signaled;
+    uint32_t waiter;
+};
+
+/**
+ * @brief FIFO lock held across suspension points, executor only
+ */
+class CoMutex {
+  public:
+    class Awaiter {
+      public:
+        explicit Awaiter(CoMutex& mutex) : mutex(mutex), next(nullptr) {}
+
+        bool await_ready() {
+          if (!mutex.locked) {
+            mutex.locked = true;
+            return true;
+          }
+          return false;
+        }
+        void await_suspend(std::coroutine_handle<> caller);
+        void await_resume() const noexcept {}
+
+      private:
+        friend class CoMutex;
+        friend void coro_detail::resume_mutex_waiters();
+        CoMutex& mutex;
+        std::coroutine_handle<> handle;
+        Awaiter *next;
+    };
+
+    CoMutex() : locked(false), head(nullptr), tail(nullptr) {}
+
+    /**
+     * @brief Take the lock, waiters get it in arrival order
+     * @return Awaitable
+     */
+    Awaiter lock() { return Awaiter(*this); }
+
+    /**
+     * @brief Release the lock, handing it to the first waiter if any
+     * @details The waiter is resumed by the executor from a list of its own,
+     *          the hand-off cannot be lost to a full ready queue
+     */
+    void unlock();
+
+  private:
+    bool locked;
+    Awaiter *head;
+    Awaiter *tail;
+};
+
+#endif /* COROUTINE_H */
@@ -17,6 +17,7 @@
 /* Includes ------------------------------------------------------------ */
 #include "oled.h"
 
+#include <string.h>
 #include "driver/i2c_master.h"
 #include "esp_lcd_panel_sh1106.h"	
 #include "esp_err.h"
@@ -29,6 +30,54 @@ static const char *heartbeat_icon = "<3";
 
 lv_disp_t *disp;
 
+// Status widgets, created once and then only their text is updated
+static lv_obj_t *status_labels[OLED_STATUS_LINES];
+static lv_obj_t *heart_indicator = NULL;
+static bool status_screen_created = false;
+
+/* Private functions ---------------------------------------------------------- */
+static void create_status_screen() {
+  lv_obj_clean(lv_scr_act());
+
+  // Fixed-size, page aligned (8 px) labels keep every redraw and flush
+  // inside the rows of the label that changed
+  for (int line = 0; line < OLED_STATUS_LINES; line++) {
+    lv_obj_t *label = lv_label_create(lv_scr_act());
+    lv_label_set_long_mode(label, LV_LABEL_LONG_CLIP);
+    bool last_line = line == OLED_STATUS_LINES - 1;
+    lv_coord_t width = last_line ? OLED_STATUS_LABEL_WIDTH - OLED_HEARTBEAT_WIDTH : OLED_STATUS_LABEL_WIDTH;
+    lv_obj_set_size(label, width, OLED_STATUS_LINE_HEIGHT);
+    lv_label_set_text(label, "");
+    lv_obj_align(label, LV_ALIGN_TOP_LEFT, 10, line * OLED_STATUS_LINE_PITCH);
+    status_labels[line] = label;
+  }
+
+  heart_indicator = lv_label_create(lv_scr_act());
+  lv_label_set_text(heart_indicator, heartbeat_icon);
+  lv_obj_align(heart_indicator, LV_ALIGN_BOTTOM_RIGHT, -4, 0);
+  lv_obj_add_flag(heart_indicator, LV_OBJ_FLAG_HIDDEN);
+
+  status_screen_created = true;
+}
+
+static void set_label_text(lv_obj_t *label, const char *text) {
+  // lv_label_set_text invalidates even when the text is the same
+  if (strcmp(lv_label_get_text(label), text) != 0) {
+    lv_label_set_text(label, text);
+  }
+}
+
+static void set_hidden(lv_obj_t *obj, bool hidden) {
+  if (lv_obj_has_flag(obj, LV_OBJ_FLAG_HIDDEN) == hidden) {
+    return;
+  }
+  if (hidden) {
+    lv_obj_add_flag(obj, LV_OBJ_FLAG_HIDDEN);
+  } else {
+    lv_obj_clear_flag(obj, LV_OBJ_FLAG_HIDDEN);
+  }
+}
+
 /* Function implementations ------------------------------------------------- */
 void oled_init() {
   ESP_LOGI(OLED_TAG, "Initialize I2C bus");
@@ -94,6 +143,7 @@ void oled_init() {
 
 void oled_welcome() {
   lv_obj_clean(lv_scr_act());
+  status_screen_created = false;
 
   lv_obj_t *label1 = lv_label_create(lv_scr_act());
   lv_label_set_text(label1, "Welcome to");
@@ -109,29 +159,12 @@ void oled_welcome() {
 }
 
 void oled_status(char *wifi_status, char *mqtt_status, char *lsu_status, bool heartbeat_active) {
-  // ESP_LOGI(OLED_TAG, "Status update");
-  lv_obj_clean(lv_scr_act());
-
-  // Create a label for WiFi status
-  lv_obj_t *wifi_label = lv_label_create(lv_scr_act());
-  lv_label_set_text(wifi_label, wifi_status);
-  lv_obj_align(wifi_label, LV_ALIGN_TOP_LEFT, 10, 0);
-
-  // Create a label for MQTT status
-  lv_obj_t *mqtt_label = lv_label_create(lv_scr_act());
-  lv_label_set_text(mqtt_label, mqtt_status);
-  lv_obj_align(mqtt_label, LV_ALIGN_TOP_LEFT, 10, 20);
-
-  // Create a label for LSU count
-  lv_obj_t *lsu_label = lv_label_create(lv_scr_act());
-  lv_label_set_text(lsu_label, lsu_status);
-  lv_obj_align(lsu_label, LV_ALIGN_TOP_LEFT, 10, 40);
-
-  // Draw heartbeat icon (small heart) at bottom left
-  if (heartbeat_active) {
-    // Create a simple filled circle as a heart indicator
-    lv_obj_t *heart_indicator = lv_label_create(lv_scr_act());
-    lv_label_set_text(heart_indicator, heartbeat_icon);
-    lv_obj_align(heart_indicator, LV_ALIGN_BOTTOM_RIGHT, -10, -10);
+  if (!status_screen_created) {
+    create_status_screen();
   }
+
+  set_label_text(status_labels[0], wifi_status);
+  set_label_text(status_labels[1], mqtt_status);
+  set_label_text(status_labels[2], lsu_status);
+  set_hidden(heart_indicator, !heartbeat_active);
 }
@@ -39,6 +39,12 @@ extern "C" {
 #define LCD_CMD_BITS           8
 #define LCD_PARAM_BITS         8
 
+#define OLED_STATUS_LINES        3
+#define OLED_STATUS_LINE_HEIGHT  16  // Two SH1106 pages
+#define OLED_STATUS_LINE_PITCH   24  // Multiple of the 8 px page height
+#define OLED_STATUS_LABEL_WIDTH  (LCD_H_RES - 10)
+#define OLED_HEARTBEAT_WIDTH     24  // Reserved at the right of the last line
+
 /* Public functions ---------------------------------------------------------- */
 
 /**
@@ -57,6 +63,8 @@ void oled_welcome();
 
 /**
  * @brief Display the status of the system
+ * @details The widgets are created on the first call, later calls only
+ *          update the labels whose text changed. Must run in LVGL context.
  * @param wifi_status: The status of the WiFi connection
  * @param mqtt_status: The status of the MQTT connection
  * @param lsu_status: The status of the LSU connection
@@ -18,75 +18,220 @@
 #include "status.h"
 
 #include <stdio.h>
+#include <string.h>
 #include "oled.h"
-#include "esp_log.h"
+#include "esp_timer.h"
 #include "lvgl.h"
+#include "esp_lvgl_port.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "freertos/semphr.h"
+
+/* Private defines ------------------------------------------------------- */
+#define STATUS_LINE_LEN 24
+
+/* Private types --------------------------------------------------------- */
+typedef enum {
+  STATUS_PAGE_STATUS = 0,
+  STATUS_PAGE_QUEUES,
+  STATUS_PAGE_FIRST_LSU,  // One page per row in the model
+} status_page_t;
 
 /* Private variables ----------------------------------------------------- */
-char wifi_status[32] = "Wi-Fi: --";
-char mqtt_status[32] = "MQTT: --";
-char lsu_count[32] = "LSUs: 0";
-bool heartbeat_active = false;
 bool display_ready = false;
 
-// Semaphore to signal display update needed
-static SemaphoreHandle_t display_update_semaphore = NULL;
+// Seqlock: odd while a producer is writing, readers retry instead of blocking
+static status_model_t status_model = {
+  .wifi = STATUS_LINK_UNKNOWN,
+  .mqtt = STATUS_LINK_UNKNOWN,
+  .lsu_count = 0,
+  .heartbeat_active = false,
+  .lsu_rows = 0,
+};
+static uint32_t status_seq = 0;
+static portMUX_TYPE status_writer_mux = portMUX_INITIALIZER_UNLOCKED;
 
-/* Public functions ----------------------------------------------------- */
-void init_display_mutex() {
-  // Create semaphore for display updates
-  if (display_update_semaphore == NULL) {
-    display_update_semaphore = xSemaphoreCreateBinary();
-    if (display_update_semaphore == NULL) {
-      ESP_LOGE("STATUS", "Failed to create display update semaphore");
-    }
+// Owned by the refresh timer, at most STATUS_MAX_FPS frames per second
+static lv_timer_t *refresh_timer = NULL;
+static bool redraw_requested = false;  // Set by any task, taken by the refresh timer
+static uint32_t rendered_seq = UINT32_MAX;
+static int rendered_page = -1;
+static status_model_t rendered;
+static char wifi_line[STATUS_LINE_LEN];
+static char mqtt_line[STATUS_LINE_LEN];
+static char lsu_line[STATUS_LINE_LEN];
+static char diag_lines[OLED_STATUS_LINES][STATUS_LINE_LEN];
+
+/* Private functions ----------------------------------------------------- */
+static const char *link_to_string(status_link_t link) {
+  switch (link) {
+    case STATUS_LINK_OFFLINE:
+      return "Offline";
+    case STATUS_LINK_ONLINE:
+      return "Online";
+    case STATUS_LINK_NO_CREDENTIALS:
+      return "No creds";
+    default:
+      return "--";
   }
 }
 
-// LVGL timer callback for safe display updates
-static void display_update_timer_cb(lv_timer_t * timer) {
-  if (display_ready) {
-    oled_status(wifi_status, mqtt_status, lsu_count, heartbeat_active);
+static void status_write_begin(void) {
+  taskENTER_CRITICAL(&status_writer_mux);
+  __atomic_store_n(&status_seq, status_seq + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static void status_write_end(void) {
+  __atomic_store_n(&status_seq, status_seq + 1, __ATOMIC_RELEASE);
+  taskEXIT_CRITICAL(&status_writer_mux);
+}
+
+static void render_status_page(const status_model_t *snapshot, uint32_t seq) {
+  if (seq == rendered_seq && rendered_page == STATUS_PAGE_STATUS) {
+    return;
+  }
+
+  // Format only the fields that changed, the first frame formats all of them
+  bool first_frame = rendered_seq == UINT32_MAX;
+  if (first_frame || snapshot->wifi != rendered.wifi) {
+    snprintf(wifi_line, sizeof(wifi_line), "Wi-Fi: %s", link_to_string(snapshot->wifi));
   }
-  // Delete the timer after one execution
-  lv_timer_del(timer);
+  if (first_frame || snapshot->mqtt != rendered.mqtt) {
+    snprintf(mqtt_line, sizeof(mqtt_line), "MQTT: %s", link_to_string(snapshot->mqtt));
+  }
+  if (first_frame || snapshot->lsu_count != rendered.lsu_count) {
+    snprintf(lsu_line, sizeof(lsu_line), "LSUs: %lu", (unsigned long) snapshot->lsu_count);
+  }
+
+  rendered = *snapshot;
+  rendered_seq = seq;
+  oled_status(wifi_line, mqtt_line, lsu_line, snapshot->heartbeat_active);
 }
 
-void push_status_to_oled() {
-  if (display_ready) {
-    // Create a one-shot timer to update display from LVGL task context
-    lv_timer_t * timer = lv_timer_create(display_update_timer_cb, 1, NULL);
-    if (timer != NULL) {
-      lv_timer_set_repeat_count(timer, 1); // Execute only once
-    }
+static void render_queues_page(const status_model_t *snapshot) {
+  snprintf(diag_lines[0], STATUS_LINE_LEN, "RX main: %u", snapshot->rx_queue_main);
+  snprintf(diag_lines[1], STATUS_LINE_LEN, "RX aux: %u", snapshot->rx_queue_aux);
+  snprintf(diag_lines[2], STATUS_LINE_LEN, "Cmds: %u", snapshot->command_queue);
+  oled_status(diag_lines[0], diag_lines[1], diag_lines[2], snapshot->heartbeat_active);
+}
+
+static void render_lsu_page(const status_model_t *snapshot, const status_lsu_row_t *row, int64_t now_us) {
+  int64_t age_s = (now_us - row->last_seen_us) / 1000000;
+
+  snprintf(diag_lines[0], STATUS_LINE_LEN, "LSU %lu @%lus", (unsigned long) row->id,
+           (unsigned long) (row->slot_ms / 1000));
+  if (row->rssi == 0) {
+    snprintf(diag_lines[1], STATUS_LINE_LEN, "-- dBm");
+  } else {
+    snprintf(diag_lines[1], STATUS_LINE_LEN, "%ddBm %ddB", row->rssi, row->snr);
+  }
+  if (age_s < 600) {
+    snprintf(diag_lines[2], STATUS_LINE_LEN, "Age %llds", (long long) age_s);
+  } else {
+    snprintf(diag_lines[2], STATUS_LINE_LEN, "Age %lldm", (long long) (age_s / 60));
+  }
+  oled_status(diag_lines[0], diag_lines[1], diag_lines[2], snapshot->heartbeat_active);
+}
+
+// LVGL timer callback, rotates the pages and renders from a model snapshot only
+static void display_refresh_timer_cb(lv_timer_t * timer) {
+  if (!display_ready) {
+    return;
+  }
+
+  if (__atomic_exchange_n(&redraw_requested, false, __ATOMIC_ACQUIRE)) {
+    rendered_seq = UINT32_MAX;
   }
+
+  status_model_t snapshot;
+  uint32_t seq = status_get_snapshot(&snapshot);
+
+  int64_t now_us = esp_timer_get_time();
+  int page_count = STATUS_PAGE_FIRST_LSU + snapshot.lsu_rows;
+  int page = (int) ((now_us / 1000 / STATUS_PAGE_DWELL_MS) % page_count);
+
+  // Diagnostics pages show ages, they are reformatted every frame and
+  // oled_status only redraws the labels whose text changed
+  if (page == STATUS_PAGE_STATUS) {
+    render_status_page(&snapshot, seq);
+  } else if (page == STATUS_PAGE_QUEUES) {
+    render_queues_page(&snapshot);
+  } else {
+    render_lsu_page(&snapshot, &snapshot.lsu[page - STATUS_PAGE_FIRST_LSU], now_us);
+  }
+  rendered_page = page;
 }
 
-void update_wifi_status(char *status) {
-  sprintf(wifi_status, "Wi-Fi: %s", status);
-  push_status_to_oled();
+/* Public functions ----------------------------------------------------- */
+uint32_t status_get_snapshot(status_model_t *snapshot) {
+  uint32_t begin;
+  uint32_t end;
+  do {
+    begin = __atomic_load_n(&status_seq, __ATOMIC_ACQUIRE);
+    if (begin & 1) {
+      continue; // Producer mid-write
+    }
+    *snapshot = status_model;
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    end = __atomic_load_n(&status_seq, __ATOMIC_RELAXED);
+  } while ((begin & 1) || begin != end);
+  return begin;
 }
 
-void update_mqtt_status(char *status) {
-  sprintf(mqtt_status, "MQTT: %s", status);
-  push_status_to_oled();
+void push_status_to_oled() {
+  // Force a redraw even if the model is unchanged, e.g. after the welcome screen.
+  // Only the refresh timer touches rendered_seq, it picks the request up.
+  __atomic_store_n(&redraw_requested, true, __ATOMIC_RELEASE);
+}
+
+void update_wifi_status(status_link_t status) {
+  status_write_begin();
+  status_model.wifi = status;
+  status_write_end();
+}
+
+void update_mqtt_status(status_link_t status) {
+  status_write_begin();
+  status_model.mqtt = status;
+  status_write_end();
 }
 
 void update_lsu_count(int count) {
-  sprintf(lsu_count, "LSUs: %d", count);
-  push_status_to_oled();
+  status_write_begin();
+  status_model.lsu_count = (uint32_t) count;
+  status_write_end();
 }
 
 void update_heartbeat_status(bool is_active) {
-  heartbeat_active = is_active;
-  push_status_to_oled();
+  status_write_begin();
+  status_model.heartbeat_active = is_active;
+  status_write_end();
+}
+
+void update_queue_depths(uint16_t rx_main, uint16_t rx_aux, uint16_t commands) {
+  status_write_begin();
+  status_model.rx_queue_main = rx_main;
+  status_model.rx_queue_aux = rx_aux;
+  status_model.command_queue = commands;
+  status_write_end();
+}
+
+void update_lsu_rows(const status_lsu_row_t *rows, uint8_t count) {
+  if (count > STATUS_MAX_LSU_ROWS) {
+    count = STATUS_MAX_LSU_ROWS;
+  }
+  status_write_begin();
+  memcpy(status_model.lsu, rows, count * sizeof(status_lsu_row_t));
+  status_model.lsu_rows = count;
+  status_write_end();
 }
 
 void set_display_ready(bool ready) {
   display_ready = ready;
+  if (ready && refresh_timer == NULL && lvgl_port_lock(0)) {
+    refresh_timer = lv_timer_create(display_refresh_timer_cb, 1000 / STATUS_MAX_FPS, NULL);
+    lvgl_port_unlock();
+  }
   if (ready) {
     push_status_to_oled(); // Update display when it becomes ready
   }
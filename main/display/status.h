@@ -19,39 +19,76 @@
 #define STATUS_H
 
 #include <stdbool.h>
+#include <stdint.h>
+
+/* Defines ------------------------------------------------------------------- */
+#define STATUS_MAX_FPS 4 // Upper bound of status frames pushed to the OLED
+#define STATUS_PAGE_DWELL_MS 4000 // Time each page stays on screen
+#define STATUS_MAX_LSU_ROWS 8     // Worst links kept for the per-LSU pages
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-/* Public functions ---------------------------------------------------------- */
+/* Types --------------------------------------------------------------------- */
+typedef enum {
+  STATUS_LINK_UNKNOWN = 0,
+  STATUS_LINK_OFFLINE,
+  STATUS_LINK_ONLINE,
+  STATUS_LINK_NO_CREDENTIALS,
+} status_link_t;
+
 /**
- * @brief Initialize the display mutex for thread-safe operations
- * @param None
- * @return None
+ * @brief Link statistics of one LSU, copied from the fleet snapshot
  */
-void init_display_mutex();
+typedef struct {
+  uint32_t id;
+  uint32_t slot_ms;
+  int64_t last_seen_us;
+  int16_t rssi;  // dBm, 0 when unknown
+  int8_t snr;    // dB
+} status_lsu_row_t;
 
+/**
+ * @brief Typed status fields, formatted only by the display
+ */
+typedef struct {
+  status_link_t wifi;
+  status_link_t mqtt;
+  uint32_t lsu_count;
+  bool heartbeat_active;
+
+  // Diagnostics pages
+  uint16_t rx_queue_main;
+  uint16_t rx_queue_aux;
+  uint16_t command_queue;
+  uint8_t lsu_rows;
+  status_lsu_row_t lsu[STATUS_MAX_LSU_ROWS];  // Weakest RSSI first
+} status_model_t;
+
+/* Public functions ---------------------------------------------------------- */
 /**
  * @brief Push the status to the OLED display
+ * @details Forces the next refresh to redraw, frames are still limited to
+ *          STATUS_MAX_FPS per second. Safe from any task
  * @param None
  * @return None
  */
 void push_status_to_oled();
 
 /**
- * @brief Update the WiFi status
+ * @brief Update the WiFi status, safe from any task
  * @param status: The status of the WiFi connection
  * @return None
  */
-void update_wifi_status(char *status);
+void update_wifi_status(status_link_t status);
 
 /**
- * @brief Update the MQTT status
+ * @brief Update the MQTT status, safe from any task
  * @param status: The status of the MQTT connection
  * @return None
  */
-void update_mqtt_status(char *status);
+void update_mqtt_status(status_link_t status);
 
 /**
  * @brief Update the LSU count
@@ -67,6 +104,30 @@ void update_lsu_count(int count);
  */
 void update_heartbeat_status(bool is_active);
 
+/**
+ * @brief Update the queue depths shown on the diagnostics page
+ * @param rx_main: Requests waiting from the main radio
+ * @param rx_aux: Requests waiting from the aux radio
+ * @param commands: Downlink commands waiting
+ * @return None
+ */
+void update_queue_depths(uint16_t rx_main, uint16_t rx_aux, uint16_t commands);
+
+/**
+ * @brief Replace the per-LSU rows shown on the diagnostics pages
+ * @param rows: Rows ordered weakest link first
+ * @param count: Number of rows, clamped to STATUS_MAX_LSU_ROWS
+ * @return None
+ */
+void update_lsu_rows(const status_lsu_row_t *rows, uint8_t count);
+
+/**
+ * @brief Take a consistent copy of the status without blocking producers
+ * @param snapshot: Output copy
+ * @return Sequence number of the copy, changes whenever any field changes
+ */
+uint32_t status_get_snapshot(status_model_t *snapshot);
+
 /**
  * @brief Set the display ready state
  * @param ready: Boolean indicating if display is ready for updates
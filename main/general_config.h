@@ -13,6 +13,9 @@
 /* Defines -------------------------------------------------------------------*/
 #define CU_ADDRESS 0x01
 #define TIME_PERIOD_MS 60000 // 1 minute
-#define MAX_LSU_COUNT 100
+#define RADIO_ROLES_DEFAULT RADIO_ROLES_JOIN_DATA  // Or RADIO_ROLES_SPLIT, see radio_roles.h
+#ifndef MAX_LSU_COUNT
+#define MAX_LSU_COUNT 100    // Host scale tools build with a larger fleet
+#endif
 
 #endif /* GENERAL_CONFIG_H */
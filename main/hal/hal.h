@@ -0,0 +1,179 @@
+/**
+  ******************************************************************************
+  * @authors        : Tomas Gonzalez & Brian Morris
+  * @file           : hal.h
+  * @brief          : Hardware abstraction layer, the platform services used by
+  *                   the CU core logic so it also builds on a Linux host
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 Tomas Gonzalez & Brian Morris
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef HAL_H
+#define HAL_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "display/status.h"
+
+/*
+ * The other services are not declared here:
+ * - Logging stays ESP_LOGx, the host build provides its own esp_log.h
+ * - UART is uart.h, implemented by uart.c on the ESP32 and host/uart_host.cpp
+ *
+ * hal_esp.cpp implements this header on the ESP32, host/hal_host.cpp on Linux.
+ */
+
+#ifdef ESP_PLATFORM
+#include "esp_timer.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Types ---------------------------------------------------------------------*/
+typedef enum {
+  HAL_NVS_OK = 0,
+  HAL_NVS_NOT_FOUND,
+  HAL_NVS_FAIL,
+} hal_nvs_err_t;
+
+typedef enum {
+  HAL_NVS_U32,
+  HAL_NVS_I64,
+  HAL_NVS_BLOB,
+} hal_nvs_type_t;
+
+/**
+ * @brief One key written by hal_nvs_write()
+ */
+typedef struct {
+  const char *key;
+  hal_nvs_type_t type;
+  const void *value;
+  size_t size;  // Blobs only, 0 skips the key
+} hal_nvs_item_t;
+
+/* Time ----------------------------------------------------------------------*/
+/**
+ * @brief Microseconds since boot, monotonic
+ */
+#ifdef ESP_PLATFORM
+static inline int64_t hal_time_us(void) {
+  return esp_timer_get_time();
+}
+#else
+int64_t hal_time_us(void);
+#endif
+
+/**
+ * @brief Free heap in bytes, reported by the STATUS command
+ */
+size_t hal_free_heap(void);
+
+/* NVS -----------------------------------------------------------------------*/
+/**
+ * @brief Write several keys of a namespace with a single commit
+ * @param ns Namespace
+ * @param items Keys to write
+ * @param count Number of keys
+ * @return HAL_NVS_OK once committed
+ */
+hal_nvs_err_t hal_nvs_write(const char *ns, const hal_nvs_item_t *items, size_t count);
+
+/**
+ * @brief Read one key
+ * @param ns Namespace
+ * @param key Key
+ * @param type Type the key was written with
+ * @param value Output, sized for the type
+ * @param size Blobs only, capacity in and bytes read out
+ * @return HAL_NVS_NOT_FOUND when the namespace or the key does not exist
+ */
+hal_nvs_err_t hal_nvs_read(const char *ns, const char *key, hal_nvs_type_t type, void *value, size_t *size);
+
+/**
+ * @brief Erase every key of a namespace
+ * @param ns Namespace
+ * @return HAL_NVS_OK once committed
+ */
+hal_nvs_err_t hal_nvs_erase(const char *ns);
+
+/* Trace storage -------------------------------------------------------------*/
+#define HAL_TRACE_SECTOR_SIZE 4096  // Erase unit, erased bytes read as 0xFF
+
+/**
+ * @brief Size of the UART trace partition, 0 when the partition table has none
+ */
+size_t hal_trace_size(void);
+
+/**
+ * @brief Erase whole sectors of the trace partition
+ * @param offset Sector aligned
+ * @param size Multiple of HAL_TRACE_SECTOR_SIZE
+ */
+bool hal_trace_erase(size_t offset, size_t size);
+
+/**
+ * @brief Write to erased bytes of the trace partition
+ */
+bool hal_trace_write(size_t offset, const void *data, size_t size);
+
+bool hal_trace_read(size_t offset, void *data, size_t size);
+
+/* Publish -------------------------------------------------------------------*/
+/**
+ * @brief Publish a message to the broker, dropped while offline
+ * @param topic Topic
+ * @param payload Null-terminated payload
+ * @param retained The broker keeps it for new subscribers
+ */
+void hal_publish(const char *topic, const char *payload, bool retained);
+
+/**
+ * @brief Publish without waiting for the broker, from the coroutine executor
+ * @param topic Topic
+ * @param payload Null-terminated payload, copied
+ * @param retained The broker keeps it for new subscribers
+ */
+void hal_publish_queued(const char *topic, const char *payload, bool retained);
+
+/**
+ * @brief Publish a command reply as "<correlation_id> <result>"
+ * @param correlation_id ID received with the command
+ * @param result Result text
+ */
+void hal_publish_reply(uint32_t correlation_id, const char *result);
+
+/**
+ * @brief Whether the broker is reachable
+ */
+bool hal_publish_connected(void);
+
+/* Display -------------------------------------------------------------------*/
+void hal_display_lsu_count(uint32_t count);
+
+void hal_display_queue_depths(uint16_t rx_main, uint16_t rx_aux, uint16_t commands);
+
+/**
+ * @brief Rows of the per-LSU diagnostics pages, weakest link first
+ * @param rows Rows to show
+ * @param count Number of rows, extra ones are dropped
+ */
+void hal_display_lsu_rows(const status_lsu_row_t *rows, uint8_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HAL_H */
@@ -0,0 +1,203 @@
+/**
+  ******************************************************************************
+  * @authors        : Tomas Gonzalez & Brian Morris
+  * @file           : hal_esp.cpp
+  * @brief          : Hardware abstraction layer on the ESP32, forwards to
+  *                   ESP-IDF, the MQTT client and the OLED status model
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 Tomas Gonzalez & Brian Morris
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "hal.h"
+
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_partition.h"
+#include "nvs.h"
+#include "wi-fi/mqtt_api.h"
+
+/* Private variables ---------------------------------------------------------*/
+static const char *HAL_TAG = "HAL";
+static const esp_partition_t *tracePartition = NULL;
+static bool traceLookedUp = false;
+
+/* Private functions ---------------------------------------------------------*/
+static hal_nvs_err_t to_hal(esp_err_t err) {
+  if (err == ESP_OK) {
+    return HAL_NVS_OK;
+  }
+  return err == ESP_ERR_NVS_NOT_FOUND ? HAL_NVS_NOT_FOUND : HAL_NVS_FAIL;
+}
+
+static esp_err_t set_item(nvs_handle_t handle, const hal_nvs_item_t& item) {
+  switch (item.type) {
+    case HAL_NVS_U32:
+      return nvs_set_u32(handle, item.key, *(const uint32_t*) item.value);
+    case HAL_NVS_I64:
+      return nvs_set_i64(handle, item.key, *(const int64_t*) item.value);
+    case HAL_NVS_BLOB:
+      return item.size == 0 ? ESP_OK : nvs_set_blob(handle, item.key, item.value, item.size);
+  }
+  return ESP_ERR_INVALID_ARG;
+}
+
+/* System --------------------------------------------------------------------*/
+size_t hal_free_heap(void) {
+  return esp_get_free_heap_size();
+}
+
+/* NVS -----------------------------------------------------------------------*/
+hal_nvs_err_t hal_nvs_write(const char *ns, const hal_nvs_item_t *items, size_t count) {
+  nvs_handle_t handle;
+  esp_err_t err = nvs_open(ns, NVS_READWRITE, &handle);
+  if (err != ESP_OK) {
+    ESP_LOGE(HAL_TAG, "Error opening NVS namespace %s: %s", ns, esp_err_to_name(err));
+    return to_hal(err);
+  }
+
+  for (size_t i = 0; i < count && err == ESP_OK; i++) {
+    err = set_item(handle, items[i]);
+    if (err != ESP_OK) {
+      ESP_LOGE(HAL_TAG, "Error writing %s/%s: %s", ns, items[i].key, esp_err_to_name(err));
+    }
+  }
+  if (err == ESP_OK) {
+    err = nvs_commit(handle);
+    if (err != ESP_OK) {
+      ESP_LOGE(HAL_TAG, "Error committing %s: %s", ns, esp_err_to_name(err));
+    }
+  }
+  nvs_close(handle);
+  return to_hal(err);
+}
+
+hal_nvs_err_t hal_nvs_read(const char *ns, const char *key, hal_nvs_type_t type, void *value, size_t *size) {
+  nvs_handle_t handle;
+  esp_err_t err = nvs_open(ns, NVS_READONLY, &handle);
+  if (err != ESP_OK) {
+    return to_hal(err);
+  }
+
+  switch (type) {
+    case HAL_NVS_U32:
+      err = nvs_get_u32(handle, key, (uint32_t*) value);
+      break;
+    case HAL_NVS_I64:
+      err = nvs_get_i64(handle, key, (int64_t*) value);
+      break;
+    case HAL_NVS_BLOB:
+      err = nvs_get_blob(handle, key, value, size);
+      break;
+  }
+  if (err != ESP_OK && err != ESP_ERR_NVS_NOT_FOUND) {
+    ESP_LOGW(HAL_TAG, "Error reading %s/%s: %s", ns, key, esp_err_to_name(err));
+  }
+  nvs_close(handle);
+  return to_hal(err);
+}
+
+hal_nvs_err_t hal_nvs_erase(const char *ns) {
+  nvs_handle_t handle;
+  esp_err_t err = nvs_open(ns, NVS_READWRITE, &handle);
+  if (err != ESP_OK) {
+    ESP_LOGE(HAL_TAG, "Error opening NVS namespace %s: %s", ns, esp_err_to_name(err));
+    return to_hal(err);
+  }
+  err = nvs_erase_all(handle);
+  if (err == ESP_OK) {
+    err = nvs_commit(handle);
+  }
+  if (err != ESP_OK) {
+    ESP_LOGE(HAL_TAG, "Error erasing %s: %s", ns, esp_err_to_name(err));
+  }
+  nvs_close(handle);
+  return to_hal(err);
+}
+
+/* Trace storage -------------------------------------------------------------*/
+#define TRACE_PARTITION_SUBTYPE ((esp_partition_subtype_t) 0x40)
+
+static const esp_partition_t *trace_partition(void) {
+  if (!traceLookedUp) {
+    tracePartition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, TRACE_PARTITION_SUBTYPE, "uarttrace");
+    traceLookedUp = true;
+    if (tracePartition == NULL) {
+      ESP_LOGW(HAL_TAG, "No uarttrace partition, UART capture disabled");
+    }
+  }
+  return tracePartition;
+}
+
+size_t hal_trace_size(void) {
+  const esp_partition_t *partition = trace_partition();
+  return partition == NULL ? 0 : partition->size;
+}
+
+bool hal_trace_erase(size_t offset, size_t size) {
+  const esp_partition_t *partition = trace_partition();
+  esp_err_t err = partition == NULL ? ESP_ERR_NOT_FOUND : esp_partition_erase_range(partition, offset, size);
+  if (err != ESP_OK) {
+    ESP_LOGE(HAL_TAG, "Error erasing trace at %zu: %s", offset, esp_err_to_name(err));
+  }
+  return err == ESP_OK;
+}
+
+bool hal_trace_write(size_t offset, const void *data, size_t size) {
+  const esp_partition_t *partition = trace_partition();
+  esp_err_t err = partition == NULL ? ESP_ERR_NOT_FOUND : esp_partition_write(partition, offset, data, size);
+  if (err != ESP_OK) {
+    ESP_LOGE(HAL_TAG, "Error writing trace at %zu: %s", offset, esp_err_to_name(err));
+  }
+  return err == ESP_OK;
+}
+
+bool hal_trace_read(size_t offset, void *data, size_t size) {
+  const esp_partition_t *partition = trace_partition();
+  esp_err_t err = partition == NULL ? ESP_ERR_NOT_FOUND : esp_partition_read(partition, offset, data, size);
+  if (err != ESP_OK) {
+    ESP_LOGE(HAL_TAG, "Error reading trace at %zu: %s", offset, esp_err_to_name(err));
+  }
+  return err == ESP_OK;
+}
+
+/* Publish -------------------------------------------------------------------*/
+void hal_publish(const char *topic, const char *payload, bool retained) {
+  if (retained) {
+    mqtt_api_publish_retained(topic, payload);
+  } else {
+    mqtt_api_publish(topic, payload);
+  }
+}
+
+void hal_publish_queued(const char *topic, const char *payload, bool retained) {
+  mqtt_api_enqueue(topic, payload, retained);
+}
+
+void hal_publish_reply(uint32_t correlation_id, const char *result) {
+  mqtt_api_publish_reply(correlation_id, result);
+}
+
+bool hal_publish_connected(void) {
+  return mqtt_api_is_connected();
+}
+
+/* Display -------------------------------------------------------------------*/
+void hal_display_lsu_count(uint32_t count) {
+  update_lsu_count(count);
+}
+
+void hal_display_queue_depths(uint16_t rx_main, uint16_t rx_aux, uint16_t commands) {
+  update_queue_depths(rx_main, rx_aux, commands);
+}
+
+void hal_display_lsu_rows(const status_lsu_row_t *rows, uint8_t count) {
+  update_lsu_rows(rows, count);
+}
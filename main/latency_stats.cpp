@@ -0,0 +1,124 @@
+/**
+  ******************************************************************************
+  * @authors        : Tomas Gonzalez & Brian Morris
+  * @file           : latency_stats.cpp
+  * @brief          : Per-stage latency histograms of the uplink pipeline, from
+  *                   the UART bytes to the MQTT publish
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 Tomas Gonzalez & Brian Morris
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  */
+
+/* Includes ------------------------------------------------------------ */
+#include "latency_stats.h"
+
+#include <atomic>
+#include <stdio.h>
+#include "esp_log.h"
+#include "hal/hal.h"
+
+/* Private variables --------------------------------------------------------- */
+static const char *LATENCY_STATS_TAG = "LATENCY";
+
+static const char *stageNames[LATENCY_STAGE_COUNT] = {
+  "uart_rx",
+  "parse",
+  "post",
+  "queue",
+  "ack",
+  "keepalive",
+  "nvs_save",
+  "publish",
+  "end_to_end"
+};
+
+// Relaxed atomics only, recording never blocks the RX or processing tasks
+static std::atomic<uint32_t> buckets[LATENCY_STAGE_COUNT][LATENCY_BUCKETS];
+static std::atomic<uint32_t> maxima[LATENCY_STAGE_COUNT];
+
+/* Private functions --------------------------------------------------------- */
+static int bucket_of(uint32_t elapsed_us) {
+  int bucket = 31 - __builtin_clz(elapsed_us | 1);
+  return bucket < LATENCY_BUCKETS ? bucket : LATENCY_BUCKETS - 1;
+}
+
+static uint32_t bucket_upper_bound(int bucket) {
+  return bucket == LATENCY_BUCKETS - 1 ? UINT32_MAX : (2u << bucket);
+}
+
+static uint32_t percentile(const uint32_t *counts, uint32_t total, uint32_t percent, uint32_t max_us) {
+  // Rank of the sample, rounded up so p99 of a few samples is the worst one
+  uint32_t rank = (uint32_t) (((uint64_t) total * percent + 99) / 100);
+  uint32_t seen = 0;
+  for (int bucket = 0; bucket < LATENCY_BUCKETS; bucket++) {
+    seen += counts[bucket];
+    if (seen >= rank) {
+      uint32_t bound = bucket_upper_bound(bucket);
+      return bound < max_us ? bound : max_us;
+    }
+  }
+  return max_us;
+}
+
+/* Functions ------------------------------------------------------------ */
+void latency_record(LatencyStage stage, int64_t elapsed_us) {
+  uint32_t sample = elapsed_us <= 0 ? 0 : elapsed_us >= UINT32_MAX ? UINT32_MAX : (uint32_t) elapsed_us;
+  buckets[stage][bucket_of(sample)].fetch_add(1, std::memory_order_relaxed);
+
+  uint32_t current = maxima[stage].load(std::memory_order_relaxed);
+  while (sample > current && !maxima[stage].compare_exchange_weak(current, sample, std::memory_order_relaxed)) {
+  }
+}
+
+int64_t latency_record_since(LatencyStage stage, int64_t start_us) {
+  int64_t now_us = hal_time_us();
+  latency_record(stage, now_us - start_us);
+  return now_us;
+}
+
+void latency_collect(LatencySummary *summaries) {
+  for (int stage = 0; stage < LATENCY_STAGE_COUNT; stage++) {
+    uint32_t counts[LATENCY_BUCKETS];
+    uint32_t total = 0;
+    for (int bucket = 0; bucket < LATENCY_BUCKETS; bucket++) {
+      counts[bucket] = buckets[stage][bucket].exchange(0, std::memory_order_relaxed);
+      total += counts[bucket];
+    }
+    uint32_t max_us = maxima[stage].exchange(0, std::memory_order_relaxed);
+
+    LatencySummary& summary = summaries[stage];
+    summary.count = total;
+    summary.max_us = max_us;
+    summary.p50_us = total ? percentile(counts, total, 50, max_us) : 0;
+    summary.p90_us = total ? percentile(counts, total, 90, max_us) : 0;
+    summary.p99_us = total ? percentile(counts, total, 99, max_us) : 0;
+  }
+}
+
+void latency_format(const LatencySummary *summaries, uint32_t window_s, char *buff, size_t size) {
+  size_t len = snprintf(buff, size, "%lu", (unsigned long) window_s);
+  for (int stage = 0; stage < LATENCY_STAGE_COUNT && len < size; stage++) {
+    const LatencySummary& summary = summaries[stage];
+    len += snprintf(&buff[len], size - len, ";%s,%lu,%lu,%lu,%lu,%lu", stageNames[stage],
+                    (unsigned long) summary.count, (unsigned long) summary.p50_us,
+                    (unsigned long) summary.p90_us, (unsigned long) summary.p99_us,
+                    (unsigned long) summary.max_us);
+  }
+}
+
+void latency_log(const LatencySummary *summaries) {
+  ESP_LOGI(LATENCY_STATS_TAG, "%-10s %6s %10s %10s %10s %10s", "stage", "count", "p50_us", "p90_us", "p99_us", "max_us");
+  for (int stage = 0; stage < LATENCY_STAGE_COUNT; stage++) {
+    const LatencySummary& summary = summaries[stage];
+    ESP_LOGI(LATENCY_STATS_TAG, "%-10s %6lu %10lu %10lu %10lu %10lu", stageNames[stage],
+             (unsigned long) summary.count, (unsigned long) summary.p50_us,
+             (unsigned long) summary.p90_us, (unsigned long) summary.p99_us,
+             (unsigned long) summary.max_us);
+  }
+}
@@ -0,0 +1,93 @@
+/**
+  ******************************************************************************
+  * @authors        : Tomas Gonzalez & Brian Morris
+  * @file           : latency_stats.h
+  * @brief          : Header for the per-stage latency histograms of the uplink
+  *                   pipeline, from the UART bytes to the MQTT publish
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 Tomas Gonzalez & Brian Morris
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  */
+
+#ifndef LATENCY_STATS_H
+#define LATENCY_STATS_H
+
+/* Includes ------------------------------------------------------------ */
+#include <cstddef>
+#include <cstdint>
+
+/* Defines ------------------------------------------------------------- */
+#define LATENCY_STATS_TOPIC "livestock/cu/stats"
+#define LATENCY_STATS_INTERVAL_US 60000000  // Publish and reset window (1 minute)
+#define LATENCY_BUCKETS 24                  // Bucket i holds [2^i, 2^(i+1)) us, the last one is open
+#define LATENCY_STATS_MAX_LEN 512
+
+/* Structs ------------------------------------------------------------- */
+enum LatencyStage {
+  LATENCY_STAGE_UART_RX,     /**< Reading the bytes from the UART driver */
+  LATENCY_STAGE_PARSE,       /**< Parsing the +RCV line */
+  LATENCY_STAGE_POST,        /**< post_request */
+  LATENCY_STAGE_QUEUE,       /**< Waiting in the request queue until get_request */
+  LATENCY_STAGE_ACK,         /**< ACK queued until the radio answered OK */
+  LATENCY_STAGE_KEEPALIVE,   /**< Updating the LSU in the manager */
+  LATENCY_STAGE_NVS_SAVE,    /**< Persisting the manager */
+  LATENCY_STAGE_PUBLISH,     /**< Handing the payload to the MQTT client */
+  LATENCY_STAGE_END_TO_END,  /**< UART bytes to publish done */
+  LATENCY_STAGE_COUNT,
+};
+
+/**
+ * @brief Summary of one stage over a window, percentiles are bucket upper bounds
+ */
+struct LatencySummary {
+  uint32_t count;
+  uint32_t p50_us;
+  uint32_t p90_us;
+  uint32_t p99_us;
+  uint32_t max_us;
+};
+
+/* Public API ---------------------------------------------------------- */
+/**
+ * @brief Record a sample, lock-free and safe from any task
+ * @param stage Stage the sample belongs to
+ * @param elapsed_us Time spent in the stage
+ */
+void latency_record(LatencyStage stage, int64_t elapsed_us);
+
+/**
+ * @brief Record the time elapsed since start_us
+ * @param stage Stage the sample belongs to
+ * @param start_us Start of the stage, from hal_time_us()
+ * @return Current time, the start of the next stage
+ */
+int64_t latency_record_since(LatencyStage stage, int64_t start_us);
+
+/**
+ * @brief Summarize every stage and start a new window
+ * @param summaries Output, LATENCY_STAGE_COUNT entries
+ */
+void latency_collect(LatencySummary *summaries);
+
+/**
+ * @brief Serialize the summaries as "window_s;stage,count,p50,p90,p99,max;..."
+ * @param summaries LATENCY_STAGE_COUNT entries
+ * @param window_s Length of the window the summaries cover
+ * @param buff Output buffer
+ * @param size Size of the output buffer
+ */
+void latency_format(const LatencySummary *summaries, uint32_t window_s, char *buff, size_t size);
+
+/**
+ * @brief Print the summaries as a table on the console
+ * @param summaries LATENCY_STAGE_COUNT entries
+ */
+void latency_log(const LatencySummary *summaries);
+
+#endif /* LATENCY_STATS_H */
@@ -0,0 +1,224 @@
+/**
+  ******************************************************************************
+  * @authors        : Tomas Gonzalez & Brian Morris
+  * @file           : log_ring.c
+  * @brief          : Deferred binary log, hot paths store a format ID and raw
+  *                   arguments, a low priority task formats and prints them
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 Tomas Gonzalez & Brian Morris
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  */
+
+/* Includes ------------------------------------------------------------ */
+#include "log_ring.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include "esp_log.h"
+#include "hal/hal.h"
+#include "freertos/FreeRTOS.h"
+
+/* Private types --------------------------------------------------------- */
+typedef struct {
+  const char *name;
+  uint32_t rate_per_s;  // Sustained lines per second
+  uint32_t burst;       // Lines allowed back to back
+} log_tag_config_t;
+
+typedef struct {
+  log_tag_t tag;
+  esp_log_level_t level;
+  uint8_t nargs;
+  uint8_t signed_mask;  // Bit i set when argument i is printed with %ld
+  bool has_str;         // The string is always the last argument
+  const char *format;
+} log_format_t;
+
+typedef struct {
+  int64_t timestamp_us;
+  log_fmt_t format;
+  uint32_t args[LOG_RING_MAX_ARGS];
+  char str[LOG_RING_STR_LEN];
+} log_record_t;
+
+typedef struct {
+  uint32_t tokens_milli;
+  int64_t last_refill_us;
+  uint32_t suppressed;
+} log_tag_state_t;
+
+/* Private variables ----------------------------------------------------- */
+static const char *LOG_RING_TAG = "LOG_RING";
+
+static const log_tag_config_t tags[LOG_TAG_COUNT] = {
+  [LOG_TAG_RX]      = {"RX_CHANNEL_TASK", 20, 40},
+  [LOG_TAG_RYLR]    = {"RYLR", 5, 10},
+  [LOG_TAG_COMMS]   = {"CU_Communications", 20, 40},
+  [LOG_TAG_PROCESS] = {"PROCESS_REQUEST_TASK", 20, 40},
+};
+
+static const log_format_t formats[LOG_FMT_COUNT] = {
+  [LOG_FMT_RX_BYTES]        = {LOG_TAG_RX, ESP_LOG_INFO, 2, 0x0, true, "[port %lu] %lu bytes: %s"},
+  [LOG_FMT_RX_RCV]          = {LOG_TAG_RX, ESP_LOG_INFO, 4, 0xC, true, "[port %lu] RCV from %lu rssi %ld snr %ld: %s"},
+  [LOG_FMT_RYLR_WRONG_CMD]  = {LOG_TAG_RYLR, ESP_LOG_ERROR, 3, 0x0, true, "Wrong command at port %lu. Expected %lu, got %lu: %s"},
+  [LOG_FMT_COMMS_ACK]       = {LOG_TAG_COMMS, ESP_LOG_INFO, 2, 0x0, false, "Sending data ACK to %lu via port %lu"},
+  [LOG_FMT_PROCESS_REQUEST] = {LOG_TAG_PROCESS, ESP_LOG_INFO, 2, 0x0, false, "Processing request from ID: %lu, Type: %lu"},
+  [LOG_FMT_PROCESS_DATA]    = {LOG_TAG_PROCESS, ESP_LOG_INFO, 1, 0x0, true, "Received data from LSU %lu: %s"},
+};
+
+static log_record_t ring[LOG_RING_LENGTH];
+static uint32_t head = 0;  // Next record to write, producers
+static uint32_t tail = 0;  // Next record to print, drain task
+static uint32_t dropped = 0;
+static log_tag_state_t tag_states[LOG_TAG_COUNT];
+static bool tag_states_ready = false;
+
+// Held for a bounded copy only, never while formatting or printing
+static portMUX_TYPE ring_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/* Private functions ----------------------------------------------------- */
+// Token bucket, must hold ring_lock
+static bool take_token(log_tag_t tag, int64_t now_us) {
+  log_tag_state_t *state = &tag_states[tag];
+  uint32_t capacity_milli = tags[tag].burst * 1000;
+
+  int64_t elapsed_us = now_us - state->last_refill_us;
+  state->last_refill_us = now_us;
+  int64_t refill_milli = elapsed_us * tags[tag].rate_per_s / 1000;
+  int64_t tokens_milli = state->tokens_milli + refill_milli;
+  state->tokens_milli = tokens_milli > capacity_milli ? capacity_milli : (uint32_t) tokens_milli;
+
+  if (state->tokens_milli < 1000) {
+    state->suppressed++;
+    return false;
+  }
+  state->tokens_milli -= 1000;
+  return true;
+}
+
+static void format_record(const log_record_t *record, char *buff, size_t size) {
+  const log_format_t *entry = &formats[record->format];
+  const char *s = record->str;
+
+  // Widen to the printf argument type, sign extending the %ld ones
+  unsigned long a[LOG_RING_MAX_ARGS];
+  for (int i = 0; i < LOG_RING_MAX_ARGS; i++) {
+    bool is_signed = entry->signed_mask & (1u << i);
+    a[i] = is_signed ? (unsigned long) (long) (int32_t) record->args[i] : (unsigned long) record->args[i];
+  }
+
+  // Arguments are passed with their exact count so the string lands on its %s
+  switch (entry->nargs * 2 + entry->has_str) {
+    case 0: snprintf(buff, size, "%s", entry->format); break;
+    case 1: snprintf(buff, size, entry->format, s); break;
+    case 2: snprintf(buff, size, entry->format, a[0]); break;
+    case 3: snprintf(buff, size, entry->format, a[0], s); break;
+    case 4: snprintf(buff, size, entry->format, a[0], a[1]); break;
+    case 5: snprintf(buff, size, entry->format, a[0], a[1], s); break;
+    case 6: snprintf(buff, size, entry->format, a[0], a[1], a[2]); break;
+    case 7: snprintf(buff, size, entry->format, a[0], a[1], a[2], s); break;
+    case 8: snprintf(buff, size, entry->format, a[0], a[1], a[2], a[3]); break;
+    default: snprintf(buff, size, entry->format, a[0], a[1], a[2], a[3], s); break;
+  }
+}
+
+static char level_letter(esp_log_level_t level) {
+  switch (level) {
+    case ESP_LOG_ERROR: return 'E';
+    case ESP_LOG_WARN: return 'W';
+    case ESP_LOG_DEBUG: return 'D';
+    case ESP_LOG_VERBOSE: return 'V';
+    default: return 'I';
+  }
+}
+
+/* Public functions ----------------------------------------------------- */
+void log_ring_write(log_fmt_t format, const char *str, uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3) {
+  int64_t now_us = hal_time_us();
+  const log_format_t *entry = &formats[format];
+
+  taskENTER_CRITICAL(&ring_lock);
+  if (!tag_states_ready) {
+    for (int tag = 0; tag < LOG_TAG_COUNT; tag++) {
+      tag_states[tag].tokens_milli = tags[tag].burst * 1000;
+      tag_states[tag].last_refill_us = now_us;
+    }
+    tag_states_ready = true;
+  }
+
+  if (!take_token(entry->tag, now_us)) {
+    taskEXIT_CRITICAL(&ring_lock);
+    return;
+  }
+  if (head - tail == LOG_RING_LENGTH) {
+    dropped++;
+    taskEXIT_CRITICAL(&ring_lock);
+    return;
+  }
+
+  log_record_t *record = &ring[head % LOG_RING_LENGTH];
+  record->timestamp_us = now_us;
+  record->format = format;
+  record->args[0] = a0;
+  record->args[1] = a1;
+  record->args[2] = a2;
+  record->args[3] = a3;
+  record->str[0] = '\0';
+  if (str != NULL) {
+    strncpy(record->str, str, LOG_RING_STR_LEN - 1);
+    record->str[LOG_RING_STR_LEN - 1] = '\0';
+  }
+  head++;
+  taskEXIT_CRITICAL(&ring_lock);
+}
+
+size_t log_ring_drain(size_t max_records) {
+  static uint32_t reported_dropped = 0;
+  static uint32_t reported_suppressed[LOG_TAG_COUNT];
+  char line[160];
+  size_t printed = 0;
+
+  while (printed < max_records) {
+    log_record_t record;
+    taskENTER_CRITICAL(&ring_lock);
+    bool empty = head == tail;
+    if (!empty) {
+      record = ring[tail % LOG_RING_LENGTH];
+      tail++;
+    }
+    taskEXIT_CRITICAL(&ring_lock);
+    if (empty) {
+      break;
+    }
+
+    const log_format_t *entry = &formats[record.format];
+    const char *tag = tags[entry->tag].name;
+    format_record(&record, line, sizeof(line));
+    esp_log_write(entry->level, tag, "%c (%lld) %s: %s\n", level_letter(entry->level),
+                  (long long) (record.timestamp_us / 1000), tag, line);
+    printed++;
+  }
+
+  // Report losses once per change, outside of the hot paths
+  uint32_t total_dropped = dropped;
+  if (total_dropped != reported_dropped) {
+    ESP_LOGW(LOG_RING_TAG, "%lu records dropped, ring full", (unsigned long) (total_dropped - reported_dropped));
+    reported_dropped = total_dropped;
+  }
+  for (int tag = 0; tag < LOG_TAG_COUNT; tag++) {
+    uint32_t suppressed = tag_states[tag].suppressed;
+    if (suppressed != reported_suppressed[tag]) {
+      ESP_LOGW(LOG_RING_TAG, "%s: %lu lines over the rate limit", tags[tag].name,
+               (unsigned long) (suppressed - reported_suppressed[tag]));
+      reported_suppressed[tag] = suppressed;
+    }
+  }
+  return printed;
+}
@@ -0,0 +1,80 @@
+/**
+  ******************************************************************************
+  * @authors        : Tomas Gonzalez & Brian Morris
+  * @file           : log_ring.h
+  * @brief          : Deferred binary log, hot paths store a format ID and raw
+  *                   arguments, a low priority task formats and prints them
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 Tomas Gonzalez & Brian Morris
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef LOG_RING_H
+#define LOG_RING_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------ */
+#include <stddef.h>
+#include <stdint.h>
+
+/* Defines ------------------------------------------------------------------- */
+#define LOG_RING_LENGTH    64  // Records, a power of two
+#define LOG_RING_MAX_ARGS  4
+#define LOG_RING_STR_LEN   48  // Longer strings are truncated when recorded
+
+/* Types --------------------------------------------------------------------- */
+typedef enum {
+  LOG_TAG_RX,
+  LOG_TAG_RYLR,
+  LOG_TAG_COMMS,
+  LOG_TAG_PROCESS,
+  LOG_TAG_COUNT,
+} log_tag_t;
+
+/**
+ * @brief Deferred log lines, the format strings live in log_ring.c
+ */
+typedef enum {
+  LOG_FMT_RX_BYTES,         /**< port, bytes + raw buffer */
+  LOG_FMT_RX_RCV,           /**< port, from_id, rssi, snr + payload */
+  LOG_FMT_RYLR_WRONG_CMD,   /**< port, expected, received + raw buffer */
+  LOG_FMT_COMMS_ACK,        /**< destination, port */
+  LOG_FMT_PROCESS_REQUEST,  /**< from_id, type */
+  LOG_FMT_PROCESS_DATA,     /**< lsu_id + payload */
+  LOG_FMT_COUNT,
+} log_fmt_t;
+
+/* Public functions ---------------------------------------------------------- */
+/**
+ * @brief Record a log line in constant time, safe from any task
+ * @details Dropped when the tag is over its rate limit or the ring is full,
+ *          both are counted and reported by the drain
+ * @param format: Line to record
+ * @param str: String argument, NULL if the line has none
+ * @param a0-a3: Integer arguments, unused ones are ignored
+ * @return None
+ */
+void log_ring_write(log_fmt_t format, const char *str, uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3);
+
+/**
+ * @brief Format and print pending records, call from a low priority task only
+ * @param max_records: Upper bound of records printed by this call
+ * @return Number of records printed
+ */
+size_t log_ring_drain(size_t max_records);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LOG_RING_H */
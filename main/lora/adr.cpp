@@ -0,0 +1,112 @@
+/**
+  ******************************************************************************
+  * @authors        : Tomas Gonzalez & Brian Morris
+  * @file           : adr.cpp
+  * @brief          : Adaptive data rate, link quality per LSU and the spreading
+  *                   factor and TX power it recommends
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 Tomas Gonzalez & Brian Morris
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  */
+
+/* Includes ------------------------------------------------------------ */
+#include "adr.h"
+
+/* Defines ------------------------------------------------------------- */
+#define Q4(db)          ((int32_t) (db) * 16)
+#define SF_STEP_Q4      40    // Each SF step moves the floor by 2.5 dB
+#define SF7_FLOOR_Q4    -120  // -7.5 dB, SX1262 demodulation floor at SF7
+
+/* Private functions --------------------------------------------------------- */
+static int32_t floor_q4(uint8_t sf) {
+  return SF7_FLOOR_Q4 - SF_STEP_Q4 * ((int32_t) sf - 7);
+}
+
+/* Public API ---------------------------------------------------------- */
+void adr_link_init(AdrLink& link) {
+  link = {};
+  link.setting = {0, ADR_MAX_POWER_DBM};
+}
+
+void adr_link_restore(AdrLink& link) {
+  adr_link_init(link);
+  link.resync = true;
+}
+
+void adr_link_sample(AdrLink& link, int16_t rssi, int8_t snr) {
+  if (link.samples == 0) {
+    link.rssi_q4 = (int16_t) Q4(rssi);
+    link.snr_q4 = (int16_t) Q4(snr);
+  } else {
+    link.rssi_q4 = (int16_t) (link.rssi_q4 + ((Q4(rssi) - link.rssi_q4) >> ADR_EWMA_SHIFT));
+    link.snr_q4 = (int16_t) (link.snr_q4 + ((Q4(snr) - link.snr_q4) >> ADR_EWMA_SHIFT));
+  }
+  if (link.samples < UINT8_MAX) {
+    link.samples++;
+  }
+}
+
+AdrSetting adr_recommend(int32_t snr_q4, AdrSetting current, uint8_t min_sf, uint8_t max_sf) {
+  AdrSetting next = current;
+  int32_t margin_q4 = snr_q4 - floor_q4(next.sf) - Q4(ADR_MARGIN_DB);
+
+  // Into the range the radio decodes, a slower SF gains margin
+  while (next.sf < min_sf) {
+    next.sf++;
+    margin_q4 += SF_STEP_Q4;
+  }
+  while (next.sf > max_sf) {
+    next.sf--;
+    margin_q4 -= SF_STEP_Q4;
+  }
+
+  // Spend the margin on airtime first, then on power
+  while (margin_q4 >= SF_STEP_Q4 && next.sf > min_sf) {
+    next.sf--;
+    margin_q4 -= SF_STEP_Q4;
+  }
+  while (margin_q4 >= Q4(ADR_POWER_STEP_DB) && next.txPower_dbm >= ADR_MIN_POWER_DBM + ADR_POWER_STEP_DB) {
+    next.txPower_dbm -= ADR_POWER_STEP_DB;
+    margin_q4 -= Q4(ADR_POWER_STEP_DB);
+  }
+
+  // A weak link gets the power back before it slows down
+  while (margin_q4 < 0 && next.txPower_dbm + ADR_POWER_STEP_DB <= ADR_MAX_POWER_DBM) {
+    next.txPower_dbm += ADR_POWER_STEP_DB;
+    margin_q4 += Q4(ADR_POWER_STEP_DB);
+  }
+  while (margin_q4 < 0 && next.sf < max_sf) {
+    next.sf++;
+    margin_q4 += SF_STEP_Q4;
+  }
+  return next;
+}
+
+bool adr_link_due(const AdrLink& link, uint8_t radio_sf, AdrSetting *next) {
+  if (link.resync) {
+    *next = {radio_sf, ADR_MAX_POWER_DBM};
+    return true;
+  }
+  if (link.samples < ADR_MIN_SAMPLES) {
+    return false;
+  }
+  AdrSetting current = link.setting;
+  if (current.sf == 0) {
+    current.sf = radio_sf;
+  }
+  // A radio decodes one spreading factor, the LSU has to stay on it
+  *next = adr_recommend(link.snr_q4, current, radio_sf, radio_sf);
+  return next->sf != current.sf || next->txPower_dbm != current.txPower_dbm;
+}
+
+void adr_link_apply(AdrLink& link, AdrSetting setting) {
+  link.setting = setting;
+  link.samples = 0;
+  link.resync = false;
+}
@@ -0,0 +1,104 @@
+/**
+  ******************************************************************************
+  * @authors        : Tomas Gonzalez & Brian Morris
+  * @file           : adr.h
+  * @brief          : Adaptive data rate, link quality per LSU and the spreading
+  *                   factor and TX power it recommends
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 Tomas Gonzalez & Brian Morris
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  */
+
+#ifndef ADR_H
+#define ADR_H
+
+/* Includes ------------------------------------------------------------ */
+#include <cstdint>
+
+/**
+ * Every uplink feeds its RSSI and SNR into a moving average per LSU. Once
+ * enough uplinks were averaged at the settings the LSU runs, the margin above
+ * the demodulation floor of its spreading factor is spent, first on a faster
+ * spreading factor, then on lower TX power. A link below the margin gets the
+ * power back first. The CU pushes a changed setting in a CONFIG and the
+ * average starts over, the old samples were measured at the old settings.
+ */
+
+/* Defines ------------------------------------------------------------- */
+#define ADR_EWMA_SHIFT      3   // Weight of a new sample is 1/8
+#define ADR_MIN_SAMPLES     4   // Uplinks averaged before a change is pushed
+#define ADR_MARGIN_DB       10  // Kept above the demodulation floor for fading
+#define ADR_MAX_POWER_DBM   22  // AT+CRFOP range of the RYLR998
+#define ADR_MIN_POWER_DBM   2
+#define ADR_POWER_STEP_DB   2
+
+/* Structs ------------------------------------------------------------- */
+/**
+ * @brief Spreading factor and TX power of an LSU
+ */
+struct AdrSetting {
+  uint8_t sf;           /**< 0 until the first push, the LSU runs its join settings */
+  uint8_t txPower_dbm;
+};
+
+/**
+ * @brief Link quality of an LSU, averaged at its current settings
+ */
+struct AdrLink {
+  int16_t rssi_q4;      /**< EWMA in 1/16 dBm */
+  int16_t snr_q4;       /**< EWMA in 1/16 dB */
+  uint8_t samples;      /**< Since the last change, saturates at 255 */
+  AdrSetting setting;   /**< Last pushed to the LSU */
+  bool resync;          /**< Setting unknown, the next uplink brings the LSU back to full power */
+};
+
+/* Public API ---------------------------------------------------------- */
+/**
+ * @brief Start a link at the join settings, full power on the radio's SF
+ */
+void adr_link_init(AdrLink& link);
+
+/**
+ * @brief Start a link restored after a reboot
+ * @details The pushed settings are not saved with the fleet, the LSU may run
+ *          any power it was told before. Its first uplink is answered with a
+ *          CONFIG back at the join settings, the ADR starts over from there.
+ */
+void adr_link_restore(AdrLink& link);
+
+/**
+ * @brief Average in the RSSI and SNR of an uplink
+ */
+void adr_link_sample(AdrLink& link, int16_t rssi, int8_t snr);
+
+/**
+ * @brief Settings for a link SNR, starting from the ones it was measured at
+ * @param snr_q4 Link SNR in 1/16 dB
+ * @param current Settings the SNR was measured at
+ * @param min_sf Fastest SF the uplink radio decodes
+ * @param max_sf Slowest SF the uplink radio decodes
+ * @return The fastest SF and lowest power that keep ADR_MARGIN_DB
+ */
+AdrSetting adr_recommend(int32_t snr_q4, AdrSetting current, uint8_t min_sf, uint8_t max_sf);
+
+/**
+ * @brief Whether the link has enough samples and its recommendation changed, or needs a resync
+ * @param link Link of the LSU
+ * @param radio_sf SF of the radio its uplinks arrive on
+ * @param next Output, settings to push
+ * @return true if next should be pushed in a CONFIG
+ */
+bool adr_link_due(const AdrLink& link, uint8_t radio_sf, AdrSetting *next);
+
+/**
+ * @brief Record the settings pushed to the LSU, the average starts over
+ */
+void adr_link_apply(AdrLink& link, AdrSetting setting);
+
+#endif /* ADR_H */
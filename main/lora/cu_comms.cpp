@@ -17,64 +17,272 @@
 /* Includes ------------------------------------------------------------ */
 #include "cu_comms.h"
 
-#include <string>
+#include <stdio.h>
 #include <string.h>
 #include "rylr998.h"
+#include "tx_scheduler.h"
+#include "radio_health.h"
+#include "radio_roles.h"
+#include "latency_stats.h"
+#include "log_ring.h"
 #include "esp_log.h"
+#include "hal/hal.h"
 
 #define TX_BUFF_SIZE 128
+#define RESPONSE_TIMEOUT_MS 2000 // AT+SEND answers once the frame is out, about 0.3 s for a CONFIG at SF9
+// Deadlines for the TX scheduler, a frame held longer than this is no use to the LSU
+#define ACK_MAX_DELAY_MS 2000     // The LSU listens for the ACK after its DATA
+#define CONFIG_MAX_DELAY_MS 3000  // Before the LSU sends SYNC again
+#define TEST_MAX_DELAY_MS 10000
 
 /* Private variables ----------------------------------------------------- */
 static const char *CU_COMMS_TAG = "CU_Communications"; 
 
-static char tx_buff[TX_BUFF_SIZE];
-std::string config_payload;
+// One buffer, lock and response event per radio. The lock is held from SEND
+// to OK, conversations waiting for it cost their coroutine frame only.
+static char tx_buff[2][TX_BUFF_SIZE];
+static CoMutex radio_lock[2];
+static CoEvent radio_response[2];
+// Last answer of each module, written by its RX task, read once the event is set
+static RYLR_response_t radio_answer[2];
+static portMUX_TYPE answer_lock = portMUX_INITIALIZER_UNLOCKED;
+// A join window CU_listenJoins() holds open, it keeps the radio lock for the
+// join CONFIGs. The window lock lets one out at a time and closes after them.
+static bool join_window_open[2];
+static CoMutex join_window_lock[2];
 
 /* Private functions ----------------------------------------------------- */
-void create_config_payload(LSU_config_package_t *config_package) {
-  config_payload = "CONFIG";
-  config_payload += "-" + std::to_string(config_package->lsu_id);
-  config_payload += "-" + std::to_string(config_package->period_ms);
-  config_payload += "-" + std::to_string(config_package->now_ms);
-  config_payload += "-" + std::to_string(config_package->time_slot_ms);
+// Waits for the next free gap, false if the frame must be dropped. Caller holds the lock
+static CoTask<bool> wait_for_air(UartPort_t port, size_t payload_length, uint32_t max_delay_ms) {
+  uint32_t delay_ms;
+  if (!tx_scheduler_reserve(port, payload_length, max_delay_ms, &delay_ms)) {
+    ESP_LOGW(CU_COMMS_TAG, "Radio %d out of duty-cycle budget, frame dropped", port);
+    co_return false;
+  }
+  if (delay_ms > 0) {
+    co_await co_sleep_ms(delay_ms);
+  }
+  co_return true;
+}
+
+// Sends tx_buff[port] and waits for the module's answer, caller holds the lock
+static CoTask<bool> send_and_wait(UartPort_t port, RYLR_RX_command_t expected, RYLR_response_t *answer) {
+  radio_response[port].reset();
+  rylr998_sendCommand(tx_buff[port], port);
+  bool answered = co_await radio_response[port].wait(RESPONSE_TIMEOUT_MS);
+  if (!answered) {
+    ESP_LOGW(CU_COMMS_TAG, "No response from radio %d", port);
+    radio_health_record(port, RADIO_EVENT_TIMEOUT);
+    co_return false;
+  }
+  taskENTER_CRITICAL(&answer_lock);
+  *answer = radio_answer[port];
+  taskEXIT_CRITICAL(&answer_lock);
+  if (answer->command != expected) {
+    log_ring_write(LOG_FMT_RYLR_WRONG_CMD, answer->line, port, expected, answer->command, 0);
+  }
+  radio_health_record(port, answer->command == RYLR_ERR ? RADIO_EVENT_ERROR : RADIO_EVENT_OK);
+  co_return answer->command == expected;
+}
+
+static CoTask<bool> send_and_wait_ok(UartPort_t port) {
+  RYLR_response_t answer;
+  bool ok = co_await send_and_wait(port, RYLR_OK, &answer);
+  co_return ok;
+}
+
+// Sends a config package as soon as the air allows, caller holds the lock
+static CoTask<bool> send_config(LSU_config_package_t config_package, uint32_t destination, UartPort_t port) {
+  char config_payload[TX_BUFF_SIZE];
+  int length = create_config_payload(config_payload, sizeof(config_payload), &config_package);
+  if (length < 0 || length >= TX_BUFF_SIZE - 16) {
+    ESP_LOGE(CU_COMMS_TAG, "Config message too long");
+    co_return false;
+  }
+
+  bool clear = co_await wait_for_air(port, length, CONFIG_MAX_DELAY_MS);
+  if (!clear) {
+    co_return false;
+  }
+  // The LSU takes the time when the frame ends, stamp it after the wait and ahead by the time on air
+  int64_t arrival_us = hal_time_us() + rylr998_airtime_us(rylr998_getConfig(port), length);
+  config_package.now_ms = (uint32_t) ((arrival_us / 1000) % config_package.period_ms);
+  length = create_config_payload(config_payload, sizeof(config_payload), &config_package);
+  snprintf(tx_buff[port], TX_BUFF_SIZE, AT "SEND=%lu,%d,%s" END, destination, length, config_payload);
+  ESP_LOGI(CU_COMMS_TAG, "Sending config package: %s", tx_buff[port]);
+  bool delivered = co_await send_and_wait_ok(port);
+  co_return delivered;
+}
+
+// Retunes the module for a while, not saved to its flash. Caller holds the lock
+static CoTask<bool> tune(UartPort_t port, uint32_t band_hz) {
+  snprintf(tx_buff[port], TX_BUFF_SIZE, AT "BAND=%lu" END, band_hz);
+  bool tuned = co_await send_and_wait_ok(port);
+  co_return tuned;
+}
+
+static CoTask<> test_conversation(UartPort_t port) {
+  co_await radio_lock[port].lock();
+  snprintf(tx_buff[port], TX_BUFF_SIZE, AT "SEND=1,4,TEST" END);
+  bool clear = co_await wait_for_air(port, 4, TEST_MAX_DELAY_MS);
+  if (clear) {
+    co_await send_and_wait_ok(port);
+  }
+  radio_lock[port].unlock();
+}
+
+static CoTask<> data_ack_conversation(uint32_t destination, UartPort_t port, int64_t queued_us) {
+  co_await radio_lock[port].lock();
+  snprintf(tx_buff[port], TX_BUFF_SIZE, AT "SEND=%lu,3,ACK" END, destination);
+  log_ring_write(LOG_FMT_COMMS_ACK, NULL, destination, port, 0, 0);
+  bool clear = co_await wait_for_air(port, 3, ACK_MAX_DELAY_MS);
+  if (clear) {
+    co_await send_and_wait_ok(port);
+  }
+  radio_lock[port].unlock();
+  latency_record_since(LATENCY_STAGE_ACK, queued_us);
+}
+
+static CoTask<> probe_conversation(UartPort_t port) {
+  co_await radio_lock[port].lock();
+  snprintf(tx_buff[port], TX_BUFF_SIZE, "AT" END);
+  co_await send_and_wait_ok(port);
+  radio_lock[port].unlock();
 }
 
 /* Public functions ----------------------------------------------------- */
+void CU_onResponse(UartPort_t port, const RYLR_response_t *response) {
+  taskENTER_CRITICAL(&answer_lock);
+  radio_answer[port] = *response;
+  taskEXIT_CRITICAL(&answer_lock);
+  radio_response[port].set();
+}
+
 static uint8_t test_count = 0;
 void CU_sendTest() {
-  memset(tx_buff, 0, TX_BUFF_SIZE);
-  snprintf(tx_buff, TX_BUFF_SIZE, AT "SEND=1,4,TEST" END);
-
   UartPort_t port = test_count % 2 == 0 ? UART_PORT_MAIN : UART_PORT_AUX;
-  rylr998_sendCommand(tx_buff, port);
-  vTaskDelay(pdMS_TO_TICKS(500));
-  rylr998_getCommand(RYLR_OK, port);
+  coro_spawn(test_conversation(port));
   test_count++;
 }
 
-void CU_sendConfigPackage(LSU_config_package_t *config_package, uint32_t destination) {
-  create_config_payload(config_package);
-  if (config_payload.length() >= TX_BUFF_SIZE) {
-    ESP_LOGE(CU_COMMS_TAG, "Config message too long");
-    return;
+int create_config_payload(char *buffer, size_t size, const LSU_config_package_t *config_package) {
+  return snprintf(buffer, size, "CONFIG-%lu-%lu-%lu-%lu-%u-%u-%lu", config_package->lsu_id, config_package->period_ms,
+                  config_package->now_ms, config_package->time_slot_ms, config_package->sf,
+                  config_package->tx_power_dbm, config_package->band_hz);
+}
+
+CoTask<bool> CU_sendConfigPackage(LSU_config_package_t config_package, uint32_t destination, UartPort_t port) {
+  co_await radio_lock[port].lock();
+  bool delivered = co_await send_config(config_package, destination, port);
+  radio_lock[port].unlock();
+  co_return delivered;
+}
+
+CoTask<size_t> CU_sendConfigBatch(const LSU_config_package_t *config_packages, size_t count, UartPort_t port,
+                                  uint32_t band_hz) {
+  co_await radio_lock[port].lock();
+  size_t delivered = 0;
+  bool tuned = co_await tune(port, band_hz);
+  if (tuned) {
+    for (size_t i = 0; i < count; i++) {
+      bool sent = co_await send_config(config_packages[i], config_packages[i].lsu_id, port);
+      delivered += sent ? 1 : 0;
+    }
+  }
+  // Back on its own channel even if the first retune failed half way
+  bool back = co_await tune(port, radio_band_hz(port));
+  if (!back) {
+    ESP_LOGE(CU_COMMS_TAG, "Radio %d did not return to its channel", port);
   }
+  radio_lock[port].unlock();
+  co_return delivered;
+}
+
+CoTask<bool> CU_listenJoins(UartPort_t port, uint32_t band_hz, int64_t until_us) {
+  co_await radio_lock[port].lock();
+  // The conversations queued ahead may have used the gap up
+  if (hal_time_us() >= until_us) {
+    radio_lock[port].unlock();
+    co_return false;
+  }
+  bool tuned = co_await tune(port, band_hz);
+  if (tuned) {
+    join_window_open[port] = true;
+    int64_t left_us = until_us - hal_time_us();
+    if (left_us > 0) {
+      co_await co_sleep_ms((uint32_t) (left_us / 1000));
+    }
+    co_await join_window_lock[port].lock();
+    join_window_open[port] = false;
+    join_window_lock[port].unlock();
+  }
+  // Back on its own channel even if the first retune failed half way
+  bool back = co_await tune(port, radio_band_hz(port));
+  if (!back) {
+    ESP_LOGE(CU_COMMS_TAG, "Radio %d did not return to its channel", port);
+  }
+  radio_lock[port].unlock();
+  co_return tuned;
+}
+
+CoTask<bool> CU_sendJoinConfig(LSU_config_package_t config_package, uint32_t destination) {
+  if (radio_health_alive(RADIO_JOIN_PORT)) {
+    bool delivered = co_await CU_sendConfigPackage(config_package, destination, RADIO_JOIN_PORT);
+    co_return delivered;
+  }
+
+  // The SYNC came in through a window of the other radio, answer before it closes
+  UartPort_t port = radio_other_port(RADIO_JOIN_PORT);
+  co_await join_window_lock[port].lock();
+  bool delivered = false;
+  if (join_window_open[port]) {
+    delivered = co_await send_config(config_package, destination, port);
+  }
+  join_window_lock[port].unlock();
+  co_return delivered;
+}
+
+CoTask<bool> CU_configureRadio(UartPort_t port, const RYLR_config_t *config, size_t *written) {
+  co_await radio_lock[port].lock();
+  *written = 0;
+  // A module still starting misses the first AT, one that never answers has
+  // enough timeouts for the radio health to fail it
+  bool configured = false;
+  for (int attempt = 0; attempt < RADIO_HEALTH_MAX_TIMEOUTS && !configured; attempt++) {
+    snprintf(tx_buff[port], TX_BUFF_SIZE, "AT" END);
+    configured = co_await send_and_wait_ok(port);
+  }
+
+  // The module keeps its settings over a reset, only the ones that differ are sent
+  for (int i = 0; i < RYLR_SET_COUNT && configured; i++) {
+    RYLR_setting_t setting = (RYLR_setting_t) i;
+    rylr998_formatQuery(setting, tx_buff[port], TX_BUFF_SIZE);
+    RYLR_response_t answer;
+    bool known = co_await send_and_wait(port, RYLR_SETTING, &answer);
+    if (known && rylr998_settingMatches(setting, &answer.setting, config)) {
+      continue;
+    }
+    rylr998_formatSetting(setting, config, tx_buff[port], TX_BUFF_SIZE);
+    ESP_LOGI(CU_COMMS_TAG, "Radio %d: %s", port, tx_buff[port]);
+    configured = co_await send_and_wait_ok(port);
+    *written += configured ? 1 : 0;
+  }
+
+  if (configured) {
+    rylr998_setConfig(config, port);
+    ESP_LOGI(CU_COMMS_TAG, "Radio %d configured, %u settings written, %u already set", port, (unsigned) *written,
+             (unsigned) (RYLR_SET_COUNT - *written));
+  } else {
+    ESP_LOGE(CU_COMMS_TAG, "Radio %d not configured", port);
+  }
+  radio_lock[port].unlock();
+  co_return configured;
+}
 
-  memset(tx_buff, 0, TX_BUFF_SIZE);
-  snprintf(tx_buff, TX_BUFF_SIZE, AT"SEND=%lu,%u,%s"END, destination, config_payload.length(), config_payload.c_str());
-  
-  ESP_LOGI(CU_COMMS_TAG, "Sending config package: %s", tx_buff);
-  rylr998_sendCommand(tx_buff, UART_PORT_AUX);
-  vTaskDelay(pdMS_TO_TICKS(500));
-  rylr998_getCommand(RYLR_OK, UART_PORT_AUX);
+void CU_probeRadio(UartPort_t port) {
+  coro_spawn(probe_conversation(port));
 }
 
 void CU_sendDataAck(uint32_t destination, UartPort_t sourcePort) {
-  memset(tx_buff, 0, TX_BUFF_SIZE);
-  snprintf(tx_buff, TX_BUFF_SIZE, AT"SEND=%lu,3,ACK"END, destination);
-
-  ESP_LOGI(CU_COMMS_TAG, "Sending data ACK via %s channel: %s", 
-          sourcePort == UART_PORT_MAIN ? "MAIN" : "AUX", tx_buff);
-  rylr998_sendCommand(tx_buff, sourcePort);
-  vTaskDelay(pdMS_TO_TICKS(500));
-  rylr998_getCommand(RYLR_OK, sourcePort);
+  coro_spawn(data_ack_conversation(destination, sourcePort, hal_time_us()));
 }
@@ -24,6 +24,8 @@
 #include <stdint.h>
 
 #include "uart.h"
+#include "rylr998.h"
+#include "coroutine.h"
 
 /* Structs ------------------------------------------------------------ */
 
@@ -33,27 +35,101 @@
 typedef struct {
   uint32_t lsu_id;        /**< The ID assigned to the LSU */
   uint32_t period_ms;     /**< The period of time (in ms) in which the LSU will send data */
-  uint32_t now_ms;        /**< The current time (in ms) inside the period */
+  uint32_t now_ms;        /**< The current time (in ms) inside the period, restamped when the frame goes out */
   uint32_t time_slot_ms;  /**< The time slot (in ms) assigned to the LSU for transmission within the period */
+  uint8_t sf;             /**< Spreading factor for the uplinks */
+  uint8_t tx_power_dbm;   /**< TX power for the uplinks */
+  uint32_t band_hz;       /**< Channel for the uplinks, see radio_roles.h */
 } LSU_config_package_t;
 
 
 /* Public functions ----------------------------------------------------- */
 
 /**
- * @brief Test sending a message to check the module is working
+ * @brief Wake the conversation waiting for the module's answer, RX tasks only
+ * @param port: The radio that answered
+ * @param response: The answer as parsed by the RX task, copied
+ */
+void CU_onResponse(UartPort_t port, const RYLR_response_t *response);
+
+/**
+ * @brief Test sending a message to check the module is working, returns once queued
  */
 void CU_sendTest();
 
 /**
- * @brief Send a config package to the LSU
+ * @brief Format the payload of a config package, "CONFIG-<id>-<period>-<now>-<slot>-<sf>-<power>-<band>"
+ * @param buffer: Destination buffer
+ * @param size: Size of the buffer
+ * @param config_package: The configuration package to format
+ * @return Length of the payload, negative or >= size if it did not fit
+ */
+int create_config_payload(char *buffer, size_t size, const LSU_config_package_t *config_package);
+
+/**
+ * @brief Send a config package to the LSU, awaitable from the coroutine executor
  * @param config_package: The configuration package to send
  * @param destination: The destination address of the LSU
+ * @param port: Radio the LSU listens on
+ * @return true once the module accepted the message
+ */
+CoTask<bool> CU_sendConfigPackage(LSU_config_package_t config_package, uint32_t destination, UartPort_t port);
+
+/**
+ * @brief Send config packages to LSUs listening on another channel, awaitable from the coroutine executor
+ * @details The radio leaves its own channel for the whole batch, keep it short
+ * @param config_packages: Packages to send, each to the LSU it names
+ * @param count: Number of packages
+ * @param port: Radio that sends them
+ * @param band_hz: Channel the LSUs listen on
+ * @return Number of packages the module accepted
+ */
+CoTask<size_t> CU_sendConfigBatch(const LSU_config_package_t *config_packages, size_t count, UartPort_t port,
+                                  uint32_t band_hz);
+
+/**
+ * @brief Listen for SYNCs on another channel until a deadline, awaitable from the coroutine executor
+ * @details Stands in for a failed join radio between the uplinks of its own
+ *          channel. The radio keeps its lock for the whole window, only the
+ *          join CONFIGs sent with CU_sendJoinConfig() go out meanwhile.
+ * @param port: Radio that listens
+ * @param band_hz: Channel the joining LSUs send their SYNC on
+ * @param until_us: Back on its own channel from then on
+ * @return false if the window was used up before it opened or the radio did not retune
+ */
+CoTask<bool> CU_listenJoins(UartPort_t port, uint32_t band_hz, int64_t until_us);
+
+/**
+ * @brief Answer a SYNC with its config package, awaitable from the coroutine executor
+ * @details Goes out on the join radio, or through the window CU_listenJoins()
+ *          holds open on the other radio once the join radio failed
+ * @param config_package: The configuration package to send
+ * @param destination: Temporary address the SYNC came from
+ * @return true once the module accepted the message, false if no window was open
+ */
+CoTask<bool> CU_sendJoinConfig(LSU_config_package_t config_package, uint32_t destination);
+
+/**
+ * @brief Bring a module to the given settings, awaitable from the coroutine executor
+ * @details Queries every setting and writes only the ones that differ, so a
+ *          module already configured costs one query each and no flash write
+ * @param port: Radio to configure
+ * @param config: Settings it must hold
+ * @param written: Output, number of settings written
+ * @return true once the module holds every setting, false if it stopped answering or refused one
+ */
+CoTask<bool> CU_configureRadio(UartPort_t port, const RYLR_config_t *config, size_t *written);
+
+/**
+ * @brief Send the module a bare AT to see if it answers, returns once queued
+ * @details The answer reaches the radio health like any other
+ * @param port: Radio to probe
  */
-void CU_sendConfigPackage(LSU_config_package_t *config_package, uint32_t destination);
+void CU_probeRadio(UartPort_t port);
 
 /**
- * @brief Send a data acknowledgement to the LSU
+ * @brief Send a data acknowledgement to the LSU, returns once queued
+ * @details Acknowledgements on the same radio go out in order
  * @param destination: The destination address of the LSU
  * @param sourcePort: The port to send the response on (same as received)
  */
@@ -0,0 +1,173 @@
+/**
+  ******************************************************************************
+  * @authors        : Tomas Gonzalez & Brian Morris
+  * @file           : radio_health.cpp
+  * @brief          : Notices a dead radio module from its command answers and
+  *                   from the uplinks it stops hearing
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 Tomas Gonzalez & Brian Morris
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  */
+
+/* Includes ------------------------------------------------------------ */
+#include "radio_health.h"
+
+#include <algorithm>
+#include <atomic>
+#include "radio_roles.h"
+#include "tx_scheduler.h"
+#include "esp_log.h"
+#include "hal/hal.h"
+#include "freertos/FreeRTOS.h"
+
+/* Private types --------------------------------------------------------- */
+struct Health {
+  uint32_t timeouts;       // In a row, reset by any answer
+  uint32_t errors;         // In the current window
+  int64_t windowStart_us;
+  int64_t lastRx_us;       // 0 until the first uplink
+  int64_t since_us;        // Silence is counted from here, first check or last uplink
+  int64_t lastAnswer_us;   // Last +OK or +ERR
+  int64_t lastProbe_us;
+  uint32_t goodAnswers;    // +OK in a row, bring a failed radio back
+  uint32_t failures;       // Since boot, spaces out the recovery probes
+  const char *reason;
+};
+
+/* Private variables --------------------------------------------------------- */
+static const char *RADIO_HEALTH_TAG = "Radio Health";
+
+static Health health[RADIO_COUNT];
+static std::atomic<bool> failed[RADIO_COUNT];
+
+static portMUX_TYPE health_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/* Private functions ----------------------------------------------------- */
+// A failed radio only answers probes, enough of them in a row and it is judged afresh
+static RadioVerdict check_failed(UartPort_t port, int64_t now_us) {
+  taskENTER_CRITICAL(&health_lock);
+  Health& radio = health[port];
+  uint32_t shift = std::min<uint32_t>(radio.failures - 1, RADIO_HEALTH_RECOVERY_MAX_SHIFT);
+  bool recovered = radio.goodAnswers >= RADIO_HEALTH_RECOVER_ANSWERS;
+  bool probe = now_us - radio.lastProbe_us >= ((int64_t) RADIO_HEALTH_RECOVERY_PROBE_MS << shift) * 1000;
+  if (recovered) {
+    radio.timeouts = 0;
+    radio.errors = 0;
+    radio.windowStart_us = now_us;
+    radio.since_us = now_us;
+    radio.lastAnswer_us = now_us;
+    radio.reason = nullptr;
+  } else if (probe) {
+    radio.lastProbe_us = now_us;
+  }
+  taskEXIT_CRITICAL(&health_lock);
+
+  if (recovered) {
+    failed[port] = false;
+    ESP_LOGW(RADIO_HEALTH_TAG, "Radio %d answers again, back in use", port);
+    return RADIO_VERDICT_RECOVERED;
+  }
+  return probe ? RADIO_VERDICT_PROBE : RADIO_VERDICT_HEALTHY;
+}
+
+/* Public API ---------------------------------------------------------- */
+void radio_health_record(UartPort_t port, RadioEvent event) {
+  int64_t now_us = hal_time_us();
+  taskENTER_CRITICAL(&health_lock);
+  Health& radio = health[port];
+  switch (event) {
+    case RADIO_EVENT_OK:
+      radio.timeouts = 0;
+      radio.goodAnswers++;
+      radio.lastAnswer_us = now_us;
+      break;
+    case RADIO_EVENT_TIMEOUT:
+      radio.timeouts++;
+      radio.goodAnswers = 0;
+      break;
+    case RADIO_EVENT_ERROR:
+      radio.timeouts = 0;
+      radio.goodAnswers = 0;
+      radio.errors++;
+      radio.lastAnswer_us = now_us;
+      break;
+    case RADIO_EVENT_RX:
+      radio.lastRx_us = now_us;
+      radio.since_us = now_us;
+      break;
+  }
+  taskEXIT_CRITICAL(&health_lock);
+}
+
+RadioVerdict radio_health_check(UartPort_t port) {
+  int64_t now_us = hal_time_us();
+  if (failed[port]) {
+    return check_failed(port, now_us);
+  }
+  UartPort_t other = radio_other_port(port);
+
+  taskENTER_CRITICAL(&health_lock);
+  Health& radio = health[port];
+  if (radio.windowStart_us == 0) {
+    radio.windowStart_us = now_us;
+    radio.since_us = now_us;
+    radio.lastAnswer_us = now_us;
+  }
+  if (now_us - radio.windowStart_us >= RADIO_HEALTH_WINDOW_MS * 1000LL) {
+    radio.windowStart_us = now_us;
+    radio.errors = 0;
+  }
+  Health state = radio;
+  // A module is only deaf if the fleet is still out there, heard by the other radio since
+  bool fleetHeard = health[other].lastRx_us > state.lastRx_us;
+  taskEXIT_CRITICAL(&health_lock);
+
+  size_t silent = tx_scheduler_uplinks_between(port, state.since_us, now_us - RADIO_HEALTH_SLOT_MARGIN_MS * 1000LL);
+  const char *reason = nullptr;
+  if (state.timeouts >= RADIO_HEALTH_MAX_TIMEOUTS) {
+    reason = "no answer";
+  } else if (state.errors >= RADIO_HEALTH_MAX_ERRORS) {
+    reason = "+ERR";
+  } else if (silent >= RADIO_HEALTH_SILENT_SLOTS && state.lastRx_us != 0 && fleetHeard) {
+    reason = "deaf";
+  }
+
+  if (reason != nullptr && !failed[other]) {
+    taskENTER_CRITICAL(&health_lock);
+    radio.reason = reason;
+    radio.goodAnswers = 0;
+    radio.failures++;
+    radio.lastProbe_us = now_us;
+    taskEXIT_CRITICAL(&health_lock);
+    failed[port] = true;
+    ESP_LOGE(RADIO_HEALTH_TAG, "Radio %d failed (%s), %lu timeouts, %lu errors, %u silent slots", port, reason,
+             state.timeouts, state.errors, (unsigned) silent);
+    return RADIO_VERDICT_FAILED;
+  }
+  bool silentProbe = silent >= RADIO_HEALTH_PROBE_SLOTS && now_us - state.lastProbe_us >= RADIO_HEALTH_PROBE_MS * 1000LL;
+  bool idleProbe = now_us - std::max(state.lastAnswer_us, state.lastProbe_us) >= RADIO_HEALTH_IDLE_PROBE_MS * 1000LL;
+  if (silentProbe || idleProbe) {
+    taskENTER_CRITICAL(&health_lock);
+    radio.lastProbe_us = now_us;
+    taskEXIT_CRITICAL(&health_lock);
+    return RADIO_VERDICT_PROBE;
+  }
+  return RADIO_VERDICT_HEALTHY;
+}
+
+bool radio_health_alive(UartPort_t port) {
+  return !failed[port];
+}
+
+const char* radio_health_reason(UartPort_t port) {
+  taskENTER_CRITICAL(&health_lock);
+  const char *reason = health[port].reason;
+  taskEXIT_CRITICAL(&health_lock);
+  return reason != nullptr ? reason : "";
+}
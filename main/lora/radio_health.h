@@ -0,0 +1,95 @@
+/**
+  ******************************************************************************
+  * @authors        : Tomas Gonzalez & Brian Morris
+  * @file           : radio_health.h
+  * @brief          : Notices a dead radio module from its command answers and
+  *                   from the uplinks it stops hearing
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 Tomas Gonzalez & Brian Morris
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  */
+
+#ifndef RADIO_HEALTH_H
+#define RADIO_HEALTH_H
+
+/* Includes ------------------------------------------------------------ */
+#include <cstdint>
+#include "uart.h"
+
+/**
+ * A module fails in one of three ways:
+ * - it stops answering commands: too many timeouts in a row
+ * - it answers +ERR: too many in one window
+ * - it answers but hears nothing: the uplink slots expected on it pass in
+ *   silence. A few silent slots send it a probe, more fail it outright.
+ * A radio that nothing was sent to for a while is probed as well, the join
+ * radio may go a long time without a SYNC.
+ * A failed radio's LSUs move to the other radio, see radio_roles.h, and the
+ * last radio alive is never failed. A failed radio keeps being probed and
+ * comes back after enough answers in a row, its LSUs then move home. A deaf
+ * module still answers, so every time a radio fails again it is probed half
+ * as often.
+ */
+
+/* Defines ------------------------------------------------------------- */
+#define RADIO_HEALTH_MAX_TIMEOUTS        3       // Commands in a row without an answer
+#define RADIO_HEALTH_MAX_ERRORS          5       // +ERR answers in one window
+#define RADIO_HEALTH_WINDOW_MS           60000
+#define RADIO_HEALTH_PROBE_SLOTS         2       // Silent slots before the module is probed
+#define RADIO_HEALTH_SILENT_SLOTS        8       // Silent slots before it counts as deaf
+#define RADIO_HEALTH_PROBE_MS            10000   // Probes of a silent radio at most this often
+#define RADIO_HEALTH_IDLE_PROBE_MS       60000   // Probe of a radio that answered nothing for this long
+#define RADIO_HEALTH_SLOT_MARGIN_MS      1000    // Uplink on the air and through the RX task
+#define RADIO_HEALTH_RECOVERY_PROBE_MS   30000   // Probes of a failed radio, doubled on every failure after the first
+#define RADIO_HEALTH_RECOVERY_MAX_SHIFT  5       // Recovery probes at most 32 times further apart
+#define RADIO_HEALTH_RECOVER_ANSWERS     3       // +OK in a row before a failed radio is used again
+#define RADIO_HEALTH_TOPIC               "livestock/cu/radio"
+
+/* Enums --------------------------------------------------------------- */
+enum RadioEvent {
+  RADIO_EVENT_OK,       /**< Command answered +OK */
+  RADIO_EVENT_TIMEOUT,  /**< Command not answered */
+  RADIO_EVENT_ERROR,    /**< Command answered +ERR */
+  RADIO_EVENT_RX,       /**< Uplink received */
+};
+
+enum RadioVerdict {
+  RADIO_VERDICT_HEALTHY,
+  RADIO_VERDICT_PROBE,      /**< Silent or failed, send it a command to see if it answers */
+  RADIO_VERDICT_FAILED,     /**< Failed by this check, move its LSUs */
+  RADIO_VERDICT_RECOVERED,  /**< A failed radio answers again, move its LSUs back */
+};
+
+/* Public API ---------------------------------------------------------- */
+/**
+ * @brief Record what a radio did, safe from any task
+ */
+void radio_health_record(UartPort_t port, RadioEvent event);
+
+/**
+ * @brief Judge a radio, coordinator only
+ * @details Reports RADIO_VERDICT_FAILED once, a failed radio is then only
+ *          probed until it reports RADIO_VERDICT_RECOVERED. Silence is
+ *          measured against the uplink slots of the TX scheduler.
+ * @param port Radio to judge
+ * @return What the coordinator should do about it
+ */
+RadioVerdict radio_health_check(UartPort_t port);
+
+/**
+ * @brief Whether the radio is still in use, safe from any task
+ */
+bool radio_health_alive(UartPort_t port);
+
+/**
+ * @brief Why a radio failed, "" while it is alive
+ */
+const char* radio_health_reason(UartPort_t port);
+
+#endif /* RADIO_HEALTH_H */
@@ -0,0 +1,76 @@
+/**
+  ******************************************************************************
+  * @authors        : Tomas Gonzalez & Brian Morris
+  * @file           : radio_roles.cpp
+  * @brief          : Which of the two radios carries the joins and which one
+  *                   the uplinks of each LSU
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 Tomas Gonzalez & Brian Morris
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  */
+
+/* Includes ------------------------------------------------------------ */
+#include "radio_roles.h"
+
+#include "rylr998.h"
+#include "radio_health.h"
+#include "general_config.h"
+
+/* Private variables --------------------------------------------------------- */
+// Written once at startup, before any task reads it
+static RadioRoles roles = RADIO_ROLES_DEFAULT;
+
+/* Public API ---------------------------------------------------------- */
+void radio_roles_set(RadioRoles newRoles) {
+  roles = newRoles;
+}
+
+RadioRoles radio_roles_get() {
+  return roles;
+}
+
+UartPort_t radio_home_port(uint32_t lsu_id) {
+  if (roles == RADIO_ROLES_SPLIT && (lsu_id & 1) != 0) {
+    return UART_PORT_AUX;
+  }
+  return UART_PORT_MAIN;
+}
+
+UartPort_t radio_data_port(uint32_t lsu_id) {
+  UartPort_t home = radio_home_port(lsu_id);
+  return radio_health_alive(home) ? home : radio_other_port(home);
+}
+
+UartPort_t radio_other_port(UartPort_t port) {
+  return port == UART_PORT_MAIN ? UART_PORT_AUX : UART_PORT_MAIN;
+}
+
+bool radio_carries_data(UartPort_t port) {
+  if (!radio_health_alive(port)) {
+    return false;
+  }
+  if (!radio_health_alive(radio_other_port(port))) {
+    return true;
+  }
+  return port == UART_PORT_MAIN || roles == RADIO_ROLES_SPLIT;
+}
+
+uint32_t radio_band_hz(UartPort_t port) {
+  return port == UART_PORT_MAIN ? RYLR_MAIN_BAND_HZ : RYLR_AUX_BAND_HZ;
+}
+
+const char* radio_role_name(UartPort_t port) {
+  if (!radio_health_alive(port)) {
+    return "failed";
+  }
+  if (port != RADIO_JOIN_PORT) {
+    return radio_health_alive(RADIO_JOIN_PORT) ? "data" : "join+data";
+  }
+  return radio_carries_data(port) ? "join+data" : "join";
+}
@@ -0,0 +1,95 @@
+/**
+  ******************************************************************************
+  * @authors        : Tomas Gonzalez & Brian Morris
+  * @file           : radio_roles.h
+  * @brief          : Which of the two radios carries the joins and which one
+  *                   the uplinks of each LSU
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 Tomas Gonzalez & Brian Morris
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  */
+
+#ifndef RADIO_ROLES_H
+#define RADIO_ROLES_H
+
+/* Includes ------------------------------------------------------------ */
+#include <cstdint>
+#include "uart.h"
+
+/**
+ * New LSUs always join on the AUX channel, a SYNC is accepted on either radio
+ * and the CONFIG goes out on AUX. The data channel of an LSU follows from its
+ * ID, so the shards, the coordinator and a restored fleet agree on it without
+ * storing it. The coordinator picks the ID of a joining LSU so that it lands
+ * on the data channel with the fewest LSUs, and plans its slot against that
+ * channel only: two LSUs on different channels can share a slot.
+ *
+ * Changing the roles moves LSUs to another channel, they rejoin after missing
+ * their ACKs.
+ *
+ * Once radio_health fails a radio, the LSUs of its channel send on the other
+ * one and the coordinator moves them there with a CONFIG, see
+ * process_requests.cpp. They are moved back the same way once it answers again. Joining LSUs keep sending SYNC on the AUX channel
+ * after the join radio failed: the survivor retunes to it in the gaps between
+ * the uplinks it expects and answers the SYNCs it hears there.
+ */
+
+/* Enums --------------------------------------------------------------- */
+enum RadioRoles {
+  RADIO_ROLES_JOIN_DATA,  /**< AUX carries the joins, MAIN every uplink */
+  RADIO_ROLES_SPLIT,      /**< Both carry uplinks, odd IDs on AUX next to the joins */
+};
+
+/* Defines ------------------------------------------------------------- */
+#define RADIO_COUNT      2
+#define RADIO_JOIN_PORT  UART_PORT_AUX
+
+/* Public API ---------------------------------------------------------- */
+/**
+ * @brief Change the roles, before the fleet is restored
+ */
+void radio_roles_set(RadioRoles roles);
+
+/**
+ * @brief Current roles, RADIO_ROLES_DEFAULT until set
+ */
+RadioRoles radio_roles_get();
+
+/**
+ * @brief Radio the roles give an LSU, whether it is alive or not
+ */
+UartPort_t radio_home_port(uint32_t lsu_id);
+
+/**
+ * @brief Radio the uplinks of an LSU arrive on and its ACKs leave from
+ * @details The home radio, or the other one once it failed
+ */
+UartPort_t radio_data_port(uint32_t lsu_id);
+
+/**
+ * @brief The radio that is not port
+ */
+UartPort_t radio_other_port(UartPort_t port);
+
+/**
+ * @brief Whether any LSU sends its uplinks on the radio, never a failed one
+ */
+bool radio_carries_data(UartPort_t port);
+
+/**
+ * @brief Channel frequency of the radio, sent to the LSU in its CONFIG
+ */
+uint32_t radio_band_hz(UartPort_t port);
+
+/**
+ * @brief Short name of the role of a radio, "join", "data", "join+data" or "failed"
+ */
+const char* radio_role_name(UartPort_t port);
+
+#endif /* RADIO_ROLES_H */
@@ -0,0 +1,133 @@
+/**
+  ******************************************************************************
+  * @authors        : Tomas Gonzalez & Brian Morris
+  * @file           : radio_setup.cpp
+  * @brief          : Brings both radio modules to their channel settings at
+  *                   boot and measures how long it takes
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 Tomas Gonzalez & Brian Morris
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  */
+
+/* Includes ------------------------------------------------------------ */
+#include "radio_setup.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include "rylr998.h"
+#include "cu_comms.h"
+#include "coroutine.h"
+#include "esp_log.h"
+#include "hal/hal.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+/* Private variables --------------------------------------------------------- */
+static const char *RADIO_SETUP_TAG = "Radio Setup";
+
+// Written by the conversations, read by anyone once finished is set. A
+// conversation that ends after the timeout finds waiter cleared and leaves both alone.
+static RadioSetupReport report = {0, {-1, -1}, {0, 0}};
+static bool finished = false;
+static TaskHandle_t waiter = NULL;
+
+static portMUX_TYPE setup_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/* Private functions --------------------------------------------------------- */
+static CoTask<> configure(UartPort_t port, RYLR_config_t config) {
+  size_t written = 0;
+  bool configured = co_await CU_configureRadio(port, &config, &written);
+  int64_t now_us = hal_time_us();
+
+  taskENTER_CRITICAL(&setup_lock);
+  TaskHandle_t task = waiter;
+  if (task != NULL) {
+    report.ready_us[port] = configured ? now_us : -1;
+    report.written[port] = (uint32_t) written;
+  }
+  taskEXIT_CRITICAL(&setup_lock);
+  if (task != NULL) {
+    xTaskNotifyGive(task);
+  }
+}
+
+/* Public API ---------------------------------------------------------- */
+bool radio_setup_run(uint16_t address) {
+  int64_t start_us = hal_time_us();
+  taskENTER_CRITICAL(&setup_lock);
+  report = {start_us, {-1, -1}, {0, 0}};
+  finished = false;
+  waiter = xTaskGetCurrentTaskHandle();
+  taskEXIT_CRITICAL(&setup_lock);
+
+  // Each conversation waits on its own module, the two run side by side
+  for (int port = 0; port < RADIO_COUNT; port++) {
+    RYLR_config_t config;
+    rylr998_channelConfig(port == UART_PORT_MAIN, address, &config);
+    coro_spawn(configure((UartPort_t) port, config));
+  }
+
+  int64_t deadline_us = start_us + RADIO_SETUP_TIMEOUT_MS * 1000LL;
+  int done = 0;
+  while (done < RADIO_COUNT) {
+    int64_t left_ms = (deadline_us - hal_time_us()) / 1000;
+    if (left_ms <= 0) {
+      break;
+    }
+    if (ulTaskNotifyTake(pdFALSE, pdMS_TO_TICKS(left_ms)) > 0) {
+      done++;
+    }
+  }
+
+  RadioSetupReport result;
+  taskENTER_CRITICAL(&setup_lock);
+  finished = true;
+  waiter = NULL;
+  result = report;
+  taskEXIT_CRITICAL(&setup_lock);
+
+  bool ready = true;
+  int64_t ready_us = start_us;
+  for (int port = 0; port < RADIO_COUNT; port++) {
+    ready = ready && result.ready_us[port] >= 0;
+    ready_us = std::max(ready_us, result.ready_us[port]);
+  }
+  if (ready) {
+    ESP_LOGI(RADIO_SETUP_TAG, "Radios ready %lld ms after boot, setup took %lld ms, %lu settings written",
+             ready_us / 1000, (ready_us - start_us) / 1000,
+             (unsigned long) (result.written[UART_PORT_MAIN] + result.written[UART_PORT_AUX]));
+  } else {
+    ESP_LOGE(RADIO_SETUP_TAG, "Radio setup incomplete after %lld ms, main %s, aux %s",
+             (hal_time_us() - start_us) / 1000, result.ready_us[UART_PORT_MAIN] >= 0 ? "ready" : "not configured",
+             result.ready_us[UART_PORT_AUX] >= 0 ? "ready" : "not configured");
+  }
+  return ready;
+}
+
+bool radio_setup_report(RadioSetupReport *out) {
+  taskENTER_CRITICAL(&setup_lock);
+  *out = report;
+  bool done = finished;
+  taskEXIT_CRITICAL(&setup_lock);
+  return done;
+}
+
+size_t radio_setup_format(char *buffer, size_t size) {
+  RadioSetupReport result;
+  bool done = radio_setup_report(&result);
+  int64_t ready_us = done ? result.start_us : -1;
+  for (int port = 0; port < RADIO_COUNT && ready_us >= 0; port++) {
+    ready_us = result.ready_us[port] >= 0 ? std::max(ready_us, result.ready_us[port]) : -1;
+  }
+  int length = snprintf(buffer, size, "radio_ms=%lld radio_ready_ms=%lld radio_writes=%lu",
+                        ready_us >= 0 ? (ready_us - result.start_us) / 1000 : -1LL,
+                        ready_us >= 0 ? ready_us / 1000 : -1LL,
+                        (unsigned long) (result.written[UART_PORT_MAIN] + result.written[UART_PORT_AUX]));
+  return std::min<size_t>(length < 0 ? 0 : length, size - 1);
+}
@@ -0,0 +1,73 @@
+/**
+  ******************************************************************************
+  * @authors        : Tomas Gonzalez & Brian Morris
+  * @file           : radio_setup.h
+  * @brief          : Brings both radio modules to their channel settings at
+  *                   boot and measures how long it takes
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 Tomas Gonzalez & Brian Morris
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  */
+
+#ifndef RADIO_SETUP_H
+#define RADIO_SETUP_H
+
+/* Includes ------------------------------------------------------------ */
+#include <cstddef>
+#include <cstdint>
+#include "radio_roles.h"
+
+/**
+ * Both modules are configured at once on the coroutine executor, each by a
+ * conversation holding its radio lock, see CU_configureRadio(). A module
+ * keeps its settings over a reset, so after the first boot only the queries
+ * go out and the band is not written to the module flash again. A module that
+ * never answers is left unconfigured with enough timeouts for the radio health
+ * to fail it.
+ */
+
+/* Defines ------------------------------------------------------------- */
+#define RADIO_SETUP_TIMEOUT_MS  30000  // Both radios, a dead module gives up well before
+
+/* Structs ------------------------------------------------------------- */
+/**
+ * @brief Timing of the boot setup, times from boot
+ */
+struct RadioSetupReport {
+  int64_t start_us;               /**< Setup started */
+  int64_t ready_us[RADIO_COUNT];  /**< Radio holds its settings, -1 if it was not configured */
+  uint32_t written[RADIO_COUNT];  /**< Settings written, the rest were already set */
+};
+
+/* Public API ---------------------------------------------------------- */
+/**
+ * @brief Configure both radios and wait for them, from a task other than the executor
+ * @details Needs the RX tasks and the coroutine executor running
+ * @param address Address of the CU on both channels
+ * @return true if both radios are configured
+ */
+bool radio_setup_run(uint16_t address);
+
+/**
+ * @brief Copy the timing of the setup, safe from any task
+ * @param report Output
+ * @return false until radio_setup_run() returned
+ */
+bool radio_setup_report(RadioSetupReport *report);
+
+/**
+ * @brief Serialize as "radio_ms=<setup> radio_ready_ms=<from boot> radio_writes=<settings written>"
+ * @details Times are -1 while a radio is not configured
+ * @param buffer Output
+ * @param size Buffer size
+ * @return Length written
+ */
+size_t radio_setup_format(char *buffer, size_t size);
+
+#endif /* RADIO_SETUP_H */
@@ -7,24 +7,32 @@
 
 #include "rylr998.h"
 #include "uart.h"
+#include "freertos/FreeRTOS.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 /* Private variables ----------------------------------------------------- */
-static const char *RYLR_TAG = "RYLR"; 
-
-static char txBuffer[TX_BUFFER_SIZE];
-
-RYLR_RX_data_t rx_packet;
 
 UartPort_t configPort = UART_PORT_MAIN;
 
+// Factory settings of the module until rylr998_setConfig() replaces them
+static RYLR_config_t activeConfig[2] = {
+	{.networkId = 18, .SF = 9, .BW = 7, .CR = 1, .ProgramedPreamble = 12, .baudRate = 115200, .frequency = 915000000, .CRFOP = 22},
+	{.networkId = 18, .SF = 9, .BW = 7, .CR = 1, .ProgramedPreamble = 12, .baudRate = 115200, .frequency = 915000000, .CRFOP = 22},
+};
+
 /* Private functions ----------------------------------------------------- */
-void Error_Handler(void) {
-    while (1) {
-        // Do nothing
-    }
+// Decimal with an optional '-', leaves ptr after the last digit
+static int32_t parse_signed(char **ptr) {
+	int negative = **ptr == '-';
+	if (negative) (*ptr)++;
+	int32_t value = 0;
+	while (**ptr >= '0' && **ptr <= '9') {
+		value = value * 10 + (**ptr - '0');
+		(*ptr)++;
+	}
+	return negative ? -value : value;
 }
 
 //------------------------------
@@ -39,6 +47,11 @@ const RYLR_CommandEntry commandTable[] = {
 	{NULL, RYLR_NOT_FOUND} // Sentinel value
 };
 
+// Names in AT+<name>=, indexed by RYLR_setting_t
+static const char *const settingNames[RYLR_SET_COUNT] = {
+	"NETWORKID", "ADDRESS", "PARAMETER", "MODE", "BAND", "CRFOP"
+};
+
 RYLR_RX_command_t rylr998_ResponseFind(const char *rxBuffer) {
 	for (int i = 0; commandTable[i].prefix != NULL; i++) {
 		if (strncmp(rxBuffer, commandTable[i].prefix, strlen(commandTable[i].prefix)) == 0) {
@@ -48,137 +61,89 @@ RYLR_RX_command_t rylr998_ResponseFind(const char *rxBuffer) {
 	return RYLR_NOT_FOUND;
 }
 
-RYLR_RX_command_t rylr998_parse_received(uint8_t *pBuff, uint8_t pBuff_size) {
-	static char aux_buff[64];  // Should match with RX_BUFFER_SIZE
-	static uint8_t start_indx = 0;
-
-	uint8_t i = 0;
-	// Find the '+' start character
-	while (i < pBuff_size && pBuff[(start_indx + i) % pBuff_size] != '+') {
-		i++;
-	}
-	start_indx = (start_indx + i) % pBuff_size;
-
-	// Copy the command into aux_buff
-	for (i = 0; i < pBuff_size; i++) {
-		aux_buff[i] = pBuff[(start_indx + i) % pBuff_size];
-		if (aux_buff[i] == '\n') break;
-	}
-	aux_buff[i + 1] = '\0'; // Ensure null termination
-
-	rylr998_SetInterruptFlag(0, configPort);
-	start_indx = (start_indx + i + 1) % pBuff_size;
-
-	volatile  RYLR_RX_command_t cmd = rylr998_ResponseFind(aux_buff);   //se define como volatil para que no sea optimizada
-	if (cmd == RYLR_OK) {
-		// Do nothing
-	} else if (cmd == RYLR_RCV) {
-		char *ptr = aux_buff;
-		memset(rx_packet.data, 0, sizeof(rx_packet.data));  // Initialize data as empty string
-
-		// Skip past "+RCV="
-		while (*ptr && *ptr != '=') ptr++;
-		if (*ptr) ptr++; // Skip '='
-
-		// Parse ID (first number after '=')
-		rx_packet.id = 0;
-		while (*ptr >= '0' && *ptr <= '9') {
-				rx_packet.id = rx_packet.id * 10 + (*ptr - '0');
-				ptr++;
-		}
-		if (*ptr != ',') return cmd = RYLR_RCV_ERR; // Invalid format
-		ptr++; // Skip ','
-
-		// Parse byte count
-		rx_packet.byte_count = 0;
-		while (*ptr >= '0' && *ptr <= '9') {
-				rx_packet.byte_count = rx_packet.byte_count * 10 + (*ptr - '0');
-				ptr++;
-		}
-		if (*ptr != ',') return cmd = RYLR_RCV_ERR; // Invalid format
-		ptr++; // Skip ','
-
-		// Parse data (copy up to byte_count or buffer size)
-		size_t i = 0;
-		size_t max_copy = (rx_packet.byte_count < sizeof(rx_packet.data)) ?
-											rx_packet.byte_count : sizeof(rx_packet.data) - 1;
-		while (i < max_copy && *ptr && *ptr != ',') {
-			rx_packet.data[i++] = *ptr++;
+// "+<name>=<values>" into setting_data, RYLR_NOT_FOUND if it is no setting
+static RYLR_RX_command_t rylr998_parse_setting(const char *line, RYLR_setting_data_t *setting_data) {
+	for (int setting = 0; setting < RYLR_SET_COUNT; setting++) {
+		size_t length = strlen(settingNames[setting]);
+		if (strncmp(line + 1, settingNames[setting], length) != 0 || line[length + 1] != '=') {
+			continue;
 		}
-		rx_packet.data[i] = '\0';
-
-		// Skip remaining data if needed
-		while (*ptr && *ptr != ',') ptr++;
-		if (*ptr != ',') return cmd = RYLR_RCV_ERR; // Invalid format
-		ptr++; // Skip ','
-		ptr++; // Skip '-'
-
-		// Parse RSSI
-		rx_packet.rssi = 0;
-		while (*ptr >= '0' && *ptr <= '9') {
-			rx_packet.rssi = rx_packet.rssi * 10 + (*ptr - '0');
-			ptr++;
-		}
-
-		if (*ptr != ',') return cmd = RYLR_RCV_ERR; // Invalid format
-		ptr++; // Skip ','
-
-		// Parse SNR
-		rx_packet.snr = 0;
-		while (*ptr >= '0' && *ptr <= '9') {
-			rx_packet.snr = rx_packet.snr * 10 + (*ptr - '0');
+		char *ptr = (char*) line + length + 2;
+		setting_data->setting = (RYLR_setting_t) setting;
+		setting_data->count = 0;
+		while (setting_data->count < 4 && *ptr >= '0' && *ptr <= '9') {
+			setting_data->values[setting_data->count++] = (uint32_t) strtoul(ptr, &ptr, 10);
+			if (*ptr != ',') break;
 			ptr++;
 		}
-
-		//------------------------------
-		// 		 PROCESS RECEIVED DATA:
-		//------------------------------
-		if(rylr998_ResponseFind(rx_packet.data)==RYLR_RCV_ACK){
-			cmd = RYLR_RCV_ACK;
-		}
-
-		//TODO proccess received SYNC DATA
-
-	} else if (cmd == RYLR_ERR) {
-		while (1) { Error_Handler(); } // Handle error
+		return RYLR_SETTING;
 	}
-	return cmd;
+	return RYLR_NOT_FOUND;
 }
 
-//----------------------------------
-// 		 IRQ FLAG -> LOOK UART FILE
-//----------------------------------
+// "+RCV=<id>,<length>,<data>,<rssi>,<snr>" into packet
+static RYLR_RX_command_t rylr998_parse_rcv(const char *line, RYLR_RX_data_t *packet) {
+	char *ptr = (char*) line + 5;  // Past "+RCV="
 
-volatile uint8_t rylr998_interrupt_flag[2];
+	packet->id = 0;
+	while (*ptr >= '0' && *ptr <= '9') {
+		packet->id = packet->id * 10 + (*ptr - '0');
+		ptr++;
+	}
+	if (*ptr != ',') return RYLR_RCV_ERR;
+	ptr++;
 
-void rylr998_SetInterruptFlag(uint8_t val, UartPort_t port){
-	rylr998_interrupt_flag[port] = val;
+	size_t byte_count = 0;
+	while (*ptr >= '0' && *ptr <= '9') {
+		byte_count = byte_count * 10 + (*ptr - '0');
+		ptr++;
+	}
+	if (*ptr != ',') return RYLR_RCV_ERR;
+	ptr++;
+
+	// The length tells where the data ends, it may hold commas
+	if (strnlen(ptr, byte_count) < byte_count) return RYLR_RCV_ERR;
+	size_t copy = byte_count < sizeof(packet->data) ? byte_count : sizeof(packet->data) - 1;
+	memcpy(packet->data, ptr, copy);
+	packet->data[copy] = '\0';
+	packet->byte_count = (uint8_t) copy;
+	ptr += byte_count;
+	if (*ptr != ',') return RYLR_RCV_ERR;
+	ptr++;
+
+	packet->rssi = (int16_t) parse_signed(&ptr);  // dBm
+	if (*ptr != ',') return RYLR_RCV_ERR;
+	ptr++;
+	packet->snr = (int8_t) parse_signed(&ptr);  // dB, negative below the noise floor
+
+	return rylr998_ResponseFind(packet->data) == RYLR_RCV_ACK ? RYLR_RCV_ACK : RYLR_RCV;
 }
 
-uint8_t rylr998_GetInterruptFlag(UartPort_t port){
-	return rylr998_interrupt_flag[port];
+RYLR_RX_command_t rylr998_parseLine(const char *line, size_t length, RYLR_response_t *response) {
+	// A terminated copy without the "\r\n", its start is kept for the logs
+	char text[UART_RX_BUFF_SIZE + 1];
+	while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r')) length--;
+	if (length > UART_RX_BUFF_SIZE) length = UART_RX_BUFF_SIZE;
+	memcpy(text, line, length);
+	text[length] = '\0';
+	size_t kept = length < sizeof(response->line) ? length : sizeof(response->line) - 1;
+	memcpy(response->line, text, kept);
+	response->line[kept] = '\0';
+
+	RYLR_RX_command_t cmd = rylr998_ResponseFind(text);
+	if (cmd == RYLR_RCV) {
+		cmd = rylr998_parse_rcv(text, &response->packet);
+	} else if (cmd == RYLR_NOT_FOUND && text[0] == '+') {
+		cmd = rylr998_parse_setting(text, &response->setting);
+	}
+	// RYLR_ERR goes back to the caller, the radio health counts it
+	response->command = cmd;
+	return cmd;
 }
 
 //------------------------------
 // 		Config Commands
 //------------------------------
-static void rylr998_setAddress(const uint8_t address) {
-	memset(txBuffer, 0, sizeof(TX_BUFFER_SIZE));
-	snprintf(txBuffer, sizeof(txBuffer), AT "ADDRESS=%d" END, address);
-	rylr998_sendCommand(txBuffer, configPort);
-}
-
-static void rylr998_networkId(const uint8_t networkId){
-	memset(txBuffer, 0, sizeof(TX_BUFFER_SIZE));
-	snprintf(txBuffer, TX_BUFFER_SIZE, AT "NETWORKID=%u" END, networkId);
-	rylr998_sendCommand(txBuffer, configPort);
-}
-
-static void rylr998_setParameter(const uint8_t SF,const uint8_t BW,const uint8_t CR,const uint8_t ProgramedPreamble){
-	memset(txBuffer, 0, sizeof(TX_BUFFER_SIZE));
-	snprintf(txBuffer, TX_BUFFER_SIZE, AT "PARAMETER=%u,%u,%u,%u" END, SF, BW, CR, ProgramedPreamble);
-	rylr998_sendCommand(txBuffer, configPort);
-}
 /*
 void rylr998_reset(void){
 	memset(txBuffer, 0, sizeof(TX_BUFFER_SIZE));
@@ -186,13 +151,6 @@ void rylr998_reset(void){
 	rylr998_sendCommand(txBuffer, configPort);
 }*/
 
-static void rylr998_mode(const uint8_t mode,const uint32_t rxTime,const uint32_t LowSpeedTime){
-	memset(txBuffer, 0, sizeof(TX_BUFFER_SIZE));
-	if (rxTime==0||LowSpeedTime==0){snprintf(txBuffer, TX_BUFFER_SIZE, AT"MODE=%u" END, mode);
-	}else{snprintf(txBuffer, TX_BUFFER_SIZE, AT"MODE=2,%lu,%lu" END,rxTime,LowSpeedTime);}
-	rylr998_sendCommand(txBuffer, configPort);
-}
-
 /*
 void rylr998_setBaudRate(uint32_t baudRate){
 	memset(txBuffer, 0, sizeof(TX_BUFFER_SIZE));
@@ -200,103 +158,135 @@ void rylr998_setBaudRate(uint32_t baudRate){
 	rylr998_sendCommand(txBuffer, configPort);
 }*/
 
-static void rylr998_setBand(const uint32_t frequency,const uint8_t memory){
+/*void rylr998_FACTORY(void){
 	memset(txBuffer, 0, sizeof(TX_BUFFER_SIZE));
-	if(memory){snprintf(txBuffer, TX_BUFFER_SIZE, AT"BAND=%lu,M"END,frequency);
-	}else{snprintf(txBuffer, TX_BUFFER_SIZE, AT"BAND=%lu,M"END,frequency);}
+	snprintf(txBuffer, TX_BUFFER_SIZE,  AT"FACTORY"END);
 	rylr998_sendCommand(txBuffer, configPort);
+}*/
+
+int rylr998_formatQuery(RYLR_setting_t setting, char *buffer, size_t size){
+	return snprintf(buffer, size, AT "%s?" END, settingNames[setting]);
 }
 
-static void rylr998_setCRFOP(const uint8_t CRFOP){
-	memset(txBuffer, 0, sizeof(TX_BUFFER_SIZE));
-	snprintf(txBuffer, TX_BUFFER_SIZE,  AT"CRFOP=%u"END, CRFOP);
-	rylr998_sendCommand(txBuffer, configPort);
+int rylr998_formatSetting(RYLR_setting_t setting, const RYLR_config_t *config, char *buffer, size_t size){
+	switch (setting) {
+		case RYLR_SET_NETWORKID:
+			return snprintf(buffer, size, AT "NETWORKID=%u" END, config->networkId);
+		case RYLR_SET_ADDRESS:
+			return snprintf(buffer, size, AT "ADDRESS=%u" END, config->address);
+		case RYLR_SET_PARAMETER:
+			return snprintf(buffer, size, AT "PARAMETER=%u,%u,%u,%u" END, config->SF, config->BW, config->CR, config->ProgramedPreamble);
+		case RYLR_SET_MODE:
+			if (config->rxTime == 0 || config->LowSpeedTime == 0) {
+				return snprintf(buffer, size, AT "MODE=%u" END, config->mode);
+			}
+			return snprintf(buffer, size, AT "MODE=2,%lu,%lu" END, config->rxTime, config->LowSpeedTime);
+		case RYLR_SET_BAND:
+			// ",M" writes the module flash, only worth it when the band changes
+			if (config->memory) {
+				return snprintf(buffer, size, AT "BAND=%lu,M" END, config->frequency);
+			}
+			return snprintf(buffer, size, AT "BAND=%lu" END, config->frequency);
+		case RYLR_SET_CRFOP:
+			return snprintf(buffer, size, AT "CRFOP=%u" END, config->CRFOP);
+		default:
+			return -1;
+	}
 }
 
-/*void rylr998_FACTORY(void){
-	memset(txBuffer, 0, sizeof(TX_BUFFER_SIZE));
-	snprintf(txBuffer, TX_BUFFER_SIZE,  AT"FACTORY"END);
-	rylr998_sendCommand(txBuffer, configPort);
-}*/
+bool rylr998_settingMatches(RYLR_setting_t setting, const RYLR_setting_data_t *answer, const RYLR_config_t *config){
+	if (answer->setting != setting || answer->count == 0) {
+		return false;
+	}
+	switch (setting) {
+		case RYLR_SET_NETWORKID:
+			return answer->values[0] == config->networkId;
+		case RYLR_SET_ADDRESS:
+			return answer->values[0] == config->address;
+		case RYLR_SET_PARAMETER:
+			return answer->count == 4 && answer->values[0] == config->SF && answer->values[1] == config->BW &&
+					answer->values[2] == config->CR && answer->values[3] == config->ProgramedPreamble;
+		case RYLR_SET_MODE:
+			// Smart receiving reports its times, the other modes only the mode
+			if (config->rxTime == 0 || config->LowSpeedTime == 0) {
+				return answer->values[0] == config->mode;
+			}
+			return answer->count == 3 && answer->values[0] == 2 && answer->values[1] == config->rxTime &&
+					answer->values[2] == config->LowSpeedTime;
+		case RYLR_SET_BAND:
+			return answer->values[0] == config->frequency;
+		case RYLR_SET_CRFOP:
+			return answer->values[0] == config->CRFOP;
+		default:
+			return false;
+	}
+}
+
+void rylr998_setConfig(const RYLR_config_t *config, UartPort_t port){
+	activeConfig[port] = *config;
+}
+
+const RYLR_config_t* rylr998_getConfig(UartPort_t port){
+	return &activeConfig[port];
+}
 
 //------------------------------
-// 		 CONFIG ALL SETTINGS
+// 		 TIME ON AIR
 //------------------------------
-void rylr998_config(const RYLR_config_t *config_handler, UartPort_t port){
-	configPort = port;
-	//rylr998_FACTORY();
-	//rylr998_getCommand(RYLR_FACTORY, configPort);
-	//NETWORKID
-	
-	rylr998_networkId(config_handler->networkId);
-	rylr998_getCommand(RYLR_OK, configPort);
-	ESP_LOGI(RYLR_TAG, "Network ID set to %d\n", config_handler->networkId);
-	//ADDRESS
-	rylr998_setAddress(config_handler->address);
-	rylr998_getCommand(RYLR_OK, configPort);
-	ESP_LOGI(RYLR_TAG, "Address set to %d\n", config_handler->address);
-	//PARAMETERS
-	rylr998_setParameter(config_handler->SF, config_handler->BW, config_handler->CR, config_handler->ProgramedPreamble);
-	rylr998_getCommand(RYLR_OK, configPort);
-	ESP_LOGI(RYLR_TAG, "Parameters set\n");
-	//MODE
-	rylr998_mode(config_handler->mode,config_handler->rxTime,config_handler->LowSpeedTime);
-	rylr998_getCommand(RYLR_OK, configPort);
-	ESP_LOGI(RYLR_TAG, "Mode set to %d\n", config_handler->mode);
-	//BaudRate
-	//rylr998_setBaudRate(config_handler->baudRate);
-	//rylr998_getCommand(RYLR_IPR); //ADD RYLR_IPR
-	//FREQ Band
-	rylr998_setBand(config_handler->frequency,config_handler->memory);
-	rylr998_getCommand(RYLR_OK, configPort);
-	//PASSWORD
-	//rylr998_setCPIN(config_handler->password);
-	//rylr998_getCommand(RYLR_OK);
-	//RF Output
-	rylr998_setCRFOP(config_handler->CRFOP);
-	rylr998_getCommand(RYLR_OK, configPort);
-	ESP_LOGI(RYLR_TAG, "CRFOP set to %d\n", config_handler->CRFOP);
+uint32_t rylr998_airtime_us(const RYLR_config_t *config, size_t payload_length){
+	// Integer form of the Semtech formula, a symbol lasts 2^SF / BW
+	uint8_t bwShift = (config->BW >= 7 && config->BW <= 9) ? config->BW - 7 : 0;
+	uint32_t symbol_us = (1u << config->SF) * (8u >> bwShift);
+	// Low data rate optimization, on when a symbol lasts 16 ms or more
+	int32_t lowDataRate = symbol_us >= 16000 ? 1 : 0;
+
+	int32_t numerator = 8 * (int32_t) payload_length - 4 * config->SF + 28 + 16;
+	int32_t denominator = 4 * (config->SF - 2 * lowDataRate);
+	int32_t blocks = numerator > 0 ? (numerator + denominator - 1) / denominator : 0;
+	uint32_t payloadSymbols = 8 + (uint32_t) blocks * (config->CR + 4);
+
+	// Preamble plus 4.25 symbols of sync word, symbol_us is a multiple of 4
+	return (config->ProgramedPreamble + payloadSymbols) * symbol_us + symbol_us / 4 * 17;
 }
 
 //------------------------------
 // 		 CHANNELS
 //------------------------------
-void rylr998_setChannel(uint8_t ch, uint8_t address, UartPort_t port) {
-	RYLR_config_t config_handler;
+void rylr998_channelConfig(uint8_t ch, uint16_t address, RYLR_config_t *config_handler) {
+	memset(config_handler, 0, sizeof(RYLR_config_t));
 	if (ch) {
 		/* MAIN CHANNEL ------------------*/
-		config_handler.networkId =18;
-		config_handler.address =address;
-		config_handler.SF=9;
-		config_handler.BW=7;
-		config_handler.CR=1;
-		config_handler.ProgramedPreamble=12;
-		config_handler.mode=0;
-		config_handler.rxTime=0;
-		config_handler.LowSpeedTime=0;
-		//config_handler.baudRate=115200;
-		config_handler.frequency=915000000;
-		config_handler.memory=1;
-		//strcpy(config_handler.password, "FFFFFFFF"); //we dont want the \0 terminator so we overflow, estan comentados para ver los msj
-		config_handler.CRFOP=22;
+		config_handler->networkId =18;
+		config_handler->address =address;
+		config_handler->SF=9;
+		config_handler->BW=7;
+		config_handler->CR=1;
+		config_handler->ProgramedPreamble=12;
+		config_handler->mode=0;
+		config_handler->rxTime=0;
+		config_handler->LowSpeedTime=0;
+		//config_handler->baudRate=115200;
+		config_handler->frequency=RYLR_MAIN_BAND_HZ;
+		config_handler->memory=1;
+		//strcpy(config_handler->password, "FFFFFFFF"); //we dont want the \0 terminator so we overflow, estan comentados para ver los msj
+		config_handler->CRFOP=22;
 	} else {
 		/* AUX CHANNEL ------------------*/
-		config_handler.networkId =18;
-		config_handler.address =address;
-		config_handler.SF=9;
-		config_handler.BW=7;
-		config_handler.CR=1;
-		config_handler.ProgramedPreamble=12;
-		config_handler.mode=0;
-		config_handler.rxTime=0;
-		config_handler.LowSpeedTime=0;
-		//config_handler.baudRate=115200;
-		config_handler.frequency=925000000;
-		config_handler.memory=1;
-		//strcpy(config_handler.password, "FFFFFFFF"); //we dont want the \0 terminator so we overflow, esta comentado para no tener que config password en ambos dispositivos
-		config_handler.CRFOP=22;
+		config_handler->networkId =18;
+		config_handler->address =address;
+		config_handler->SF=9;
+		config_handler->BW=7;
+		config_handler->CR=1;
+		config_handler->ProgramedPreamble=12;
+		config_handler->mode=0;
+		config_handler->rxTime=0;
+		config_handler->LowSpeedTime=0;
+		//config_handler->baudRate=115200;
+		config_handler->frequency=RYLR_AUX_BAND_HZ;
+		config_handler->memory=1;
+		//strcpy(config_handler->password, "FFFFFFFF"); //we dont want the \0 terminator so we overflow, esta comentado para no tener que config password en ambos dispositivos
+		config_handler->CRFOP=22;
 	}
-	rylr998_config(&config_handler, port);
 }
 
 //-----------------------------------------------
@@ -306,19 +296,3 @@ void rylr998_sendCommand(const char *cmd, UartPort_t port) {
 	uint16_t len = strlen(cmd);
 	uart_send(cmd, len, port);
 }
-
-RYLR_RX_data_t* rylr998_getCommand(RYLR_RX_command_t cmd, UartPort_t port){
-	uint8_t* rx_buff = uart_get_rx_buff(port);
-
-	vTaskDelay(pdMS_TO_TICKS(30));  //Sin un retardo, la bandera no llega a ponerse en 1, Esta parte del codigo resulta delicada
-	while(!rylr998_interrupt_flag[port]);
-
-	RYLR_RX_command_t received_cmd = rylr998_parse_received(rx_buff, UART_RX_BUFF_SIZE);
-	if (received_cmd != cmd) { 
-		ESP_LOGE(RYLR_TAG, "Wrong command. Expected %d, got %d", cmd, received_cmd);
-		ESP_LOGE(RYLR_TAG, "RX buffer: %s", rx_buff);
-		ESP_LOGE(RYLR_TAG, "Read at port %d", port);
-	}
-
-	return &rx_packet;
-}
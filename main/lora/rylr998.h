@@ -13,7 +13,8 @@ extern "C" {
 #endif
 
 
-#include "esp_system.h"
+#include <stdbool.h>
+#include <stddef.h>
 #include "esp_log.h"
 #include "uart.h"
 
@@ -22,6 +23,9 @@ extern "C" {
 
 #define TX_BUFFER_SIZE 128
 
+#define RYLR_MAIN_BAND_HZ 915000000
+#define RYLR_AUX_BAND_HZ  925000000
+
 typedef enum
 {
 	RYLR_OK = 0x00U,
@@ -37,6 +41,7 @@ typedef enum
 	//RYLR_RESET,
 	//RYLR_READY,
 	RYLR_ERR,
+	RYLR_SETTING,		// Answer to a query, "+<setting>=<values>"
 	RYLR_NOT_FOUND
 
 } RYLR_RX_command_t;
@@ -73,28 +78,70 @@ typedef struct{
 	uint16_t id;
 	uint8_t byte_count;
 	char data[64];    //LoRa suports up to 240 data char, this must less or equal RxBuff var in UART file
-	uint8_t rssi;      //Always negative
-	uint8_t snr;
+	int16_t rssi;      //dBm
+	int8_t snr;        //dB, negative below the noise floor
 }RYLR_RX_data_t;
 
+// Settings the CU configures, in the order they are sent
+typedef enum
+{
+	RYLR_SET_NETWORKID = 0,
+	RYLR_SET_ADDRESS,
+	RYLR_SET_PARAMETER,
+	RYLR_SET_MODE,
+	RYLR_SET_BAND,
+	RYLR_SET_CRFOP,
+	RYLR_SET_COUNT
+} RYLR_setting_t;
+
+/*
+ * +<setting>=<value>,<value>...
+ * Answer to "AT+<setting>?", up to four values
+ */
+typedef struct{
+	RYLR_setting_t setting;
+	uint8_t count;
+	uint32_t values[4];
+}RYLR_setting_data_t;
+
+/*
+ * One line from the module, parsed by the RX task of its port and copied on
+ * to whoever handles it, nothing is shared between lines or ports
+ */
+typedef struct{
+	RYLR_RX_command_t command;
+	RYLR_RX_data_t packet;			// RYLR_RCV and RYLR_RCV_ACK
+	RYLR_setting_data_t setting;	// RYLR_SETTING
+	char line[32];					// Start of the line, for the logs
+}RYLR_response_t;
+
 typedef struct {
     const char *prefix;
     RYLR_RX_command_t command;
 } RYLR_CommandEntry;
 
-
-extern RYLR_RX_data_t rx_packet;
-
 //Tx CFG
-void rylr998_setChannel(uint8_t ch,uint8_t address, UartPort_t port);
-
-RYLR_RX_data_t* rylr998_getCommand(RYLR_RX_command_t cmd, UartPort_t port);
+// Settings of a channel, 1 for the main one
+void rylr998_channelConfig(uint8_t ch, uint16_t address, RYLR_config_t *config);
+// "AT+<setting>?", returns the length as snprintf
+int rylr998_formatQuery(RYLR_setting_t setting, char *buffer, size_t size);
+// "AT+<setting>=<values>" from config, BAND is saved to the module flash only with config->memory
+int rylr998_formatSetting(RYLR_setting_t setting, const RYLR_config_t *config, char *buffer, size_t size);
+// Whether the answer to a query of setting already holds the value of config
+bool rylr998_settingMatches(RYLR_setting_t setting, const RYLR_setting_data_t *answer, const RYLR_config_t *config);
+// Records the settings the module behind port now holds
+void rylr998_setConfig(const RYLR_config_t *config, UartPort_t port);
+// Settings the module behind port holds, the factory defaults until configured
+const RYLR_config_t* rylr998_getConfig(UartPort_t port);
+
+//Time on air
+// Frame of payload_length bytes with explicit header and CRC, Semtech AN1200.13
+uint32_t rylr998_airtime_us(const RYLR_config_t *config, size_t payload_length);
+
+// Parses one line, with or without its "\r\n", keeps no state so each RX task parses its own
+RYLR_RX_command_t rylr998_parseLine(const char *line, size_t length, RYLR_response_t *response);
 void rylr998_sendCommand(const char *cmd, UartPort_t port);
 
-//IRQ
-void rylr998_SetInterruptFlag(uint8_t val, UartPort_t port);
-uint8_t rylr998_GetInterruptFlag(UartPort_t port);
-
 
 
 #ifdef __cplusplus
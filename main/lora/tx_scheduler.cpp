@@ -0,0 +1,237 @@
+/**
+  ******************************************************************************
+  * @authors        : Tomas Gonzalez & Brian Morris
+  * @file           : tx_scheduler.cpp
+  * @brief          : Places the CU transmissions between the expected uplink
+  *                   slots and keeps each radio within its duty-cycle budget
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 Tomas Gonzalez & Brian Morris
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  */
+
+/* Includes ------------------------------------------------------------ */
+#include "tx_scheduler.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+#include "rylr998.h"
+#include "radio_roles.h"
+#include "general_config.h"
+#include "hal/hal.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+/* Private types --------------------------------------------------------- */
+struct Budget {
+  int64_t tokens_us;       // Time on air left, negative while a reserved frame waits for it
+  int64_t lastRefill_us;
+  bool ready;
+};
+
+/* Private variables --------------------------------------------------------- */
+static const uint32_t dutyPermille[RADIO_COUNT] = {TX_SCHEDULER_DUTY_PERMILLE, TX_SCHEDULER_DUTY_PERMILLE};
+
+// Written by the coordinator, read by the conversations, guarded by schedule_lock
+static uint32_t uplinkSlots[RADIO_COUNT][MAX_LSU_COUNT];
+static size_t uplinkCount[RADIO_COUNT];
+static uint32_t uplinkPeriod_ms = TIME_PERIOD_MS;
+static Budget budgets[RADIO_COUNT];
+static TxRadioStats radioStats[RADIO_COUNT];
+static int64_t windowStart_us = 0;
+
+// A mutex, not a spinlock: next_gap() walks up to the whole plan and
+// set_uplinks() copies it, too long to hold with interrupts masked
+static StaticSemaphore_t scheduleLockBuffer;
+static SemaphoreHandle_t schedule_lock = NULL;
+
+/* Private functions --------------------------------------------------------- */
+// Must hold schedule_lock
+static void refill(Budget& budget, uint32_t permille, int64_t now_us) {
+  int64_t capacity_us = (int64_t) TX_SCHEDULER_BUDGET_MS * permille;
+  if (!budget.ready) {
+    budget.tokens_us = capacity_us;
+    budget.lastRefill_us = now_us;
+    budget.ready = true;
+  }
+  int64_t elapsed_us = now_us - budget.lastRefill_us;
+  budget.lastRefill_us = now_us;
+  budget.tokens_us = std::min(capacity_us, budget.tokens_us + elapsed_us * permille / 1000);
+}
+
+// First start at or after at_us where need_us fits between the uplink windows,
+// -1 if the windows cover the whole period. Must hold schedule_lock.
+static int64_t next_gap(UartPort_t port, int64_t at_us, int64_t need_us, int64_t uplink_us) {
+  int64_t n = (int64_t) uplinkCount[port];
+  if (n == 0) {
+    return at_us;
+  }
+  int64_t period_us = (int64_t) uplinkPeriod_ms * 1000;
+  int64_t base_us = at_us - at_us % period_us;
+  int64_t before_us = TX_SCHEDULER_SLOT_GUARD_MS * 1000LL;
+  int64_t after_us = uplink_us + before_us;
+  int64_t t = at_us - base_us;
+
+  // Windows in time order are slots in order, lap after lap. Start at the first
+  // one still open at t, a window of the previous period may reach into this one.
+  const uint32_t *begin = uplinkSlots[port];
+  const uint32_t *end = begin + n;
+  int64_t j;
+  int64_t wrap_us = t + period_us - after_us;
+  int64_t k = wrap_us < 0 ? 0 : std::upper_bound(begin, end, (uint32_t) (wrap_us / 1000)) - begin;
+  if (k < n) {
+    j = k - n;
+  } else {
+    int64_t open_us = t - after_us;
+    j = open_us < 0 ? 0 : std::upper_bound(begin, end, (uint32_t) (open_us / 1000)) - begin;
+  }
+
+  for (int64_t steps = 0; steps <= 2 * n + 1; steps++, j++) {
+    int64_t lap = j >= 0 ? j / n : -((-j + n - 1) / n);
+    int64_t slot_us = (int64_t) begin[j - lap * n] * 1000 + lap * period_us;
+    int64_t start_us = slot_us - before_us;
+    if (t + need_us <= start_us) {
+      return base_us + t;
+    }
+    t = std::max(t, slot_us + after_us);
+  }
+  return -1;
+}
+
+/* Public API ---------------------------------------------------------- */
+void tx_scheduler_init() {
+  if (schedule_lock == NULL) {
+    schedule_lock = xSemaphoreCreateMutexStatic(&scheduleLockBuffer);
+  }
+}
+
+void tx_scheduler_set_uplinks(UartPort_t port, const uint32_t *slots_ms, size_t count, uint32_t period_ms) {
+  count = std::min<size_t>(count, MAX_LSU_COUNT);
+  xSemaphoreTake(schedule_lock, portMAX_DELAY);
+  memcpy(uplinkSlots[port], slots_ms, count * sizeof(uint32_t));
+  uplinkCount[port] = count;
+  uplinkPeriod_ms = period_ms;
+  xSemaphoreGive(schedule_lock);
+}
+
+bool tx_scheduler_reserve(UartPort_t port, size_t payload_length, uint32_t max_delay_ms, uint32_t *delay_ms) {
+  const RYLR_config_t *config = rylr998_getConfig(port);
+  int64_t frame_us = rylr998_airtime_us(config, payload_length);
+  int64_t uplink_us = rylr998_airtime_us(config, TX_SCHEDULER_UPLINK_BYTES);
+  int64_t now_us = hal_time_us();
+  int64_t deadline_us = now_us + (int64_t) max_delay_ms * 1000;
+  uint32_t permille = dutyPermille[port];
+  TxRadioStats& stats = radioStats[port];
+
+  xSemaphoreTake(schedule_lock, portMAX_DELAY);
+  Budget& budget = budgets[port];
+  refill(budget, permille, now_us);
+  int64_t ready_us = now_us;
+  if (budget.tokens_us < frame_us) {
+    ready_us += (frame_us - budget.tokens_us) * 1000 / permille;
+  }
+  if (ready_us > deadline_us) {
+    stats.dropped++;
+    xSemaphoreGive(schedule_lock);
+    *delay_ms = 0;
+    return false;
+  }
+
+  int64_t start_us = next_gap(port, ready_us, frame_us, uplink_us);
+  if (start_us < 0 || start_us > deadline_us) {
+    start_us = ready_us;
+    stats.overlapped++;
+  }
+  budget.tokens_us -= frame_us;
+  uint32_t wait_ms = (uint32_t) ((start_us - now_us + 999) / 1000);
+  stats.frames++;
+  stats.airtime_us += frame_us;
+  if (wait_ms > 0) {
+    stats.deferred++;
+    stats.maxDelay_ms = std::max(stats.maxDelay_ms, wait_ms);
+  }
+  xSemaphoreGive(schedule_lock);
+
+  *delay_ms = wait_ms;
+  return true;
+}
+
+void tx_scheduler_record_rx(UartPort_t port, size_t payload_length) {
+  int64_t frame_us = rylr998_airtime_us(rylr998_getConfig(port), payload_length);
+  xSemaphoreTake(schedule_lock, portMAX_DELAY);
+  radioStats[port].rxFrames++;
+  radioStats[port].rxAirtime_us += frame_us;
+  xSemaphoreGive(schedule_lock);
+}
+
+void tx_scheduler_collect(TxRadioStats *stats, int64_t *window_us) {
+  int64_t now_us = hal_time_us();
+  xSemaphoreTake(schedule_lock, portMAX_DELAY);
+  for (int port = 0; port < RADIO_COUNT; port++) {
+    stats[port] = radioStats[port];
+    radioStats[port] = {};
+  }
+  *window_us = now_us - windowStart_us;
+  windowStart_us = now_us;
+  xSemaphoreGive(schedule_lock);
+}
+
+uint32_t tx_scheduler_uplink_permille(UartPort_t port) {
+  int64_t uplink_us = rylr998_airtime_us(rylr998_getConfig(port), TX_SCHEDULER_UPLINK_BYTES);
+  xSemaphoreTake(schedule_lock, portMAX_DELAY);
+  int64_t busy_us = (int64_t) uplinkCount[port] * uplink_us;
+  int64_t period_us = (int64_t) uplinkPeriod_ms * 1000;
+  xSemaphoreGive(schedule_lock);
+  return (uint32_t) std::min<int64_t>(busy_us * 1000 / period_us, 1000);
+}
+
+size_t tx_scheduler_uplinks_between(UartPort_t port, int64_t from_us, int64_t to_us) {
+  if (to_us <= from_us || from_us < 0) {
+    return 0;
+  }
+  xSemaphoreTake(schedule_lock, portMAX_DELAY);
+  int64_t n = (int64_t) uplinkCount[port];
+  int64_t period_us = (int64_t) uplinkPeriod_ms * 1000;
+  // Slots due in [0, t], whole periods first
+  auto due = [port, n, period_us](int64_t t) {
+    const uint32_t *begin = uplinkSlots[port];
+    int64_t partial = std::upper_bound(begin, begin + n, (uint32_t) (t % period_us / 1000)) - begin;
+    return t / period_us * n + partial;
+  };
+  int64_t count = n == 0 ? 0 : due(to_us) - due(from_us);
+  xSemaphoreGive(schedule_lock);
+  return (size_t) count;
+}
+
+size_t tx_scheduler_format(const TxRadioStats *stats, int64_t window_us, char *buffer, size_t size) {
+  size_t lsus[RADIO_COUNT];
+  xSemaphoreTake(schedule_lock, portMAX_DELAY);
+  for (int port = 0; port < RADIO_COUNT; port++) {
+    lsus[port] = uplinkCount[port];
+  }
+  xSemaphoreGive(schedule_lock);
+  if (window_us <= 0) {
+    window_us = 1;
+  }
+
+  size_t length = snprintf(buffer, size, "%lu", (unsigned long) (window_us / 1000000));
+  for (int port = 0; port < RADIO_COUNT && length < size; port++) {
+    const TxRadioStats& radio = stats[port];
+    uint64_t rxPermille = radio.rxAirtime_us * 1000 / window_us;
+    uint64_t txPermille = radio.airtime_us * 1000 / window_us;
+    length += snprintf(buffer + length, size - length, ";%d,%s,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu", port,
+                       radio_role_name((UartPort_t) port), (unsigned long) lsus[port],
+                       (unsigned long) tx_scheduler_uplink_permille((UartPort_t) port), (unsigned long) radio.rxFrames,
+                       (unsigned long) rxPermille, (unsigned long) radio.frames,
+                       (unsigned long) (radio.airtime_us / 1000), (unsigned long) txPermille,
+                       (unsigned long) radio.deferred, (unsigned long) radio.overlapped, (unsigned long) radio.dropped,
+                       (unsigned long) radio.maxDelay_ms, (unsigned long) std::min<uint64_t>(rxPermille + txPermille, 1000));
+  }
+  return std::min(length, size - 1);
+}
@@ -0,0 +1,125 @@
+/**
+  ******************************************************************************
+  * @authors        : Tomas Gonzalez & Brian Morris
+  * @file           : tx_scheduler.h
+  * @brief          : Places the CU transmissions between the expected uplink
+  *                   slots and keeps each radio within its duty-cycle budget
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 Tomas Gonzalez & Brian Morris
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  */
+
+#ifndef TX_SCHEDULER_H
+#define TX_SCHEDULER_H
+
+/* Includes ------------------------------------------------------------ */
+#include <cstddef>
+#include <cstdint>
+#include "uart.h"
+
+/**
+ * The radios are half duplex, a frame the CU sends while an LSU transmits in
+ * its slot loses that uplink. Every LSU transmits at its slot inside the
+ * period, counted from boot as in the CONFIG package, on its data radio. The
+ * window of a slot spans the time on air of a DATA frame plus a guard on both
+ * sides and only blocks the radio that carries it.
+ *
+ * A frame starts in the first gap that fits it. If no gap comes before its
+ * deadline it goes out as soon as the budget allows and counts as overlapped.
+ * The budget is a token bucket of time on air per radio. A frame that would
+ * wait past its deadline for budget is dropped.
+ */
+
+/* Defines ------------------------------------------------------------- */
+#define TX_SCHEDULER_DUTY_PERMILLE  1000   // Time on air per radio, open as 915 MHz has no duty-cycle rule, 10 for a 1% band
+#define TX_SCHEDULER_BUDGET_MS      60000  // Bucket size, a period's worth of budget can go out in a burst
+#define TX_SCHEDULER_SLOT_GUARD_MS  50     // LSU clock error and UART latency around each slot
+#define TX_SCHEDULER_UPLINK_BYTES   16     // DATA payload the uplink windows are sized for
+#define TX_SCHEDULER_MAX_LEN        256
+#define AIRTIME_STATS_TOPIC         "livestock/cu/airtime"
+
+/* Structs ------------------------------------------------------------- */
+/**
+ * @brief Transmissions of one radio over a stats window
+ */
+struct TxRadioStats {
+  uint32_t frames;       /**< Sent */
+  uint32_t deferred;     /**< Moved to a later gap or held for budget */
+  uint32_t overlapped;   /**< No gap before the deadline, sent over a slot */
+  uint32_t dropped;      /**< Out of budget until past the deadline */
+  uint32_t maxDelay_ms;
+  uint64_t airtime_us;
+  uint32_t rxFrames;     /**< Received from the LSUs */
+  uint64_t rxAirtime_us;
+};
+
+/* Public API ---------------------------------------------------------- */
+/**
+ * @brief Create the schedule lock, must be called before any other function
+ */
+void tx_scheduler_init();
+
+/**
+ * @brief Replace the expected uplink slots of a radio, coordinator only
+ * @param port Radio the uplinks arrive on
+ * @param slots_ms Slot offsets inside the period, sorted
+ * @param count Number of slots, extra ones past MAX_LSU_COUNT are ignored
+ * @param period_ms Fleet period
+ */
+void tx_scheduler_set_uplinks(UartPort_t port, const uint32_t *slots_ms, size_t count, uint32_t period_ms);
+
+/**
+ * @brief Reserve the air for a frame, call right before sending it
+ * @details Frames of one radio must be reserved in the order they are sent
+ * @param port Radio sending it
+ * @param payload_length Bytes of the AT+SEND payload
+ * @param max_delay_ms Deadline, later than this the frame is worthless
+ * @param delay_ms Output, wait this long before sending
+ * @return false if the frame must be dropped
+ */
+bool tx_scheduler_reserve(UartPort_t port, size_t payload_length, uint32_t max_delay_ms, uint32_t *delay_ms);
+
+/**
+ * @brief Count a received frame towards the utilization of its radio
+ * @param port Radio it arrived on
+ * @param payload_length Bytes of the +RCV payload
+ */
+void tx_scheduler_record_rx(UartPort_t port, size_t payload_length);
+
+/**
+ * @brief Counters of both radios since the last collect, starts a new window
+ * @param stats Output, one entry per radio
+ * @param window_us Output, length of the window
+ */
+void tx_scheduler_collect(TxRadioStats *stats, int64_t *window_us);
+
+/**
+ * @brief Share of the period the expected uplinks of a radio take, in permille
+ */
+uint32_t tx_scheduler_uplink_permille(UartPort_t port);
+
+/**
+ * @brief Uplink slots of a radio that came due in (from_us, to_us]
+ * @details Counts slots only, the LSUs drift but keep their rate
+ */
+size_t tx_scheduler_uplinks_between(UartPort_t port, int64_t from_us, int64_t to_us);
+
+/**
+ * @brief Serialize collected counters as "window_s;port,role,lsus,uplink_permille,rx_frames,rx_permille,tx_frames,
+ *        tx_airtime_ms,tx_permille,deferred,overlapped,dropped,max_delay_ms,busy_permille;..."
+ * @details Reads the current plan only, the counters are left alone
+ * @param stats Counters of both radios from tx_scheduler_collect()
+ * @param window_us Window they cover
+ * @param buffer Output
+ * @param size Buffer size, TX_SCHEDULER_MAX_LEN fits both radios
+ * @return Length written
+ */
+size_t tx_scheduler_format(const TxRadioStats *stats, int64_t window_us, char *buffer, size_t size);
+
+#endif /* TX_SCHEDULER_H */
@@ -0,0 +1,163 @@
+/**
+  ******************************************************************************
+  * @authors        : Tomas Gonzalez & Brian Morris
+  * @file           : FleetCoordinator.cpp
+  * @brief          : FleetCoordinator class, fleet-wide state of the sharded
+  *                   registry: ID allocation, slot plan, period and snapshot
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "FleetCoordinator.h"
+
+#include <algorithm>
+#include "esp_log.h"
+#include "hal/hal.h"
+#include "radio_roles.h"
+
+/* Private variables --------------------------------------------------------- */
+static const char *FLEET_COORDINATOR_TAG = "Fleet Coordinator";
+
+/* Function implementations -------------------------------------------------*/
+bool FleetCoordinator::allocate(uint32_t *lsuId, uint32_t *timeSlotInPeriod) {
+    const auto& entries = snapshot.getEntries();
+    if (entries.size() >= MAX_LSU_COUNT) {
+        ESP_LOGE(FLEET_COORDINATOR_TAG, "Failed to allocate LSU. Max LSU count reached.");
+        return false;
+    }
+
+    // Channel and slot together, the new LSU goes to the data channel with the fewest LSUs
+    size_t load[RADIO_COUNT] = {};
+    for (const auto& [id, entry] : entries) {
+        load[radio_data_port(id)]++;
+    }
+    uint32_t id = nextLSUId;
+    UartPort_t channel = radio_data_port(id);
+    UartPort_t other = radio_data_port(id + 1);
+    if (other != channel && load[other] < load[channel]) {
+        id++;
+        channel = other;
+    }
+    nextLSUId = id + 1;
+
+    // The slot plan spans every shard but only its channel, LSUs on the other one never collide with it
+    std::vector<uint32_t> slots;
+    slots.reserve(load[channel]);
+    for (const auto& [otherId, entry] : entries) {
+        if (radio_data_port(otherId) == channel) {
+            slots.push_back(entry.timeSlotInPeriod);
+        }
+    }
+
+    *lsuId = id;
+    *timeSlotInPeriod = lsu_plan_time_slot(slots, periodMs);
+    snapshot.upsert(FleetEntry{*lsuId, *timeSlotInPeriod, hal_time_us(), 0, 0});
+    hal_display_lsu_count(entries.size());
+    ESP_LOGI(FLEET_COORDINATOR_TAG, "Allocated LSU %lu at slot %lu on radio %d", *lsuId, *timeSlotInPeriod, channel);
+    return true;
+}
+
+void FleetCoordinator::rehome(UartPort_t failed, std::vector<FleetEntry> *moved) {
+    const auto& entries = snapshot.getEntries();
+    std::vector<uint32_t> slots;
+    moved->clear();
+    for (const auto& [id, entry] : entries) {
+        if (radio_home_port(id) == failed) {
+            moved->push_back(entry);
+        } else {
+            slots.push_back(entry.timeSlotInPeriod);
+        }
+    }
+    if (moved->empty()) {
+        return;
+    }
+
+    // Half the spacing of an even plan, closer than that the two channels were planned over each other
+    int64_t clearance = periodMs / (2 * entries.size());
+    std::sort(slots.begin(), slots.end());
+    size_t kept = 0;
+    for (FleetEntry& entry : *moved) {
+        // Distance to the nearest slot on either side, around the end of the period
+        int64_t slot = entry.timeSlotInPeriod;
+        int64_t nearest = periodMs;
+        if (!slots.empty()) {
+            auto next = std::lower_bound(slots.begin(), slots.end(), entry.timeSlotInPeriod);
+            int64_t after = next != slots.end() ? *next : (int64_t) slots.front() + periodMs;
+            int64_t before = next != slots.begin() ? *(next - 1) : (int64_t) slots.back() - periodMs;
+            nearest = std::min(after - slot, slot - before);
+        }
+        if (nearest >= clearance) {
+            kept++;
+        } else {
+            entry.timeSlotInPeriod = lsu_plan_time_slot(slots, periodMs);
+            snapshot.upsert(entry);
+        }
+        slots.insert(std::lower_bound(slots.begin(), slots.end(), entry.timeSlotInPeriod), entry.timeSlotInPeriod);
+    }
+    ESP_LOGW(FLEET_COORDINATOR_TAG, "Moved %zu LSUs off radio %d, %zu kept their slot", moved->size(), failed, kept);
+}
+
+bool FleetCoordinator::release(uint32_t lsuId) {
+    if (!contains(lsuId)) {
+        return false;
+    }
+    snapshot.remove(lsuId);
+    hal_display_lsu_count(snapshot.getEntries().size());
+    ESP_LOGI(FLEET_COORDINATOR_TAG, "Released LSU %lu", lsuId);
+    return true;
+}
+
+bool FleetCoordinator::setPeriodMs(uint32_t newPeriodMs) {
+    if (newPeriodMs < LSU_MIN_PERIOD_MS || newPeriodMs > LSU_MAX_PERIOD_MS) {
+        ESP_LOGE(FLEET_COORDINATOR_TAG, "Invalid period: %lu ms", newPeriodMs);
+        return false;
+    }
+
+    // Same scaling as LSUManager::setPeriodMs so the shards agree on every slot
+    std::vector<FleetEntry> rescaled;
+    rescaled.reserve(snapshot.getEntries().size());
+    for (const auto& [id, entry] : snapshot.getEntries()) {
+        FleetEntry scaled = entry;
+        scaled.timeSlotInPeriod = (uint32_t) ((uint64_t) entry.timeSlotInPeriod * newPeriodMs / periodMs);
+        rescaled.push_back(scaled);
+    }
+    for (const auto& entry : rescaled) {
+        snapshot.upsert(entry);
+    }
+
+    ESP_LOGI(FLEET_COORDINATOR_TAG, "Period changed from %lu ms to %lu ms", periodMs, newPeriodMs);
+    periodMs = newPeriodMs;
+    return true;
+}
+
+/* Save/Load functions --------------------------------------------------------- */
+std::vector<LSUData> FleetCoordinator::getLsuSerializedData() const {
+    std::vector<LSUData> lsuDataVector;
+    lsuDataVector.reserve(snapshot.getEntries().size());
+
+    for (const auto& [id, entry] : snapshot.getEntries()) {
+        lsuDataVector.push_back(LSUData{entry.id, entry.timeSlotInPeriod, entry.lastSeen_us});
+    }
+    return lsuDataVector;
+}
+
+bool FleetCoordinator::restoreLsuFromSerializedData(const std::vector<LSUData>& lsuDataVector,
+                                                    int64_t savedTimestamp_us) {
+    snapshot.clear();
+
+    int64_t timeOffset_us = hal_time_us() - savedTimestamp_us;
+    uint32_t maxId = 0x01; // Start with CU address = 0x01
+    for (const auto& data : lsuDataVector) {
+        // Adjust the last connection time by the time offset (can be negative)
+        snapshot.upsert(FleetEntry{data.id, data.timeSlotInPeriod, data.lastConnectionTime_us + timeOffset_us, 0, 0});
+        if (data.id > maxId) {
+            maxId = data.id;
+        }
+    }
+
+    // Update the next ID counter to avoid conflicts
+    nextLSUId = maxId + 1;
+    hal_display_lsu_count(snapshot.getEntries().size());
+    ESP_LOGI(FLEET_COORDINATOR_TAG, "Restored %zu LSUs, next ID %lu", lsuDataVector.size(), nextLSUId);
+    return true;
+}
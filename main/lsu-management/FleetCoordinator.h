@@ -0,0 +1,121 @@
+/**
+  ******************************************************************************
+  * @authors        : Tomas Gonzalez & Brian Morris
+  * @file           : FleetCoordinator.h
+  * @brief          : FleetCoordinator class, fleet-wide state of the sharded
+  *                   registry: ID allocation, slot plan, period and snapshot
+  ******************************************************************************
+  */
+
+#ifndef FLEET_COORDINATOR_H
+#define FLEET_COORDINATOR_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <vector>
+#include <cstdint>
+#include "LSUManager.h"
+#include "FleetSnapshot.h"
+#include "uart.h"
+#include "general_config.h"
+
+/* Class ---------------------------------------------------------------------*/
+/**
+ * Owned by the coordinator shard only. The shards keep the LSU objects and
+ * their timeouts, the coordinator only mirrors what they report by message.
+ */
+class FleetCoordinator {
+  private:
+    FleetSnapshot snapshot;
+    uint32_t nextLSUId;
+    uint32_t periodMs;
+
+  public:
+    // Start at 0x02 to avoid conflict with CU
+    FleetCoordinator() : nextLSUId(0x02), periodMs(TIME_PERIOD_MS) {}
+
+    /**
+     * @brief Allocates an ID and a time slot for a joining LSU
+     * @details The ID picks the data channel, see radio_roles.h, and the slot
+     *          is planned against the LSUs on that channel
+     * @param lsuId Output ID
+     * @param timeSlotInPeriod Output time slot
+     * @return true if allocated, false if the fleet is full
+     */
+    bool allocate(uint32_t *lsuId, uint32_t *timeSlotInPeriod);
+
+    /**
+     * @brief Moves the LSUs of a failed radio onto the other one
+     * @details Call once radio_data_port() sends them to the other radio. An
+     *          LSU keeps its slot if it is clear of the LSUs already there,
+     *          otherwise it gets the middle of the largest gap.
+     * @param failed The radio that failed
+     * @param moved Output, the moved LSUs with their new slots
+     */
+    void rehome(UartPort_t failed, std::vector<FleetEntry> *moved);
+
+    /**
+     * @brief Frees the ID and slot of an LSU removed by its shard
+     * @param lsuId The ID of the LSU
+     * @return true if the LSU was known
+     */
+    bool release(uint32_t lsuId);
+
+    /**
+     * @brief Mirrors a packet seen by the owning shard, never allocates
+     * @param lsuId The ID of the LSU
+     * @param lastSeen_us Time of the packet
+     * @param rssi RSSI in dBm
+     * @param snr SNR in dB
+     */
+    void touch(uint32_t lsuId, int64_t lastSeen_us, int16_t rssi, int8_t snr) {
+      snapshot.touch(lsuId, lastSeen_us, rssi, snr);
+    }
+
+    /**
+     * @brief Checks whether an LSU is part of the fleet
+     * @param lsuId The ID of the LSU
+     * @return true if known
+     */
+    bool contains(uint32_t lsuId) const { return snapshot.getEntries().count(lsuId) != 0; }
+
+    /**
+     * @brief Changes the period, rescaling the slot plan the same way the shards do
+     * @param newPeriodMs The new period, between LSU_MIN_PERIOD_MS and LSU_MAX_PERIOD_MS
+     * @return true if the period was changed, false if out of range
+     */
+    bool setPeriodMs(uint32_t newPeriodMs);
+
+    /**
+     * @brief Gets the period (in ms) in which every LSU sends data
+     * @return The current period
+     */
+    uint32_t getPeriodMs() const { return periodMs; }
+
+    /**
+     * @brief Gets the number of LSUs in the fleet, across every shard
+     * @return The count of connected LSUs
+     */
+    size_t getLSUCount() const { return snapshot.getEntries().size(); }
+
+    /**
+     * @brief Gets the fleet snapshot
+     * @return Reference to the snapshot
+     */
+    FleetSnapshot& getSnapshot() { return snapshot; }
+
+    /**
+     * @brief Gets the fleet in the NVS format
+     * @return Vector of LSUData, last connection from the latest touch
+     */
+    std::vector<LSUData> getLsuSerializedData() const;
+
+    /**
+     * @brief Restores the fleet from NVS, the caller hands every LSU to its shard
+     * @param lsuDataVector Vector of LSUData to restore
+     * @param savedTimestamp_us Timestamp when data was saved (for time offset calculation)
+     * @return true if restore was successful, false otherwise
+     */
+    bool restoreLsuFromSerializedData(const std::vector<LSUData>& lsuDataVector, int64_t savedTimestamp_us = 0);
+};
+
+#endif /* FLEET_COORDINATOR_H */
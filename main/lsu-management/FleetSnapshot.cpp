@@ -0,0 +1,78 @@
+/**
+  ******************************************************************************
+  * @authors        : Tomas Gonzalez & Brian Morris
+  * @file           : FleetSnapshot.cpp
+  * @brief          : FleetSnapshot class, compact view of every connected LSU
+  *                   kept in sync with the LSUManager and published retained
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "FleetSnapshot.h"
+
+#include <cstdio>
+
+/* Function implementations -------------------------------------------------*/
+void FleetSnapshot::upsert(const FleetEntry& entry) {
+    entries[entry.id] = entry;
+    membershipChanged = true;
+    version++;
+}
+
+void FleetSnapshot::remove(uint32_t lsuId) {
+    if (entries.erase(lsuId) > 0) {
+        membershipChanged = true;
+        version++;
+    }
+}
+
+void FleetSnapshot::clear() {
+    entries.clear();
+    membershipChanged = true;
+    version++;
+}
+
+void FleetSnapshot::touch(uint32_t lsuId, int64_t lastSeen_us, int16_t rssi, int8_t snr) {
+    auto it = entries.find(lsuId);
+    if (it == entries.end()) {
+        return;
+    }
+    it->second.lastSeen_us = lastSeen_us;
+    it->second.rssi = rssi;
+    it->second.snr = snr;
+    dataChanged = true;
+    version++;
+}
+
+bool FleetSnapshot::isPublishDue(int64_t now_us) const {
+    int64_t sinceLastPublish_us = now_us - lastPublish_us;
+    if (membershipChanged) {
+        return sinceLastPublish_us >= FLEET_SNAPSHOT_MIN_INTERVAL_US;
+    }
+    return dataChanged && sinceLastPublish_us >= FLEET_SNAPSHOT_THROTTLE_US;
+}
+
+const std::string& FleetSnapshot::serialize(int64_t now_us, uint32_t periodMs) {
+    char row[FLEET_SNAPSHOT_ROW_MAX_LEN];
+
+    // Reuse the buffer capacity from previous publishes
+    payload.clear();
+    payload.reserve((entries.size() + 1) * FLEET_SNAPSHOT_ROW_MAX_LEN);
+
+    snprintf(row, sizeof(row), "%lu,%u,%lld", (unsigned long) periodMs,
+             (unsigned) entries.size(), (long long) (now_us / 1000000));
+    payload += row;
+
+    for (const auto& pair : entries) {
+        const FleetEntry& entry = pair.second;
+        int64_t age_s = (now_us - entry.lastSeen_us) / 1000000;
+        snprintf(row, sizeof(row), ";%lu,%lu,%lld,%d,%d", (unsigned long) entry.id,
+                 (unsigned long) entry.timeSlotInPeriod, (long long) age_s, entry.rssi, entry.snr);
+        payload += row;
+    }
+
+    membershipChanged = false;
+    dataChanged = false;
+    lastPublish_us = now_us;
+    return payload;
+}
@@ -0,0 +1,109 @@
+/**
+  ******************************************************************************
+  * @authors        : Tomas Gonzalez & Brian Morris
+  * @file           : FleetSnapshot.h
+  * @brief          : FleetSnapshot class, compact view of every connected LSU
+  *                   kept in sync with the LSUManager and published retained
+  ******************************************************************************
+  */
+
+#ifndef FLEET_SNAPSHOT_H
+#define FLEET_SNAPSHOT_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <map>
+#include <string>
+#include <cstdint>
+
+/* Macros -------------------------------------------------------------------*/
+#define FLEET_SNAPSHOT_TOPIC "livestock/cu/fleet"
+#define FLEET_SNAPSHOT_MIN_INTERVAL_US 1000000   // Coalesce membership bursts (1 second)
+#define FLEET_SNAPSHOT_THROTTLE_US 30000000      // Link/age only changes (30 seconds)
+#define FLEET_SNAPSHOT_ROW_MAX_LEN 48
+
+/* Structs -------------------------------------------------------------------*/
+struct FleetEntry {
+  uint32_t id;
+  uint32_t timeSlotInPeriod;
+  int64_t lastSeen_us;
+  int16_t rssi;  // dBm, 0 when unknown
+  int8_t snr;    // dB
+};
+
+/* Class ---------------------------------------------------------------------*/
+class FleetSnapshot {
+  private:
+    std::map<uint32_t, FleetEntry> entries;
+    std::string payload;
+    bool membershipChanged;
+    bool dataChanged;
+    int64_t lastPublish_us;
+    uint32_t version;
+
+  public:
+    FleetSnapshot() : membershipChanged(true), dataChanged(false), lastPublish_us(0), version(0) {}
+
+    /**
+     * @brief Adds or replaces an LSU (join, restore, slot change)
+     * @param entry The LSU state
+     */
+    void upsert(const FleetEntry& entry);
+
+    /**
+     * @brief Removes an LSU (manual removal or timeout)
+     * @param lsuId The ID of the LSU to remove
+     */
+    void remove(uint32_t lsuId);
+
+    /**
+     * @brief Removes every LSU
+     */
+    void clear();
+
+    /**
+     * @brief Updates last-seen time and link quality of an LSU, never allocates
+     * @param lsuId The ID of the LSU
+     * @param lastSeen_us Time of the last packet
+     * @param rssi Last RSSI in dBm
+     * @param snr Last SNR in dB
+     */
+    void touch(uint32_t lsuId, int64_t lastSeen_us, int16_t rssi, int8_t snr);
+
+    /**
+     * @brief Forces a publish on the next check, e.g. after reconnecting to the broker
+     */
+    void invalidate() { membershipChanged = true; }
+
+    /**
+     * @brief Checks whether the snapshot should be published now
+     * @details Membership changes are published within FLEET_SNAPSHOT_MIN_INTERVAL_US,
+     *          other changes at most every FLEET_SNAPSHOT_THROTTLE_US
+     * @param now_us Current time
+     * @return true if a publish is due
+     */
+    bool isPublishDue(int64_t now_us) const;
+
+    /**
+     * @brief Serializes the snapshot and marks it as published
+     * @details Header "period_ms,count,uptime_s" then one "id,slot_ms,age_s,rssi,snr"
+     *          row per LSU, separated by ';'
+     * @param now_us Current time, used for the ages
+     * @param periodMs Current period
+     * @return The payload, valid until the next call
+     */
+    const std::string& serialize(int64_t now_us, uint32_t periodMs);
+
+    /**
+     * @brief Gets the entries, ordered by ID
+     * @return The entries
+     */
+    const std::map<uint32_t, FleetEntry>& getEntries() const { return entries; }
+
+    /**
+     * @brief Gets a counter bumped on every change, lets other views skip unchanged copies
+     * @return The version
+     */
+    uint32_t getVersion() const { return version; }
+};
+
+#endif /* FLEET_SNAPSHOT_H */
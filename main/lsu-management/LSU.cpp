@@ -7,8 +7,28 @@
   */
 
 #include "LSU.h"
-#include "esp_timer.h"
 
-LSU::LSU(uint32_t lsuId, uint32_t timeSlotInPeriod) : id(lsuId), timeSlotInPeriod(timeSlotInPeriod) {
-  lastConnectionTime_us = esp_timer_get_time();
+#include <cstdio>
+#include "hal/hal.h"
+
+/* Private variables --------------------------------------------------------- */
+static const char *topicSuffixes[LSU_TOPIC_COUNT] = {
+  "data",
+  "link",
+  "alert"
+};
+
+/* Function implementations -------------------------------------------------*/
+void lsu_format_topic(char *buff, size_t size, uint32_t lsuId, LSUTopic topic) {
+  snprintf(buff, size, LSU_TOPIC_PREFIX "%lu/%s", (unsigned long) lsuId, topicSuffixes[topic]);
+}
+
+LSU::LSU(uint32_t lsuId, uint32_t timeSlotInPeriod) : id(lsuId), timeSlotInPeriod(timeSlotInPeriod), rssi(0), snr(0) {
+  lastConnectionTime_us = hal_time_us();
+  adr_link_init(link);
+
+  // Intern the topics once so that publishing never builds strings
+  for (int topic = 0; topic < LSU_TOPIC_COUNT; topic++) {
+    lsu_format_topic(topics[topic], LSU_TOPIC_MAX_LEN, lsuId, (LSUTopic) topic);
+  }
 }
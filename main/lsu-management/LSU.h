@@ -9,21 +9,59 @@
 #ifndef LSU_H
 #define LSU_H
 
+#include <cstddef>
 #include <cstdint>
+#include "adr.h"
 
+/* Macros -------------------------------------------------------------------*/
+#define LSU_TOPIC_PREFIX "livestock/"
+#define LSU_TOPIC_MAX_LEN 32 // "livestock/" + 10 digit ID + "/alert" + '\0'
+
+/* Enums ---------------------------------------------------------------------*/
+enum LSUTopic {
+  LSU_TOPIC_DATA,
+  LSU_TOPIC_LINK,
+  LSU_TOPIC_ALERT,
+  LSU_TOPIC_COUNT
+};
+
+/**
+ * @brief Formats the MQTT topic of an LSU for the given event class
+ * @param buff Destination buffer (at least LSU_TOPIC_MAX_LEN bytes)
+ * @param size Size of the destination buffer
+ * @param lsuId ID of the LSU
+ * @param topic Event class of the topic
+ */
+void lsu_format_topic(char *buff, size_t size, uint32_t lsuId, LSUTopic topic);
+
+/* Class ---------------------------------------------------------------------*/
 class LSU {
   private:
     uint32_t id;
     uint32_t timeSlotInPeriod;
     int64_t lastConnectionTime_us; // Microseconds since boot (can be negative)
+    int16_t rssi; // dBm of the last packet, 0 when unknown
+    int8_t snr;   // dB of the last packet
+    AdrLink link; // Averaged link quality and the settings the LSU was told
+    char topics[LSU_TOPIC_COUNT][LSU_TOPIC_MAX_LEN]; // Built once, publishes reference them
 
   public:
     LSU(uint32_t lsuId, uint32_t timeSlotInPeriod);
 
     uint32_t getId() const {return id;};
     uint32_t getTimeSlotInPeriod() const {return timeSlotInPeriod;};
-    int64_t getLastConnectionTime() { return lastConnectionTime_us; };
+    void setTimeSlotInPeriod(uint32_t timeSlot) { timeSlotInPeriod = timeSlot; };
+    int64_t getLastConnectionTime() const { return lastConnectionTime_us; };
     void setLastConnectionTime(int64_t time_us) { lastConnectionTime_us = time_us; };
+    int16_t getRssi() const { return rssi; };
+    int8_t getSnr() const { return snr; };
+    void setLinkQuality(int16_t lastRssi, int8_t lastSnr) {
+      rssi = lastRssi;
+      snr = lastSnr;
+      adr_link_sample(link, lastRssi, lastSnr);
+    };
+    AdrLink& getLink() { return link; };
+    const char* getTopic(LSUTopic topic) const { return topics[topic]; };
 };
 
 #endif /* LSU_H */
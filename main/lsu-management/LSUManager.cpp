@@ -11,57 +11,65 @@
 
 #include <algorithm>
 #include <string>
-#include "esp_timer.h"
+#include "hal/hal.h"
 
 #include "LSU.h"
 #include "general_config.h"
 #include "esp_log.h"
-#include "display/status.h"
 
 /* Private variables --------------------------------------------------------- */
 static const char *LSU_MANAGER_TAG = "LSU Manager";
 
 /* Helper functions ----------------------------------------------------------*/
+LSUManager::~LSUManager() {
+    for (const auto& pair : connectedLSUs) {
+        delete pair.second;
+    }
+}
+
 uint32_t LSUManager::generateLSUId() {
     ESP_LOGI(LSU_MANAGER_TAG, "Generating LSU ID: %lu", nextLSUId);
     return nextLSUId++;
 }
 
-uint32_t LSUManager::generateTimeSlot() {
+uint32_t lsu_plan_time_slot(std::vector<uint32_t>& slots, uint32_t periodMs) {
     // If no LSUs exist, start with slot 0
-    if (connectedLSUs.empty()) {
+    if (slots.empty()) {
         return 0;
     }
-
-    std::vector<uint32_t> existingSlots;
-    for (const auto& lsu : connectedLSUs) {
-        existingSlots.push_back(lsu.second->getTimeSlotInPeriod());
-    }
-    std::sort(existingSlots.begin(), existingSlots.end());
+    std::sort(slots.begin(), slots.end());
     
     // Find the largest gap in the circular period
     uint32_t maxGap = 0;
     uint32_t bestSlot = -1;
-    uint32_t n = existingSlots.size();
+    uint32_t n = slots.size();
     for (uint32_t index = 0; index < n; index++) {
-        uint32_t current = existingSlots[index];
-        uint32_t next = existingSlots[(index + 1) % n];
+        uint32_t current = slots[index];
+        uint32_t next = slots[(index + 1) % n];
         
         // Handle circular wrap-around
         uint32_t gap = (next - current);
         if (index == n - 1) {
-            gap += TIME_PERIOD_MS;
+            gap += periodMs;
         }
         
         if (gap > maxGap) {
             maxGap = gap;
-            bestSlot = (current + gap / 2) % TIME_PERIOD_MS;
+            bestSlot = (current + gap / 2) % periodMs;
         }
     }
     ESP_LOGI(LSU_MANAGER_TAG, "Generating time slot: %lu", bestSlot);
     return bestSlot;
 }
 
+uint32_t LSUManager::generateTimeSlot() {
+    std::vector<uint32_t> existingSlots;
+    for (const auto& lsu : connectedLSUs) {
+        existingSlots.push_back(lsu.second->getTimeSlotInPeriod());
+    }
+    return lsu_plan_time_slot(existingSlots, periodMs);
+}
+
 void LSUManager::updateNextIdCounter() {
     uint32_t maxId = 0x01; // Start with CU address = 0x01
     for (const auto& pair : connectedLSUs) {
@@ -75,6 +83,30 @@ void LSUManager::updateNextIdCounter() {
     ESP_LOGI(LSU_MANAGER_TAG, "Updated next ID counter to start from %lu", nextLSUId);
 }
 
+FleetEntry LSUManager::toFleetEntry(const LSU* lsu) {
+    return FleetEntry{
+        lsu->getId(),
+        lsu->getTimeSlotInPeriod(),
+        lsu->getLastConnectionTime(),
+        lsu->getRssi(),
+        lsu->getSnr()
+    };
+}
+
+bool LSUManager::insertLSU(LSU* lsu) {
+    auto result = connectedLSUs.insert(std::make_pair(lsu->getId(), lsu));
+    if (!result.second) {
+        return false;
+    }
+    snapshot.upsert(toFleetEntry(lsu));
+
+    // Add timeout event for the new LSU (two whole periods)
+    int64_t timeoutTime_us = lsu->getLastConnectionTime() + LSU_TIMEOUT_US(periodMs) + LSU_TIMEOUT_PADDING_US;
+    TimeoutEvent event = {lsu->getId(), timeoutTime_us};
+    timeoutQueue.push(event);
+    return true;
+}
+
 /* Function implementations -------------------------------------------------*/
 std::pair<LSU*, bool> LSUManager::createLSU() {
     if (connectedLSUs.size() >= MAX_LSU_COUNT) {
@@ -86,21 +118,43 @@ std::pair<LSU*, bool> LSUManager::createLSU() {
     uint32_t timeSlotInPeriod = generateTimeSlot();
     LSU* newLSU = new LSU(lsuId, timeSlotInPeriod);
     
-    auto result = connectedLSUs.insert(std::make_pair(lsuId, newLSU));
-    update_lsu_count(connectedLSUs.size());
-    
-    if (result.second) {
-        // Add timeout event for the new LSU (two whole periods)
-        int64_t currentTime_us = esp_timer_get_time();
-        int64_t timeoutTime_us = currentTime_us + LSU_TIMEOUT_US + LSU_TIMEOUT_PADDING_US;
-        TimeoutEvent event = {lsuId, timeoutTime_us};
-        timeoutQueue.push(event);
+    if (insertLSU(newLSU)) {
         return std::make_pair(newLSU, true);
     }
     
+    delete newLSU;
     return std::make_pair(nullptr, false); // Insert failed
 }
 
+LSU* LSUManager::adoptLSU(uint32_t lsuId, uint32_t timeSlotInPeriod, int64_t lastConnectionTime_us) {
+    if (connectedLSUs.size() >= MAX_LSU_COUNT) {
+        ESP_LOGE(LSU_MANAGER_TAG, "Failed to adopt LSU %lu. Max LSU count reached.", lsuId);
+        return nullptr;
+    }
+
+    LSU* lsu = new LSU(lsuId, timeSlotInPeriod);
+    lsu->setLastConnectionTime(lastConnectionTime_us);
+    if (!insertLSU(lsu)) {
+        ESP_LOGW(LSU_MANAGER_TAG, "LSU %lu already managed", lsuId);
+        delete lsu;
+        return nullptr;
+    }
+
+    // Keep locally generated IDs clear of adopted ones
+    if (lsuId >= nextLSUId) {
+        nextLSUId = lsuId + 1;
+    }
+    return lsu;
+}
+
+LSU* LSUManager::restoreLSU(uint32_t lsuId, uint32_t timeSlotInPeriod, int64_t lastConnectionTime_us) {
+    LSU* lsu = adoptLSU(lsuId, timeSlotInPeriod, lastConnectionTime_us);
+    if (lsu != nullptr) {
+        adr_link_restore(lsu->getLink());
+    }
+    return lsu;
+}
+
 bool LSUManager::removeLSU(uint32_t lsuId) {
     auto it = connectedLSUs.find(lsuId);
     if (it != connectedLSUs.end()) {
@@ -108,20 +162,34 @@ bool LSUManager::removeLSU(uint32_t lsuId) {
         uint32_t lsu_id = it->second->getId();
         
         // Publish device removal notification to MQTT
-        std::string topic = "livestock/" + std::to_string(lsu_id) + "/alert";
         std::string payload = "Device manually removed - ID: " + std::to_string(lsu_id);
-        extern void mqtt_api_publish(const char *topic, const char *payload);
-        mqtt_api_publish(topic.c_str(), payload.c_str());
+        hal_publish(it->second->getTopic(LSU_TOPIC_ALERT), payload.c_str(), false);
         
         ESP_LOGI(LSU_MANAGER_TAG, "Published device removal notification to MQTT for LSU %lu", lsu_id);
         
+        delete it->second;
         connectedLSUs.erase(it);
-        update_lsu_count(connectedLSUs.size());
+        snapshot.remove(lsuId);
+        if (removedCallback != nullptr) {
+            removedCallback(lsuId, removedContext);
+        }
         return true;
     }
     return false; // LSU not found
 }
 
+bool LSUManager::moveLSU(uint32_t lsuId, uint32_t timeSlotInPeriod) {
+    LSU* lsu = getLSU(lsuId);
+    if (lsu == nullptr) {
+        return false;
+    }
+    lsu->setTimeSlotInPeriod(timeSlotInPeriod);
+    // The other radio hears the LSU through another antenna, the old average says nothing about it
+    adr_link_init(lsu->getLink());
+    snapshot.upsert(toFleetEntry(lsu));
+    return true;
+}
+
 LSU* LSUManager::getLSU(uint32_t lsuId) {
     auto it = connectedLSUs.find(lsuId);
     if (it != connectedLSUs.end()) {
@@ -130,23 +198,23 @@ LSU* LSUManager::getLSU(uint32_t lsuId) {
     return nullptr; // LSU not found
 }
 
-bool LSUManager::keepaliveLSU(uint32_t lsuId) {
+bool LSUManager::keepaliveLSU(uint32_t lsuId, int16_t rssi, int8_t snr) {
     LSU* lsu = getLSU(lsuId);
 
     if (lsu != nullptr) {
-        int64_t currentTime_us = esp_timer_get_time();
+        // The pending timeout event is re-armed by processTimeouts(), so a
+        // keepalive only touches the LSU and never grows the timeout queue
+        int64_t currentTime_us = hal_time_us();
         lsu->setLastConnectionTime(currentTime_us);
-
-        int64_t timeoutTime_us = currentTime_us + LSU_TIMEOUT_US + LSU_TIMEOUT_PADDING_US;
-        TimeoutEvent event = {lsuId, timeoutTime_us};
-        timeoutQueue.push(event);
+        lsu->setLinkQuality(rssi, snr);
+        snapshot.touch(lsuId, currentTime_us, rssi, snr);
         return true;
     }
     return false; // LSU not found
 }
 
 void LSUManager::processTimeouts() {
-    int64_t currentTime_us = esp_timer_get_time();
+    int64_t currentTime_us = hal_time_us();
 
     while (!timeoutQueue.empty() && timeoutQueue.top().timeoutTime <= currentTime_us) {
         TimeoutEvent event = timeoutQueue.top();
@@ -158,28 +226,53 @@ void LSUManager::processTimeouts() {
             int64_t lastConnectionTime_us = lsu->getLastConnectionTime();
             int64_t timeSinceConnection_us = currentTime_us - lastConnectionTime_us;
             
-            if (timeSinceConnection_us >= LSU_TIMEOUT_US) {
+            if (timeSinceConnection_us >= LSU_TIMEOUT_US(periodMs)) {
                 // LSU has timed out, send alert and remove it
                 uint32_t lsu_id = lsu->getId();
                 
                 // Send timeout alert to MQTT
-                std::string topic = "livestock/" + std::to_string(lsu_id) + "/alert";
                 std::string payload = "ALERT: Device timeout - LSU " + std::to_string(lsu_id) + 
-                                      " has not communicated for " + std::to_string(LSU_TIMEOUT_US/1000000) + " seconds";
-                extern void mqtt_api_publish(const char *topic, const char *payload);
-                mqtt_api_publish(topic.c_str(), payload.c_str());
+                                      " has not communicated for " + std::to_string(LSU_TIMEOUT_US(periodMs)/1000000) + " seconds";
+                hal_publish(lsu->getTopic(LSU_TOPIC_ALERT), payload.c_str(), false);
                 
                 ESP_LOGW(LSU_MANAGER_TAG, "LSU %lu timed out after %lu seconds - removed and alert sent", 
-                         lsu_id, (uint32_t) LSU_TIMEOUT_US/1000000);
+                         lsu_id, (uint32_t) (LSU_TIMEOUT_US(periodMs)/1000000));
                 
                 // Remove the LSU
+                delete lsu;
                 connectedLSUs.erase(event.lsuId);
-                update_lsu_count(connectedLSUs.size());
+                snapshot.remove(event.lsuId);
+                if (removedCallback != nullptr) {
+                    removedCallback(event.lsuId, removedContext);
+                }
+            } else {
+                // LSU kept alive since the event was queued, re-arm its timeout
+                TimeoutEvent rearmed = {event.lsuId, lastConnectionTime_us + LSU_TIMEOUT_US(periodMs) + LSU_TIMEOUT_PADDING_US};
+                timeoutQueue.push(rearmed);
             }
         }
     }
 }
 
+bool LSUManager::setPeriodMs(uint32_t newPeriodMs) {
+    if (newPeriodMs < LSU_MIN_PERIOD_MS || newPeriodMs > LSU_MAX_PERIOD_MS) {
+        ESP_LOGE(LSU_MANAGER_TAG, "Invalid period: %lu ms", newPeriodMs);
+        return false;
+    }
+
+    // Keep the relative position of every slot inside the period
+    for (const auto& pair : connectedLSUs) {
+        LSU* lsu = pair.second;
+        uint64_t scaledSlot = (uint64_t) lsu->getTimeSlotInPeriod() * newPeriodMs / periodMs;
+        lsu->setTimeSlotInPeriod((uint32_t) scaledSlot);
+        snapshot.upsert(toFleetEntry(lsu));
+    }
+
+    ESP_LOGI(LSU_MANAGER_TAG, "Period changed from %lu ms to %lu ms", periodMs, newPeriodMs);
+    periodMs = newPeriodMs;
+    return true;
+}
+
 /* Save/Load functions --------------------------------------------------------- */
 std::vector<LSUData> LSUManager::getLsuSerializedData() const {
     std::vector<LSUData> lsuDataVector;
@@ -199,28 +292,34 @@ std::vector<LSUData> LSUManager::getLsuSerializedData() const {
 
 bool LSUManager::restoreLsuFromSerializedData(const std::vector<LSUData>& lsuDataVector, int64_t savedTimestamp_us) {
     // Clear existing LSUs first
+    for (const auto& pair : connectedLSUs) {
+        delete pair.second;
+    }
     connectedLSUs.clear();
+    snapshot.clear();
     while (!timeoutQueue.empty()) {
         timeoutQueue.pop();
     }
     
     // Calculate time offset in microseconds if we have a saved timestamp
-    int64_t currentTime_us = esp_timer_get_time();
+    int64_t currentTime_us = hal_time_us();
     int64_t timeOffset_us = currentTime_us - savedTimestamp_us;
     ESP_LOGI(LSU_MANAGER_TAG, "Time offset calculated: %lld microseconds since save", timeOffset_us);
     
     // Restore LSUs from loaded data
     for (const auto& data : lsuDataVector) {
         LSU* lsu = new LSU(data.id, data.timeSlotInPeriod);
+        adr_link_restore(lsu->getLink());
         
         // Adjust the last connection time by the time offset (can be negative)
         int64_t adjustedLastConnection_us = data.lastConnectionTime_us + timeOffset_us;
         lsu->setLastConnectionTime(adjustedLastConnection_us);
         
         connectedLSUs.insert(std::make_pair(data.id, lsu));
+        snapshot.upsert(toFleetEntry(lsu));
         
         // Add timeout event for the restored LSU
-        int64_t timeoutTime_us = adjustedLastConnection_us + LSU_TIMEOUT_US + LSU_TIMEOUT_PADDING_US;
+        int64_t timeoutTime_us = adjustedLastConnection_us + LSU_TIMEOUT_US(periodMs) + LSU_TIMEOUT_PADDING_US;
         TimeoutEvent event = {data.id, timeoutTime_us};
         timeoutQueue.push(event);
         
@@ -228,8 +327,6 @@ bool LSUManager::restoreLsuFromSerializedData(const std::vector<LSUData>& lsuDat
                  data.id, data.timeSlotInPeriod, adjustedLastConnection_us, timeOffset_us);
     }
     
-    update_lsu_count(connectedLSUs.size());
-    
     // Update the next ID counter to avoid conflicts
     updateNextIdCounter();
     
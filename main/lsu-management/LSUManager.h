@@ -15,12 +15,15 @@
 #include <vector>
 #include <functional>
 #include <cstdint>
-#include "esp_timer.h"
+#include "hal/hal.h"
 #include "LSU.h"
+#include "FleetSnapshot.h"
 #include "general_config.h"
 
 /* Macros -------------------------------------------------------------------*/
-#define LSU_TIMEOUT_US (2 * TIME_PERIOD_MS * 1000)  // Two whole periods in microseconds
+#define LSU_TIMEOUT_US(period_ms) (2 * (int64_t)(period_ms) * 1000)  // Two whole periods in microseconds
+#define LSU_MIN_PERIOD_MS 10000    // 10 seconds
+#define LSU_MAX_PERIOD_MS 3600000  // 1 hour
 #define LSU_TIMEOUT_PADDING_US 1000000 // 1 second
 
 /* Structs -------------------------------------------------------------------*/
@@ -42,6 +45,16 @@ struct LSUData {
 /* Typedefs ------------------------------------------------------------------*/
 typedef std::map<uint32_t, LSU*> LSUMap;
 typedef std::priority_queue<TimeoutEvent, std::vector<TimeoutEvent>, std::greater<TimeoutEvent>> TimeoutQueue;
+typedef void (*LSURemovedCallback)(uint32_t lsuId, void *context);
+
+/* Function declarations -----------------------------------------------------*/
+/**
+ * @brief Picks the middle of the largest free gap in the circular period
+ * @param slots Slots already assigned, sorted in place
+ * @param periodMs The period
+ * @return Time slot for a new LSU
+ */
+uint32_t lsu_plan_time_slot(std::vector<uint32_t>& slots, uint32_t periodMs);
 
 /* Class ---------------------------------------------------------------------*/
 class LSUManager {
@@ -49,6 +62,10 @@ class LSUManager {
     LSUMap connectedLSUs;
     TimeoutQueue timeoutQueue;
     uint32_t nextLSUId;
+    uint32_t periodMs;
+    FleetSnapshot snapshot;
+    LSURemovedCallback removedCallback;
+    void *removedContext;
     
     /**
      * @brief Generates a unique ID for a new LSU
@@ -67,8 +84,28 @@ class LSUManager {
      */
     void updateNextIdCounter();
 
+    /**
+     * @brief Builds the snapshot entry of an LSU
+     * @param lsu The LSU
+     * @return Snapshot entry
+     */
+    static FleetEntry toFleetEntry(const LSU* lsu);
+
+    /**
+     * @brief Inserts an LSU and arms its timeout
+     * @param lsu The LSU, owned by the manager from now on
+     * @return true if inserted, false if the ID is already in use
+     */
+    bool insertLSU(LSU* lsu);
+
   public:
-    LSUManager() : nextLSUId(0x02) {} // Start at 0x02 to avoid conflict with CU
+    // Start at 0x02 to avoid conflict with CU
+    LSUManager() : nextLSUId(0x02), periodMs(TIME_PERIOD_MS), removedCallback(nullptr), removedContext(nullptr) {}
+    ~LSUManager();
+
+    // Owns its LSUs, a copy would free them twice
+    LSUManager(const LSUManager&) = delete;
+    LSUManager& operator=(const LSUManager&) = delete;
 
     /**
      * @brief Creates and adds a new LSU to the system
@@ -76,6 +113,34 @@ class LSUManager {
      */
     std::pair<LSU*, bool> createLSU();
 
+    /**
+     * @brief Takes ownership of an LSU whose ID and slot were assigned elsewhere
+     * @param lsuId The ID of the LSU
+     * @param timeSlotInPeriod The assigned time slot
+     * @param lastConnectionTime_us Time of the last packet, e.g. restored from NVS
+     * @return Pointer to the LSU, nullptr if the ID is in use or the manager is full
+     */
+    LSU* adoptLSU(uint32_t lsuId, uint32_t timeSlotInPeriod, int64_t lastConnectionTime_us);
+
+    /**
+     * @brief Adopts an LSU restored from NVS, its link settings are resent on its next uplink
+     * @param lsuId The ID of the LSU
+     * @param timeSlotInPeriod The saved time slot
+     * @param lastConnectionTime_us Time of the last packet, aged by the time since the save
+     * @return Pointer to the LSU, nullptr if the ID is in use or the manager is full
+     */
+    LSU* restoreLSU(uint32_t lsuId, uint32_t timeSlotInPeriod, int64_t lastConnectionTime_us);
+
+    /**
+     * @brief Sets a callback run whenever an LSU is removed or times out
+     * @param callback The callback, nullptr to disable
+     * @param context Passed back to the callback
+     */
+    void setRemovedCallback(LSURemovedCallback callback, void *context) {
+      removedCallback = callback;
+      removedContext = context;
+    }
+
     /**
      * @brief Removes an LSU from the system by its ID
      * @param lsuId The ID of the LSU to remove
@@ -83,6 +148,14 @@ class LSUManager {
      */
     bool removeLSU(uint32_t lsuId);
 
+    /**
+     * @brief Gives an LSU a new slot on another radio, its link starts over
+     * @param lsuId The ID of the LSU
+     * @param timeSlotInPeriod The new time slot
+     * @return true if the LSU was found
+     */
+    bool moveLSU(uint32_t lsuId, uint32_t timeSlotInPeriod);
+
     /**
      * @brief Gets an LSU by its ID
      * @param lsuId The ID of the LSU to retrieve
@@ -91,11 +164,13 @@ class LSUManager {
     LSU* getLSU(uint32_t lsuId);
 
     /**
-     * @brief Updates the last connection time for an LSU
+     * @brief Updates the last connection time and link quality for an LSU
      * @param lsuId The ID of the LSU to update
+     * @param rssi RSSI of the received packet in dBm
+     * @param snr SNR of the received packet in dB
      * @return true if LSU was updated successfully, false if not found
      */
-    bool keepaliveLSU(uint32_t lsuId);
+    bool keepaliveLSU(uint32_t lsuId, int16_t rssi, int8_t snr);
 
     /**
      * @brief Processes timeout events and removes timed-out LSUs
@@ -108,6 +183,26 @@ class LSUManager {
      */
     size_t getLSUCount() const { return connectedLSUs.size(); }
 
+    /**
+     * @brief Gets the period (in ms) in which every LSU sends data
+     * @return The current period
+     */
+    uint32_t getPeriodMs() const { return periodMs; }
+
+    /**
+     * @brief Changes the period, rescaling the assigned time slots to keep their spacing
+     * @details The caller sends the connected LSUs their rescaled slots
+     * @param newPeriodMs The new period, between LSU_MIN_PERIOD_MS and LSU_MAX_PERIOD_MS
+     * @return true if the period was changed, false if out of range
+     */
+    bool setPeriodMs(uint32_t newPeriodMs);
+
+    /**
+     * @brief Gets the fleet snapshot, kept in sync with every change
+     * @return Reference to the snapshot
+     */
+    FleetSnapshot& getSnapshot() { return snapshot; }
+
     /**
      * @brief Gets a list of all LSU data for debugging/monitoring
      * @return Vector of LSUData containing all LSU information
@@ -9,173 +9,132 @@
 /* Includes ------------------------------------------------------------------*/
 #include "lsu_nvs_persistence.h"
 #include "LSUManager.h"
+#include "FleetCoordinator.h"
 #include "LSU.h"
 #include "general_config.h"
 #include "esp_log.h"
-#include "esp_timer.h"
-#include "nvs.h"
-#include "nvs_flash.h"
+#include "hal/hal.h"
 
 /* Private variables --------------------------------------------------------- */
 static const char *LSU_NVS_TAG = "LSU NVS";
 
-/* Function implementations --------------------------------------------------*/
-bool lsu_nvs_save(LSUManager& manager) {
-    nvs_handle_t nvs_handle;
-    esp_err_t err;
-    
-    // Open NVS handle
-    err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
-    if (err != ESP_OK) {
-        ESP_LOGE(LSU_NVS_TAG, "Error opening NVS handle: %s", esp_err_to_name(err));
-        return false;
-    }
-    
-    // Get LSU data from manager
-    std::vector<LSUData> lsuDataVector = manager.getLsuSerializedData();
-    
-    // Save timestamp snapshot (in microseconds since boot)
-    int64_t currentTime_us = esp_timer_get_time();
-    err = nvs_set_i64(nvs_handle, NVS_TIMESTAMP_KEY, currentTime_us);
-    if (err != ESP_OK) {
-        ESP_LOGE(LSU_NVS_TAG, "Error saving timestamp to NVS: %s", esp_err_to_name(err));
-        nvs_close(nvs_handle);
-        return false;
-    }
-    
-    // Save LSU count
+/* Private functions --------------------------------------------------------- */
+static bool save_data(const std::vector<LSUData>& lsuDataVector, uint32_t periodMs) {
+    // Timestamp snapshot (in microseconds since boot), lets the load age the LSUs
+    int64_t currentTime_us = hal_time_us();
     uint32_t lsuCount = lsuDataVector.size();
-    err = nvs_set_u32(nvs_handle, NVS_LSU_COUNT_KEY, lsuCount);
-    if (err != ESP_OK) {
-        ESP_LOGE(LSU_NVS_TAG, "Error saving LSU count to NVS: %s", esp_err_to_name(err));
-        nvs_close(nvs_handle);
-        return false;
-    }
-    
-    // Save LSU data
     size_t dataSize = lsuDataVector.size() * sizeof(LSUData);
-    if (dataSize > 0) {
-        err = nvs_set_blob(nvs_handle, NVS_LSU_DATA_KEY, lsuDataVector.data(), dataSize);
-        if (err != ESP_OK) {
-            ESP_LOGE(LSU_NVS_TAG, "Error saving LSU data to NVS: %s", esp_err_to_name(err));
-            nvs_close(nvs_handle);
-            return false;
-        }
-    }
-    
-    // Commit changes
-    err = nvs_commit(nvs_handle);
-    if (err != ESP_OK) {
-        ESP_LOGE(LSU_NVS_TAG, "Error committing NVS changes: %s", esp_err_to_name(err));
-        nvs_close(nvs_handle);
+
+    // Written with a single commit, an empty fleet keeps the stale blob behind a count of 0
+    const hal_nvs_item_t items[] = {
+        {NVS_TIMESTAMP_KEY, HAL_NVS_I64, &currentTime_us, 0},
+        {NVS_PERIOD_KEY, HAL_NVS_U32, &periodMs, 0},
+        {NVS_LSU_COUNT_KEY, HAL_NVS_U32, &lsuCount, 0},
+        {NVS_LSU_DATA_KEY, HAL_NVS_BLOB, lsuDataVector.data(), dataSize},
+    };
+    if (hal_nvs_write(NVS_NAMESPACE, items, sizeof(items) / sizeof(items[0])) != HAL_NVS_OK) {
+        ESP_LOGE(LSU_NVS_TAG, "Error saving %lu LSUs to NVS", lsuCount);
         return false;
     }
-    
-    nvs_close(nvs_handle);
+
     ESP_LOGI(LSU_NVS_TAG, "Successfully saved %lu LSUs to NVS", lsuCount);
     return true;
 }
 
-bool lsu_nvs_load(LSUManager& manager) {
-    nvs_handle_t nvs_handle;
-    esp_err_t err;
-    
-    // Open NVS handle
-    err = nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs_handle);
-    if (err != ESP_OK) {
-        ESP_LOGE(LSU_NVS_TAG, "Error opening NVS handle: %s", esp_err_to_name(err));
-        return false;
-    }
-    
+// Period is left untouched when the save has none
+static bool load_data(std::vector<LSUData>& lsuDataVector, int64_t& savedTimestamp_us, uint32_t& periodMs) {
     // Get timestamp snapshot (in microseconds since boot)
-    int64_t savedTimestamp_us = 0;
-    err = nvs_get_i64(nvs_handle, NVS_TIMESTAMP_KEY, &savedTimestamp_us);
-    if (err != ESP_OK) {
-        if (err == ESP_ERR_NVS_NOT_FOUND) {
+    hal_nvs_err_t err = hal_nvs_read(NVS_NAMESPACE, NVS_TIMESTAMP_KEY, HAL_NVS_I64, &savedTimestamp_us, nullptr);
+    if (err != HAL_NVS_OK) {
+        if (err == HAL_NVS_NOT_FOUND) {
             ESP_LOGI(LSU_NVS_TAG, "No timestamp found in NVS (first boot)");
         } else {
-            ESP_LOGW(LSU_NVS_TAG, "Error reading timestamp from NVS: %s", esp_err_to_name(err));
+            ESP_LOGW(LSU_NVS_TAG, "Error reading timestamp from NVS");
         }
-        nvs_close(nvs_handle);
         return false;
     }
     
+    // Get period, older saves do not have one and keep the default
+    hal_nvs_read(NVS_NAMESPACE, NVS_PERIOD_KEY, HAL_NVS_U32, &periodMs, nullptr);
+    
     // Get LSU count
     uint32_t lsuCount = 0;
-    err = nvs_get_u32(nvs_handle, NVS_LSU_COUNT_KEY, &lsuCount);
-    if (err != ESP_OK) {
-        if (err == ESP_ERR_NVS_NOT_FOUND) {
+    err = hal_nvs_read(NVS_NAMESPACE, NVS_LSU_COUNT_KEY, HAL_NVS_U32, &lsuCount, nullptr);
+    if (err != HAL_NVS_OK) {
+        if (err == HAL_NVS_NOT_FOUND) {
             ESP_LOGI(LSU_NVS_TAG, "No LSU data found in NVS (first boot)");
         } else {
-            ESP_LOGW(LSU_NVS_TAG, "Error reading LSU count from NVS: %s", esp_err_to_name(err));
+            ESP_LOGW(LSU_NVS_TAG, "Error reading LSU count from NVS");
         }
-        nvs_close(nvs_handle);
         return false;
     }
     
+    lsuDataVector.clear();
     if (lsuCount == 0) {
         ESP_LOGI(LSU_NVS_TAG, "No LSUs to load from NVS");
-        nvs_close(nvs_handle);
         return true;
     }
     
     // Validate LSU count is reasonable
     if (lsuCount > MAX_LSU_COUNT) {
         ESP_LOGE(LSU_NVS_TAG, "Invalid LSU count in NVS: %lu (max: %d)", lsuCount, MAX_LSU_COUNT);
-        nvs_close(nvs_handle);
         return false;
     }
     
     // Get LSU data
-    std::vector<LSUData> lsuDataVector(lsuCount);
+    lsuDataVector.resize(lsuCount);
     size_t dataSize = lsuCount * sizeof(LSUData);
-    err = nvs_get_blob(nvs_handle, NVS_LSU_DATA_KEY, lsuDataVector.data(), &dataSize);
-    if (err != ESP_OK) {
-        ESP_LOGE(LSU_NVS_TAG, "Error loading LSU data from NVS: %s", esp_err_to_name(err));
-        nvs_close(nvs_handle);
+    if (hal_nvs_read(NVS_NAMESPACE, NVS_LSU_DATA_KEY, HAL_NVS_BLOB, lsuDataVector.data(), &dataSize) != HAL_NVS_OK) {
+        ESP_LOGE(LSU_NVS_TAG, "Error loading LSU data from NVS");
         return false;
     }
     
-    nvs_close(nvs_handle);
+    ESP_LOGI(LSU_NVS_TAG, "Successfully loaded %lu LSUs from NVS (saved at timestamp %lld us)", lsuCount, savedTimestamp_us);
+    return true;
+}
+
+/* Function implementations --------------------------------------------------*/
+bool lsu_nvs_save(LSUManager& manager) {
+    return save_data(manager.getLsuSerializedData(), manager.getPeriodMs());
+}
+
+bool lsu_nvs_save(FleetCoordinator& coordinator) {
+    return save_data(coordinator.getLsuSerializedData(), coordinator.getPeriodMs());
+}
+
+bool lsu_nvs_load(LSUManager& manager) {
+    std::vector<LSUData> lsuDataVector;
+    int64_t savedTimestamp_us = 0;
+    uint32_t periodMs = manager.getPeriodMs();
+    if (!load_data(lsuDataVector, savedTimestamp_us, periodMs)) {
+        return false;
+    }
+    manager.setPeriodMs(periodMs);
     
     // Restore LSUs to manager with timestamp offset
     if (!manager.restoreLsuFromSerializedData(lsuDataVector, savedTimestamp_us)) {
         ESP_LOGE(LSU_NVS_TAG, "Failed to restore LSUs to manager");
         return false;
     }
-    
-    ESP_LOGI(LSU_NVS_TAG, "Successfully loaded %lu LSUs from NVS (saved at timestamp %lld us)", lsuCount, savedTimestamp_us);
     return true;
 }
 
-bool lsu_nvs_clear() {
-    nvs_handle_t nvs_handle;
-    esp_err_t err;
-    
-    // Open NVS handle
-    err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
-    if (err != ESP_OK) {
-        ESP_LOGE(LSU_NVS_TAG, "Error opening NVS handle: %s", esp_err_to_name(err));
-        return false;
-    }
-    
-    // Erase all keys in the namespace
-    err = nvs_erase_all(nvs_handle);
-    if (err != ESP_OK) {
-        ESP_LOGE(LSU_NVS_TAG, "Error erasing NVS data: %s", esp_err_to_name(err));
-        nvs_close(nvs_handle);
+bool lsu_nvs_load(FleetCoordinator& coordinator) {
+    std::vector<LSUData> lsuDataVector;
+    int64_t savedTimestamp_us = 0;
+    uint32_t periodMs = coordinator.getPeriodMs();
+    if (!load_data(lsuDataVector, savedTimestamp_us, periodMs)) {
         return false;
     }
-    
-    // Commit changes
-    err = nvs_commit(nvs_handle);
-    if (err != ESP_OK) {
-        ESP_LOGE(LSU_NVS_TAG, "Error committing NVS changes: %s", esp_err_to_name(err));
-        nvs_close(nvs_handle);
+    coordinator.setPeriodMs(periodMs);
+    return coordinator.restoreLsuFromSerializedData(lsuDataVector, savedTimestamp_us);
+}
+
+bool lsu_nvs_clear() {
+    if (hal_nvs_erase(NVS_NAMESPACE) != HAL_NVS_OK) {
+        ESP_LOGE(LSU_NVS_TAG, "Error erasing LSU data from NVS");
         return false;
     }
-    
-    nvs_close(nvs_handle);
     ESP_LOGI(LSU_NVS_TAG, "Successfully cleared LSU data from NVS");
     return true;
 }
@@ -204,8 +163,8 @@ bool lsu_nvs_test(LSUManager& manager) {
     uint32_t testId2 = testLSU2->getId();
     uint32_t testTimeSlot1 = testLSU1->getTimeSlotInPeriod();
     uint32_t testTimeSlot2 = testLSU2->getTimeSlotInPeriod();
-    uint64_t testLastConnection1 = testLSU1->getLastConnectionTime();
-    uint64_t testLastConnection2 = testLSU2->getLastConnectionTime();
+    int64_t testLastConnection1 = testLSU1->getLastConnectionTime();
+    int64_t testLastConnection2 = testLSU2->getLastConnectionTime();
     
     ESP_LOGI(LSU_NVS_TAG, "Created test LSUs - ID1: %lu (slot: %lu), ID2: %lu (slot: %lu)", 
              testId1, testTimeSlot1, testId2, testTimeSlot2);
@@ -250,7 +209,7 @@ bool lsu_nvs_test(LSUManager& manager) {
     }
     
     if (restoredLSU1->getLastConnectionTime() != testLastConnection1) {
-        ESP_LOGE(LSU_NVS_TAG, "LSU1 last connection time mismatch - expected: %llu, got: %llu", 
+        ESP_LOGE(LSU_NVS_TAG, "LSU1 last connection time mismatch - expected: %lld, got: %lld", 
                  testLastConnection1, restoredLSU1->getLastConnectionTime());
         return false;
     }
@@ -263,7 +222,7 @@ bool lsu_nvs_test(LSUManager& manager) {
     }
     
     if (restoredLSU2->getLastConnectionTime() != testLastConnection2) {
-        ESP_LOGE(LSU_NVS_TAG, "LSU2 last connection time mismatch - expected: %llu, got: %llu", 
+        ESP_LOGE(LSU_NVS_TAG, "LSU2 last connection time mismatch - expected: %lld, got: %lld", 
                  testLastConnection2, restoredLSU2->getLastConnectionTime());
         return false;
     }
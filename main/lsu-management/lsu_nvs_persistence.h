@@ -13,12 +13,14 @@
 #include <vector>
 #include <cstdint>
 #include "LSUManager.h"
+#include "FleetCoordinator.h"
 
 /* Macros -------------------------------------------------------------------*/
 #define NVS_NAMESPACE "lsu_manager"
 #define NVS_LSU_COUNT_KEY "lsu_count"
 #define NVS_LSU_DATA_KEY "lsu_data"
 #define NVS_TIMESTAMP_KEY "timestamp_us"
+#define NVS_PERIOD_KEY "period_ms"
 
 /* Function declarations -----------------------------------------------------*/
 
@@ -29,6 +31,13 @@
  */
 bool lsu_nvs_save(LSUManager& manager);
 
+/**
+ * @brief Saves the whole fleet to NVS, same format as a single LSUManager
+ * @param coordinator Reference to the FleetCoordinator of the coordinator shard
+ * @return true if save was successful, false otherwise
+ */
+bool lsu_nvs_save(FleetCoordinator& coordinator);
+
 /**
  * @brief Loads LSUManager data from NVS
  * @param manager Reference to LSUManager instance
@@ -36,6 +45,13 @@ bool lsu_nvs_save(LSUManager& manager);
  */
 bool lsu_nvs_load(LSUManager& manager);
 
+/**
+ * @brief Loads the whole fleet from NVS, the LSUs still have to be handed to their shards
+ * @param coordinator Reference to the FleetCoordinator of the coordinator shard
+ * @return true if load was successful, false otherwise
+ */
+bool lsu_nvs_load(FleetCoordinator& coordinator);
+
 /**
  * @brief Clears all LSU data from NVS
  * @return true if clear was successful, false otherwise
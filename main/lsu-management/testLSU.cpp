@@ -8,7 +8,7 @@
 
 /**
  * Run tests with the command:
- * g++ -std=c++17 testLSU.cpp LSU.cpp LSUManager.cpp -o testLSU && "./testLSU"
+ * cmake -S . -B build && cmake --build build && ctest --test-dir build -R testLSU
  */
 
 #include <iostream>
@@ -67,7 +67,7 @@ int main() {
     // Sleep for a second to ensure time difference
     std::this_thread::sleep_for(std::chrono::seconds(1));
     
-    if (manager.keepaliveLSU(lsu1->getId())) {
+    if (manager.keepaliveLSU(lsu1->getId(), -60, 8)) {
         std::cout << "Keepalive successful for LSU 1" << std::endl;
         displayLSUInfo(manager.getLSU(lsu1->getId()));
     } else {
@@ -4,20 +4,26 @@
 #include <freertos/mpu_wrappers.h>
 #include <freertos/projdefs.h>
 #include "esp_log.h"
+#include "esp_system.h"
 
 #include "general_config.h"
 #include "uart.h"
 #include "nvs_flash.h"
+#include "command_queue.h"
+#include "request_queue.h"
+#include "shard_router.h"
+#include "coroutine.h"
+#include "timer_service.h"
+#include "task_table.h"
 
 #include "display/oled.h"
 #include "display/status.h"
 
-#include "lora/rylr998.h"
+#include "lora/radio_setup.h"
+#include "lora/tx_scheduler.h"
 
-#include "tasks/rx_channel.h"
-#include "tasks/process_requests.h"
-#include "tasks/server_connection.h"
 #include "tasks/heartbeat.h"
+#include "tasks/server_connection.h"
 
 #include "wi-fi/wifi.h"
 #include "wi-fi/mqtt_api.h"
@@ -32,27 +38,25 @@ extern "C" void app_main(void) {
   oled_init();
   oled_welcome();
   uart_init();
-  init_display_mutex();
+  command_queue_init();
+  request_queue_init();
+  shard_router_init();
+  coro_executor_init();
+  timer_service_init();
+  tx_scheduler_init();
 
   vTaskDelay(pdMS_TO_TICKS(3000));
   set_display_ready(true);
 
-  // Init connectivity
-  xTaskCreate(server_connection_task, "server_connection_task", 1024 * 8, NULL, configMAX_PRIORITIES - 1, NULL);
-
-  // Start tasks
-  static UartPort_t main_port = UART_PORT_MAIN;
-  static UartPort_t aux_port = UART_PORT_AUX;
-  xTaskCreate(rx_channel_task, "uart_main_rx_task", 1024 * 6, &main_port, configMAX_PRIORITIES - 1, NULL);
-  xTaskCreate(rx_channel_task, "uart_aux_rx_task", 1024 * 6, &aux_port, configMAX_PRIORITIES - 2, NULL);
-  xTaskCreate(process_requests_task, "process_request_task", 1024 * 4, NULL, configMAX_PRIORITIES - 3, NULL);
-  //xTaskCreate(heartbeat_task, "heartbeat_task", 1024 * 4, NULL, configMAX_PRIORITIES - 4, NULL);
-
-  // Configure channels
-  rylr998_setChannel(1, CU_ADDRESS, main_port);
-  rylr998_setChannel(0, CU_ADDRESS, aux_port);
-  while (1) {
-   // printf("--------------------------------\n");
-    vTaskDelay(pdMS_TO_TICKS(500));
-  }
+  // Connectivity runs on the coroutine executor, periodic work on the timer
+  // service, radio and background tasks are listed in task_table.cpp
+  server_connection_start();
+  heartbeat_start();
+  task_table_start();
+
+  // Configure channels, both modules at once, the boot report carries the time
+  radio_setup_run(CU_ADDRESS);
+  server_connection_notify(); // The boot report waits for the setup
+
+  // Periodic work lives on the timer service, the main task has nothing left to do
 }
@@ -2,8 +2,8 @@
   ******************************************************************************
   * @authors        : Tomas Gonzalez & Brian Morris
   * @file           : request_queue.cpp
-  * @brief          : Single interface to manage requests, can be accessed and
-  *                   modified by different tasks
+  * @brief          : Request queues, one per LSU shard, filled by the RX
+  *                   tasks and drained by the shard workers
   ******************************************************************************
   * @attention
   *
@@ -17,45 +17,89 @@
 
 /* Includes ------------------------------------------------------------ */
 #include "request_queue.h"
+
+#include <atomic>
+#include <string.h>
+#include "latency_stats.h"
+#include "shard_router.h"
 #include "esp_log.h"
+#include "hal/hal.h"
 #include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
 
 /* Defines ------------------------------------------------------------ */
 #define WAIT_TIME_BEFORE_RESPONSE 10 // 1 second in ticks
+#define REQUEST_QUEUE_LENGTH 32      // Per shard
 
 /* Private variables --------------------------------------------------------- */
 static const char *REQUEST_QUEUE_TAG = "RQ_QUEUE";
-std::queue<Request*> RequestQueue;
+static QueueHandle_t RequestQueue[LSU_SHARD_COUNT] = {};
+static std::atomic<uint16_t> RequestQueueDepth[2]; // Indexed by UartPort_t
+static std::atomic<uint32_t> RequestsDropped{0};
 
 /* Functions ------------------------------------------------------------ */
-void post_request(std::string data, uint16_t from_id, UartPort_t sourcePort) {
-  // Validate the format of the data
-
-  // TODO: Add error handling try/catch
-
-  Request* request = new Request({
-    from_id,
-    (data.starts_with("SYNC")) ? REQUEST_TYPE_SYNC : REQUEST_TYPE_DATA,
-    data,
-    xTaskGetTickCount(),
-    sourcePort
-  });
-  RequestQueue.push(request);
+void request_queue_init() {
+  for (int shard = 0; shard < LSU_SHARD_COUNT; shard++) {
+    if (RequestQueue[shard] == NULL) {
+      RequestQueue[shard] = xQueueCreate(REQUEST_QUEUE_LENGTH, sizeof(Request));
+      if (RequestQueue[shard] == NULL) {
+        ESP_LOGE(REQUEST_QUEUE_TAG, "Failed to create request queue of shard %d", shard);
+      }
+    }
+  }
+}
+
+void post_request(const char *data, uint16_t from_id, UartPort_t sourcePort, int16_t rssi, int8_t snr,
+                  int64_t received_us) {
+  Request request;
+  request.from_id = from_id;
+  request.type = strncmp(data, "SYNC", 4) == 0 ? REQUEST_TYPE_SYNC : REQUEST_TYPE_DATA;
+  strncpy(request.data, data, sizeof(request.data) - 1);
+  request.data[sizeof(request.data) - 1] = '\0';
+  request.timestamp = xTaskGetTickCount();
+  request.sourcePort = sourcePort;
+  request.rssi = rssi;
+  request.snr = snr;
+  request.received_us = received_us;
+  request.posted_us = hal_time_us();
+
+  // Joins need the coordinator, data stays with the shard owning the sender
+  int shard = request.type == REQUEST_TYPE_SYNC ? LSU_COORDINATOR_SHARD : shard_of(from_id);
+  RequestQueueDepth[sourcePort]++;
+  if (RequestQueue[shard] == NULL || xQueueSend(RequestQueue[shard], &request, 0) != pdTRUE) {
+    ESP_LOGW(REQUEST_QUEUE_TAG, "Request queue of shard %d full, dropping request from %u", shard, from_id);
+    RequestQueueDepth[sourcePort]--;
+    RequestsDropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  shard_wake(shard, SHARD_WAKE_REQUEST);
 }
 
-Request* get_request() {
-  if (RequestQueue.empty()) {
-    return NULL;
+bool get_request(int shard, uint32_t *hold_ms, Request *request) {
+  // Single consumer per queue, the peeked request is the one received below
+  *hold_ms = 0;
+  if (RequestQueue[shard] == NULL || xQueuePeek(RequestQueue[shard], request, 0) != pdTRUE) {
+    return false;
   }
 
-  Request* request = RequestQueue.front();
   uint32_t currentTick = xTaskGetTickCount();
   uint32_t timeSinceRequest = currentTick - request->timestamp;
 
   // Delay the response for at least 1 second since the request was posted
   if (timeSinceRequest >= WAIT_TIME_BEFORE_RESPONSE) {
-    RequestQueue.pop();
-    return request;
+    xQueueReceive(RequestQueue[shard], request, 0);
+    RequestQueueDepth[request->sourcePort]--;
+    latency_record_since(LATENCY_STAGE_QUEUE, request->posted_us);
+    return true;
   }
-  return NULL;
+  *hold_ms = pdTICKS_TO_MS(WAIT_TIME_BEFORE_RESPONSE - timeSinceRequest);
+  return false;
+}
+
+size_t request_queue_depth(UartPort_t sourcePort) {
+  return RequestQueueDepth[sourcePort].load(std::memory_order_relaxed);
+}
+
+uint32_t request_queue_dropped() {
+  return RequestsDropped.load(std::memory_order_relaxed);
 }
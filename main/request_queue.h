@@ -2,8 +2,8 @@
   ******************************************************************************
   * @authors        : Tomas Gonzalez & Brian Morris
   * @file           : request_queue.h
-  * @brief          : Header for single interface to manage requests, can be
-  *                   accessed and modified by different tasks
+  * @brief          : Header for the request queues, one per LSU shard, filled
+  *                   by the RX tasks and drained by the shard workers
   ******************************************************************************
   * @attention
   *
@@ -19,40 +19,77 @@
 #define REQUEST_QUEUE_H
 
 /* Includes ------------------------------------------------------------ */
-#include <queue>
-#include <string>
+#include <stddef.h>
+#include <stdint.h>
 
 #include "uart.h"
 
+/* Defines ------------------------------------------------------------- */
+#define REQUEST_DATA_MAX_LEN 64  // Payload of a +RCV with its terminator, as RYLR_RX_data_t keeps it
+
 /* Structs ------------------------------------------------------------- */
 enum RequestType {
   REQUEST_TYPE_SYNC,
   REQUEST_TYPE_DATA,
 };
 
+// Copied by value through the shard queues, nothing to allocate or free
 struct Request {
   uint16_t from_id;
   RequestType type;
-  std::string data;
+  char data[REQUEST_DATA_MAX_LEN];  // Null terminated, longer payloads are cut
   uint32_t timestamp;
   UartPort_t sourcePort;
+  int16_t rssi;  // dBm
+  int8_t snr;    // dB
+  int64_t received_us;  // UART bytes read, start of the pipeline
+  int64_t posted_us;    // Entered the queue
 };
 
 /* Public API ---------------------------------------------------------- */
 /**
- * @brief Post a request to the queue
+ * @brief Initialize the queues, must be called before any other function
+ */
+void request_queue_init();
+
+/**
+ * @brief Post a request to the queue of the shard that handles it
+ * @details SYNC goes to the coordinator shard, DATA to the shard owning from_id
  * 
- * @param data 
+ * @param data Payload, null terminated, copied into the request
  * @param from_id
  * @param sourcePort
+ * @param rssi RSSI reported by the module in dBm
+ * @param snr SNR reported by the module in dB
+ * @param received_us Time the UART bytes were read
  */
-void post_request(std::string data, uint16_t from_id, UartPort_t sourcePort);
+void post_request(const char *data, uint16_t from_id, UartPort_t sourcePort, int16_t rssi, int8_t snr,
+                  int64_t received_us);
 
 /**
- * @brief Get a request from the queue
+ * @brief Get a request from the queue of a shard, owner only
+ * @details Requests are held for at least 1 second after being posted
  * 
- * @return Request* 
+ * @param shard Shard of the calling task
+ * @param hold_ms Set to the time left before the next request is ready, 0 if the queue is empty
+ * @param request Filled with the request when one is ready
+ * @return true if a request was taken
  */ 
-Request* get_request();
+bool get_request(int shard, uint32_t *hold_ms, Request *request);
+
+/**
+ * @brief Number of requests waiting from a given radio, safe from any task
+ * 
+ * @param sourcePort
+ * @return size_t 
+ */
+size_t request_queue_depth(UartPort_t sourcePort);
+
+/**
+ * @brief Requests dropped because the queue of their shard was full, since boot
+ * 
+ * @return uint32_t 
+ */
+uint32_t request_queue_dropped();
 
 #endif /* REQUEST_QUEUE_H */
@@ -0,0 +1,67 @@
+/**
+  ******************************************************************************
+  * @authors        : Tomas Gonzalez & Brian Morris
+  * @file           : shard_router.cpp
+  * @brief          : Messages exchanged by the LSU shards, every shard owns
+  *                   part of the registry and only talks by value
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 Tomas Gonzalez & Brian Morris
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  */
+
+/* Includes ------------------------------------------------------------ */
+#include "shard_router.h"
+
+#include <atomic>
+#include "esp_log.h"
+#include "freertos/queue.h"
+
+/* Private variables --------------------------------------------------------- */
+static const char *SHARD_ROUTER_TAG = "SHARD_ROUTER";
+static QueueHandle_t ShardInbox[LSU_SHARD_COUNT] = {};
+static std::atomic<TaskHandle_t> ShardWorker[LSU_SHARD_COUNT] = {};
+
+/* Functions ------------------------------------------------------------ */
+void shard_router_init() {
+  for (int shard = 0; shard < LSU_SHARD_COUNT; shard++) {
+    if (ShardInbox[shard] == NULL) {
+      ShardInbox[shard] = xQueueCreate(SHARD_INBOX_LENGTH, sizeof(ShardMessage));
+      if (ShardInbox[shard] == NULL) {
+        ESP_LOGE(SHARD_ROUTER_TAG, "Failed to create inbox of shard %d", shard);
+      }
+    }
+  }
+}
+
+void shard_attach(int shard, TaskHandle_t worker) {
+  ShardWorker[shard].store(worker, std::memory_order_release);
+}
+
+void shard_wake(int shard, uint32_t bits) {
+  // Before attaching the worker has not slept yet, its first pass looks at everything
+  TaskHandle_t worker = ShardWorker[shard].load(std::memory_order_acquire);
+  if (worker != NULL) {
+    xTaskNotify(worker, bits, eSetBits);
+  }
+}
+
+bool shard_send(int shard, const ShardMessage *message, TickType_t wait) {
+  if (ShardInbox[shard] == NULL || xQueueSend(ShardInbox[shard], message, wait) != pdTRUE) {
+    return false;
+  }
+  shard_wake(shard, SHARD_WAKE_INBOX);
+  return true;
+}
+
+bool shard_receive(int shard, ShardMessage *message) {
+  if (ShardInbox[shard] == NULL) {
+    return false;
+  }
+  return xQueueReceive(ShardInbox[shard], message, 0) == pdTRUE;
+}
@@ -0,0 +1,110 @@
+/**
+  ******************************************************************************
+  * @authors        : Tomas Gonzalez & Brian Morris
+  * @file           : shard_router.h
+  * @brief          : Header for the messages exchanged by the LSU shards, every
+  *                   shard owns part of the registry and only talks by value
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 Tomas Gonzalez & Brian Morris
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  */
+
+#ifndef SHARD_ROUTER_H
+#define SHARD_ROUTER_H
+
+/* Includes ------------------------------------------------------------ */
+#include <cstddef>
+#include <cstdint>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+/* Defines ------------------------------------------------------------- */
+#define LSU_SHARD_COUNT        2
+#define LSU_COORDINATOR_SHARD  0   // Also allocates IDs and slots, persists and publishes the fleet
+#define SHARD_INBOX_LENGTH     32
+
+// Notification bits waking a shard worker, it sleeps until one of them is set
+#define SHARD_WAKE_REQUEST      (1u << 0)  // Request posted, or the held one is due
+#define SHARD_WAKE_INBOX        (1u << 1)  // Message from another shard
+#define SHARD_WAKE_COMMAND      (1u << 2)  // Downlink command, coordinator only
+#define SHARD_WAKE_TIMEOUTS     (1u << 3)  // Time to look for silent LSUs
+#define SHARD_WAKE_HOUSEKEEPING (1u << 4)  // Publishing and batched saves, coordinator only
+#define SHARD_WAKE_ALL          0x1F
+
+/* Structs ------------------------------------------------------------- */
+enum ShardMessageType {
+  SHARD_MSG_ADOPT,     /**< Coordinator -> owner: lsuId joined at slot value, last seen at time_us */
+  SHARD_MSG_REMOVE,    /**< Coordinator -> owner: remove lsuId, reply to correlation_id */
+  SHARD_MSG_PERIOD,    /**< Coordinator -> owners: period changed to value */
+  SHARD_MSG_RELEASED,  /**< Owner -> coordinator: lsuId was removed or timed out */
+  SHARD_MSG_TOUCH,     /**< Owner -> coordinator: packet from lsuId at time_us, best effort */
+  SHARD_MSG_MOVED,     /**< Coordinator -> owner: lsuId moved off a failed radio to slot value */
+  SHARD_MSG_RESTORE,   /**< Coordinator -> owner: lsuId restored from NVS at slot value, last seen at time_us */
+};
+
+/**
+ * @brief Message between shards, copied by value through the inboxes
+ */
+struct ShardMessage {
+  ShardMessageType type;
+  uint32_t lsuId;
+  uint32_t value;
+  int64_t time_us;
+  int16_t rssi;
+  int8_t snr;
+  uint32_t correlation_id;
+};
+
+/* Public API ---------------------------------------------------------- */
+/**
+ * @brief Shard owning an LSU, every ID has exactly one owner
+ * @param lsuId ID of the LSU
+ * @return Shard index
+ */
+inline int shard_of(uint32_t lsuId) {
+  return lsuId % LSU_SHARD_COUNT;
+}
+
+/**
+ * @brief Initialize the shard inboxes, must be called before any other function
+ */
+void shard_router_init();
+
+/**
+ * @brief Register the worker task of a shard, woken by shard_wake()
+ * @param shard Shard of the calling task
+ * @param worker Task handle
+ */
+void shard_attach(int shard, TaskHandle_t worker);
+
+/**
+ * @brief Wake the worker of a shard, safe from any task
+ * @param shard Shard to wake
+ * @param bits SHARD_WAKE_* reasons
+ */
+void shard_wake(int shard, uint32_t bits);
+
+/**
+ * @brief Send a message to a shard
+ * @param shard Destination shard
+ * @param message Message to send
+ * @param wait Ticks to wait for room in the inbox, 0 for best effort messages
+ * @return true if sent, false if the inbox stayed full
+ */
+bool shard_send(int shard, const ShardMessage *message, TickType_t wait);
+
+/**
+ * @brief Get a message from a shard inbox without blocking, owner only
+ * @param shard Shard of the calling task
+ * @param message Output message
+ * @return true if a message was retrieved
+ */
+bool shard_receive(int shard, ShardMessage *message);
+
+#endif /* SHARD_ROUTER_H */
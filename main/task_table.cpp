@@ -0,0 +1,147 @@
+/**
+  ******************************************************************************
+  * @authors        : Tomas Gonzalez & Brian Morris
+  * @file           : task_table.cpp
+  * @brief          : Task topology, every application task with its core,
+  *                   priority and statically allocated stack
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 Tomas Gonzalez & Brian Morris
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  */
+
+/* Includes ------------------------------------------------------------ */
+#include "task_table.h"
+
+#include "esp_log.h"
+#include "esp_task.h"
+#include "uart.h"
+#include "shard_router.h"
+#include "coroutine.h"
+#include "timer_service.h"
+
+#include "tasks/rx_channel.h"
+#include "tasks/process_requests.h"
+#include "tasks/resource_monitor.h"
+#include "tasks/log_drain.h"
+
+/* Defines ------------------------------------------------------------- */
+#define TIMER_SERVICE_STACK      (1024 * 3)
+#define CORO_EXECUTOR_STACK      (1024 * 6)
+#define RX_CHANNEL_STACK         (1024 * 6)
+#define PROCESS_REQUESTS_STACK   (1024 * 4)
+#define RESOURCE_MONITOR_STACK   (1024 * 3)
+#define LOG_DRAIN_STACK          (1024 * 3)
+
+// Indexes in the table, used by the feeds field
+enum TaskIndex {
+  TASK_TIMER_SERVICE,
+  TASK_RX_MAIN,
+  TASK_RX_AUX,
+  TASK_PROCESS_SHARD_0,
+  TASK_PROCESS_SHARD_1,
+  TASK_CORO_EXECUTOR,
+  TASK_RESOURCE_MONITOR,
+  TASK_LOG_DRAIN,
+  TASK_COUNT,
+};
+
+/* Private variables --------------------------------------------------------- */
+static const char *TASK_TABLE_TAG = "TASKS";
+
+static UartPort_t mainPort = UART_PORT_MAIN;
+static UartPort_t auxPort = UART_PORT_AUX;
+static const int shards[LSU_SHARD_COUNT] = {0, 1};
+
+// Stacks live in .bss, creating a task never touches the heap
+static StackType_t timerServiceStack[TIMER_SERVICE_STACK];
+static StackType_t rxMainStack[RX_CHANNEL_STACK];
+static StackType_t rxAuxStack[RX_CHANNEL_STACK];
+static StackType_t processShardStacks[LSU_SHARD_COUNT][PROCESS_REQUESTS_STACK];
+static StackType_t coroExecutorStack[CORO_EXECUTOR_STACK];
+static StackType_t resourceMonitorStack[RESOURCE_MONITOR_STACK];
+static StackType_t logDrainStack[LOG_DRAIN_STACK];
+static StaticTask_t tcbs[TASK_COUNT];
+
+// Radio path on its own core at mid priorities, everything that talks to the
+// network stays with Wi-Fi and lwIP below their priorities. One LSU shard per
+// core, both RX tasks feed both shards so feeds names the one on their core.
+// The timer service sits above everything it wakes, its callbacks are short.
+static const TaskSpec taskTable[TASK_COUNT] = {
+  {"timer_service", timer_service_task, NULL, TIMER_SERVICE_STACK,
+   15, NETWORK_CORE, timerServiceStack, &tcbs[TASK_TIMER_SERVICE], false, TASK_NO_CONSUMER},
+  {"uart_main_rx_task", rx_channel_task, &mainPort, RX_CHANNEL_STACK,
+   12, RADIO_CORE, rxMainStack, &tcbs[TASK_RX_MAIN], false, TASK_PROCESS_SHARD_0},
+  {"uart_aux_rx_task", rx_channel_task, &auxPort, RX_CHANNEL_STACK,
+   12, RADIO_CORE, rxAuxStack, &tcbs[TASK_RX_AUX], false, TASK_PROCESS_SHARD_0},
+  {"process_shard_0", process_requests_task, (void*) &shards[0], PROCESS_REQUESTS_STACK,
+   11, RADIO_CORE, processShardStacks[0], &tcbs[TASK_PROCESS_SHARD_0], false, TASK_NO_CONSUMER},
+  {"process_shard_1", process_requests_task, (void*) &shards[1], PROCESS_REQUESTS_STACK,
+   11, NETWORK_CORE, processShardStacks[1], &tcbs[TASK_PROCESS_SHARD_1], false, TASK_NO_CONSUMER},
+  {"coro_executor", coro_executor_task, NULL, CORO_EXECUTOR_STACK,
+   10, NETWORK_CORE, coroExecutorStack, &tcbs[TASK_CORO_EXECUTOR], false, TASK_NO_CONSUMER},
+  {"resource_monitor", resource_monitor_task, NULL, RESOURCE_MONITOR_STACK,
+   1, NETWORK_CORE, resourceMonitorStack, &tcbs[TASK_RESOURCE_MONITOR], true, TASK_NO_CONSUMER},
+  {"log_drain", log_drain_task, NULL, LOG_DRAIN_STACK,
+   1, NETWORK_CORE, logDrainStack, &tcbs[TASK_LOG_DRAIN], true, TASK_NO_CONSUMER},
+};
+
+/* Functions ------------------------------------------------------------ */
+int task_table_audit() {
+  int violations = 0;
+
+  for (int i = 0; i < TASK_COUNT; i++) {
+    const TaskSpec& task = taskTable[i];
+
+    if (task.priority >= configMAX_PRIORITIES) {
+      ESP_LOGE(TASK_TABLE_TAG, "%s: priority %u out of range", task.name, task.priority);
+      violations++;
+    }
+    // Above lwIP on its core the task can delay every packet of the CU
+    if (task.core == NETWORK_CORE && task.priority >= ESP_TASK_TCPIP_PRIO) {
+      ESP_LOGE(TASK_TABLE_TAG, "%s: priority %u preempts the network stack (%d) on core %d",
+               task.name, task.priority, ESP_TASK_TCPIP_PRIO, NETWORK_CORE);
+      violations++;
+    }
+    if (task.stackBytes < configMINIMAL_STACK_SIZE) {
+      ESP_LOGE(TASK_TABLE_TAG, "%s: stack %lu below the minimum", task.name, task.stackBytes);
+      violations++;
+    }
+
+    // A polling consumer above its producer on the same core starves it
+    if (task.feeds != TASK_NO_CONSUMER) {
+      const TaskSpec& consumer = taskTable[task.feeds];
+      if (consumer.polls && consumer.core == task.core && consumer.priority > task.priority) {
+        ESP_LOGE(TASK_TABLE_TAG, "%s (%u) polls above its producer %s (%u) on core %d",
+                 consumer.name, consumer.priority, task.name, task.priority, task.core);
+        violations++;
+      }
+    }
+  }
+
+  if (violations == 0) {
+    ESP_LOGI(TASK_TABLE_TAG, "Task table audit passed (%d tasks)", TASK_COUNT);
+  }
+  return violations;
+}
+
+void task_table_start() {
+  task_table_audit();
+
+  for (int i = 0; i < TASK_COUNT; i++) {
+    const TaskSpec& task = taskTable[i];
+    TaskHandle_t handle = xTaskCreateStaticPinnedToCore(task.function, task.name, task.stackBytes, task.arg,
+                                                        task.priority, task.stack, task.tcb, task.core);
+    if (handle == NULL) {
+      ESP_LOGE(TASK_TABLE_TAG, "Failed to create %s", task.name);
+      continue;
+    }
+    ESP_LOGI(TASK_TABLE_TAG, "%s: core %d, priority %u, stack %lu", task.name, task.core, task.priority,
+             task.stackBytes);
+  }
+}
@@ -0,0 +1,61 @@
+/**
+  ******************************************************************************
+  * @authors        : Tomas Gonzalez & Brian Morris
+  * @file           : task_table.h
+  * @brief          : Header for the task topology, every application task with
+  *                   its core, priority and statically allocated stack
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 Tomas Gonzalez & Brian Morris
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  */
+
+#ifndef TASK_TABLE_H
+#define TASK_TABLE_H
+
+/* Includes ------------------------------------------------------------ */
+#include <cstddef>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+/* Defines ------------------------------------------------------------- */
+#define NETWORK_CORE 0  // Wi-Fi, lwIP, MQTT and esp_timer are pinned here
+#define RADIO_CORE   1  // LoRa RX and the coordinator LSU shard
+
+#define TASK_NO_CONSUMER -1
+
+/* Structs ------------------------------------------------------------- */
+struct TaskSpec {
+  const char *name;
+  TaskFunction_t function;
+  void *arg;
+  uint32_t stackBytes;
+  UBaseType_t priority;
+  BaseType_t core;
+  StackType_t *stack;   /**< stackBytes long, never freed */
+  StaticTask_t *tcb;
+  bool polls;           /**< Wakes up on a timer instead of blocking on its input */
+  int feeds;            /**< Index of the task consuming its output, TASK_NO_CONSUMER if none */
+};
+
+/* Public API ---------------------------------------------------------- */
+/**
+ * @brief Check the task table for priority inversions and starvation
+ * @details Logs every violation: tasks above the network stack on its core,
+ *          polling consumers above their producer on the same core and
+ *          stacks below the FreeRTOS minimum
+ * @return Number of violations
+ */
+int task_table_audit();
+
+/**
+ * @brief Audit the table and create every task pinned to its core
+ */
+void task_table_start();
+
+#endif /* TASK_TABLE_H */
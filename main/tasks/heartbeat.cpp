@@ -1,22 +1,28 @@
+#include "heartbeat.h"
+
 #include "esp_log.h"
-#include "freertos/FreeRTOS.h"
-#include "freertos/task.h"
+#include "timer_service.h"
 
 #include "display/status.h"
 
 static const char *HEARTBEAT_TASK_TAG = "Heartbeat";
 
-void heartbeat_task(void *arg) {
-  ESP_LOGI(HEARTBEAT_TASK_TAG, "Heartbeat task started");
+static timer_id_t offTimer = TIMER_INVALID;
+
+// Both run on the timer service task, they only touch the status model
+static void heartbeat_off(void *arg) {
+  update_heartbeat_status(false);
+}
 
-  while (1) {
-    // Turn heartbeat ON for 1 second
-    update_heartbeat_status(true);
-    ESP_LOGD(HEARTBEAT_TASK_TAG, "Heartbeat");
-    vTaskDelay(pdMS_TO_TICKS(1000));  // 1 second delay
+static void heartbeat_on(void *arg) {
+  update_heartbeat_status(true);
+  ESP_LOGD(HEARTBEAT_TASK_TAG, "Heartbeat");
+  timer_service_start_once(offTimer, HEARTBEAT_ON_MS);
+}
 
-    // Turn heartbeat OFF for 3 seconds
-    update_heartbeat_status(false);
-    vTaskDelay(pdMS_TO_TICKS(3000));  // 3 seconds delay
-  }
+void heartbeat_start() {
+  offTimer = timer_service_create_callback("heartbeat_off", heartbeat_off, NULL);
+  timer_id_t onTimer = timer_service_create_callback("heartbeat_on", heartbeat_on, NULL);
+  timer_service_start_periodic(onTimer, HEARTBEAT_PERIOD_MS);
+  ESP_LOGI(HEARTBEAT_TASK_TAG, "Heartbeat started");
 }
@@ -9,7 +9,14 @@
 #ifndef HEARTBEAT_H
 #define HEARTBEAT_H
 
+/* Defines ------------------------------------------------------------- */
+#define HEARTBEAT_ON_MS      1000
+#define HEARTBEAT_PERIOD_MS  4000  // On for 1 second, off for 3
+
 /* Function ------------------------------------------------------------ */
-void heartbeat_task(void *arg);
+/**
+ * @brief Blink the heartbeat indicator from the timer service, no task needed
+ */
+void heartbeat_start();
 
 #endif /* HEARTBEAT_H */
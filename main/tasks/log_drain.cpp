@@ -0,0 +1,34 @@
+/**
+ * ******************************************************************************
+  * @authors        : Tomas Gonzalez & Brian Morris
+  * @file           : log_drain.cpp
+  * @brief          : Task - Formats and prints the deferred log records and
+  *                   writes the UART capture at low priority, so the console
+  *                   and the flash never block the radio path
+  * ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------ */
+#include "log_drain.h"
+
+#include "log_ring.h"
+#include "uart_trace.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "timer_service.h"
+
+/* Functions ------------------------------------------------------------ */
+void log_drain_task(void *arg) {
+  timer_id_t drainTimer = timer_service_create_notify("log_drain", xTaskGetCurrentTaskHandle(), 1);
+  timer_service_start_periodic(drainTimer, LOG_DRAIN_INTERVAL_MS);
+
+  while (1) {
+    // The UART capture shares the low priority, flash writes never stall the RX tasks
+    uart_trace_flush();
+
+    // Keep draining while full batches come out, then sleep
+    if (log_ring_drain(LOG_DRAIN_BATCH) < LOG_DRAIN_BATCH) {
+      ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+  }
+}
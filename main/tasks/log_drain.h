@@ -0,0 +1,19 @@
+/**
+ * ******************************************************************************
+  * @authors        : Tomas Gonzalez & Brian Morris
+  * @file           : log_drain.h
+  * @brief          : Header file for log_drain.cpp
+  * ******************************************************************************
+  */
+
+#ifndef LOG_DRAIN_H
+#define LOG_DRAIN_H
+
+/* Defines ------------------------------------------------------------- */
+#define LOG_DRAIN_INTERVAL_MS 50
+#define LOG_DRAIN_BATCH       16  // Records printed per wake-up
+
+/* Function ------------------------------------------------------------ */
+void log_drain_task(void *arg);
+
+#endif /* LOG_DRAIN_H */
@@ -2,131 +2,875 @@
  * ******************************************************************************
   * @authors        : Tomas Gonzalez & Brian Morris
   * @file           : process_requests.cpp
-  * @brief          : Task - Processes requests from the request queue
+  * @brief          : Task - Processes the requests of one LSU shard, the
+  *                   coordinator shard also handles joins and the fleet
   * ******************************************************************************
   */
 
 /* Includes ------------------------------------------------------------ */
 #include "process_requests.h"
 
+#include <stdio.h>
+#include <algorithm>
+#include <string>
 #include "LSUManager.h"
+#include "FleetCoordinator.h"
 #include "lsu_nvs_persistence.h"
 #include "request_queue.h"
+#include "command_queue.h"
+#include "shard_router.h"
+#include "coroutine.h"
+#include "timer_service.h"
+#include "latency_stats.h"
+#include "log_ring.h"
+#include "uart_trace.h"
+#include "tx_scheduler.h"
 #include "esp_log.h"
-#include "esp_timer.h"
+#include "hal/hal.h"
 #include "cu_comms.h"
+#include "rylr998.h"
+#include "adr.h"
+#include "radio_roles.h"
+#include "radio_health.h"
 #include "general_config.h"
 #include "wi-fi/mqtt_api.h"
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
+/* Defines ------------------------------------------------------------------- */
+#define STATUS_DIAGNOSTICS_INTERVAL_US 1000000 // Display diagnostics refresh (1 second)
+#define FLEET_SAVE_INTERVAL_US 60000000        // Link/age changes reach NVS at most every minute
+#define SHARD_SEND_WAIT pdMS_TO_TICKS(100)     // Both inboxes full means both shards are stuck
+#define SHARD_RESTORE_WAIT pdMS_TO_TICKS(1000) // Boot hand-over, the other shard may still be starting
+#define RELEASE_RETRY_MS 100                   // Deferred releases and moves are offered again this often
+#define TRACE_EXPORT_CHUNKS 8                  // Trace messages per housekeeping round, about 6 KB/s
+#define FAILOVER_BATCH 8                       // CONFIGs per retune, the radio is off its channel meanwhile
+#define JOIN_LISTEN_ROUND_MS 10000             // Join windows are planned this far ahead while the join radio is down
+#define JOIN_LISTEN_MIN_MS 300                 // Shorter gaps are not worth the two retunes
+#define JOIN_LISTEN_GUARD_MS 250               // Back before an expected uplink, about its air time at SF9
+#define JOIN_LISTEN_HOLD_MS 400                // And after it, for the rest of the uplink and its ACK
+#define JOIN_LISTEN_MAX_SKEW_MS 2000           // Farther from its slot, the last packet of an LSU was its SYNC
+
+/* Private types ------------------------------------------------------------- */
+struct JoinWindow {
+  int64_t start_us;
+  int64_t end_us;
+};
+
 /* Private variables --------------------------------------------------------- */
 static const char *PROCESS_REQUEST_TASK_TAG = "PROCESS_REQUEST_TASK";
 
+// Touched by the coordinator shard task only
+static FleetCoordinator fleetCoordinator;
+static int64_t joinRoundEnd_us = 0;  // Last join window planned, see listen_for_joins()
+
+static const char *const holdTimerNames[LSU_SHARD_COUNT] = {"shard0_hold", "shard1_hold"};
+static const char *const timeoutTimerNames[LSU_SHARD_COUNT] = {"shard0_timeouts", "shard1_timeouts"};
+
 /* Private functions --------------------------------------------------------- */
-void process_sync_request(Request* request, LSUManager& manager) {
-  auto [lsu, success] = manager.createLSU();
-  if (success) {
-    ESP_LOGI(PROCESS_REQUEST_TASK_TAG, "LSU created successfully");
-    uint32_t lsu_id = lsu->getId();             // ID assigned to the LSU
-    uint32_t lsu_time_slot = lsu->getTimeSlotInPeriod();
-    uint32_t lsu_id_to_send = request->from_id; // old ID of the sender, loses meaning after sync
-
-    int64_t time_since_boot_ms = esp_timer_get_time() / 1000;
-    uint32_t now_ms = time_since_boot_ms % TIME_PERIOD_MS;
-
-    LSU_config_package_t config_package(
-      lsu_id,
-      TIME_PERIOD_MS,
-      now_ms,
-      lsu_time_slot
-    );
-    CU_sendConfigPackage(&config_package, lsu_id_to_send);
-    
-    // Publish device linking notification to MQTT
-    std::string topic = "livestock/" + std::to_string(lsu_id) + "/link";
-    std::string payload = "Device linked with ID: " + std::to_string(lsu_id) + 
-                          ", Time slot: " + std::to_string(lsu_time_slot) + 
-                          ", Period: " + std::to_string(TIME_PERIOD_MS) + "ms";
-    mqtt_api_publish(topic.c_str(), payload.c_str());
-    
-    ESP_LOGI(PROCESS_REQUEST_TASK_TAG, "Published device link notification to MQTT topic: %s", topic.c_str());
-    
-    // Save to NVS after creating LSU
-    lsu_nvs_save(manager);
-  } else {
-    ESP_LOGW(PROCESS_REQUEST_TASK_TAG, "Failed to create LSU");
+static void save_fleet(ShardWorker& worker) {
+  int64_t start_us = hal_time_us();
+  lsu_nvs_save(*worker.coordinator);
+  latency_record_since(LATENCY_STAGE_NVS_SAVE, start_us);
+  worker.savedVersion = worker.coordinator->getSnapshot().getVersion();
+  worker.lastSave_us = start_us;
+}
+
+// Runs on the owning shard whenever one of its LSUs is removed or times out
+static void on_lsu_removed(uint32_t lsu_id, void *context) {
+  ShardWorker& worker = *(ShardWorker*) context;
+  if (worker.coordinator != nullptr) {
+    if (worker.coordinator->release(lsu_id)) {
+      save_fleet(worker);
+    }
+    return;
   }
+
+  // A timeout storm removes more LSUs in one pass than the inbox holds, and
+  // waiting here stalls the shard. Keep them and offer them again later.
+  worker.pendingReleases.push_back(lsu_id);
 }
 
-void process_data_request(Request* request, LSUManager& manager) {
-  uint32_t lsu_id = request->from_id;
+// Hands deferred releases to the coordinator, returns true once none are left
+static bool flush_releases(ShardWorker& worker) {
+  size_t sent = 0;
+  for (uint32_t lsu_id : worker.pendingReleases) {
+    ShardMessage message = {SHARD_MSG_RELEASED, lsu_id, 0, 0, 0, 0, 0};
+    if (!shard_send(LSU_COORDINATOR_SHARD, &message, 0)) {
+      break;
+    }
+    sent++;
+  }
+  worker.pendingReleases.erase(worker.pendingReleases.begin(), worker.pendingReleases.begin() + sent);
+  if (!worker.pendingReleases.empty()) {
+    ESP_LOGW(PROCESS_REQUEST_TASK_TAG, "Shard %d: coordinator busy, %u releases deferred", worker.shard,
+             (unsigned) worker.pendingReleases.size());
+    return false;
+  }
+  return true;
+}
 
-  CU_sendDataAck(lsu_id, request->sourcePort);
-  manager.keepaliveLSU(lsu_id);
-  ESP_LOGI(PROCESS_REQUEST_TASK_TAG, "Received data from LSU %lu: %s", lsu_id, request->data.c_str());
+// Hands deferred failover moves to their owners, returns true once none are left
+static bool flush_moves(ShardWorker& worker) {
+  size_t sent = 0;
+  for (const ShardMessage& message : worker.pendingMoves) {
+    if (!shard_send(shard_of(message.lsuId), &message, 0)) {
+      break;
+    }
+    sent++;
+  }
+  worker.pendingMoves.erase(worker.pendingMoves.begin(), worker.pendingMoves.begin() + sent);
+  return worker.pendingMoves.empty();
+}
 
-  std::string topic = "livestock/" + std::to_string(lsu_id) + "/data";
-  mqtt_api_publish(topic.c_str(), request->data.c_str());
-  
-  // Save to NVS after updating LSU connection time
-  lsu_nvs_save(manager);
+// Gives an allocated or restored LSU to the shard owning its ID
+static bool hand_over_lsu(ShardWorker& worker, uint32_t lsu_id, uint32_t time_slot, int64_t last_seen_us,
+                          TickType_t wait, bool restored) {
+  int owner = shard_of(lsu_id);
+  if (owner == worker.shard) {
+    LSU* lsu = restored ? worker.manager.restoreLSU(lsu_id, time_slot, last_seen_us)
+                        : worker.manager.adoptLSU(lsu_id, time_slot, last_seen_us);
+    return lsu != nullptr;
+  }
+  ShardMessage message = {restored ? SHARD_MSG_RESTORE : SHARD_MSG_ADOPT, lsu_id, time_slot, last_seen_us, 0, 0, 0};
+  return shard_send(owner, &message, wait);
 }
 
-/* Functions ------------------------------------------------------------ */
-void process_requests_task(void *arg) {
-  ESP_LOGI(PROCESS_REQUEST_TASK_TAG, "Request processing task started");
+// Mirrors a packet on the coordinator, dropped when its inbox is full
+static void report_touch(ShardWorker& worker, uint32_t lsu_id) {
+  LSU* lsu = worker.manager.getLSU(lsu_id);
+  if (lsu == nullptr) {
+    return;
+  }
+  if (worker.coordinator != nullptr) {
+    worker.coordinator->touch(lsu_id, lsu->getLastConnectionTime(), lsu->getRssi(), lsu->getSnr());
+    return;
+  }
+  ShardMessage message = {SHARD_MSG_TOUCH, lsu_id, 0, lsu->getLastConnectionTime(), lsu->getRssi(), lsu->getSnr(), 0};
+  shard_send(LSU_COORDINATOR_SHARD, &message, 0);
+}
 
-  LSUManager manager;
-  
-  // Small delay to ensure display is ready
-  vTaskDelay(pdMS_TO_TICKS(1000));
-  
-  // Load LSU data from NVS on boot
-  if (lsu_nvs_load(manager)) {
-    ESP_LOGI(PROCESS_REQUEST_TASK_TAG, "Successfully restored LSU data from NVS");
-  } else {
+// One CONFIG at a time on the data radios, uplinks keep their turns in between
+static CoTask<> announce_period(std::vector<LSU_config_package_t> config_packages) {
+  size_t delivered = 0;
+  for (const LSU_config_package_t& config_package : config_packages) {
+    UartPort_t port = radio_data_port(config_package.lsu_id);
+    bool sent = co_await CU_sendConfigPackage(config_package, config_package.lsu_id, port);
+    delivered += sent ? 1 : 0;
+  }
+  ESP_LOGI(PROCESS_REQUEST_TASK_TAG, "%zu of %zu LSUs told the new period", delivered, config_packages.size());
+}
+
+// Applies a new period to the shard and sends its LSUs their rescaled slots,
+// those that miss the CONFIG drift until they time out and rejoin
+static void apply_period(ShardWorker& worker, uint32_t period_ms) {
+  if (!worker.manager.setPeriodMs(period_ms)) {
+    return;
+  }
+  std::vector<LSU_config_package_t> config_packages;
+  config_packages.reserve(worker.manager.getLSUCount());
+  for (const LSUData& data : worker.manager.getLsuSerializedData()) {
+    LSU* lsu = worker.manager.getLSU(data.id);
+    UartPort_t port = radio_data_port(data.id);
+    // Keep the link the ADR chose, the join settings if it never pushed one
+    AdrSetting setting = lsu->getLink().setting;
+    if (setting.sf == 0) {
+      setting = {rylr998_getConfig(port)->SF, ADR_MAX_POWER_DBM};
+    }
+    config_packages.push_back(LSU_config_package_t{data.id, period_ms, 0, data.timeSlotInPeriod, setting.sf,
+                                                   setting.txPower_dbm, radio_band_hz(port)});
+  }
+  if (!config_packages.empty()) {
+    coro_spawn(announce_period(std::move(config_packages)));
+  }
+}
+
+static void broadcast_period(ShardWorker& worker, uint32_t period_ms) {
+  apply_period(worker, period_ms);
+  for (int shard = 0; shard < LSU_SHARD_COUNT; shard++) {
+    if (shard == worker.shard) {
+      continue;
+    }
+    ShardMessage message = {SHARD_MSG_PERIOD, 0, period_ms, 0, 0, 0, 0};
+    if (!shard_send(shard, &message, SHARD_SEND_WAIT)) {
+      ESP_LOGE(PROCESS_REQUEST_TASK_TAG, "Shard %d busy, period %lu not applied", shard, period_ms);
+    }
+  }
+}
+
+void handle_shard_messages(ShardWorker& worker) {
+  char result[MQTT_REPLY_MAX_LEN];
+  ShardMessage message;
+
+  while (shard_receive(worker.shard, &message)) {
+    switch (message.type) {
+      case SHARD_MSG_ADOPT:
+      case SHARD_MSG_RESTORE: {
+        LSU* lsu = message.type == SHARD_MSG_RESTORE
+                     ? worker.manager.restoreLSU(message.lsuId, message.value, message.time_us)
+                     : worker.manager.adoptLSU(message.lsuId, message.value, message.time_us);
+        if (lsu == nullptr && worker.manager.getLSU(message.lsuId) == nullptr) {
+          on_lsu_removed(message.lsuId, &worker); // Full, give the ID back
+        }
+        break;
+      }
+      case SHARD_MSG_REMOVE: {
+        if (worker.manager.removeLSU(message.lsuId)) {
+          snprintf(result, sizeof(result), "OK");
+        } else {
+          snprintf(result, sizeof(result), "ERR LSU %lu not found", message.lsuId);
+        }
+        ESP_LOGI(PROCESS_REQUEST_TASK_TAG, "Command %lu (shard %d): %s", message.correlation_id, worker.shard, result);
+        hal_publish_reply(message.correlation_id, result);
+        break;
+      }
+      case SHARD_MSG_PERIOD: {
+        apply_period(worker, message.value);
+        break;
+      }
+      case SHARD_MSG_RELEASED: {
+        if (worker.coordinator != nullptr && worker.coordinator->release(message.lsuId)) {
+          save_fleet(worker);
+        }
+        break;
+      }
+      case SHARD_MSG_TOUCH: {
+        if (worker.coordinator != nullptr) {
+          worker.coordinator->touch(message.lsuId, message.time_us, message.rssi, message.snr);
+        }
+        break;
+      }
+      case SHARD_MSG_MOVED: {
+        worker.manager.moveLSU(message.lsuId, message.value);
+        break;
+      }
+    }
+  }
+}
+
+// Loads the fleet and hands every LSU to its shard, period first so the
+// shards arm their timeouts with it and have no LSU to announce it to
+static void restore_fleet(ShardWorker& worker) {
+  FleetCoordinator& coordinator = *worker.coordinator;
+  if (!lsu_nvs_load(coordinator)) {
     ESP_LOGI(PROCESS_REQUEST_TASK_TAG, "No LSU data found in NVS or failed to load");
+    return;
+  }
+  ESP_LOGI(PROCESS_REQUEST_TASK_TAG, "Successfully restored LSU data from NVS");
+
+  broadcast_period(worker, coordinator.getPeriodMs());
+  for (const LSUData& data : coordinator.getLsuSerializedData()) {
+    if (!hand_over_lsu(worker, data.id, data.timeSlotInPeriod, data.lastConnectionTime_us, SHARD_RESTORE_WAIT, true)) {
+      ESP_LOGE(PROCESS_REQUEST_TASK_TAG, "Shard %d did not take restored LSU %lu", shard_of(data.id), data.id);
+      coordinator.release(data.id);
+    }
   }
+  worker.savedVersion = coordinator.getSnapshot().getVersion();
+}
+
+// Runs on the coroutine executor, the shard moves on while the radio works
+static CoTask<> join_handshake(LSU_config_package_t config_package, uint32_t lsu_id_to_send) {
+  uint32_t lsu_id = config_package.lsu_id;
+  bool delivered = co_await CU_sendJoinConfig(config_package, lsu_id_to_send);
+  if (!delivered) {
+    ESP_LOGW(PROCESS_REQUEST_TASK_TAG, "Config for LSU %lu not sent, it will time out unless it retries", lsu_id);
+    co_return;
+  }
+
+  // Publish device linking notification to MQTT
+  char topic[LSU_TOPIC_MAX_LEN];
+  lsu_format_topic(topic, sizeof(topic), lsu_id, LSU_TOPIC_LINK);
+  std::string payload = "Device linked with ID: " + std::to_string(lsu_id) + 
+                        ", Time slot: " + std::to_string(config_package.time_slot_ms) + 
+                        ", Period: " + std::to_string(config_package.period_ms) + "ms";
+  hal_publish_queued(topic, payload.c_str(), false);
   
-  uint32_t last_timeout_check_ms = 0;
-  const uint32_t TIMEOUT_CHECK_INTERVAL_MS = 10000; // Check every 10 seconds
+  ESP_LOGI(PROCESS_REQUEST_TASK_TAG, "Published device link notification to MQTT topic: %s", topic);
+}
 
-  while (1) {
-    Request* request = get_request();
-    if (request != NULL) {
-      ESP_LOGI(PROCESS_REQUEST_TASK_TAG, "Processing request from ID: %u, Type: %d", request->from_id, request->type);
-      
-      // All enum values are handled in this switch statement
-      switch (request->type) {
-        case REQUEST_TYPE_SYNC: {
-          ESP_LOGI(PROCESS_REQUEST_TASK_TAG, "Sync request received");
-          process_sync_request(request, manager);
-          break;
+void process_sync_request(Request* request, ShardWorker& worker) {
+  FleetCoordinator& coordinator = *worker.coordinator;
+  uint32_t lsu_id;        // ID assigned to the LSU
+  uint32_t lsu_time_slot;
+  if (!coordinator.allocate(&lsu_id, &lsu_time_slot)) {
+    ESP_LOGW(PROCESS_REQUEST_TASK_TAG, "Failed to create LSU");
+    return;
+  }
+  if (!hand_over_lsu(worker, lsu_id, lsu_time_slot, hal_time_us(), SHARD_SEND_WAIT, false)) {
+    ESP_LOGW(PROCESS_REQUEST_TASK_TAG, "Shard %d did not take LSU %lu", shard_of(lsu_id), lsu_id);
+    coordinator.release(lsu_id);
+    return;
+  }
+
+  ESP_LOGI(PROCESS_REQUEST_TASK_TAG, "LSU created successfully");
+  uint32_t lsu_id_to_send = request->from_id; // old ID of the sender, loses meaning after sync
+
+  uint32_t period_ms = coordinator.getPeriodMs();
+  int64_t time_since_boot_ms = hal_time_us() / 1000;
+  uint32_t now_ms = time_since_boot_ms % period_ms;
+
+  // A new LSU starts at full power on its data channel, the ADR lowers it once its uplinks are averaged
+  UartPort_t data_port = radio_data_port(lsu_id);
+  LSU_config_package_t config_package(
+    lsu_id,
+    period_ms,
+    now_ms,
+    lsu_time_slot,
+    rylr998_getConfig(data_port)->SF,
+    ADR_MAX_POWER_DBM,
+    radio_band_hz(data_port)
+  );
+  coro_spawn(join_handshake(config_package, lsu_id_to_send));
+  
+  // Save to NVS after creating LSU
+  save_fleet(worker);
+}
+
+static CoTask<> push_link_settings(LSU_config_package_t config_package, UartPort_t port) {
+  bool delivered = co_await CU_sendConfigPackage(config_package, config_package.lsu_id, port);
+  if (!delivered) {
+    ESP_LOGW(PROCESS_REQUEST_TASK_TAG, "Link settings for LSU %lu not sent", config_package.lsu_id);
+  }
+}
+
+// Pushes a new SF and TX power once the averaged link allows or needs one
+static void adapt_data_rate(ShardWorker& worker, uint32_t lsu_id) {
+  LSU* lsu = worker.manager.getLSU(lsu_id);
+  if (lsu == nullptr) {
+    return;
+  }
+  UartPort_t port = radio_data_port(lsu_id);
+  AdrSetting next;
+  AdrLink& link = lsu->getLink();
+  if (!adr_link_due(link, rylr998_getConfig(port)->SF, &next)) {
+    return;
+  }
+  ESP_LOGI(PROCESS_REQUEST_TASK_TAG, "LSU %lu at SNR %ld/16 dB moves to SF%u, %u dBm", lsu_id, (long) link.snr_q4,
+           next.sf, next.txPower_dbm);
+  adr_link_apply(link, next);
+
+  uint32_t period_ms = worker.manager.getPeriodMs();
+  uint32_t now_ms = (hal_time_us() / 1000) % period_ms;
+  LSU_config_package_t config_package(lsu_id, period_ms, now_ms, lsu->getTimeSlotInPeriod(), next.sf,
+                                      next.txPower_dbm, radio_band_hz(port));
+  coro_spawn(push_link_settings(config_package, port));
+}
+
+// The LSUs still listen on their old channel, the radio they move to borrows it a batch at a time
+static CoTask<> migrate_lsus(std::vector<LSU_config_package_t> config_packages, UartPort_t port, uint32_t band_hz) {
+  size_t delivered = 0;
+  for (size_t i = 0; i < config_packages.size(); i += FAILOVER_BATCH) {
+    size_t count = std::min<size_t>(FAILOVER_BATCH, config_packages.size() - i);
+    size_t sent = co_await CU_sendConfigBatch(config_packages.data() + i, count, port, band_hz);
+    delivered += sent;
+  }
+  ESP_LOGW(PROCESS_REQUEST_TASK_TAG, "%zu of %zu LSUs told to move to radio %d", delivered, config_packages.size(),
+           port);
+}
+
+// Points the LSUs at the channel of port, those that miss the CONFIG rejoin
+static void move_lsus(ShardWorker& worker, const std::vector<FleetEntry>& moved, UartPort_t port) {
+  // Full power on the new radio's SF, the ADR starts over on the new link
+  uint32_t period_ms = worker.coordinator->getPeriodMs();
+  std::vector<LSU_config_package_t> config_packages;
+  config_packages.reserve(moved.size());
+  for (const FleetEntry& entry : moved) {
+    ShardMessage message = {SHARD_MSG_MOVED, entry.id, entry.timeSlotInPeriod, 0, 0, 0, 0};
+    if (shard_of(entry.id) == worker.shard) {
+      worker.manager.moveLSU(entry.id, entry.timeSlotInPeriod);
+    } else {
+      worker.pendingMoves.push_back(message);
+    }
+    config_packages.push_back(LSU_config_package_t{entry.id, period_ms, 0, entry.timeSlotInPeriod,
+                                                   rylr998_getConfig(port)->SF, ADR_MAX_POWER_DBM,
+                                                   radio_band_hz(port)});
+  }
+  flush_moves(worker);
+  if (!config_packages.empty()) {
+    coro_spawn(migrate_lsus(std::move(config_packages), port, radio_band_hz(radio_other_port(port))));
+  }
+}
+
+// Moves every LSU of a failed radio to the other one
+static void fail_over(ShardWorker& worker, UartPort_t failed) {
+  UartPort_t survivor = radio_other_port(failed);
+  std::vector<FleetEntry> moved;
+  worker.coordinator->rehome(failed, &moved);
+  move_lsus(worker, moved, survivor);
+  if (failed == RADIO_JOIN_PORT) {
+    ESP_LOGW(PROCESS_REQUEST_TASK_TAG, "Join radio lost, radio %d listens for joins between its uplinks", survivor);
+  }
+
+  char payload[MQTT_REPLY_MAX_LEN];
+  snprintf(payload, sizeof(payload), "FAILED radio=%d reason=%s moved=%zu survivor=%d", failed,
+           radio_health_reason(failed), moved.size(), survivor);
+  hal_publish(RADIO_HEALTH_TOPIC, payload, true);
+  save_fleet(worker);
+}
+
+// Sends the LSUs of a radio back to it once it answers again. Their slots were
+// planned against both channels, they still fit on their own.
+static void recover(ShardWorker& worker, UartPort_t port) {
+  std::vector<FleetEntry> moved;
+  for (const auto& [id, entry] : worker.coordinator->getSnapshot().getEntries()) {
+    if (radio_home_port(id) == port) {
+      moved.push_back(entry);
+    }
+  }
+  move_lsus(worker, moved, port);
+
+  char payload[MQTT_REPLY_MAX_LEN];
+  snprintf(payload, sizeof(payload), "RECOVERED radio=%d moved=%zu", port, moved.size());
+  hal_publish(RADIO_HEALTH_TOPIC, payload, true);
+  save_fleet(worker);
+}
+
+// Where an LSU is next expected at or after from_us: where it was last heard,
+// which follows its drift, unless that was its SYNC and not an uplink
+static int64_t next_uplink_us(const FleetEntry& entry, uint32_t period_ms, int64_t from_us) {
+  int64_t period_us = (int64_t) period_ms * 1000;
+  int64_t slot_us = (int64_t) entry.timeSlotInPeriod * 1000;
+  int64_t skew_us = ((entry.lastSeen_us - slot_us) % period_us + period_us) % period_us;
+  if (skew_us > period_us / 2) {
+    skew_us -= period_us;
+  }
+  int64_t phase_us = std::abs(skew_us) <= JOIN_LISTEN_MAX_SKEW_MS * 1000LL ? slot_us + skew_us : slot_us;
+  return from_us + ((phase_us - from_us) % period_us + period_us) % period_us;
+}
+
+static CoTask<> join_listener(std::vector<JoinWindow> windows, UartPort_t port) {
+  for (const JoinWindow& window : windows) {
+    int64_t wait_us = window.start_us - hal_time_us();
+    if (wait_us > 0) {
+      co_await co_sleep_ms((uint32_t) (wait_us / 1000));
+    }
+    co_await CU_listenJoins(port, radio_band_hz(RADIO_JOIN_PORT), window.end_us);
+  }
+}
+
+// The survivor of a failed join radio listens on the join channel in the gaps
+// between the uplinks it expects, a round at a time so new slots are seen
+static void listen_for_joins(ShardWorker& worker) {
+  UartPort_t port = radio_other_port(RADIO_JOIN_PORT);
+  int64_t start_us = hal_time_us();
+  if (radio_health_alive(RADIO_JOIN_PORT) || !radio_health_alive(port) || start_us < joinRoundEnd_us) {
+    return;
+  }
+
+  FleetCoordinator& coordinator = *worker.coordinator;
+  uint32_t period_ms = coordinator.getPeriodMs();
+  int64_t period_us = (int64_t) period_ms * 1000;
+  int64_t end_us = start_us + JOIN_LISTEN_ROUND_MS * 1000LL;
+  std::vector<JoinWindow> busy;
+  for (const auto& [id, entry] : coordinator.getSnapshot().getEntries()) {
+    // An uplink just before the round may still be waiting for its ACK
+    int64_t uplink_us = next_uplink_us(entry, period_ms, start_us - JOIN_LISTEN_HOLD_MS * 1000LL);
+    for (; uplink_us < end_us + JOIN_LISTEN_GUARD_MS * 1000LL; uplink_us += period_us) {
+      busy.push_back(JoinWindow{uplink_us - JOIN_LISTEN_GUARD_MS * 1000LL, uplink_us + JOIN_LISTEN_HOLD_MS * 1000LL});
+    }
+  }
+  std::sort(busy.begin(), busy.end(),
+            [](const JoinWindow& a, const JoinWindow& b) { return a.start_us < b.start_us; });
+
+  std::vector<JoinWindow> windows;
+  int64_t free_us = start_us;
+  for (const JoinWindow& uplink : busy) {
+    if (uplink.start_us - free_us >= JOIN_LISTEN_MIN_MS * 1000LL) {
+      windows.push_back(JoinWindow{free_us, uplink.start_us});
+    }
+    free_us = std::max(free_us, uplink.end_us);
+  }
+  if (end_us - free_us >= JOIN_LISTEN_MIN_MS * 1000LL) {
+    windows.push_back(JoinWindow{free_us, end_us});
+  }
+  joinRoundEnd_us = end_us;
+  if (windows.empty()) {
+    return;
+  }
+  coro_spawn(join_listener(std::move(windows), port));
+}
+
+// Probes a silent or failed radio, moves the LSUs of a dead or recovered one and covers for a dead join radio
+static void check_radios(ShardWorker& worker) {
+  for (int port = 0; port < RADIO_COUNT; port++) {
+    RadioVerdict verdict = radio_health_check((UartPort_t) port);
+    if (verdict == RADIO_VERDICT_PROBE) {
+      CU_probeRadio((UartPort_t) port);
+    } else if (verdict == RADIO_VERDICT_FAILED) {
+      fail_over(worker, (UartPort_t) port);
+    } else if (verdict == RADIO_VERDICT_RECOVERED) {
+      recover(worker, (UartPort_t) port);
+    }
+  }
+  listen_for_joins(worker);
+}
+
+void publish_lsu_data(const Request& request, LSUManager& manager) {
+  uint32_t lsu_id = request.from_id;
+  const char *data = request.data;
+
+  LSU* lsu = manager.getLSU(lsu_id);
+  if (lsu != nullptr) {
+    int64_t start_us = hal_time_us();
+    manager.keepaliveLSU(lsu_id, request.rssi, request.snr);
+    start_us = latency_record_since(LATENCY_STAGE_KEEPALIVE, start_us);
+    hal_publish(lsu->getTopic(LSU_TOPIC_DATA), data, false);
+    latency_record_since(LATENCY_STAGE_PUBLISH, start_us);
+    return;
+  }
+
+  // Unregistered sender, format its topic on the stack
+  char topic[LSU_TOPIC_MAX_LEN];
+  lsu_format_topic(topic, sizeof(topic), lsu_id, LSU_TOPIC_DATA);
+  int64_t start_us = hal_time_us();
+  hal_publish(topic, data, false);
+  latency_record_since(LATENCY_STAGE_PUBLISH, start_us);
+}
+
+void process_data_request(Request* request, ShardWorker& worker) {
+  uint32_t lsu_id = request->from_id;
+
+  // Queued on the executor, the ACK stage is recorded once the radio answers
+  CU_sendDataAck(lsu_id, request->sourcePort);
+  log_ring_write(LOG_FMT_PROCESS_DATA, request->data, lsu_id, 0, 0, 0);
+  publish_lsu_data(*request, worker.manager);
+  latency_record_since(LATENCY_STAGE_END_TO_END, request->received_us);
+  adapt_data_rate(worker, lsu_id);
+
+  // The coordinator saves the connection time with its next periodic save
+  report_touch(worker, lsu_id);
+}
+
+void process_command(const Command& command, ShardWorker& worker) {
+  char result[MQTT_REPLY_MAX_LEN];
+  FleetCoordinator& coordinator = *worker.coordinator;
+
+  switch (command.type) {
+    case COMMAND_TYPE_REMOVE: {
+      int owner = shard_of(command.arg);
+      if (!coordinator.contains(command.arg)) {
+        snprintf(result, sizeof(result), "ERR LSU %lu not found", command.arg);
+      } else if (owner == worker.shard) {
+        if (worker.manager.removeLSU(command.arg)) {
+          snprintf(result, sizeof(result), "OK");
+        } else {
+          snprintf(result, sizeof(result), "ERR LSU %lu not found", command.arg);
         }
-        case REQUEST_TYPE_DATA: {
-          ESP_LOGI(PROCESS_REQUEST_TASK_TAG, "Data request received");
-          process_data_request(request, manager);
-          break;
+      } else {
+        // The owner removes it and replies, the release comes back by message
+        ShardMessage message = {SHARD_MSG_REMOVE, command.arg, 0, 0, 0, 0, command.correlation_id};
+        if (shard_send(owner, &message, SHARD_SEND_WAIT)) {
+          return;
         }
-
-        default:
-          [[deprecated]];
-          ESP_LOGW(PROCESS_REQUEST_TASK_TAG, "Unknown request type: %d", request->type);
-          break;
+        snprintf(result, sizeof(result), "ERR shard %d busy", owner);
+      }
+      break;
+    }
+    case COMMAND_TYPE_PERIOD: {
+      if (coordinator.setPeriodMs(command.arg)) {
+        broadcast_period(worker, command.arg);
+        save_fleet(worker);
+        snprintf(result, sizeof(result), "OK period=%lu", command.arg);
+      } else {
+        snprintf(result, sizeof(result), "ERR period out of range [%d, %d]", LSU_MIN_PERIOD_MS, LSU_MAX_PERIOD_MS);
       }
+      break;
     }
+    case COMMAND_TYPE_DIAG: {
+      snprintf(result, sizeof(result), "OK lsus=%zu period=%lu heap=%lu uptime_s=%lld",
+               coordinator.getLSUCount(), coordinator.getPeriodMs(), hal_free_heap(),
+               hal_time_us() / 1000000);
+      break;
+    }
+    case COMMAND_TYPE_TRACE_START: {
+      if (uart_trace_start()) {
+        snprintf(result, sizeof(result), "OK");
+      } else {
+        snprintf(result, sizeof(result), "ERR no trace partition");
+      }
+      break;
+    }
+    case COMMAND_TYPE_TRACE_STOP: {
+      uart_trace_stats_t stats;
+      uart_trace_stop();
+      uart_trace_get_stats(&stats);
+      snprintf(result, sizeof(result), "OK records=%lu dropped=%lu full=%d", (unsigned long) stats.records,
+               (unsigned long) stats.dropped, stats.full);
+      break;
+    }
+    case COMMAND_TYPE_TRACE_EXPORT: {
+      uart_trace_stats_t stats;
+      uart_trace_get_stats(&stats);
+      if (stats.active) {
+        snprintf(result, sizeof(result), "ERR capture running, send TRACE_STOP first");
+      } else if (!uart_trace_export_begin()) {
+        snprintf(result, sizeof(result), "ERR no trace or still flushing, retry");
+      } else {
+        snprintf(result, sizeof(result), "OK bytes=%lu topic=%s", (unsigned long) stats.bytes, UART_TRACE_TOPIC);
+      }
+      break;
+    }
+    default:
+      snprintf(result, sizeof(result), "ERR unknown command");
+      break;
+  }
+
+  ESP_LOGI(PROCESS_REQUEST_TASK_TAG, "Command %lu (type %d): %s", command.correlation_id, command.type, result);
+  hal_publish_reply(command.correlation_id, result);
+}
+
+void publish_fleet_snapshot(FleetCoordinator& coordinator) {
+  static bool was_connected = false;
+  FleetSnapshot& snapshot = coordinator.getSnapshot();
+
+  // The broker may have dropped the retained copy while we were away
+  bool connected = hal_publish_connected();
+  if (connected && !was_connected) {
+    snapshot.invalidate();
+  }
+  was_connected = connected;
+
+  int64_t now_us = hal_time_us();
+  if (connected && snapshot.isPublishDue(now_us)) {
+    const std::string& payload = snapshot.serialize(now_us, coordinator.getPeriodMs());
+    hal_publish(FLEET_SNAPSHOT_TOPIC, payload.c_str(), true);
+  }
+}
+
+// Lower is worse, LSUs without a packet since boot rank below any measured link
+static int32_t link_rank(const FleetEntry& entry) {
+  return entry.rssi == 0 ? INT32_MIN : entry.rssi;
+}
+
+void publish_status_diagnostics(FleetCoordinator& coordinator) {
+  static int64_t last_publish_us = 0;
+  static uint32_t published_version = UINT32_MAX;
+
+  int64_t now_us = hal_time_us();
+  if (now_us - last_publish_us < STATUS_DIAGNOSTICS_INTERVAL_US) {
+    return;
+  }
+  last_publish_us = now_us;
+
+  hal_display_queue_depths(request_queue_depth(UART_PORT_MAIN), request_queue_depth(UART_PORT_AUX),
+                      command_queue_depth());
+
+  const FleetSnapshot& snapshot = coordinator.getSnapshot();
+  if (snapshot.getVersion() == published_version) {
+    return;
+  }
+  published_version = snapshot.getVersion();
+
+  // Keep the weakest links by insertion into a fixed array, the display never
+  // walks the registry
+  status_lsu_row_t rows[STATUS_MAX_LSU_ROWS];
+  int32_t ranks[STATUS_MAX_LSU_ROWS];
+  uint8_t count = 0;
+  for (const auto& [id, entry] : snapshot.getEntries()) {
+    int32_t rank = link_rank(entry);
+    if (count == STATUS_MAX_LSU_ROWS && rank >= ranks[count - 1]) {
+      continue;
+    }
+    int pos = count < STATUS_MAX_LSU_ROWS ? count++ : count - 1;
+    while (pos > 0 && ranks[pos - 1] > rank) {
+      rows[pos] = rows[pos - 1];
+      ranks[pos] = ranks[pos - 1];
+      pos--;
+    }
+    rows[pos] = {entry.id, entry.timeSlotInPeriod, entry.lastSeen_us, entry.rssi, entry.snr};
+    ranks[pos] = rank;
+  }
+  hal_display_lsu_rows(rows, count);
+}
 
-    // Check for LSU timeouts every 10 seconds
-    uint32_t current_time_ms = esp_timer_get_time() / 1000; // Convert to milliseconds
-    if (current_time_ms - last_timeout_check_ms >= TIMEOUT_CHECK_INTERVAL_MS) {
-      manager.processTimeouts();
-      // Save to NVS after processing timeouts (in case LSUs were removed)
-      lsu_nvs_save(manager);
-      last_timeout_check_ms = current_time_ms;
+void publish_latency_stats() {
+  static int64_t window_start_us = 0;
+  static char payload[LATENCY_STATS_MAX_LEN];
+
+  int64_t now_us = hal_time_us();
+  if (now_us - window_start_us < LATENCY_STATS_INTERVAL_US) {
+    return;
+  }
+
+  LatencySummary summaries[LATENCY_STAGE_COUNT];
+  latency_collect(summaries);
+  latency_log(summaries);
+  latency_format(summaries, (uint32_t) ((now_us - window_start_us) / 1000000), payload, sizeof(payload));
+  window_start_us = now_us;
+
+  if (hal_publish_connected()) {
+    hal_publish(LATENCY_STATS_TOPIC, payload, false);
+  }
+}
+
+// The TX scheduler keeps the CU frames out of the slots the LSUs transmit in, per radio
+void update_uplink_slots(FleetCoordinator& coordinator) {
+  static uint32_t scheduled_version = UINT32_MAX;
+  static uint32_t scheduled_period_ms = 0;
+  static bool scheduled_alive[RADIO_COUNT] = {};
+
+  const FleetSnapshot& snapshot = coordinator.getSnapshot();
+  uint32_t period_ms = coordinator.getPeriodMs();
+  // A radio failing or coming back moves uplinks without touching the snapshot
+  bool alive[RADIO_COUNT];
+  bool same_radios = true;
+  for (int port = 0; port < RADIO_COUNT; port++) {
+    alive[port] = radio_health_alive((UartPort_t) port);
+    same_radios = same_radios && alive[port] == scheduled_alive[port];
+  }
+  if (snapshot.getVersion() == scheduled_version && period_ms == scheduled_period_ms && same_radios) {
+    return;
+  }
+  scheduled_version = snapshot.getVersion();
+  scheduled_period_ms = period_ms;
+  std::copy(alive, alive + RADIO_COUNT, scheduled_alive);
+
+  static uint32_t slots_ms[RADIO_COUNT][MAX_LSU_COUNT];
+  size_t count[RADIO_COUNT] = {};
+  for (const auto& [id, entry] : snapshot.getEntries()) {
+    int port = radio_data_port(id);
+    if (count[port] < MAX_LSU_COUNT) {
+      slots_ms[port][count[port]++] = entry.timeSlotInPeriod;
     }
+  }
+  for (int port = 0; port < RADIO_COUNT; port++) {
+    std::sort(slots_ms[port], slots_ms[port] + count[port]);
+    tx_scheduler_set_uplinks((UartPort_t) port, slots_ms[port], count[port], period_ms);
+  }
+}
+
+void publish_airtime_stats() {
+  static int64_t window_start_us = 0;
+  static char payload[TX_SCHEDULER_MAX_LEN];
+
+  int64_t now_us = hal_time_us();
+  if (now_us - window_start_us < LATENCY_STATS_INTERVAL_US) {
+    return;
+  }
+  window_start_us = now_us;
+
+  TxRadioStats stats[RADIO_COUNT];
+  int64_t window_us;
+  tx_scheduler_collect(stats, &window_us);
+  tx_scheduler_format(stats, window_us, payload, sizeof(payload));
+  ESP_LOGI(PROCESS_REQUEST_TASK_TAG, "Airtime: %s", payload);
+  if (hal_publish_connected()) {
+    hal_publish(AIRTIME_STATS_TOPIC, payload, false);
+  }
+}
+
+/* Functions ------------------------------------------------------------ */
+void shard_worker_init(ShardWorker& worker, int shard) {
+  worker.shard = shard;
+  worker.coordinator = shard == LSU_COORDINATOR_SHARD ? &fleetCoordinator : nullptr;
+  worker.savedVersion = 0;
+  worker.lastSave_us = 0;
+  worker.manager.setRemovedCallback(on_lsu_removed, &worker);
+}
+
+void shard_worker_restore(ShardWorker& worker) {
+  // Load LSU data from NVS on boot, the coordinator hands it to the shards
+  if (worker.coordinator != nullptr) {
+    restore_fleet(worker);
+  }
+}
+
+uint32_t shard_worker_step(ShardWorker& worker, uint32_t wake) {
+  handle_shard_messages(worker);
+
+  uint32_t hold_ms = 0;
+  Request request;
+  while (get_request(worker.shard, &hold_ms, &request)) {
+    log_ring_write(LOG_FMT_PROCESS_REQUEST, NULL, request.from_id, request.type, 0, 0);
     
-    vTaskDelay(pdMS_TO_TICKS(100));
+    // All enum values are handled in this switch statement
+    switch (request.type) {
+      case REQUEST_TYPE_SYNC: {
+        ESP_LOGI(PROCESS_REQUEST_TASK_TAG, "Sync request received");
+        if (worker.coordinator != nullptr) {
+          process_sync_request(&request, worker);
+        }
+        break;
+      }
+      case REQUEST_TYPE_DATA: {
+        process_data_request(&request, worker);
+        break;
+      }
+
+      default:
+        ESP_LOGW(PROCESS_REQUEST_TASK_TAG, "Unknown request type: %d", request.type);
+        break;
+    }
+  }
+
+  if (worker.coordinator != nullptr) {
+    // Drain every pending downlink command so bursts do not back up the queue
+    Command command;
+    while (get_command(&command)) {
+      process_command(command, worker);
+    }
+
+    // Membership changes go out right away, link/age updates are throttled
+    publish_fleet_snapshot(*worker.coordinator);
+    publish_status_diagnostics(*worker.coordinator);
+    publish_latency_stats();
+    update_uplink_slots(*worker.coordinator);
+    publish_airtime_stats();
+    if (wake & SHARD_WAKE_HOUSEKEEPING) {
+      check_radios(worker);
+      uart_trace_export_step(TRACE_EXPORT_CHUNKS);
+    }
+
+    // Membership and period are saved when they change, the rest in batches
+    int64_t now_us = hal_time_us();
+    if (worker.coordinator->getSnapshot().getVersion() != worker.savedVersion &&
+        now_us - worker.lastSave_us >= FLEET_SAVE_INTERVAL_US) {
+      save_fleet(worker);
+    }
+  }
+
+  // Removals reach the coordinator through on_lsu_removed
+  if (wake & SHARD_WAKE_TIMEOUTS) {
+    worker.manager.processTimeouts();
+  }
+  bool flushed = flush_releases(worker);
+  flushed = flush_moves(worker) && flushed;
+  if (!flushed && (hold_ms == 0 || hold_ms > RELEASE_RETRY_MS)) {
+    hold_ms = RELEASE_RETRY_MS;
+  }
+  return hold_ms;
+}
+
+void process_requests_task(void *arg) {
+  int shard = *(const int*) arg;
+  ESP_LOGI(PROCESS_REQUEST_TASK_TAG, "Request processing task started (shard %d)", shard);
+
+  ShardWorker worker;
+  shard_worker_init(worker, shard);
+
+  // The worker sleeps until a producer or one of its timers wakes it
+  TaskHandle_t self = xTaskGetCurrentTaskHandle();
+  shard_attach(shard, self);
+  timer_id_t holdTimer = timer_service_create_notify(holdTimerNames[shard], self, SHARD_WAKE_REQUEST);
+  timer_id_t timeoutTimer = timer_service_create_notify(timeoutTimerNames[shard], self, SHARD_WAKE_TIMEOUTS);
+  timer_service_start_periodic(timeoutTimer, TIMEOUT_CHECK_INTERVAL_MS);
+  if (worker.coordinator != nullptr) {
+    timer_id_t housekeepingTimer = timer_service_create_notify("fleet_upkeep", self, SHARD_WAKE_HOUSEKEEPING);
+    timer_service_start_periodic(housekeepingTimer, HOUSEKEEPING_INTERVAL_MS);
+  }
+  
+  // Small delay to ensure display is ready
+  vTaskDelay(pdMS_TO_TICKS(1000));
+  shard_worker_restore(worker);
+
+  uint32_t wake = SHARD_WAKE_ALL;
+  while (1) {
+    // The next request is still held, come back when it is due
+    uint32_t hold_ms = shard_worker_step(worker, wake);
+    if (hold_ms > 0) {
+      timer_service_start_once(holdTimer, hold_ms);
+    }
+    xTaskNotifyWait(0, UINT32_MAX, &wake, portMAX_DELAY);
   }
 }
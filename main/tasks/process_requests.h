@@ -9,7 +9,70 @@
 #ifndef PROCESS_REQUESTS_H
 #define PROCESS_REQUESTS_H
 
+/* Includes ------------------------------------------------------------ */
+#include <vector>
+#include "LSUManager.h"
+#include "FleetCoordinator.h"
+#include "shard_router.h"
+#include "request_queue.h"
+
+/* Defines ------------------------------------------------------------- */
+#define TIMEOUT_CHECK_INTERVAL_MS 10000  // Check every 10 seconds
+#define HOUSEKEEPING_INTERVAL_MS  1000   // Coordinator publishing and batched saves
+
+/* Structs ------------------------------------------------------------- */
+/**
+ * @brief State of one shard, touched by its task only
+ */
+struct ShardWorker {
+  int shard;
+  LSUManager manager;             // LSUs owned by this shard
+  FleetCoordinator *coordinator;  // Coordinator shard only, nullptr otherwise
+  uint32_t savedVersion;          // Snapshot version last written to NVS
+  int64_t lastSave_us;
+  std::vector<uint32_t> pendingReleases;  // Removals the coordinator inbox had no room for yet
+  std::vector<ShardMessage> pendingMoves; // Failover moves the owner inbox had no room for yet, coordinator only
+};
+
 /* Function ------------------------------------------------------------ */
+/**
+ * @brief Owns the LSUs of one shard and processes their requests
+ * @details The coordinator shard also handles joins, commands, persistence
+ *          and the fleet publishes, see shard_router.h
+ * @param arg Pointer to the int index of the shard
+ */
 void process_requests_task(void *arg);
 
+/**
+ * @brief Set up a shard, the coordinator shard gets the fleet coordinator
+ * @param worker Worker to initialize
+ * @param shard Index of the shard
+ */
+void shard_worker_init(ShardWorker& worker, int shard);
+
+/**
+ * @brief Load the fleet from NVS and hand it to the shards, coordinator only
+ * @param worker Initialized worker
+ */
+void shard_worker_restore(ShardWorker& worker);
+
+/**
+ * @brief One pass of the worker loop, never blocks on an empty queue
+ * @details process_requests_task() calls it on every wake-up. Host tools
+ *          drive it directly to run the shards without tasks or timers.
+ * @param worker Initialized worker
+ * @param wake SHARD_WAKE_* bits that caused the pass
+ * @return Time left before the next held request or release retry is due, 0 if none
+ */
+uint32_t shard_worker_step(ShardWorker& worker, uint32_t wake);
+
+/**
+ * @brief ACK, publish and link upkeep of one DATA uplink
+ * @details Does not touch the heap once every coroutine it spawns has run
+ *          once, the ESP-IDF MQTT outbox allocates on its own
+ * @param request DATA request taken from the shard queue
+ * @param worker Worker of the shard owning the sender
+ */
+void process_data_request(Request* request, ShardWorker& worker);
+
 #endif /* PROCESS_REQUESTS_H */
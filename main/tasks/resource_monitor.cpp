@@ -0,0 +1,208 @@
+/**
+ * ******************************************************************************
+  * @authors        : Tomas Gonzalez & Brian Morris
+  * @file           : resource_monitor.cpp
+  * @brief          : Task - Samples stack margins, CPU share and heap
+  *                   fragmentation, publishes them and raises alerts
+  * ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------ */
+#include "resource_monitor.h"
+
+#include <stdio.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "timer_service.h"
+
+#include "wi-fi/mqtt_api.h"
+
+/* Defines ------------------------------------------------------------- */
+#define RESOURCE_HEAP_CAPS    (MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT)
+#define RESOURCE_PAYLOAD_LEN  1024
+#define RESOURCE_ALERT_LEN    96
+
+/* Private types ------------------------------------------------------- */
+struct TrackedTask {
+  UBaseType_t number;         /**< xTaskNumber, 0 when the slot is free */
+  uint32_t prevRunTime;       /**< Run time counter at the previous sample */
+  uint32_t cpuPermille;       /**< Share of both cores over the last sample */
+  bool stackAlerted;
+  bool seen;
+};
+
+struct HeapSample {
+  size_t free;
+  size_t minFree;
+  size_t largestBlock;
+  uint32_t fragPct;
+};
+
+/* Private variables --------------------------------------------------------- */
+static const char *RESOURCE_MONITOR_TAG = "Resources";
+
+// Static so that sampling never allocates, the heap is what we are watching
+static TaskStatus_t taskStatus[RESOURCE_MAX_TASKS];
+static TrackedTask trackedTasks[RESOURCE_MAX_TASKS];
+static UBaseType_t taskCount = 0;
+static uint32_t prevTotalRunTime = 0;
+static char payload[RESOURCE_PAYLOAD_LEN];
+
+static bool heapLowAlerted = false;
+static bool heapFragAlerted = false;
+
+/* Private functions --------------------------------------------------------- */
+static void raise_alert(const char *alert) {
+  ESP_LOGW(RESOURCE_MONITOR_TAG, "ALERT %s", alert);
+  if (mqtt_api_is_connected()) {
+    mqtt_api_publish(RESOURCE_ALERT_TOPIC, alert);
+  }
+}
+
+static TrackedTask* track(UBaseType_t number) {
+  TrackedTask *freeSlot = nullptr;
+  for (int i = 0; i < RESOURCE_MAX_TASKS; i++) {
+    if (trackedTasks[i].number == number) {
+      return &trackedTasks[i];
+    }
+    if (freeSlot == nullptr && trackedTasks[i].number == 0) {
+      freeSlot = &trackedTasks[i];
+    }
+  }
+  if (freeSlot != nullptr) {
+    *freeSlot = {number, 0, 0, false, false};
+  }
+  return freeSlot;
+}
+
+static HeapSample sample_heap() {
+  HeapSample heap;
+  heap.free = heap_caps_get_free_size(RESOURCE_HEAP_CAPS);
+  heap.minFree = heap_caps_get_minimum_free_size(RESOURCE_HEAP_CAPS);
+  heap.largestBlock = heap_caps_get_largest_free_block(RESOURCE_HEAP_CAPS);
+  heap.fragPct = heap.free > 0 ? 100 - (uint32_t) ((uint64_t) heap.largestBlock * 100 / heap.free) : 0;
+  return heap;
+}
+
+static void check_heap(const HeapSample& heap) {
+  char alert[RESOURCE_ALERT_LEN];
+
+  bool low = heap.free < RESOURCE_HEAP_MIN_FREE_BYTES;
+  if (low && !heapLowAlerted) {
+    snprintf(alert, sizeof(alert), "HEAP_LOW free=%u min_free=%u", (unsigned) heap.free, (unsigned) heap.minFree);
+    raise_alert(alert);
+  }
+  heapLowAlerted = low;
+
+  bool fragmented = heap.fragPct > RESOURCE_HEAP_MAX_FRAG_PCT;
+  if (fragmented && !heapFragAlerted) {
+    snprintf(alert, sizeof(alert), "HEAP_FRAG frag_pct=%lu largest=%u free=%u",
+             heap.fragPct, (unsigned) heap.largestBlock, (unsigned) heap.free);
+    raise_alert(alert);
+  }
+  heapFragAlerted = fragmented;
+}
+
+static void sample_tasks() {
+#if CONFIG_FREERTOS_USE_TRACE_FACILITY
+  uint32_t totalRunTime = 0;
+  taskCount = uxTaskGetSystemState(taskStatus, RESOURCE_MAX_TASKS, &totalRunTime);
+  if (taskCount == 0) {
+    ESP_LOGW(RESOURCE_MONITOR_TAG, "More than %d tasks, task stats skipped", RESOURCE_MAX_TASKS);
+    return;
+  }
+
+  // The run time counter advances once per core, each task runs on one at a time
+  uint64_t capacity = (uint64_t) (totalRunTime - prevTotalRunTime) * portNUM_PROCESSORS;
+  prevTotalRunTime = totalRunTime;
+
+  for (int i = 0; i < RESOURCE_MAX_TASKS; i++) {
+    trackedTasks[i].seen = false;
+  }
+
+  char alert[RESOURCE_ALERT_LEN];
+  for (UBaseType_t i = 0; i < taskCount; i++) {
+    const TaskStatus_t& status = taskStatus[i];
+    TrackedTask *tracked = track(status.xTaskNumber);
+    if (tracked == nullptr) {
+      continue;
+    }
+    tracked->seen = true;
+
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+    uint32_t runTime = status.ulRunTimeCounter;
+    tracked->cpuPermille = capacity > 0 ? (uint32_t) ((uint64_t) (runTime - tracked->prevRunTime) * 1000 / capacity) : 0;
+    tracked->prevRunTime = runTime;
+#endif
+
+    // The high water mark is in bytes on this port
+    bool stackLow = status.usStackHighWaterMark < RESOURCE_STACK_MIN_FREE_BYTES;
+    if (stackLow && !tracked->stackAlerted) {
+      snprintf(alert, sizeof(alert), "STACK_LOW task=%s free=%u", status.pcTaskName,
+               (unsigned) status.usStackHighWaterMark);
+      raise_alert(alert);
+    }
+    tracked->stackAlerted = stackLow;
+  }
+
+  // Free the slots of deleted tasks
+  for (int i = 0; i < RESOURCE_MAX_TASKS; i++) {
+    if (!trackedTasks[i].seen) {
+      trackedTasks[i].number = 0;
+    }
+  }
+#endif
+}
+
+static void publish_report(const HeapSample& heap) {
+  size_t len = snprintf(payload, sizeof(payload), "%lld,%u,%u,%u,%lu",
+                        esp_timer_get_time() / 1000000, (unsigned) heap.free, (unsigned) heap.minFree,
+                        (unsigned) heap.largestBlock, heap.fragPct);
+  ESP_LOGI(RESOURCE_MONITOR_TAG, "heap free=%u min_free=%u largest=%u frag=%lu%%",
+           (unsigned) heap.free, (unsigned) heap.minFree, (unsigned) heap.largestBlock, heap.fragPct);
+
+#if CONFIG_FREERTOS_USE_TRACE_FACILITY
+  ESP_LOGI(RESOURCE_MONITOR_TAG, "%-16s %6s %10s", "task", "cpu", "stack_free");
+  for (UBaseType_t i = 0; i < taskCount && len < sizeof(payload); i++) {
+    const TaskStatus_t& status = taskStatus[i];
+    TrackedTask *tracked = track(status.xTaskNumber);
+    uint32_t cpuPermille = tracked != nullptr ? tracked->cpuPermille : 0;
+
+    ESP_LOGI(RESOURCE_MONITOR_TAG, "%-16s %3lu.%lu%% %10u", status.pcTaskName,
+             cpuPermille / 10, cpuPermille % 10, (unsigned) status.usStackHighWaterMark);
+    len += snprintf(&payload[len], sizeof(payload) - len, ";%s,%lu,%u", status.pcTaskName,
+                    cpuPermille, (unsigned) status.usStackHighWaterMark);
+  }
+#endif
+
+  if (mqtt_api_is_connected()) {
+    mqtt_api_publish(RESOURCE_METRICS_TOPIC, payload);
+  }
+}
+
+/* Functions ------------------------------------------------------------ */
+void resource_monitor_task(void *arg) {
+  ESP_LOGI(RESOURCE_MONITOR_TAG, "Resource monitor started");
+
+  timer_id_t sampleTimer = timer_service_create_notify("resource_sample", xTaskGetCurrentTaskHandle(), 1);
+  timer_service_start_periodic(sampleTimer, RESOURCE_SAMPLE_INTERVAL_MS);
+
+  int64_t last_publish_us = esp_timer_get_time();
+  while (1) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    HeapSample heap = sample_heap();
+    check_heap(heap);
+    sample_tasks();
+
+    int64_t now_us = esp_timer_get_time();
+    if (now_us - last_publish_us >= (int64_t) RESOURCE_PUBLISH_INTERVAL_MS * 1000) {
+      publish_report(heap);
+      timer_service_log_stats();
+      last_publish_us = now_us;
+    }
+  }
+}
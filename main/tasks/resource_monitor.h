@@ -0,0 +1,33 @@
+/**
+ * ******************************************************************************
+  * @authors        : Tomas Gonzalez & Brian Morris
+  * @file           : resource_monitor.h
+  * @brief          : Header file for resource_monitor.cpp
+  * ******************************************************************************
+  */
+
+#ifndef RESOURCE_MONITOR_H
+#define RESOURCE_MONITOR_H
+
+/* Defines ------------------------------------------------------------- */
+#define RESOURCE_METRICS_TOPIC "livestock/cu/resources"
+#define RESOURCE_ALERT_TOPIC "livestock/cu/alert"
+
+#define RESOURCE_SAMPLE_INTERVAL_MS   30000            // Thresholds checked every 30 seconds
+#define RESOURCE_PUBLISH_INTERVAL_MS  (5 * 60 * 1000)  // Full report every 5 minutes
+#define RESOURCE_MAX_TASKS            24
+
+#define RESOURCE_STACK_MIN_FREE_BYTES 512    // Alert when a task gets this close to overflowing
+#define RESOURCE_HEAP_MIN_FREE_BYTES  20480  // Alert below 20 KB of free internal heap
+#define RESOURCE_HEAP_MAX_FRAG_PCT    70     // Alert when the largest block is under 30% of the free heap
+
+/* Function ------------------------------------------------------------ */
+/**
+ * @brief Samples resources every RESOURCE_SAMPLE_INTERVAL_MS and alerts on
+ *        RESOURCE_ALERT_TOPIC when a threshold is crossed
+ * @details Report: "uptime_s,heap_free,heap_min_free,largest_block,frag_pct"
+ *          then one ";task,cpu_permille,stack_free_bytes" per task
+ */
+void resource_monitor_task(void *arg);
+
+#endif /* RESOURCE_MONITOR_H */
@@ -19,14 +19,78 @@
 #include "rx_channel.h"
 
 #include "rylr998.h"
+#include "cu_comms.h"
 #include "request_queue.h"
+#include "latency_stats.h"
+#include "log_ring.h"
+#include "uart_trace.h"
+#include "tx_scheduler.h"
+#include "radio_health.h"
 #include "esp_log.h"
+#include "hal/hal.h"
 #include <string.h>
+#include <string>
 
 /* Private variables --------------------------------------------------------- */
 static const std::string RX_CHANNEL_TASK_TAG_PREFIX = "RX_CHANNEL_TASK";
 
+// A line split across reads waits here for its end, only the RX task of the port touches it
+static char pending_line[2][UART_RX_BUFF_SIZE];
+static size_t pending_length[2];
+
+/* Private functions --------------------------------------------------------- */
+static void handle_line(UartPort_t uart_port, const char *line, size_t length, int64_t received_us) {
+  RYLR_response_t response;
+  RYLR_RX_command_t command = rylr998_parseLine(line, length, &response);
+  if (command == RYLR_RCV || command == RYLR_RCV_ACK) {
+    const RYLR_RX_data_t* rcv_data = &response.packet;
+    log_ring_write(LOG_FMT_RX_RCV, rcv_data->data, uart_port, rcv_data->id,
+                   (uint32_t) (int32_t) rcv_data->rssi, (uint32_t) (int32_t) rcv_data->snr);
+    int64_t post_start_us = latency_record_since(LATENCY_STAGE_PARSE, received_us);
+    post_request(rcv_data->data, rcv_data->id, uart_port, rcv_data->rssi, rcv_data->snr, received_us);
+    tx_scheduler_record_rx(uart_port, rcv_data->byte_count);
+    radio_health_record(uart_port, RADIO_EVENT_RX);
+    latency_record_since(LATENCY_STAGE_POST, post_start_us);
+  } else if (command == RYLR_RCV_ERR) {
+    ESP_LOGW(RX_CHANNEL_TASK_TAG_PREFIX.c_str(), "Malformed frame on port %d: %s", uart_port, response.line);
+  } else {
+    // Answer to a command, handed by copy to the conversation waiting for it
+    CU_onResponse(uart_port, &response);
+  }
+}
+
 /* Functions ------------------------------------------------------------ */
+void rx_channel_receive(UartPort_t uart_port) {
+  uint8_t* rx_buff = uart_get_rx_buff(uart_port);
+  int64_t read_start_us = hal_time_us();
+  const int rxBytes = uart_receive(uart_port);
+  if (rxBytes <= 0) {
+    return;
+  }
+  int64_t received_us = latency_record_since(LATENCY_STAGE_UART_RX, read_start_us);
+  uart_trace_record(uart_port, rx_buff, rxBytes, read_start_us);
+  rx_buff[rxBytes] = 0;
+  log_ring_write(LOG_FMT_RX_BYTES, (const char*) rx_buff, uart_port, rxBytes, 0, 0);
+
+  // One read may end a line started by the last one and hold several more
+  char *line = pending_line[uart_port];
+  size_t& length = pending_length[uart_port];
+  for (int i = 0; i < rxBytes; i++) {
+    if (length == 0 && rx_buff[i] != '+') {
+      continue;  // Every line from the module starts with '+', skip the blank ones
+    }
+    if (length == sizeof(pending_line[uart_port])) {
+      length = 0;  // No end in sight, the line is lost
+      continue;
+    }
+    line[length++] = (char) rx_buff[i];
+    if (rx_buff[i] == '\n') {
+      handle_line(uart_port, line, length, received_us);
+      length = 0;
+    }
+  }
+}
+
 void rx_channel_task(void *arg) {
   UartPort_t uart_port = *(UartPort_t*)arg;
 
@@ -36,29 +100,10 @@ void rx_channel_task(void *arg) {
 
   ESP_LOGI(RX_CHANNEL_TASK_TAG, "RX task started for port %d", uart_port);
 
-  uint8_t* rx_buff = uart_get_rx_buff(uart_port);
   while (1) {
-    const int rxBytes = uart_receive(uart_port);
-    if (rxBytes > 0) {
-      rx_buff[rxBytes] = 0;
-      ESP_LOGI(RX_CHANNEL_TASK_TAG, "[%d] %s", rxBytes, rx_buff);
-      rylr998_SetInterruptFlag(true, uart_port);
-
-      // Create a string from the received bytes
-      std::string received_data(reinterpret_cast<char*>(rx_buff), rxBytes);
-      
-      // Check if this is a request that needs to be parsed
-      if (received_data.starts_with("+RCV=")) {
-        RYLR_RX_data_t* rcv_data = rylr998_getCommand(RYLR_RCV, uart_port);
-        ESP_LOGI(RX_CHANNEL_TASK_TAG, "RCV data: %s", rcv_data->data);
-
-        // Create a string from the received data in rcv_data->data
-        std::string data(rcv_data->data);
-        ESP_LOGI(RX_CHANNEL_TASK_TAG, "Converted to string: %s", data.c_str());
-        post_request(data, rcv_data->id, uart_port);
-        ESP_LOGI(RX_CHANNEL_TASK_TAG, "Request parsed and added to queue");
-      }
+    // The driver wakes the task when a line ends, nothing to poll
+    if (uart_wait_rx(uart_port, portMAX_DELAY)) {
+      rx_channel_receive(uart_port);
     }
-    vTaskDelay(pdMS_TO_TICKS(500));
   }
-}
\ No newline at end of file
+}
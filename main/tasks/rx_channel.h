@@ -9,8 +9,18 @@
 #ifndef RX_CHANNEL_H
 #define RX_CHANNEL_H
 
+/* Includes ------------------------------------------------------------ */
+#include "uart.h"
+
 /* Function ------------------------------------------------------------ */
 void rx_channel_task(void *arg);
 
+/**
+ * @brief Read what the radio sent and hand it on, one wake-up of the RX task
+ * @details Also called directly by the host replay, which injects the bytes first
+ * @param uart_port Port to read
+ */
+void rx_channel_receive(UartPort_t uart_port);
+
 #endif /* RX_CHANNEL_H */
  
\ No newline at end of file
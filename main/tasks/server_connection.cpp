@@ -1,54 +1,283 @@
+/**
+ * ******************************************************************************
+  * @authors        : Tomas Gonzalez & Brian Morris
+  * @file           : server_connection.cpp
+  * @brief          : Coroutine - Supervises Wi-Fi and MQTT, reconnecting with
+  *                   a jittered exponential backoff for as long as the CU runs
+  * ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------ */
+#include "server_connection.h"
+
+#include <stdio.h>
+#include "esp_event.h"
 #include "esp_log.h"
+#include "esp_random.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
+#include "coroutine.h"
+#include "lora/radio_setup.h"
 #include "wi-fi/wifi.h"
 #include "wi-fi/mqtt_api.h"
-#include "display/status.h"
 
+/* Defines ------------------------------------------------------------- */
+#define WIFI_CONNECT_TIMEOUT_MS   15000
+#define MQTT_CONNECT_TIMEOUT_MS   10000
+#define BACKOFF_BASE_MS           1000
+#define BACKOFF_MAX_MS            (5 * 60 * 1000) // 5 minutes
+
+/* Private types ------------------------------------------------------- */
+enum ConnectionState {
+  CONN_STATE_WIFI_CONNECTING,
+  CONN_STATE_MQTT_CONNECTING,
+  CONN_STATE_ONLINE,
+  CONN_STATE_BACKOFF,
+};
+
+/* Private variables --------------------------------------------------------- */
 static const char *CONNECTIVITY_TASK_TAG = "Connectivity";
 
-void server_connection_task(void *arg) {
-  ESP_LOGI(CONNECTIVITY_TASK_TAG, "Connectivity task started");
+static ConnectivityMetrics metrics = {0, 0, 0, 0, 0, 0, -1};
+static portMUX_TYPE metrics_lock = portMUX_INITIALIZER_UNLOCKED;
+static int64_t offline_since_us = 0;
+static bool has_been_online = false;
+static int64_t boot_online_us = -1;  // Boot timing waits for the radio setup, -1 once published
 
-  uint32_t total_timeout_ms = 30000;  // 30 seconds total timeout
-  uint32_t start_time = xTaskGetTickCount() * portTICK_PERIOD_MS;
+// Set by the Wi-Fi, MQTT and radio setup events, the supervisor sleeps on it
+static CoEvent link_changed;
 
-  // Initialize WiFi with reasonable timeout (30 seconds)
-  wifi_init_sta();
-  wifi_start(30000);  // 30 seconds for WiFi connection
-
-  // Check if we still have time for MQTT
-  uint32_t elapsed_time = (xTaskGetTickCount() * portTICK_PERIOD_MS) - start_time;
-  if (elapsed_time >= total_timeout_ms) {
-    ESP_LOGW(CONNECTIVITY_TASK_TAG, "WiFi connection took too long - proceeding without MQTT");
-    update_mqtt_status("Offline");
-    ESP_LOGI(CONNECTIVITY_TASK_TAG, "Connectivity task completed");
-    vTaskDelete(NULL);
-    return;
-  }
-
-  // Initialize MQTT
-  mqtt_api_init();
-
-  // Wait for MQTT connection with remaining time
-  while (!mqtt_api_is_connected()) {
-    vTaskDelay(pdMS_TO_TICKS(5000));  // Check every 5 seconds
-    
-    elapsed_time = (xTaskGetTickCount() * portTICK_PERIOD_MS) - start_time;
-    if (elapsed_time >= total_timeout_ms) {
-      ESP_LOGW(CONNECTIVITY_TASK_TAG, "Connection timeout - stopping MQTT and proceeding without it");
-      mqtt_api_deinit();
-      break;
+/* Private functions --------------------------------------------------------- */
+static uint32_t backoff_delay_ms(uint32_t attempt) {
+  uint32_t shift = attempt < 16 ? attempt : 16;
+  uint64_t delay_ms = (uint64_t) BACKOFF_BASE_MS << shift;
+  if (delay_ms > BACKOFF_MAX_MS) {
+    delay_ms = BACKOFF_MAX_MS;
+  }
+
+  // Equal jitter: keep half of the delay, randomize the rest so that CUs
+  // sharing a router do not reconnect in lockstep
+  uint32_t half_ms = delay_ms / 2;
+  return half_ms + esp_random() % (half_ms + 1);
+}
+
+static void publish_metrics() {
+  ConnectivityMetrics snapshot;
+  connectivity_get_metrics(&snapshot);
+
+  char payload[160];
+  snprintf(payload, sizeof(payload),
+           "reconnects=%lu wifi_attempts=%lu mqtt_attempts=%lu last_ttr_ms=%lld max_ttr_ms=%lld uptime_s=%lld",
+           snapshot.reconnects, snapshot.wifi_attempts, snapshot.mqtt_attempts,
+           snapshot.last_time_to_reconnect_us / 1000, snapshot.max_time_to_reconnect_us / 1000,
+           snapshot.total_uptime_us / 1000000);
+  mqtt_api_enqueue(CONNECTIVITY_METRICS_TOPIC, payload, false);
+}
+
+static void publish_boot_timing(int64_t online_us) {
+  wifi_timing_t timing;
+  wifi_get_timing(&timing);
+
+  // Every phase in ms: boot to Wi-Fi init, driver start, association, IP, MQTT, then the radio setup
+  char payload[256];
+  int length = snprintf(payload, sizeof(payload),
+                        "fast_connect=%d boot_ms=%lld start_ms=%lld assoc_ms=%lld ip_ms=%lld mqtt_ms=%lld total_ms=%lld ",
+                        timing.fast_connect,
+                        timing.init_us / 1000,
+                        (timing.started_us - timing.init_us) / 1000,
+                        (timing.associated_us - timing.started_us) / 1000,
+                        (timing.got_ip_us - timing.associated_us) / 1000,
+                        (online_us - timing.got_ip_us) / 1000,
+                        online_us / 1000);
+  if (length > 0 && (size_t) length < sizeof(payload)) {
+    radio_setup_format(payload + length, sizeof(payload) - length);
+  }
+  ESP_LOGI(CONNECTIVITY_TASK_TAG, "Boot to online: %s", payload);
+  mqtt_api_enqueue(BOOT_TIMING_TOPIC, payload, false);
+}
+
+// The radios are set up next to the first connection, whichever ends last publishes
+static void publish_boot_timing_when_ready() {
+  RadioSetupReport report;
+  if (boot_online_us >= 0 && radio_setup_report(&report)) {
+    publish_boot_timing(boot_online_us);
+    boot_online_us = -1;
+  }
+}
+
+static void on_online() {
+  int64_t now_us = esp_timer_get_time();
+  int64_t time_to_reconnect_us = now_us - offline_since_us;
+
+  taskENTER_CRITICAL(&metrics_lock);
+  // The first session is the boot connection, not a reconnect
+  if (has_been_online) {
+    metrics.reconnects++;
+  }
+  uint32_t reconnects = metrics.reconnects;
+  metrics.last_time_to_reconnect_us = time_to_reconnect_us;
+  if (time_to_reconnect_us > metrics.max_time_to_reconnect_us) {
+    metrics.max_time_to_reconnect_us = time_to_reconnect_us;
+  }
+  metrics.online_since_us = now_us;
+  taskEXIT_CRITICAL(&metrics_lock);
+  has_been_online = true;
+
+  ESP_LOGI(CONNECTIVITY_TASK_TAG, "Online after %lld ms offline", time_to_reconnect_us / 1000);
+  if (reconnects == 0) {
+    boot_online_us = now_us;
+    publish_boot_timing_when_ready();
+  }
+  publish_metrics();
+}
+
+static void on_offline() {
+  int64_t now_us = esp_timer_get_time();
+
+  taskENTER_CRITICAL(&metrics_lock);
+  metrics.total_uptime_us += now_us - metrics.online_since_us;
+  metrics.online_since_us = -1;
+  taskEXIT_CRITICAL(&metrics_lock);
+
+  offline_since_us = now_us;
+  ESP_LOGW(CONNECTIVITY_TASK_TAG, "Connection lost, Wi-Fi %s, MQTT %s",
+           wifi_is_connected() ? "up" : "down", mqtt_api_is_connected() ? "up" : "down");
+}
+
+static void count_attempt(uint32_t *attempts) {
+  taskENTER_CRITICAL(&metrics_lock);
+  (*attempts)++;
+  taskEXIT_CRITICAL(&metrics_lock);
+}
+
+// Rounded up, a wait of 0 would never time out
+static uint32_t ms_until(int64_t deadline_us) {
+  int64_t remaining_us = deadline_us - esp_timer_get_time();
+  return remaining_us <= 1000 ? 1 : (uint32_t) ((remaining_us + 999) / 1000);
+}
+
+// Runs on the default event loop, after the Wi-Fi driver's own handler
+static void on_link_event(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data) {
+  link_changed.set();
+}
+
+// Same contract as wifi_wait_connected() without blocking the executor
+static CoTask<bool> wait_wifi_connected(uint32_t timeout_ms) {
+  int64_t deadline_us = esp_timer_get_time() + (int64_t) timeout_ms * 1000;
+  while (!wifi_is_connected()) {
+    if (esp_timer_get_time() >= deadline_us) {
+      co_return false;
     }
+    co_await link_changed.wait(ms_until(deadline_us));
   }
+  co_return true;
+}
+
+/* Functions ------------------------------------------------------------ */
+void connectivity_get_metrics(ConnectivityMetrics *out) {
+  taskENTER_CRITICAL(&metrics_lock);
+  *out = metrics;
+  taskEXIT_CRITICAL(&metrics_lock);
 
-  if (mqtt_api_is_connected()) {
-    ESP_LOGI(CONNECTIVITY_TASK_TAG, "Both WiFi and MQTT connected successfully");
-  } else {
-    ESP_LOGW(CONNECTIVITY_TASK_TAG, "Proceeding without server connectivity");
+  if (out->online_since_us >= 0) {
+    out->total_uptime_us += esp_timer_get_time() - out->online_since_us;
   }
+}
+
+static CoTask<> connection_supervisor() {
+  ESP_LOGI(CONNECTIVITY_TASK_TAG, "Connectivity supervisor started");
+
+  ConnectionState state = CONN_STATE_WIFI_CONNECTING;
+  ConnectionState retry_state = CONN_STATE_WIFI_CONNECTING;
+  uint32_t attempt = 0;
+  int64_t mqtt_deadline_us = 0;
+
+  while (1) {
+    switch (state) {
+      case CONN_STATE_WIFI_CONNECTING: {
+        bool connected = co_await wait_wifi_connected(WIFI_CONNECT_TIMEOUT_MS);
+        if (connected) {
+          mqtt_api_reconnect();
+          count_attempt(&metrics.mqtt_attempts);
+          mqtt_deadline_us = esp_timer_get_time() + (int64_t) MQTT_CONNECT_TIMEOUT_MS * 1000;
+          state = CONN_STATE_MQTT_CONNECTING;
+        } else {
+          retry_state = CONN_STATE_WIFI_CONNECTING;
+          state = CONN_STATE_BACKOFF;
+        }
+        break;
+      }
+      case CONN_STATE_MQTT_CONNECTING: {
+        if (!wifi_is_connected()) {
+          retry_state = CONN_STATE_WIFI_CONNECTING;
+          state = CONN_STATE_BACKOFF;
+        } else if (mqtt_api_is_connected()) {
+          on_online();
+          attempt = 0;
+          state = CONN_STATE_ONLINE;
+        } else if (esp_timer_get_time() >= mqtt_deadline_us) {
+          ESP_LOGW(CONNECTIVITY_TASK_TAG, "MQTT connection timeout");
+          if (wifi_abandon_fast_connect()) {
+            count_attempt(&metrics.wifi_attempts);
+            state = CONN_STATE_WIFI_CONNECTING; // Rescanned, no backoff for the first full attempt
+          } else {
+            retry_state = CONN_STATE_MQTT_CONNECTING;
+            state = CONN_STATE_BACKOFF;
+          }
+        } else {
+          co_await link_changed.wait(ms_until(mqtt_deadline_us));
+        }
+        break;
+      }
+      case CONN_STATE_ONLINE: {
+        if (!wifi_is_connected() || !mqtt_api_is_connected()) {
+          on_offline();
+          retry_state = wifi_is_connected() ? CONN_STATE_MQTT_CONNECTING : CONN_STATE_WIFI_CONNECTING;
+          state = CONN_STATE_BACKOFF;
+        } else {
+          publish_boot_timing_when_ready();
+          co_await link_changed.wait(0);
+        }
+        break;
+      }
+      case CONN_STATE_BACKOFF: {
+        uint32_t delay_ms = backoff_delay_ms(attempt++);
+        ESP_LOGI(CONNECTIVITY_TASK_TAG, "Retrying %s in %lu ms (attempt %lu)",
+                 retry_state == CONN_STATE_WIFI_CONNECTING ? "Wi-Fi" : "MQTT", delay_ms, attempt);
+        co_await co_sleep_ms(delay_ms);
+
+        // Wi-Fi may have dropped while waiting for an MQTT retry
+        if (retry_state == CONN_STATE_WIFI_CONNECTING || !wifi_is_connected()) {
+          wifi_reconnect();
+          count_attempt(&metrics.wifi_attempts);
+          state = CONN_STATE_WIFI_CONNECTING;
+        } else {
+          mqtt_api_reconnect();
+          count_attempt(&metrics.mqtt_attempts);
+          mqtt_deadline_us = esp_timer_get_time() + (int64_t) MQTT_CONNECT_TIMEOUT_MS * 1000;
+          state = CONN_STATE_MQTT_CONNECTING;
+        }
+        break;
+      }
+    }
+  }
+}
+
+void server_connection_start() {
+  // The driver init waits on NVS and the netif, it must not run on the executor.
+  // The first association is started by the STA_START event.
+  offline_since_us = esp_timer_get_time();
+  wifi_init_sta();
+  count_attempt(&metrics.wifi_attempts);
+
+  // Registered after wifi_init_sta() so the link state is updated when these run
+  ESP_ERROR_CHECK(esp_event_handler_register(WIFI_EVENT, ESP_EVENT_ANY_ID, &on_link_event, NULL));
+  ESP_ERROR_CHECK(esp_event_handler_register(IP_EVENT, IP_EVENT_STA_GOT_IP, &on_link_event, NULL));
+  coro_spawn(connection_supervisor());
+}
 
-  ESP_LOGI(CONNECTIVITY_TASK_TAG, "Connectivity task completed");
-  vTaskDelete(NULL);  // Delete the current task
+void server_connection_notify() {
+  link_changed.set();
 }
@@ -9,7 +9,40 @@
 #ifndef SERVER_CONNECTION_H
 #define SERVER_CONNECTION_H
 
+/* Includes ------------------------------------------------------------ */
+#include <cstdint>
+
+/* Defines ------------------------------------------------------------- */
+#define CONNECTIVITY_METRICS_TOPIC "livestock/cu/connectivity"
+#define BOOT_TIMING_TOPIC "livestock/cu/boot"
+
+/* Structs ------------------------------------------------------------- */
+struct ConnectivityMetrics {
+  uint32_t reconnects;                /**< Times the CU came back online after being online */
+  uint32_t wifi_attempts;             /**< Wi-Fi association attempts since boot */
+  uint32_t mqtt_attempts;             /**< MQTT connection attempts since boot */
+  int64_t last_time_to_reconnect_us;  /**< Offline duration before the last time online */
+  int64_t max_time_to_reconnect_us;   /**< Longest offline duration seen */
+  int64_t total_uptime_us;            /**< Time spent online, including the current session */
+  int64_t online_since_us;            /**< Start of the current session, -1 when offline */
+};
+
 /* Function ------------------------------------------------------------ */
-void server_connection_task(void *arg);
+/**
+ * @brief Initialize Wi-Fi on the calling task, then supervise Wi-Fi and MQTT on the coroutine executor
+ */
+void server_connection_start();
+
+/**
+ * @brief Wake the supervisor after a change it reacts to, safe from any task
+ * @details Wi-Fi events wake it on their own, the MQTT client and the radio setup call this
+ */
+void server_connection_notify();
+
+/**
+ * @brief Copies the current connectivity metrics, safe from any task
+ * @param metrics Output metrics
+ */
+void connectivity_get_metrics(ConnectivityMetrics *metrics);
 
 #endif /* SERVER_CONNECTION_H */
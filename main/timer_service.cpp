@@ -0,0 +1,285 @@
+/**
+  ******************************************************************************
+  * @authors        : Tomas Gonzalez & Brian Morris
+  * @file           : timer_service.cpp
+  * @brief          : Timer service, one timing wheel serving every one-shot
+  *                   and periodic deadline of the firmware
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 Tomas Gonzalez & Brian Morris
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  */
+
+/* Includes ------------------------------------------------------------ */
+#include "timer_service.h"
+
+#include "esp_log.h"
+#include "hal/hal.h"
+
+/* Defines ------------------------------------------------------------- */
+#define TICK_US ((int64_t) TIMER_SERVICE_TICK_MS * 1000)
+
+/* Private types ------------------------------------------------------- */
+struct TimerEntry {
+  TimerCallback callback;  // NULL for notification delivery
+  void *arg;
+  TaskHandle_t task;
+  uint32_t bits;
+  uint32_t period_ms;      // 0 for one-shot
+  int64_t deadline_us;     // Exact deadline, lateness is measured against it
+  int64_t expiryTick;      // Wheel tick the timer is filed under, never behind the cursor
+  bool armed;
+  TimerStats stats;
+};
+
+struct Delivery {
+  TimerCallback callback;
+  void *arg;
+  TaskHandle_t task;
+  uint32_t bits;
+};
+
+/* Private variables --------------------------------------------------------- */
+static const char *TIMER_SERVICE_TAG = "TIMER_SERVICE";
+
+static TimerEntry timers[TIMER_SERVICE_MAX];
+static int timerCount = 0;
+
+// Bit i of a slot is set while timer i is filed there, for this turn or a later one
+static uint32_t wheel[TIMER_SERVICE_SLOTS];
+static int64_t cursorTick = 0;  // Tick being examined, earlier ones are done
+static portMUX_TYPE wheel_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static TaskHandle_t serviceTask = NULL;
+static int64_t sleepUntil_us = INT64_MAX;  // Deadline the service task sleeps towards
+
+/* Private functions --------------------------------------------------------- */
+// Must hold wheel_lock
+static void unfile(int id) {
+  TimerEntry& timer = timers[id];
+  if (timer.armed) {
+    wheel[timer.expiryTick % TIMER_SERVICE_SLOTS] &= ~(1u << id);
+    timer.armed = false;
+  }
+}
+
+// Must hold wheel_lock
+static void file(int id, int64_t deadline_us) {
+  TimerEntry& timer = timers[id];
+  unfile(id);
+  int64_t tick = deadline_us / TICK_US;
+  timer.deadline_us = deadline_us;
+  timer.expiryTick = tick < cursorTick ? cursorTick : tick;
+  timer.armed = true;
+  wheel[timer.expiryTick % TIMER_SERVICE_SLOTS] |= 1u << id;
+}
+
+static bool arm(timer_id_t id, uint32_t delay_ms, uint32_t period_ms) {
+  if (id < 0 || id >= timerCount) {
+    return false;
+  }
+  int64_t deadline_us = hal_time_us() + (int64_t) delay_ms * 1000;
+
+  taskENTER_CRITICAL(&wheel_lock);
+  timers[id].period_ms = period_ms;
+  file(id, deadline_us);
+  bool earlier = deadline_us < sleepUntil_us;
+  taskEXIT_CRITICAL(&wheel_lock);
+
+  // The service task sleeps towards a later deadline, let it recompute
+  if (earlier && serviceTask != NULL && xTaskGetCurrentTaskHandle() != serviceTask) {
+    xTaskNotifyGive(serviceTask);
+  }
+  return true;
+}
+
+static timer_id_t create(const char *name, TimerCallback callback, void *arg, TaskHandle_t task, uint32_t bits) {
+  taskENTER_CRITICAL(&wheel_lock);
+  timer_id_t id = timerCount < TIMER_SERVICE_MAX ? timerCount++ : TIMER_INVALID;
+  if (id != TIMER_INVALID) {
+    TimerEntry& timer = timers[id];
+    timer = TimerEntry{};
+    timer.callback = callback;
+    timer.arg = arg;
+    timer.task = task;
+    timer.bits = bits;
+    timer.stats.name = name;
+  }
+  taskEXIT_CRITICAL(&wheel_lock);
+
+  if (id == TIMER_INVALID) {
+    ESP_LOGE(TIMER_SERVICE_TAG, "No free timer for %s (%d in use)", name, TIMER_SERVICE_MAX);
+  }
+  return id;
+}
+
+// Must hold wheel_lock. Collects every timer due at now_us, re-filing the periodic ones.
+static int collect_due(int64_t now_us, Delivery *due) {
+  int64_t nowTick = now_us / TICK_US;
+  int count = 0;
+
+  while (cursorTick <= nowTick) {
+    uint32_t mask = wheel[cursorTick % TIMER_SERVICE_SLOTS];
+    while (mask != 0) {
+      int id = __builtin_ctz(mask);
+      mask &= mask - 1;
+      TimerEntry& timer = timers[id];
+      // Later turns share the slot, the current tick may still hold future deadlines
+      if (timer.expiryTick != cursorTick || timer.deadline_us > now_us) {
+        continue;
+      }
+
+      int64_t late_us = now_us - timer.deadline_us;
+      timer.stats.fires++;
+      timer.stats.lateSum_us += late_us;
+      if (late_us > timer.stats.lateMax_us) {
+        timer.stats.lateMax_us = late_us;
+      }
+      due[count++] = Delivery{timer.callback, timer.arg, timer.task, timer.bits};
+
+      if (timer.period_ms == 0) {
+        unfile(id);
+        continue;
+      }
+      // Keep the original phase, skipping the periods that were missed entirely
+      int64_t period_us = (int64_t) timer.period_ms * 1000;
+      int64_t next_us = timer.deadline_us + period_us;
+      if (next_us <= now_us) {
+        int64_t missed = (now_us - next_us) / period_us + 1;
+        timer.stats.overruns += missed;
+        next_us += missed * period_us;
+      }
+      file(id, next_us);
+    }
+
+    if (cursorTick == nowTick) {
+      break;  // Stay on the current tick until it is over
+    }
+    cursorTick++;
+  }
+  return count;
+}
+
+// Must hold wheel_lock
+static int64_t next_deadline() {
+  // Walk one turn from the cursor, the first slot holding a timer of this turn wins
+  for (int64_t tick = cursorTick; tick < cursorTick + TIMER_SERVICE_SLOTS; tick++) {
+    uint32_t mask = wheel[tick % TIMER_SERVICE_SLOTS];
+    int64_t deadline_us = INT64_MAX;
+    while (mask != 0) {
+      int id = __builtin_ctz(mask);
+      mask &= mask - 1;
+      if (timers[id].expiryTick == tick && timers[id].deadline_us < deadline_us) {
+        deadline_us = timers[id].deadline_us;
+      }
+    }
+    if (deadline_us != INT64_MAX) {
+      return deadline_us;
+    }
+  }
+
+  // Nothing this turn, only long timers are left
+  int64_t deadline_us = INT64_MAX;
+  for (int id = 0; id < timerCount; id++) {
+    if (timers[id].armed && timers[id].deadline_us < deadline_us) {
+      deadline_us = timers[id].deadline_us;
+    }
+  }
+  return deadline_us;
+}
+
+/* Functions ------------------------------------------------------------ */
+void timer_service_init() {
+  taskENTER_CRITICAL(&wheel_lock);
+  cursorTick = hal_time_us() / TICK_US;
+  taskEXIT_CRITICAL(&wheel_lock);
+}
+
+timer_id_t timer_service_create_callback(const char *name, TimerCallback callback, void *arg) {
+  return create(name, callback, arg, NULL, 0);
+}
+
+timer_id_t timer_service_create_notify(const char *name, TaskHandle_t task, uint32_t bits) {
+  return create(name, NULL, NULL, task, bits);
+}
+
+bool timer_service_start_once(timer_id_t id, uint32_t delay_ms) {
+  return arm(id, delay_ms, 0);
+}
+
+bool timer_service_start_periodic(timer_id_t id, uint32_t period_ms) {
+  return period_ms > 0 && arm(id, period_ms, period_ms);
+}
+
+void timer_service_stop(timer_id_t id) {
+  if (id < 0 || id >= timerCount) {
+    return;
+  }
+  taskENTER_CRITICAL(&wheel_lock);
+  unfile(id);
+  taskEXIT_CRITICAL(&wheel_lock);
+}
+
+bool timer_service_get_stats(timer_id_t id, TimerStats *stats) {
+  if (id < 0 || id >= timerCount) {
+    return false;
+  }
+  taskENTER_CRITICAL(&wheel_lock);
+  *stats = timers[id].stats;
+  taskEXIT_CRITICAL(&wheel_lock);
+  return true;
+}
+
+void timer_service_log_stats() {
+  ESP_LOGI(TIMER_SERVICE_TAG, "%-16s %8s %10s %10s %8s", "Timer", "Fires", "Mean(us)", "Max(us)", "Overrun");
+  for (timer_id_t id = 0; id < timerCount; id++) {
+    TimerStats stats;
+    timer_service_get_stats(id, &stats);
+    int64_t mean_us = stats.fires > 0 ? stats.lateSum_us / stats.fires : 0;
+    ESP_LOGI(TIMER_SERVICE_TAG, "%-16s %8lu %10lld %10lld %8lu", stats.name, stats.fires,
+             (long long) mean_us, (long long) stats.lateMax_us, stats.overruns);
+  }
+}
+
+void timer_service_task(void *arg) {
+  ESP_LOGI(TIMER_SERVICE_TAG, "Timer service started");
+  serviceTask = xTaskGetCurrentTaskHandle();
+  Delivery due[TIMER_SERVICE_MAX];
+
+  while (1) {
+    int64_t now_us = hal_time_us();
+    taskENTER_CRITICAL(&wheel_lock);
+    int count = collect_due(now_us, due);
+    int64_t deadline_us = next_deadline();
+    sleepUntil_us = deadline_us;
+    taskEXIT_CRITICAL(&wheel_lock);
+
+    // Delivered outside of the lock, callbacks may re-arm timers
+    for (int i = 0; i < count; i++) {
+      if (due[i].callback != NULL) {
+        due[i].callback(due[i].arg);
+      } else if (due[i].task != NULL) {
+        xTaskNotify(due[i].task, due[i].bits, eSetBits);
+      }
+    }
+    if (count > 0) {
+      continue;  // Callbacks take time, look again before sleeping
+    }
+
+    // Sleep until the next deadline, rounded up so the wake-up is never early
+    TickType_t ticks = portMAX_DELAY;
+    if (deadline_us != INT64_MAX) {
+      int64_t tick_us = (int64_t) portTICK_PERIOD_MS * 1000;
+      int64_t remaining_us = deadline_us - hal_time_us();
+      ticks = remaining_us <= 0 ? 0 : (TickType_t) ((remaining_us + tick_us - 1) / tick_us);
+    }
+    if (ticks > 0) {
+      ulTaskNotifyTake(pdTRUE, ticks);
+    }
+  }
+}
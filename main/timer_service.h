@@ -0,0 +1,112 @@
+/**
+  ******************************************************************************
+  * @authors        : Tomas Gonzalez & Brian Morris
+  * @file           : timer_service.h
+  * @brief          : Header for the timer service, one timing wheel serving
+  *                   every one-shot and periodic deadline of the firmware
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 Tomas Gonzalez & Brian Morris
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  */
+
+#ifndef TIMER_SERVICE_H
+#define TIMER_SERVICE_H
+
+/* Includes ------------------------------------------------------------ */
+#include <cstdint>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+/* Defines ------------------------------------------------------------- */
+#define TIMER_SERVICE_TICK_MS  10  // Wheel resolution, one FreeRTOS tick
+#define TIMER_SERVICE_SLOTS    64  // One turn is 640 ms, longer timers wait for their round
+#define TIMER_SERVICE_MAX      32  // Registrations, one bit each in a slot mask
+#define TIMER_INVALID          -1
+
+/* Structs ------------------------------------------------------------- */
+typedef int timer_id_t;
+typedef void (*TimerCallback)(void *arg);
+
+/**
+ * @brief Delivery lateness of one timer, measured against its exact deadline
+ */
+struct TimerStats {
+  const char *name;
+  uint32_t fires;
+  uint32_t overruns;   /**< Periods skipped because a delivery came a whole period late */
+  int64_t lateSum_us;
+  int64_t lateMax_us;
+};
+
+/* Public API ---------------------------------------------------------- */
+/**
+ * @brief Initialize the wheel, must be called before creating timers
+ */
+void timer_service_init();
+
+/**
+ * @brief Fires the due timers, sleeping until the next deadline in between
+ */
+void timer_service_task(void *arg);
+
+/**
+ * @brief Register a timer that calls a function on the timer service task
+ * @details Callbacks must be short and must not block, they delay every other timer
+ * @param name Static string, shown in the stats
+ * @param callback Function to call
+ * @param arg Passed to the callback
+ * @return Timer ID, TIMER_INVALID if every slot is taken
+ */
+timer_id_t timer_service_create_callback(const char *name, TimerCallback callback, void *arg);
+
+/**
+ * @brief Register a timer that sets notification bits of a task
+ * @param name Static string, shown in the stats
+ * @param task Task to notify
+ * @param bits Bits set with eSetBits
+ * @return Timer ID, TIMER_INVALID if every slot is taken
+ */
+timer_id_t timer_service_create_notify(const char *name, TaskHandle_t task, uint32_t bits);
+
+/**
+ * @brief Arm a timer once, re-arming moves its deadline, safe from any task
+ * @param id Timer ID
+ * @param delay_ms Time from now
+ * @return true if armed
+ */
+bool timer_service_start_once(timer_id_t id, uint32_t delay_ms);
+
+/**
+ * @brief Arm a timer every period_ms, the first time one period from now, safe from any task
+ * @param id Timer ID
+ * @param period_ms Period, deadlines do not drift with delivery lateness
+ * @return true if armed
+ */
+bool timer_service_start_periodic(timer_id_t id, uint32_t period_ms);
+
+/**
+ * @brief Disarm a timer, safe from any task
+ * @param id Timer ID
+ */
+void timer_service_stop(timer_id_t id);
+
+/**
+ * @brief Lateness of a timer since boot
+ * @param id Timer ID
+ * @param stats Output stats
+ * @return true if the ID is valid
+ */
+bool timer_service_get_stats(timer_id_t id, TimerStats *stats);
+
+/**
+ * @brief Log the mean and worst lateness of every timer
+ */
+void timer_service_log_stats();
+
+#endif /* TIMER_SERVICE_H */
@@ -18,10 +18,14 @@
 
 /* Includes ------------------------------------------------------------------*/
 #include "uart.h"
+#include "driver/uart.h"
 #include "esp_log.h"
 /* Private variables ---------------------------------------------------------*/
 static uint8_t rx_buff[2][UART_RX_BUFF_SIZE + 1];
 
+static const char *UART_TAG = "UART";
+static QueueHandle_t rx_events[2];
+
 static const uint8_t ports[2] = {
   UART1_PORT_NUM,
   UART2_PORT_NUM
@@ -44,12 +48,12 @@ void uart_init(void) {
 #endif
 
   /* Initialize UART1 */
-  ESP_ERROR_CHECK(uart_driver_install(UART1_PORT_NUM, UART_RX_BUFF_SIZE * 2, 0, 0, NULL, intr_alloc_flags));
+  ESP_ERROR_CHECK(uart_driver_install(UART1_PORT_NUM, UART_RX_BUFF_SIZE * 2, 0, UART_EVENT_QUEUE_LEN, &rx_events[UART_PORT_MAIN], intr_alloc_flags));
   ESP_ERROR_CHECK(uart_param_config(UART1_PORT_NUM, &uart_config));
   ESP_ERROR_CHECK(uart_set_pin(UART1_PORT_NUM, UART1_TXD, UART1_RXD, UART_RTS, UART_CTS));
 
   /* Initialize UART2 */
-  ESP_ERROR_CHECK(uart_driver_install(UART2_PORT_NUM, UART_RX_BUFF_SIZE * 2, 0, 0, NULL, intr_alloc_flags));
+  ESP_ERROR_CHECK(uart_driver_install(UART2_PORT_NUM, UART_RX_BUFF_SIZE * 2, 0, UART_EVENT_QUEUE_LEN, &rx_events[UART_PORT_AUX], intr_alloc_flags));
   ESP_ERROR_CHECK(uart_param_config(UART2_PORT_NUM, &uart_config));
   ESP_ERROR_CHECK(uart_set_pin(UART2_PORT_NUM, UART2_TXD, UART2_RXD, UART_RTS, UART_CTS));
 }
@@ -64,6 +68,26 @@ uint16_t uart_receive(UartPort_t portIndex) {
   return uart_read_bytes(port, rx_buff[portIndex], UART_RX_BUFF_SIZE, 2);
 }
 
+bool uart_wait_rx(UartPort_t portIndex, TickType_t wait) {
+  uart_event_t event;
+  while (xQueueReceive(rx_events[portIndex], &event, wait) == pdTRUE) {
+    switch (event.type) {
+      case UART_DATA:
+        return true;
+      case UART_FIFO_OVF:
+      case UART_BUFFER_FULL:
+        // The driver stops receiving until the buffer is emptied, the partial line is lost anyway
+        ESP_LOGW(UART_TAG, "Port %d overflow, flushing", portIndex);
+        uart_flush_input(ports[portIndex]);
+        xQueueReset(rx_events[portIndex]);
+        break;
+      default:
+        break;
+    }
+  }
+  return false;
+}
+
 uint8_t* uart_get_rx_buff(UartPort_t portIndex) {
   return rx_buff[portIndex];
 }
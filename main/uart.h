@@ -25,9 +25,12 @@ extern "C" {
 #endif
 
 /* Includes ------------------------------------------------------------------*/
-#include "driver/uart.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
 
 /* Macros --------------------------------------------------------------------*/
+// The driver is only included by uart.c, the host build brings its own UART
 #define UART1_PORT_NUM       UART_NUM_1
 #define UART1_TXD             17
 #define UART1_RXD             16
@@ -43,6 +46,7 @@ extern "C" {
 #define UART_TASK_STACK_SIZE 2048
 
 #define UART_RX_BUFF_SIZE    128
+#define UART_EVENT_QUEUE_LEN 10
 
 /* Structs -------------------------------------------------------------------*/
 typedef enum {
@@ -57,6 +61,14 @@ void uart_send(const char *data, uint16_t length, UartPort_t port);
 
 uint16_t uart_receive(UartPort_t port);
 
+/**
+ * @brief Block until the driver reports received bytes
+ * @param port Port to wait on
+ * @param wait Ticks to wait, portMAX_DELAY for ever
+ * @return true if bytes are ready for uart_receive()
+ */
+bool uart_wait_rx(UartPort_t port, TickType_t wait);
+
 uint8_t* uart_get_rx_buff(UartPort_t port);
 
 #ifdef __cplusplus
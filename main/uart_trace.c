@@ -0,0 +1,356 @@
+/**
+  ******************************************************************************
+  * @authors        : Tomas Gonzalez & Brian Morris
+  * @file           : uart_trace.c
+  * @brief          : Capture of the raw radio UART bytes into a flash
+  *                   partition, exported over MQTT and replayed on the host
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 Tomas Gonzalez & Brian Morris
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  */
+
+/* Includes ------------------------------------------------------------ */
+#include "uart_trace.h"
+
+#include <stdio.h>
+#include <string.h>
+#include "esp_log.h"
+#include "hal/hal.h"
+#include "freertos/FreeRTOS.h"
+
+/* Defines ------------------------------------------------------------- */
+#define VARINT_MAX_LEN   10
+#define FLUSH_CHUNK      256
+#define BASE64_LEN(n)    (((n) + 2) / 3 * 4)
+
+/* Private variables ----------------------------------------------------- */
+static const char *UART_TRACE_TAG = "UART_TRACE";
+static const char base64_chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// Shared with the RX tasks, guarded by stage_lock
+static uint8_t stage[UART_TRACE_STAGING_SIZE];
+static uint32_t stage_head = 0;  // Next byte to stage, RX tasks
+static uint32_t stage_tail = 0;  // Next byte to write to flash, drain task
+static bool capturing = false;
+static bool header_pending = false;  // The drain task starts the partition over
+static uint32_t generation = 0;      // Bumped by every start, a flush racing it drops its chunk
+static int64_t start_us = 0;
+static int64_t last_us = 0;
+static uint32_t records = 0;
+static uint32_t dropped = 0;
+static portMUX_TYPE stage_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Drain task only, read by the coordinator once the capture is stopped and flushed
+static volatile uint32_t write_offset = 0;
+static uint32_t erased_end = 0;
+static volatile bool full = false;
+
+// Coordinator task only
+static bool exporting = false;
+static uint32_t export_offset = 0;
+
+/* Private functions ----------------------------------------------------- */
+static size_t put_varint(uint8_t *out, uint64_t value) {
+  size_t length = 0;
+  do {
+    uint8_t byte = value & 0x7F;
+    value >>= 7;
+    out[length++] = byte | (value != 0 ? 0x80 : 0);
+  } while (value != 0);
+  return length;
+}
+
+// Must hold stage_lock, the ring always has room for the byte
+static void stage_byte(uint8_t byte) {
+  stage[stage_head % UART_TRACE_STAGING_SIZE] = byte;
+  stage_head++;
+}
+
+static bool write_flash(const uint8_t *data, size_t length) {
+  size_t size = hal_trace_size();
+  if (write_offset + length > size) {
+    // Keep what fits, the decoder stops at the truncated record
+    length = size - write_offset;
+    full = true;
+  }
+  while (erased_end < write_offset + length) {
+    if (!hal_trace_erase(erased_end, HAL_TRACE_SECTOR_SIZE)) {
+      return false;
+    }
+    erased_end += HAL_TRACE_SECTOR_SIZE;
+  }
+  if (length > 0 && !hal_trace_write(write_offset, data, length)) {
+    return false;
+  }
+  write_offset += length;
+  return !full;
+}
+
+static bool write_header(int64_t time_us) {
+  uint8_t header[UART_TRACE_HEADER_SIZE] = {0};
+  memcpy(header, UART_TRACE_MAGIC, 4);
+  header[4] = UART_TRACE_VERSION;
+  for (int i = 0; i < 8; i++) {
+    header[8 + i] = (uint8_t) ((uint64_t) time_us >> (8 * i));
+  }
+  write_offset = 0;
+  erased_end = 0;
+  full = false;
+  return write_flash(header, sizeof(header));
+}
+
+static size_t base64_encode(const uint8_t *data, size_t length, char *out) {
+  size_t pos = 0;
+  for (size_t i = 0; i < length; i += 3) {
+    uint32_t block = (uint32_t) data[i] << 16;
+    if (i + 1 < length) block |= (uint32_t) data[i + 1] << 8;
+    if (i + 2 < length) block |= data[i + 2];
+    out[pos++] = base64_chars[(block >> 18) & 0x3F];
+    out[pos++] = base64_chars[(block >> 12) & 0x3F];
+    out[pos++] = i + 1 < length ? base64_chars[(block >> 6) & 0x3F] : '=';
+    out[pos++] = i + 2 < length ? base64_chars[block & 0x3F] : '=';
+  }
+  out[pos] = '\0';
+  return pos;
+}
+
+/* Public functions ----------------------------------------------------- */
+bool uart_trace_start(void) {
+  if (hal_trace_size() == 0) {
+    return false;
+  }
+  exporting = false;
+  int64_t now_us = hal_time_us();
+
+  taskENTER_CRITICAL(&stage_lock);
+  stage_head = 0;
+  stage_tail = 0;
+  start_us = now_us;
+  last_us = now_us;
+  records = 0;
+  dropped = 0;
+  generation++;
+  header_pending = true;
+  full = false;
+  capturing = true;
+  taskEXIT_CRITICAL(&stage_lock);
+
+  ESP_LOGI(UART_TRACE_TAG, "Capture started, %zu bytes of flash", hal_trace_size());
+  return true;
+}
+
+void uart_trace_stop(void) {
+  taskENTER_CRITICAL(&stage_lock);
+  bool was_capturing = capturing;
+  capturing = false;
+  taskEXIT_CRITICAL(&stage_lock);
+
+  if (was_capturing) {
+    ESP_LOGI(UART_TRACE_TAG, "Capture stopped, %lu records", (unsigned long) records);
+  }
+}
+
+void uart_trace_record(uint8_t port, const uint8_t *data, size_t length, int64_t time_us) {
+  if (!capturing || length == 0) {
+    return;
+  }
+  size_t chunks = (length + UART_TRACE_MAX_RECORD - 1) / UART_TRACE_MAX_RECORD;
+  size_t worst = length + chunks * (1 + VARINT_MAX_LEN);
+
+  taskENTER_CRITICAL(&stage_lock);
+  if (!capturing || full) {
+    taskEXIT_CRITICAL(&stage_lock);
+    return;
+  }
+  if (UART_TRACE_STAGING_SIZE - (stage_head - stage_tail) < worst) {
+    dropped++;
+    taskEXIT_CRITICAL(&stage_lock);
+    return;
+  }
+
+  // Both RX tasks read the clock before taking the lock, never go back in time
+  uint64_t delta_us = time_us > last_us ? (uint64_t) (time_us - last_us) : 0;
+  last_us += (int64_t) delta_us;
+  for (size_t offset = 0; offset < length; offset += UART_TRACE_MAX_RECORD) {
+    size_t chunk = length - offset < UART_TRACE_MAX_RECORD ? length - offset : UART_TRACE_MAX_RECORD;
+    uint8_t varint[VARINT_MAX_LEN];
+    size_t varint_length = put_varint(varint, offset == 0 ? delta_us : 0);
+
+    stage_byte((uint8_t) ((port & 1) << 7 | chunk));
+    for (size_t i = 0; i < varint_length; i++) {
+      stage_byte(varint[i]);
+    }
+    for (size_t i = 0; i < chunk; i++) {
+      stage_byte(data[offset + i]);
+    }
+    records++;
+  }
+  taskEXIT_CRITICAL(&stage_lock);
+}
+
+void uart_trace_flush(void) {
+  static uint32_t reported_dropped = 0;
+  uint8_t chunk[FLUSH_CHUNK];
+
+  taskENTER_CRITICAL(&stage_lock);
+  bool restart = header_pending;
+  int64_t header_us = start_us;
+  header_pending = false;
+  taskEXIT_CRITICAL(&stage_lock);
+  if (restart) {
+    reported_dropped = 0;
+    write_header(header_us);
+  }
+
+  while (!full) {
+    taskENTER_CRITICAL(&stage_lock);
+    uint32_t copied_generation = generation;
+    size_t length = stage_head - stage_tail;
+    if (length > sizeof(chunk)) {
+      length = sizeof(chunk);
+    }
+    for (size_t i = 0; i < length; i++) {
+      chunk[i] = stage[(stage_tail + i) % UART_TRACE_STAGING_SIZE];
+    }
+    taskEXIT_CRITICAL(&stage_lock);
+    if (length == 0) {
+      break;
+    }
+
+    // Flash is slow, the RX tasks keep staging meanwhile
+    bool written = write_flash(chunk, length);
+    taskENTER_CRITICAL(&stage_lock);
+    bool restarted = generation != copied_generation;
+    if (!restarted) {
+      stage_tail += length;
+    }
+    taskEXIT_CRITICAL(&stage_lock);
+    if (restarted) {
+      break;  // The next flush writes the new header first
+    }
+    if (!written) {
+      // Whatever is still staged has no room left, let the export start
+      taskENTER_CRITICAL(&stage_lock);
+      stage_tail = stage_head;
+      taskEXIT_CRITICAL(&stage_lock);
+      uart_trace_stop();
+      ESP_LOGW(UART_TRACE_TAG, "Capture stopped, %s", full ? "trace partition full" : "flash write failed");
+      break;
+    }
+  }
+
+  uint32_t total_dropped = dropped;
+  if (total_dropped != reported_dropped) {
+    ESP_LOGW(UART_TRACE_TAG, "%lu reads dropped, staging full", (unsigned long) (total_dropped - reported_dropped));
+    reported_dropped = total_dropped;
+  }
+}
+
+void uart_trace_get_stats(uart_trace_stats_t *stats) {
+  taskENTER_CRITICAL(&stage_lock);
+  stats->active = capturing;
+  stats->records = records;
+  stats->dropped = dropped;
+  taskEXIT_CRITICAL(&stage_lock);
+  stats->full = full;
+  stats->bytes = write_offset;
+}
+
+bool uart_trace_export_begin(void) {
+  taskENTER_CRITICAL(&stage_lock);
+  bool settled = !capturing && !header_pending && stage_head == stage_tail;
+  taskEXIT_CRITICAL(&stage_lock);
+  if (!settled || write_offset < UART_TRACE_HEADER_SIZE) {
+    return false;
+  }
+  exporting = true;
+  export_offset = 0;
+  return true;
+}
+
+bool uart_trace_export_step(size_t max_chunks) {
+  static uint8_t raw[UART_TRACE_EXPORT_CHUNK];
+  static char payload[16 + BASE64_LEN(UART_TRACE_EXPORT_CHUNK) + 1];
+
+  if (!exporting) {
+    return false;
+  }
+  // Dropped while offline, wait for the broker instead of leaving a hole
+  if (!hal_publish_connected()) {
+    return true;
+  }
+
+  uint32_t end = write_offset;
+  for (size_t sent = 0; sent < max_chunks; sent++) {
+    if (export_offset >= end) {
+      snprintf(payload, sizeof(payload), "%lu END", (unsigned long) end);
+      hal_publish(UART_TRACE_TOPIC, payload, false);
+      exporting = false;
+      ESP_LOGI(UART_TRACE_TAG, "Export done, %lu bytes", (unsigned long) end);
+      return false;
+    }
+    size_t length = end - export_offset < UART_TRACE_EXPORT_CHUNK ? end - export_offset : UART_TRACE_EXPORT_CHUNK;
+    if (!hal_trace_read(export_offset, raw, length)) {
+      exporting = false;
+      return false;
+    }
+    int prefix = snprintf(payload, sizeof(payload), "%lu ", (unsigned long) export_offset);
+    base64_encode(raw, length, payload + prefix);
+    hal_publish(UART_TRACE_TOPIC, payload, false);
+    export_offset += length;
+  }
+  return true;
+}
+
+bool uart_trace_decode(const uint8_t *trace, size_t size, size_t *pos, uart_trace_record_t *record) {
+  if (size < UART_TRACE_HEADER_SIZE || memcmp(trace, UART_TRACE_MAGIC, 4) != 0 ||
+      trace[4] != UART_TRACE_VERSION) {
+    return false;
+  }
+  if (*pos == 0) {
+    uint64_t time = 0;
+    for (int i = 0; i < 8; i++) {
+      time |= (uint64_t) trace[8 + i] << (8 * i);
+    }
+    record->time_us = (int64_t) time;
+    *pos = UART_TRACE_HEADER_SIZE;
+  }
+
+  size_t at = *pos;
+  if (at >= size) {
+    return false;
+  }
+  uint8_t length = trace[at] & 0x7F;
+  if (length == 0 || length > UART_TRACE_MAX_RECORD) {
+    return false;  // 0xFF is erased flash, the end of the trace
+  }
+  uint8_t port = trace[at++] >> 7;
+
+  uint64_t delta_us = 0;
+  for (int shift = 0;; shift += 7) {
+    if (at >= size || shift >= 64) {
+      return false;
+    }
+    uint8_t byte = trace[at++];
+    delta_us |= (uint64_t) (byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0) {
+      break;
+    }
+  }
+  if (at + length > size) {
+    return false;
+  }
+
+  record->port = port;
+  record->length = length;
+  record->time_us += (int64_t) delta_us;
+  record->data = trace + at;
+  *pos = at + length;
+  return true;
+}
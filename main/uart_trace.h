@@ -0,0 +1,125 @@
+/**
+  ******************************************************************************
+  * @authors        : Tomas Gonzalez & Brian Morris
+  * @file           : uart_trace.h
+  * @brief          : Capture of the raw radio UART bytes into a flash
+  *                   partition, exported over MQTT and replayed on the host
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 Tomas Gonzalez & Brian Morris
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef UART_TRACE_H
+#define UART_TRACE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------ */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Trace layout, little endian:
+ * - Header: "UTRC", version, 3 reserved bytes, int64 start time in us
+ * - Records: one byte port << 7 | length (1 to 126), a LEB128 varint with the
+ *   microseconds since the previous record, then the bytes as read
+ * - Erased flash ends the trace, 0xFF is never a valid first record byte
+ *
+ * The RX tasks stage records in RAM in constant time, the log drain task
+ * writes them to flash. Capture stops by itself when the partition is full.
+ */
+
+/* Defines ------------------------------------------------------------------- */
+#define UART_TRACE_MAGIC         "UTRC"
+#define UART_TRACE_VERSION       1
+#define UART_TRACE_HEADER_SIZE   16
+#define UART_TRACE_MAX_RECORD    126   // Longer reads are split, the rest follows 0 us later
+#define UART_TRACE_STAGING_SIZE  4096  // RAM between the RX tasks and flash
+#define UART_TRACE_EXPORT_CHUNK  768   // Raw bytes per export message, 1 KB of base64
+#define UART_TRACE_TOPIC         "livestock/cu/trace"
+
+/* Types --------------------------------------------------------------------- */
+typedef struct {
+  bool active;
+  bool full;           // Capture stopped at the end of the partition
+  uint32_t bytes;      // Trace size in flash, header included
+  uint32_t records;
+  uint32_t dropped;    // Records lost because the staging buffer was full
+} uart_trace_stats_t;
+
+typedef struct {
+  uint8_t port;
+  uint8_t length;
+  int64_t time_us;     // Start time of the trace plus the deltas so far
+  const uint8_t *data;
+} uart_trace_record_t;
+
+/* Public functions ---------------------------------------------------------- */
+/**
+ * @brief Start a new capture, the previous trace is overwritten
+ * @return false if there is no trace partition
+ */
+bool uart_trace_start(void);
+
+/**
+ * @brief Stop capturing, staged records still reach flash on the next flush
+ */
+void uart_trace_stop(void);
+
+/**
+ * @brief Record bytes read from a radio, constant time, safe from any task
+ * @param port: Radio the bytes came from
+ * @param data: Bytes as read
+ * @param length: Number of bytes
+ * @param time_us: Time of the read
+ */
+void uart_trace_record(uint8_t port, const uint8_t *data, size_t length, int64_t time_us);
+
+/**
+ * @brief Write staged records to flash, call from a low priority task only
+ */
+void uart_trace_flush(void);
+
+/**
+ * @brief Counters of the current or last capture
+ */
+void uart_trace_get_stats(uart_trace_stats_t *stats);
+
+/**
+ * @brief Start publishing the trace on UART_TRACE_TOPIC
+ * @return false while capturing or flushing, or when there is no trace
+ */
+bool uart_trace_export_begin(void);
+
+/**
+ * @brief Publish the next chunks of an export as "<offset> <base64>", then "<offset> END"
+ * @param max_chunks: Upper bound of messages published by this call
+ * @return true while the export has more to publish
+ */
+bool uart_trace_export_step(size_t max_chunks);
+
+/**
+ * @brief Decode the next record of a trace
+ * @param trace: Whole trace, header included
+ * @param size: Size of the trace
+ * @param pos: Offset of the next record, 0 to start, advanced on success
+ * @param record: Decoded record, data points into trace, pass the same one to every call
+ * @return false at the end of the trace or on a malformed record
+ */
+bool uart_trace_decode(const uint8_t *trace, size_t size, size_t *pos, uart_trace_record_t *record);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* UART_TRACE_H */
@@ -17,7 +17,10 @@
 /* Includes -------------------------------------------------------------- */
 #include "MQTTClient.h"
 
+#include <string.h>
 #include "display/status.h"
+#include "tasks/server_connection.h"
+#include "command_queue.h"
 #include "mqtt_api.h"
 #include "esp_log.h"
 
@@ -34,27 +37,41 @@ piral::MQTTClient::MQTTClient(const char *broker_uri, const char *client_id)
 void piral::MQTTClient::on_connected(const esp_mqtt_event_handle_t) {
   ESP_LOGI(MQTT_TAG, "MQTT connected ✅");
   mqtt_api_set_connected(true);
-  update_mqtt_status((char *)"Online");
-  publish_data("piral/ecu/online", {"true"});
+  server_connection_notify();
+  update_mqtt_status(STATUS_LINK_ONLINE);
+  publish_data("piral/ecu/online", "true");
   
   // Publish CU connection status to central
   publish_data("central", CONNECTED_MESSAGE);
   ESP_LOGI(MQTT_TAG, "Published CU connection status to central topic");
+
+  // Listen for downlink commands from the backend
+  esp_mqtt_client_subscribe_single(handler.get(), MQTT_CU_COMMAND_TOPIC, 1);
 }
 
 void piral::MQTTClient::on_data(const esp_mqtt_event_handle_t evt) {
-  ESP_LOGI(MQTT_TAG, "RX %.*s → %.*s", evt->topic_len, evt->topic, evt->data_len, evt->data);
+  size_t topic_len = strlen(MQTT_CU_COMMAND_TOPIC);
+  if (evt->topic_len != (int) topic_len || memcmp(evt->topic, MQTT_CU_COMMAND_TOPIC, topic_len) != 0) {
+    return;
+  }
+
+  // Commands are tiny, a fragmented payload is not a valid command
+  Command command = {};
+  if (evt->current_data_offset != 0 || evt->data_len != evt->total_data_len ||
+      !parse_command(evt->data, evt->data_len, &command)) {
+    mqtt_api_publish_reply(command.correlation_id, "ERR PARSE");
+    return;
+  }
+
+  // Never block the MQTT event task, reject when the owner falls behind
+  if (!post_command(&command)) {
+    mqtt_api_publish_reply(command.correlation_id, "ERR BUSY");
+  }
 }
 
 void piral::MQTTClient::on_disconnected(const esp_mqtt_event_handle_t) {
   ESP_LOGW(MQTT_TAG, "MQTT disconnected ❌");
   mqtt_api_set_connected(false);
-  update_mqtt_status((char *)"Offline");
-}
-
-inline void piral::MQTTClient::publish_data(const std::string &topic, const std::string &data) {
-  publish(topic, data.begin(), data.end(),
-    idf::mqtt::QoS::AtLeastOnce,
-    idf::mqtt::Retain::NotRetained
-  );
+  server_connection_notify();
+  update_mqtt_status(STATUS_LINK_OFFLINE);
 }
@@ -32,6 +32,7 @@ class MQTTClient : public idf::mqtt::Client {
       esp_mqtt_client_config_t c{};
       c.broker.address.uri    = uri;
       c.credentials.client_id = id;
+      c.network.disable_auto_reconnect = true; // Paced by the connectivity supervisor
       return c;
     }
 
@@ -39,14 +40,15 @@ class MQTTClient : public idf::mqtt::Client {
     /**
      * @brief Called when MQTT client connects to broker
      * @param evt MQTT event handle (unused)
-     * @details Publishes online status message when connection established
+     * @details Publishes online status message and subscribes to the command topic
      */
     void on_connected(const esp_mqtt_event_handle_t) override;
 
     /**
      * @brief Called when MQTT message is received
      * @param evt MQTT event handle containing topic and payload data
-     * @details Logs received message topic and payload
+     * @details Parses commands on MQTT_CU_COMMAND_TOPIC in place and queues them
+     *          for the task that owns the LSUManager, never blocking
      */
     void on_data(const esp_mqtt_event_handle_t evt) override;
 
@@ -72,8 +74,38 @@ class MQTTClient : public idf::mqtt::Client {
       }
     }
 
-    /* helper for the rest of the firmware */
-    inline void publish_data(const std::string &topic, const std::string &data);
+    inline void reconnect() {
+      if (handler) {
+        esp_mqtt_client_reconnect(handler.get());
+      }
+    }
+
+    /**
+     * @brief Publishes a null-terminated payload without copying topic or data
+     * @param topic Null-terminated topic, must stay valid during the call
+     * @param data Null-terminated payload
+     * @param retain Whether the broker keeps it for new subscribers
+     */
+    inline void publish_data(const char *topic, const char *data, bool retain = false) {
+      if (handler) {
+        esp_mqtt_client_publish(handler.get(), topic, data, 0, 1, retain ? 1 : 0);
+      }
+    }
+
+    /**
+     * @brief Copies a null-terminated payload to the outbox, the client task sends it
+     * @details Returns at once, publish_data() waits for the socket
+     * @param topic Null-terminated topic
+     * @param data Null-terminated payload
+     * @param retain Whether the broker keeps it for new subscribers
+     * @return false if the outbox is full
+     */
+    inline bool enqueue_data(const char *topic, const char *data, bool retain = false) {
+      if (!handler) {
+        return false;
+      }
+      return esp_mqtt_client_enqueue(handler.get(), topic, data, 0, 1, retain ? 1 : 0, true) >= 0;
+    }
 };
 
 } /* namespace piral */
@@ -18,6 +18,7 @@
 #include "mqtt_api.h"
 #include "MQTTClient.h"
 #include "esp_log.h"
+#include <stdio.h>
 
 /* Defines --------------------------------------------------------------- */
 static const char *MQTT_API_TAG = "MQTT_API";
@@ -42,12 +43,39 @@ void mqtt_api_deinit() {
   mqtt_connected = false;
 }
 
+void mqtt_api_reconnect() {
+  if (mqtt == nullptr) {
+    mqtt_api_init();
+    return;
+  }
+  mqtt->reconnect();
+}
+
 void mqtt_api_publish(const char *topic, const char *payload) {
   if (!mqtt_connected) return;
   ESP_LOGI(MQTT_API_TAG, "Publishing message to topic: %s", topic);
   mqtt->publish_data(topic, payload);
 }
 
+void mqtt_api_enqueue(const char *topic, const char *payload, bool retained) {
+  if (!mqtt_connected) return;
+  if (!mqtt->enqueue_data(topic, payload, retained)) {
+    ESP_LOGW(MQTT_API_TAG, "Outbox full, message to %s dropped", topic);
+  }
+}
+
+void mqtt_api_publish_retained(const char *topic, const char *payload) {
+  if (!mqtt_connected) return;
+  ESP_LOGI(MQTT_API_TAG, "Publishing retained message to topic: %s", topic);
+  mqtt->publish_data(topic, payload, true);
+}
+
+void mqtt_api_publish_reply(uint32_t correlation_id, const char *result) {
+  char reply[MQTT_REPLY_MAX_LEN];
+  snprintf(reply, sizeof(reply), "%lu %s", correlation_id, result);
+  mqtt_api_enqueue(MQTT_CU_REPLY_TOPIC, reply, false);
+}
+
 bool mqtt_api_is_connected() {
   return mqtt_connected;
 }
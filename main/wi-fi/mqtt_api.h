@@ -18,17 +18,53 @@
 #ifndef MQTT_API_H
 #define MQTT_API_H
 
+/* Includes -------------------------------------------------------------- */
+#include <stdint.h>
+
 /* Defines --------------------------------------------------------------- */
 #define MQTT_BROKER_IP "172.24.255.70"
 #define MQTT_BROKER_PORT "1883"
 
+#define MQTT_CU_COMMAND_TOPIC "livestock/cu/cmd"
+#define MQTT_CU_REPLY_TOPIC "livestock/cu/reply"
+#define MQTT_REPLY_MAX_LEN 128
+
 /* Function declarations ----------------------------------------------------*/
 void mqtt_api_init();
 
 void mqtt_api_deinit();
 
+/**
+ * @brief Starts the client if needed, otherwise forces a new connection attempt
+ */
+void mqtt_api_reconnect();
+
 void mqtt_api_publish(const char *topic, const char *payload);
 
+/**
+ * @brief Queues a message for the client task without waiting for the socket
+ * @details For the coroutine executor, which must not block on the network
+ * @param topic Topic
+ * @param payload Null-terminated payload, copied
+ * @param retained Whether the broker keeps it for new subscribers
+ */
+void mqtt_api_enqueue(const char *topic, const char *payload, bool retained);
+
+/**
+ * @brief Publishes a message the broker keeps and hands to every new subscriber
+ * @param topic Topic
+ * @param payload Null-terminated payload
+ */
+void mqtt_api_publish_retained(const char *topic, const char *payload);
+
+/**
+ * @brief Publishes a command reply as "<correlation_id> <result>" on the reply topic
+ * @details Queued like mqtt_api_enqueue(), safe from the MQTT event task and the executor
+ * @param correlation_id ID received with the command
+ * @param result Result text, truncated to fit MQTT_REPLY_MAX_LEN
+ */
+void mqtt_api_publish_reply(uint32_t correlation_id, const char *result);
+
 bool mqtt_api_is_connected();
 
 void mqtt_api_set_connected(bool connected);
@@ -15,6 +15,7 @@
   */
 
 #include "wifi.h"
+#include <string.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/event_groups.h"
 #include "esp_wifi.h"
@@ -22,31 +23,99 @@
 #include "esp_log.h"
 #include "esp_timer.h"
 
+#include "wifi_nvs.h"
 #include "display/status.h"
 
 static const char *WIFI_TAG = "Wi-Fi";
 static EventGroupHandle_t wifi_event_group;
 static esp_netif_t *sta_netif = NULL;
 
-static int deadline_us = -1;
+static wifi_config_t wifi_config = {
+  .sta = {
+    .threshold.authmode = WIFI_AUTH_WPA2_PSK,
+    .pmf_cfg = {
+      .capable = true,
+      .required = false
+    },
+  },
+};
+static bool provisioned = false;
+static bool fast_connect_active = false;
+static bool fast_connect_got_ip = false;
+static wifi_timing_t timing = {0};
+
+static void apply_fast_connect(const wifi_fast_connect_t *cache) {
+  // Directed connect: skip the scan of every channel
+  memcpy(wifi_config.sta.bssid, cache->bssid, sizeof(cache->bssid));
+  wifi_config.sta.bssid_set = true;
+  wifi_config.sta.channel = cache->channel;
+  wifi_config.sta.scan_method = WIFI_FAST_SCAN;
+
+  // The address still comes from DHCP after association, a cached lease run
+  // as a static IP outlives its expiry and may clash on the network
+  fast_connect_active = true;
+  ESP_LOGI(WIFI_TAG, "Fast connect on channel %u", cache->channel);
+}
+
+static void fall_back_to_full_scan(void) {
+  ESP_LOGW(WIFI_TAG, "Fast connect failed, falling back to full scan");
+  fast_connect_active = false;
+  if (!fast_connect_got_ip) {
+    wifi_nvs_clear_fast_connect(); // The cache never worked, drop it
+  }
+
+  wifi_config.sta.bssid_set = false;
+  wifi_config.sta.channel = 0;
+  wifi_config.sta.scan_method = WIFI_ALL_CHANNEL_SCAN;
+  esp_wifi_set_config(WIFI_IF_STA, &wifi_config);
+}
+
+static void save_fast_connect(void) {
+  wifi_ap_record_t ap_info;
+  if (esp_wifi_sta_get_ap_info(&ap_info) != ESP_OK) {
+    return;
+  }
+
+  wifi_fast_connect_t cache = {0};
+  memcpy(cache.bssid, ap_info.bssid, sizeof(cache.bssid));
+  cache.channel = ap_info.primary;
+  wifi_nvs_store_fast_connect(&cache);
+}
 
 static void wifi_event_handler(void* arg, esp_event_base_t event_base, int32_t event_id, void* event_data) {
   ESP_LOGI(WIFI_TAG, "Event: %s, ID: %ld", event_base, event_id);
+  int64_t now_us = esp_timer_get_time();
   if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_START) {
-    esp_wifi_connect();
+    timing.started_us = now_us;
+    if (provisioned) {
+      esp_wifi_connect();
+    }
+  } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_CONNECTED) {
+    if (timing.associated_us == 0) {
+      timing.associated_us = now_us;
+    }
   } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED) {
-    update_wifi_status("Offline");
+    update_wifi_status(STATUS_LINK_OFFLINE);
+    xEventGroupClearBits(wifi_event_group, WIFI_CONNECTED_BIT);
     wifi_event_sta_disconnected_t *disc = (wifi_event_sta_disconnected_t*) event_data;
     ESP_LOGW("Wi-Fi", "Disconnected, reason=%d", disc->reason);
-    if (esp_timer_get_time() < deadline_us) {
-      esp_wifi_connect();
-      ESP_LOGI(WIFI_TAG, "Retrying connection…");
+    if (fast_connect_active) {
+      fall_back_to_full_scan();
     }
+    // Retries are paced by the connectivity supervisor
     return;
   } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
     ip_event_got_ip_t* event = event_data;
     ESP_LOGI(WIFI_TAG, "Got IP: " IPSTR, IP2STR(&event->ip_info.ip));
-    update_wifi_status("Online");
+    if (timing.got_ip_us == 0) {
+      timing.got_ip_us = now_us;
+    }
+    if (fast_connect_active) {
+      fast_connect_got_ip = true;
+    } else {
+      save_fast_connect();
+    }
+    update_wifi_status(STATUS_LINK_ONLINE);
     xEventGroupSetBits(wifi_event_group, WIFI_CONNECTED_BIT);
   } else {
     ESP_LOGW(WIFI_TAG, "Unknown event: %s, ID: %ld", event_base, event_id);
@@ -54,6 +123,7 @@ static void wifi_event_handler(void* arg, esp_event_base_t event_base, int32_t e
 }
 
 void wifi_init_sta(void) {
+  timing.init_us = esp_timer_get_time();
   ESP_ERROR_CHECK(esp_netif_init());
   wifi_event_group = xEventGroupCreate();
   ESP_ERROR_CHECK(esp_event_loop_create_default());
@@ -64,19 +134,24 @@ void wifi_init_sta(void) {
   ESP_ERROR_CHECK(esp_wifi_init(&cfg));
   ESP_ERROR_CHECK(esp_event_handler_register(WIFI_EVENT, ESP_EVENT_ANY_ID, &wifi_event_handler, NULL));
   ESP_ERROR_CHECK(esp_event_handler_register(IP_EVENT, IP_EVENT_STA_GOT_IP, &wifi_event_handler, NULL));
+  // Our own NVS records are the source of truth, keep the driver copy in RAM
   ESP_ERROR_CHECK(esp_wifi_set_storage(WIFI_STORAGE_RAM));
 
-  wifi_config_t wifi_config = {
-    .sta = {
-      .ssid = "Brimix",
-      .password = "Holis420",
-      .threshold.authmode = WIFI_AUTH_WPA2_PSK,
-      .pmf_cfg = {
-        .capable = true,
-        .required = false
-      },
-    },
-  };
+  wifi_prov_record_t record;
+  provisioned = wifi_nvs_load_prov(&record);
+  if (provisioned) {
+    strncpy((char *) wifi_config.sta.ssid, record.ssid, sizeof(wifi_config.sta.ssid));
+    strncpy((char *) wifi_config.sta.password, record.password, sizeof(wifi_config.sta.password));
+
+    wifi_fast_connect_t cache;
+    if (wifi_nvs_load_fast_connect(&cache)) {
+      apply_fast_connect(&cache);
+    }
+  } else {
+    ESP_LOGE(WIFI_TAG, "Not provisioned, write " WIFI_NVS_SSID_KEY "/" WIFI_NVS_PASSWORD_KEY " to NVS namespace " WIFI_NVS_NAMESPACE);
+    update_wifi_status(STATUS_LINK_NO_CREDENTIALS);
+  }
+  timing.fast_connect = fast_connect_active;
 
   ESP_LOGI(WIFI_TAG, "Setting WiFi configuration SSID %s...", wifi_config.sta.ssid);
   ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
@@ -86,12 +161,11 @@ void wifi_init_sta(void) {
   ESP_LOGI(WIFI_TAG, "wifi_init_sta finished.");
 }
 
-void wifi_start(uint32_t timeout_ms) {
-  // Use esp_timer_get_time() for absolute timeout
-  int64_t start_time_us = esp_timer_get_time();
-  int64_t timeout_us = (int64_t)timeout_ms * 1000;
-  deadline_us = start_time_us + timeout_us;
+void wifi_get_timing(wifi_timing_t *out) {
+  *out = timing;
+}
 
+bool wifi_wait_connected(uint32_t timeout_ms) {
   TickType_t timeout_ticks = (timeout_ms == 0) ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
   
   EventBits_t bits = xEventGroupWaitBits(
@@ -104,9 +178,39 @@ void wifi_start(uint32_t timeout_ms) {
   
   if (bits & WIFI_CONNECTED_BIT) {
     ESP_LOGI(WIFI_TAG, "We are online 🎉");
-    update_wifi_status("Online");
-  } else {
-    ESP_LOGE(WIFI_TAG, "We are offline 💀");
-    update_wifi_status("Offline");
+    return true;
+  }
+  ESP_LOGE(WIFI_TAG, "We are offline 💀");
+  return false;
+}
+
+bool wifi_is_connected(void) {
+  return (xEventGroupGetBits(wifi_event_group) & WIFI_CONNECTED_BIT) != 0;
+}
+
+void wifi_reconnect(void) {
+  if (!provisioned) {
+    ESP_LOGW(WIFI_TAG, "Not provisioned, not connecting");
+    return;
+  }
+  ESP_LOGI(WIFI_TAG, "Retrying connection…");
+  esp_wifi_disconnect();
+  if (fast_connect_active && !fast_connect_got_ip) {
+    fall_back_to_full_scan();
+  }
+  esp_wifi_connect();
+}
+
+bool wifi_abandon_fast_connect(void) {
+  if (!fast_connect_active) {
+    return false;
   }
+  // Associated and addressed but the broker is out of reach, likely the wrong AP
+  ESP_LOGW(WIFI_TAG, "No broker behind the cached AP, dropping the fast-connect cache");
+  xEventGroupClearBits(wifi_event_group, WIFI_CONNECTED_BIT);
+  esp_wifi_disconnect();
+  fast_connect_got_ip = false;
+  fall_back_to_full_scan();
+  esp_wifi_connect();
+  return true;
 }
@@ -23,23 +23,66 @@ extern "C" {
 #endif
 
 /* Includes -------------------------------------------------------------- */
+#include <stdbool.h>
+#include <stdint.h>
 #include "esp_event.h"
 
 /* Defines --------------------------------------------------------------- */
 #define WIFI_CONNECTED_BIT BIT0
 
+/* Structs --------------------------------------------------------------- */
+/**
+ * @brief Timestamps (esp_timer, us since boot) of the first connection
+ */
+typedef struct {
+  int64_t init_us;        /**< wifi_init_sta entered */
+  int64_t started_us;     /**< Driver started (STA_START) */
+  int64_t associated_us;  /**< Associated to the AP (STA_CONNECTED) */
+  int64_t got_ip_us;      /**< IP available from DHCP */
+  bool fast_connect;      /**< Cached BSSID and channel were used */
+} wifi_timing_t;
+
 /* Functions ------------------------------------------------------------- */
 
 /**
  * @brief Wifi init
+ * @details Credentials come from the provisioning record in NVS. When a
+ *          fast-connect cache exists the station connects to the cached
+ *          BSSID and channel without a scan, and falls back to a full scan
+ *          if that fails. The address always comes from DHCP.
  */
 void wifi_init_sta(void);
 
 /**
- * @brief Wifi start
+ * @brief Get the timestamps of the first connection
+ * @param timing: Output timestamps, zero when not reached yet
+ */
+void wifi_get_timing(wifi_timing_t *timing);
+
+/**
+ * @brief Wait until the station has an IP
  * @param timeout_ms: Timeout in milliseconds (0 for no timeout)
+ * @return true if connected before the timeout
+ */
+bool wifi_wait_connected(uint32_t timeout_ms);
+
+/**
+ * @brief Check if the station currently has an IP
+ * @return true if connected
+ */
+bool wifi_is_connected(void);
+
+/**
+ * @brief Drop the current association attempt and start a new one
+ */
+void wifi_reconnect(void);
+
+/**
+ * @brief Give up on a fast connect that reached the AP but not the broker
+ * @details Erases the cache and reconnects with a full scan
+ * @return true if a fast connect was active and has been dropped
  */
-void wifi_start(uint32_t timeout_ms);
+bool wifi_abandon_fast_connect(void);
 
 #ifdef __cplusplus
 }
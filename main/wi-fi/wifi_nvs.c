@@ -0,0 +1,126 @@
+/**
+  ******************************************************************************
+  * @authors        : Tomas Gonzalez & Brian Morris
+  * @file           : wifi_nvs.c
+  * @brief          : NVS records for Wi-Fi provisioning and fast-connect cache
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 Tomas Gonzalez & Brian Morris
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  */
+
+/* Includes -------------------------------------------------------------- */
+#include "wifi_nvs.h"
+
+#include <string.h>
+#include "esp_log.h"
+#include "nvs.h"
+
+/* Private variables ----------------------------------------------------- */
+static const char *WIFI_NVS_TAG = "Wi-Fi NVS";
+
+/* Functions ------------------------------------------------------------- */
+bool wifi_nvs_load_prov(wifi_prov_record_t *record) {
+  nvs_handle_t nvs_handle;
+  esp_err_t err = nvs_open(WIFI_NVS_NAMESPACE, NVS_READONLY, &nvs_handle);
+  if (err != ESP_OK) {
+    ESP_LOGE(WIFI_NVS_TAG, "No provisioning record: %s", esp_err_to_name(err));
+    return false;
+  }
+
+  size_t ssid_len = sizeof(record->ssid);
+  size_t password_len = sizeof(record->password);
+  err = nvs_get_str(nvs_handle, WIFI_NVS_SSID_KEY, record->ssid, &ssid_len);
+  if (err == ESP_OK) {
+    err = nvs_get_str(nvs_handle, WIFI_NVS_PASSWORD_KEY, record->password, &password_len);
+  }
+  nvs_close(nvs_handle);
+
+  if (err != ESP_OK) {
+    ESP_LOGE(WIFI_NVS_TAG, "Error reading provisioning record: %s", esp_err_to_name(err));
+    return false;
+  }
+  return true;
+}
+
+bool wifi_nvs_store_prov(const char *ssid, const char *password) {
+  nvs_handle_t nvs_handle;
+  esp_err_t err = nvs_open(WIFI_NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
+  if (err != ESP_OK) {
+    ESP_LOGE(WIFI_NVS_TAG, "Error opening NVS handle: %s", esp_err_to_name(err));
+    return false;
+  }
+
+  err = nvs_set_str(nvs_handle, WIFI_NVS_SSID_KEY, ssid);
+  if (err == ESP_OK) {
+    err = nvs_set_str(nvs_handle, WIFI_NVS_PASSWORD_KEY, password);
+  }
+  // New credentials invalidate the cached association
+  if (err == ESP_OK) {
+    nvs_erase_key(nvs_handle, WIFI_NVS_FAST_KEY);
+    err = nvs_commit(nvs_handle);
+  }
+  nvs_close(nvs_handle);
+
+  if (err != ESP_OK) {
+    ESP_LOGE(WIFI_NVS_TAG, "Error storing provisioning record: %s", esp_err_to_name(err));
+    return false;
+  }
+  return true;
+}
+
+bool wifi_nvs_load_fast_connect(wifi_fast_connect_t *cache) {
+  nvs_handle_t nvs_handle;
+  esp_err_t err = nvs_open(WIFI_NVS_NAMESPACE, NVS_READONLY, &nvs_handle);
+  if (err != ESP_OK) {
+    return false;
+  }
+
+  size_t size = sizeof(*cache);
+  err = nvs_get_blob(nvs_handle, WIFI_NVS_FAST_KEY, cache, &size);
+  nvs_close(nvs_handle);
+  return err == ESP_OK && size == sizeof(*cache);
+}
+
+bool wifi_nvs_store_fast_connect(const wifi_fast_connect_t *cache) {
+  wifi_fast_connect_t stored;
+  if (wifi_nvs_load_fast_connect(&stored) && memcmp(&stored, cache, sizeof(stored)) == 0) {
+    return true; // Unchanged, spare the flash
+  }
+
+  nvs_handle_t nvs_handle;
+  esp_err_t err = nvs_open(WIFI_NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
+  if (err != ESP_OK) {
+    ESP_LOGE(WIFI_NVS_TAG, "Error opening NVS handle: %s", esp_err_to_name(err));
+    return false;
+  }
+
+  err = nvs_set_blob(nvs_handle, WIFI_NVS_FAST_KEY, cache, sizeof(*cache));
+  if (err == ESP_OK) {
+    err = nvs_commit(nvs_handle);
+  }
+  nvs_close(nvs_handle);
+
+  if (err != ESP_OK) {
+    ESP_LOGE(WIFI_NVS_TAG, "Error storing fast-connect cache: %s", esp_err_to_name(err));
+    return false;
+  }
+  ESP_LOGI(WIFI_NVS_TAG, "Fast-connect cache updated (channel %u)", cache->channel);
+  return true;
+}
+
+void wifi_nvs_clear_fast_connect(void) {
+  nvs_handle_t nvs_handle;
+  if (nvs_open(WIFI_NVS_NAMESPACE, NVS_READWRITE, &nvs_handle) != ESP_OK) {
+    return;
+  }
+  if (nvs_erase_key(nvs_handle, WIFI_NVS_FAST_KEY) == ESP_OK) {
+    nvs_commit(nvs_handle);
+  }
+  nvs_close(nvs_handle);
+}
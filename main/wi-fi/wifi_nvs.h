@@ -0,0 +1,92 @@
+/**
+  ******************************************************************************
+  * @authors        : Tomas Gonzalez & Brian Morris
+  * @file           : wifi_nvs.h
+  * @brief          : NVS records for Wi-Fi provisioning and fast-connect cache
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 Tomas Gonzalez & Brian Morris
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  */
+
+/* Define to prevent recursive inclusion --------------------------------- */
+#ifndef WIFI_NVS_H
+#define WIFI_NVS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes -------------------------------------------------------------- */
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Defines --------------------------------------------------------------- */
+#define WIFI_NVS_NAMESPACE      "wifi"
+#define WIFI_NVS_SSID_KEY       "prov_ssid"
+#define WIFI_NVS_PASSWORD_KEY   "prov_pass"
+#define WIFI_NVS_FAST_KEY       "fast_conn"
+
+/* Structs --------------------------------------------------------------- */
+/**
+ * @brief Credentials written at provisioning time
+ */
+typedef struct {
+  char ssid[33];      /**< Null terminated, up to 32 chars */
+  char password[65];  /**< Null terminated, up to 64 chars */
+} wifi_prov_record_t;
+
+/**
+ * @brief Last good association, used for a directed connect
+ */
+typedef struct {
+  uint8_t bssid[6];
+  uint8_t channel;
+} wifi_fast_connect_t;
+
+/* Functions ------------------------------------------------------------- */
+
+/**
+ * @brief Load the provisioning record
+ * @param record: Output record
+ * @return true if both SSID and password were found
+ */
+bool wifi_nvs_load_prov(wifi_prov_record_t *record);
+
+/**
+ * @brief Store the provisioning record
+ * @param ssid: Network SSID
+ * @param password: Network password
+ * @return true if stored successfully
+ */
+bool wifi_nvs_store_prov(const char *ssid, const char *password);
+
+/**
+ * @brief Load the fast-connect cache
+ * @param cache: Output cache
+ * @return true if a cache was found
+ */
+bool wifi_nvs_load_fast_connect(wifi_fast_connect_t *cache);
+
+/**
+ * @brief Store the fast-connect cache, skipping the flash write if unchanged
+ * @param cache: Cache to store
+ * @return true if the stored cache matches
+ */
+bool wifi_nvs_store_fast_connect(const wifi_fast_connect_t *cache);
+
+/**
+ * @brief Erase the fast-connect cache so the next boot does a full scan
+ */
+void wifi_nvs_clear_fast_connect(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WIFI_NVS_H */